@@ -0,0 +1,81 @@
+/**
+ * IntelliCPP Batch Marshalling Benchmark
+ * Per-query cost of the N-API boundary: getSuggestions called once per query
+ * (one JS object per result, code copied from a JS string each call) against
+ * getSuggestionsBatch for batches of 1, 16 and 256 queries (one packed
+ * ArrayBuffer per batch, code passed as a Buffer and read in place).
+ * Batched results are decoded fully, so both sides produce the same records.
+ *
+ *   node bench_batch.js [queries]
+ */
+
+const native = require('./src/native/nativeEngine');
+const { SuggestionBatch } = require('./src/native/suggestionBatch');
+
+const QUERIES = parseInt(process.argv[2], 10) || 20000;
+const BATCH_SIZES = [1, 16, 256];
+
+if (!native.engine) {
+  console.log(`Native engine unavailable (${native.loadError}): run \`npm run build:native\` first.`);
+  process.exit(0);
+}
+
+const engine = native.engine;
+const source = [
+  '#include <vector>',
+  '#include <string>',
+  'using namespace std;',
+  'int main() {',
+  '  vector<int> nums;',
+  '  string name;',
+  '  // ' + 'padding '.repeat(512),
+  '  nums.p'
+].join('\n');
+const sourceBuffer = Buffer.from(source);
+const cursor = sourceBuffer.length;
+
+const session = engine.openSession();
+engine.updateSession(session, source);
+
+const CASES = [
+  { prefix: 'p', contextType: '' },
+  { prefix: 'app', contextType: 'name' },
+  { prefix: 'wh', contextType: '' },
+  { prefix: 'e', contextType: 'nums' }
+];
+
+function perQuery(label, run) {
+  for (let i = 0; i < QUERIES / 10;) i += run(i); // Warm up
+  const start = process.hrtime.bigint();
+  let results = 0;
+  for (let i = 0; i < QUERIES;) i += run(i, n => { results += n; });
+  const ns = Number(process.hrtime.bigint() - start) / QUERIES;
+  console.log(`${label.padEnd(28)} ${ns.toFixed(0).padStart(6)} ns/query  (${(results / QUERIES).toFixed(1)} results/query)`);
+}
+
+console.log(`${QUERIES} queries, ${source.length} bytes of source\n`);
+
+perQuery('getSuggestions (per query)', (i, count) => {
+  const c = CASES[i % CASES.length];
+  const out = engine.getSuggestions(c.prefix, c.contextType, source, cursor, 10);
+  if (count) count(out.length);
+  return 1;
+});
+
+for (const size of BATCH_SIZES) {
+  const queries = Array.from({ length: size }, (_, i) => ({
+    session,
+    ...CASES[i % CASES.length],
+    cursor,
+    code: sourceBuffer
+  }));
+  perQuery(`getSuggestionsBatch (${size})`, (i, count) => {
+    const batch = new SuggestionBatch(engine.getSuggestionsBatch(queries, 10));
+    let n = 0;
+    for (let q = 0; q < batch.queryCount; q++) n += batch.results(q).length;
+    if (count) count(n);
+    return size;
+  });
+}
+
+engine.closeSession(session);
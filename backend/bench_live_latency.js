@@ -0,0 +1,118 @@
+/**
+ * IntelliCPP Liveness Latency Benchmark
+ * Measures GET /live while compiles run through the native engine's worker
+ * pool. The server runs in a child process; this process polls /live first
+ * on an idle server, then with 8 runCodeAsync compiles in flight, and with
+ * --sync also with the same compiles issued through the blocking runCode.
+ *
+ *   node bench_live_latency.js [--sync]
+ */
+
+const http = require('http');
+const { spawn } = require('child_process');
+
+const COMPILES = 8;
+const IDLE_MS = 2000;
+
+function program(i) {
+  return [
+    '#include <bits/stdc++.h>',
+    'int main() {',
+    '  std::map<int, std::vector<std::string>> m;',
+    `  for (int i = 0; i < ${1000 + i}; ++i) m[i % 7].push_back(std::to_string(i));`,
+    '  std::cout << m.size() << std::endl;',
+    '}',
+    ''
+  ].join('\n');
+}
+
+// Child: serve the app and run compiles on request
+if (process.argv[2] === '--serve') {
+  const app = require('./server');
+  const native = require('./src/native/nativeEngine');
+  const server = app.listen(0, '127.0.0.1', () => {
+    process.send({ port: server.address().port, native: Boolean(native.engine) });
+  });
+  process.on('message', async ({ mode }) => {
+    const start = Date.now();
+    let failures = 0;
+    if (mode === 'async') {
+      const results = await Promise.all(
+        Array.from({ length: COMPILES }, (_, i) => native.engine.runCodeAsync(program(i))));
+      failures = results.filter(r => !JSON.parse(r).success).length;
+    } else {
+      for (let i = 0; i < COMPILES; i++) {
+        // Let queued /live requests through between the blocking calls
+        await new Promise(resolve => setImmediate(resolve));
+        if (!JSON.parse(native.engine.runCode(program(i))).success) failures++;
+      }
+    }
+    process.send({ done: true, ms: Date.now() - start, failures });
+  });
+  process.on('disconnect', () => server.close());
+  return;
+}
+
+function probe(port) {
+  return new Promise((resolve, reject) => {
+    const start = process.hrtime.bigint();
+    http.get({ host: '127.0.0.1', port, path: '/live' }, (res) => {
+      res.resume();
+      res.on('end', () => resolve(Number(process.hrtime.bigint() - start) / 1e6));
+    }).on('error', reject);
+  });
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+function report(label, latencies, extra = '') {
+  latencies.sort((a, b) => a - b);
+  console.log(`${label.padEnd(26)} n=${String(latencies.length).padEnd(5)} ` +
+    `p50 ${percentile(latencies, 0.5).toFixed(2)} ms  p99 ${percentile(latencies, 0.99).toFixed(2)} ms  ` +
+    `max ${latencies[latencies.length - 1].toFixed(2)} ms${extra}`);
+}
+
+// Poll /live back to back until done() reports true
+async function poll(port, done) {
+  const latencies = [];
+  while (!done()) {
+    latencies.push(await probe(port));
+  }
+  return latencies;
+}
+
+async function underLoad(child, port, mode) {
+  let finished = null;
+  child.once('message', msg => { finished = msg; });
+  child.send({ mode });
+  const latencies = await poll(port, () => finished !== null);
+  return { latencies, finished };
+}
+
+(async () => {
+  const child = spawn(process.execPath, [__filename, '--serve'], {
+    stdio: ['ignore', 'ignore', 'inherit', 'ipc']
+  });
+  const { port, native } = await new Promise(resolve => child.once('message', resolve));
+  if (!native) {
+    console.log('Native engine unavailable: run `npm run build:native` first.');
+    child.kill();
+    return;
+  }
+
+  console.log(`GET /live latency, ${COMPILES} compiles in flight\n`);
+  const idleUntil = Date.now() + IDLE_MS;
+  report('idle', await poll(port, () => Date.now() > idleUntil));
+
+  const runs = [['runCodeAsync (worker pool)', 'async']];
+  if (process.argv.includes('--sync')) runs.push(['runCode (blocking)', 'sync']);
+  for (const [label, mode] of runs) {
+    const { latencies, finished } = await underLoad(child, port, mode);
+    report(label, latencies, `  (compiles took ${finished.ms} ms, ${finished.failures} failed)`);
+  }
+
+  child.disconnect();
+  child.kill();
+})();
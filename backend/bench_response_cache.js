@@ -0,0 +1,121 @@
+/**
+ * Response Cache Benchmark
+ * The POST /api/getSuggestions cache hit path and memory per entry, with
+ * the JavaScript LRUCache (src/cache/lruCache.js) as the native route used
+ * it: a sha1 of the code in the key and a JSON.stringify of the cached
+ * records on every hit. With the addon built, the same for the native
+ * response cache (engine.completeJson), whose hits are the serialized body.
+ * codeflow_bench_engine measures the native side without Node.
+ *
+ *   node --expose-gc bench_response_cache.js [entries]
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+const { LRUCache } = require('./src/cache/lruCache');
+const native = require('./src/native/nativeEngine');
+
+const ENTRIES = parseInt(process.argv[2], 10) || 2000;
+const HITS = 20000;
+
+// The 200-line document codeflow_bench_engine's completeJson benchmarks use
+function syntheticSource(lines) {
+  let code = '#include <algorithm>\n#include <iostream>\n#include <map>\n#include <string>\n' +
+    '#include <vector>\nusing namespace std;\n\nvector<int> values;\n';
+  for (let f = 0, line = 8; line < lines; ++f, line += 12) {
+    code += `// Fills and sorts batch ${f}\n` +
+      `int process${f}(vector<int>& items${f}) {\n` +
+      `  map<string, int> counts${f};\n` +
+      '  for (int i = 0; i < 16; ++i) {\n' +
+      `    items${f}.push_back(i * ${f} % 7);\n` +
+      `    counts${f}["key" + to_string(i)] += i;\n` +
+      '  }\n' +
+      `  sort(items${f}.begin(), items${f}.end());\n` +
+      `  auto it = lower_bound(items${f}.begin(), items${f}.end(), 3);\n` +
+      `  cout << "batch ${f}: " << counts${f}.size() << endl;\n` +
+      `  return it == items${f}.end() ? 0 : *it;\n` +
+      '}\n';
+  }
+  return code;
+}
+
+const CODE = syntheticSource(200);
+
+// Member completions of `values.`, as the route returns them
+function records() {
+  if (native.engine) return native.engine.complete('', 'values', CODE, 20);
+  const vector = JSON.parse(fs.readFileSync(path.join(__dirname, 'data/stl/vector.json'), 'utf8'));
+  return vector.methods.slice(0, 20).map(m => ({
+    text: m.name,
+    display: `${m.name}()`,
+    type: 'method',
+    doc: m.doc,
+    sig: m.sig,
+    complexity: m.complexity,
+    container: 'vector',
+    header: 'vector',
+    score: 80
+  }));
+}
+
+function nsPerOp(op) {
+  for (let i = 0; i < HITS / 10; i++) op(i);
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < HITS; i++) op(i);
+  return Number(process.hrtime.bigint() - start) / HITS;
+}
+
+function heapUsed() {
+  if (global.gc) { global.gc(); global.gc(); }
+  return process.memoryUsage().heapUsed;
+}
+
+function jsCache() {
+  const template = records();
+  const cache = new LRUCache({ capacity: ENTRIES, ttlMs: 5 * 60 * 1000 });
+  const keyOf = (prefix) => {
+    const digest = crypto.createHash('sha1').update(CODE).digest('base64');
+    return `sug:native:cpp:prefix:values:${prefix}:${digest}`;
+  };
+
+  const before = heapUsed();
+  for (let i = 0; i < ENTRIES; i++) {
+    // Fresh strings per entry, as each native complete() call returns
+    cache.set(keyOf(`p${i}`), JSON.parse(JSON.stringify(template)));
+  }
+  const perEntry = (heapUsed() - before) / ENTRIES;
+
+  let bytes = 0;
+  const ns = nsPerOp(i => {
+    bytes = JSON.stringify(cache.get(keyOf(`p${i % ENTRIES}`))).length;
+  });
+  return { ns, perEntry, bytes };
+}
+
+function nativeCache() {
+  const engine = native.engine;
+  for (let i = 0; i < ENTRIES; i++) engine.completeJson('cpp', `p${i}`, 'values', CODE, 20);
+  const { bytes: charged, entries } = engine.getResponseCacheStats();
+
+  let bytes = 0;
+  const ns = nsPerOp(i => {
+    bytes = engine.completeJson('cpp', `p${i % ENTRIES}`, 'values', CODE, 20).body.length;
+  });
+  return { ns, perEntry: charged / entries, bytes };
+}
+
+function report(name, { ns, perEntry, bytes }) {
+  console.log(`${name.padEnd(28)} ${(ns / 1000).toFixed(2).padStart(9)} µs ` +
+              `${Math.round(perEntry).toString().padStart(9)} B ${String(bytes).padStart(9)} B`);
+}
+
+if (!global.gc) console.log('(run with --expose-gc for steady heap numbers)');
+console.log(`${ENTRIES} entries of 20 member completions; ${HITS} hits over a ${CODE.length}-byte document\n`);
+console.log(`${'cache'.padEnd(28)} ${'hit'.padStart(12)} ${'per entry'.padStart(11)} ${'body'.padStart(11)}`);
+report('JavaScript LRUCache', jsCache());
+if (native.engine) {
+  report('native response cache', nativeCache());
+} else {
+  console.log(`native response cache        (addon unavailable: ${native.loadError}; see codeflow_bench_engine)`);
+}
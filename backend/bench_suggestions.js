@@ -0,0 +1,119 @@
+/**
+ * IntelliCPP Suggestions Benchmark
+ * Compares POST /api/getSuggestions end to end with the native engine and
+ * with the JavaScript fallback. Each engine runs in its own server process;
+ * every request carries a unique comment so the LRU cache never answers.
+ *
+ *   node bench_suggestions.js [requests]
+ */
+
+const http = require('http');
+const { spawn } = require('child_process');
+
+const REQUESTS = parseInt(process.argv[2], 10) || 2000;
+const WARMUP = 200;
+
+const SOURCE = [
+  '#include <vector>',
+  '#include <queue>',
+  '#include <algorithm>',
+  '#include <string>',
+  'using namespace std;',
+  'int main() {',
+  '  vector<int> nums = {3, 1, 2};',
+  '  priority_queue<int> pq;',
+  '  string name = "x";',
+  '  int total = 0;',
+  ''
+].join('\n');
+
+const CASES = [
+  { prefix: 'pu', contextType: 'nums' },
+  { prefix: 'e', contextType: 'nums' },
+  { prefix: 't', contextType: 'pq' },
+  { prefix: 'sub', contextType: 'name' },
+  { prefix: 'so', contextType: 'global' },
+  { prefix: 't', contextType: 'global' },
+  { prefix: 'vec', contextType: 'include_header' },
+  { prefix: 'in', contextType: 'template_arg' }
+];
+
+function post(port, body) {
+  return new Promise((resolve, reject) => {
+    const data = JSON.stringify(body);
+    const req = http.request({
+      host: '127.0.0.1',
+      port,
+      path: '/api/getSuggestions',
+      method: 'POST',
+      headers: { 'Content-Type': 'application/json', 'Content-Length': Buffer.byteLength(data) }
+    }, (res) => {
+      let text = '';
+      res.on('data', chunk => text += chunk);
+      res.on('end', () => resolve({ engine: res.headers['x-engine'], json: JSON.parse(text) }));
+    });
+    req.on('error', reject);
+    req.end(data);
+  });
+}
+
+function percentile(sorted, p) {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+// Child: serve the app with the engine selected by the environment
+if (process.argv[2] === '--serve') {
+  // The rate limiters would reject a benchmark's worth of requests
+  process.env.RATE_LIMIT_SUGGESTIONS_PER_MIN = '1000000000';
+  process.env.RATE_LIMIT_GLOBAL_API_PER_WINDOW = '1000000000';
+  const app = require('./server');
+  const server = app.listen(0, '127.0.0.1', () => {
+    process.send({ port: server.address().port });
+  });
+  process.on('disconnect', () => server.close());
+  return;
+}
+
+async function measure(label, env) {
+  const child = spawn(process.execPath, [__filename, '--serve'], {
+    env: { ...process.env, ...env },
+    stdio: ['ignore', 'ignore', 'inherit', 'ipc']
+  });
+  const { port } = await new Promise(resolve => child.once('message', resolve));
+
+  const latencies = [];
+  let engine = null;
+  let results = 0;
+  for (let i = 0; i < WARMUP + REQUESTS; i++) {
+    const c = CASES[i % CASES.length];
+    const body = { ...c, code: `${SOURCE}  // ${i}\n}\n` };
+    const start = process.hrtime.bigint();
+    const res = await post(port, body);
+    const elapsedUs = Number(process.hrtime.bigint() - start) / 1000;
+    if (i >= WARMUP) {
+      latencies.push(elapsedUs);
+      results += Array.isArray(res.json) ? res.json.length : 0;
+    }
+    engine = res.engine;
+  }
+  child.disconnect();
+  child.kill();
+
+  latencies.sort((a, b) => a - b);
+  const mean = latencies.reduce((s, v) => s + v, 0) / latencies.length;
+  console.log(`${label.padEnd(12)} engine=${String(engine).padEnd(10)} ` +
+    `mean ${mean.toFixed(1)} µs  p50 ${percentile(latencies, 0.5).toFixed(1)} µs  ` +
+    `p99 ${percentile(latencies, 0.99).toFixed(1)} µs  (${(results / REQUESTS).toFixed(1)} results/request)`);
+  return { engine, mean };
+}
+
+(async () => {
+  console.log(`POST /api/getSuggestions, ${REQUESTS} uncached requests per engine\n`);
+  const js = await measure('javascript', { CODEFLOW_DISABLE_NATIVE: 'true' });
+  const nat = await measure('native', {});
+  if (nat.engine !== 'native') {
+    console.log('\nNative engine unavailable: run `npm run build:native` first.');
+    return;
+  }
+  console.log(`\nNative speedup (mean): ${(js.mean / nat.mean).toFixed(2)}x`);
+})();
@@ -3,10 +3,28 @@
     {
       "target_name": "codeflow_native",
       "sources": [
+        "src/symbol_pool.cpp",
         "src/trie.cpp",
         "src/tokenizer.cpp",
+        "src/fuzzy.cpp",
+        "src/json.cpp",
+        "src/stl_index.cpp",
+        "src/index_file.cpp",
+        "src/scope_index.cpp",
+        "src/document.cpp",
+        "src/session_store.cpp",
+        "src/usage_counts.cpp",
         "src/suggestion_engine.cpp",
+        "src/suggestion_batch.cpp",
         "src/code_runner.cpp",
+        "src/compile_cache.cpp",
+        "src/pch_cache.cpp",
+        "src/subprocess.cpp",
+        "src/run_profile.cpp",
+        "src/thread_pool.cpp",
+        "src/engine_metrics.cpp",
+        "src/response_cache.cpp",
+        "src/workspace_index.cpp",
         "src/binding.cpp"
       ],
       "include_dirs": [
@@ -36,6 +54,43 @@
           }
         ]
       ]
+    },
+    {
+      "target_name": "codeflow_build_index",
+      "type": "executable",
+      "sources": [
+        "tools/build_index.cpp",
+        "src/symbol_pool.cpp",
+        "src/trie.cpp",
+        "src/tokenizer.cpp",
+        "src/fuzzy.cpp",
+        "src/json.cpp",
+        "src/stl_index.cpp",
+        "src/index_file.cpp"
+      ],
+      "include_dirs": ["include"],
+      "cflags_cc": ["-std=c++20", "-O3", "-fexceptions"],
+      "conditions": [
+        [
+          "OS == 'mac'",
+          {
+            "xcode_settings": {
+              "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+              "CLANG_CXX_LANGUAGE_DIALECT": "c++20"
+            }
+          }
+        ]
+      ]
+    },
+    {
+      "target_name": "codeflow_run_profiled",
+      "type": "executable",
+      "sources": [
+        "tools/run_profiled.cpp",
+        "src/run_profile.cpp"
+      ],
+      "include_dirs": ["include"],
+      "cflags_cc": ["-std=c++20", "-O2", "-fexceptions"]
     }
   ]
 }
@@ -33,7 +33,15 @@ const config = {
   EXECUTION_TIMEOUT_MS: parseInt(process.env.EXECUTION_TIMEOUT_MS, 10) || 5000,
   EXECUTION_HARD_KILL_TIMEOUT_MS: parseInt(process.env.EXECUTION_HARD_KILL_TIMEOUT_MS, 10) || 6500,
   COMPILE_TIMEOUT_MS: parseInt(process.env.COMPILE_TIMEOUT_MS, 10) || 15000,
+  // Build policy for languages with sanitizer builds, unless a request sets
+  // X-Execution-Mode: tiered (fast build, sanitizer rebuild after a crash),
+  // fast or sanitized
+  DEFAULT_EXECUTION_MODE: process.env.DEFAULT_EXECUTION_MODE || 'tiered',
   MAX_EXEC_BUFFER_BYTES: 512 * 1024, // 512KB max stdout/stderr buffer
+  // Output kept per job for streaming clients (GET /api/runCode/:jobId as
+  // text/event-stream); a client further behind than this pauses the program
+  STREAM_BUFFER_BYTES: (parseInt(process.env.STREAM_BUFFER_KB, 10) || 64) * 1024,
+  STREAM_HEARTBEAT_MS: parseInt(process.env.STREAM_HEARTBEAT_MS, 10) || 15000,
 
   // Host Execution Resource Limits (ulimits)
   ULIMITS: {
@@ -69,7 +77,7 @@ const config = {
     },
     GLOBAL_API: {
       WINDOW_MS: 15 * 60 * 1000,
-      MAX_PER_WINDOW: 400
+      MAX_PER_WINDOW: parseInt(process.env.RATE_LIMIT_GLOBAL_API_PER_WINDOW, 10) || 400
     }
   },
 
@@ -78,7 +86,40 @@ const config = {
     CXX: process.env.CXX_BIN || 'g++',
     PYTHON: process.env.PYTHON_BIN || 'python3',
     RUSTC: process.env.RUSTC_BIN || 'rustc'
-  }
+  },
+
+  // Native engine worker pool behind the *Async addon methods
+  NATIVE_WORKER_THREADS: parseInt(process.env.NATIVE_WORKER_THREADS, 10) || 4,
+
+  // Serialized native /api/getSuggestions responses, bounded by total size
+  // (bodies and bookkeeping) and age
+  RESPONSE_CACHE_MAX_MB: parseInt(process.env.RESPONSE_CACHE_MAX_MB, 10) || 32,
+  RESPONSE_CACHE_TTL_MS: parseInt(process.env.RESPONSE_CACHE_TTL_MS, 10) || 5 * 60 * 1000,
+
+  // Native index of the C and C++ sources under WORKSPACE_ROOT, followed
+  // with inotify, so completions offer other files' declarations
+  WORKSPACE_INDEX: process.env.WORKSPACE_INDEX !== 'false',
+
+  // Learned completion popularity (POST /api/acceptCompletion), snapshotted
+  // to disk periodically and reloaded at startup
+  USAGE_SNAPSHOT_PATH: process.env.CODEFLOW_USAGE_PATH
+    ? path.resolve(process.env.CODEFLOW_USAGE_PATH)
+    : path.resolve(__dirname, '../dist/codeflow_usage.txt'),
+  USAGE_SNAPSHOT_INTERVAL_MS: parseInt(process.env.USAGE_SNAPSHOT_INTERVAL_MS, 10) || 60 * 1000,
+
+  // Content-addressed cache of build results (binaries and compile errors),
+  // shared by the job queue and the native runner; an empty
+  // COMPILE_CACHE_DIR disables it
+  COMPILE_CACHE_DIR: process.env.COMPILE_CACHE_DIR !== undefined
+    ? process.env.COMPILE_CACHE_DIR
+    : path.join('/tmp', 'intellicpp_compile_cache'),
+  COMPILE_CACHE_MAX_MB: parseInt(process.env.COMPILE_CACHE_MAX_MB, 10) || 256,
+
+  // Precompiled headers for common C++ include sets, built on first use; an
+  // empty PCH_DIR disables them
+  PCH_DIR: process.env.PCH_DIR !== undefined
+    ? process.env.PCH_DIR
+    : path.join('/tmp', 'intellicpp_pch')
 };
 
 module.exports = config;
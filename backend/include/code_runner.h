@@ -1,24 +1,144 @@
 #ifndef CODE_RUNNER_H
 #define CODE_RUNNER_H
 
+#include "compile_cache.h"
+#include "pch_cache.h"
+#include "subprocess.h"
+#include <atomic>
+#include <optional>
 #include <string>
 
+/**
+ * How runCode builds and runs a program. Sanitizer builds (ASan, UBSan and
+ * the debug standard library) find memory errors and undefined behaviour,
+ * but compile and run several times slower than a plain -O1 build.
+ */
+enum class ExecutionMode {
+  Tiered,   // Fast build; rebuilt and re-run with sanitizers if it crashes
+  Fast,     // Fast build only
+  Sanitized // Sanitizer build only
+};
+
+/**
+ * Parse "tiered", "fast" or "sanitized"
+ * @return False, leaving mode as it was, for anything else
+ */
+bool parseExecutionMode(const std::string& name, ExecutionMode& mode);
+
+/**
+ * Outcome of one runCode call. Compile errors and anything that stopped
+ * the program from being built leave stage at "compile" or "setup".
+ */
+struct RunResult {
+  bool success = false;
+  std::string stage = "setup"; // "setup", "compile" or "run"
+  std::string tier = "fast";   // Build that produced the result: "fast" or
+                               // "sanitized"
+  bool escalated = false;      // The fast build crashed, so it was rebuilt
+                               // with sanitizers and run again
+  int fastSignal = 0;          // That crashed the fast build, when escalated
+  std::string output;          // Program stdout
+  std::string error;           // Compiler diagnostics, or program stderr
+  int exitCode = -1;           // Of the program, when it exited normally
+  int signal = 0;              // That ended the program
+  bool timedOut = false;
+  bool truncated = false;      // Program output past 1 MB per stream dropped
+  bool compileCached = false;  // Built earlier; the compiler did not run
+  double compileMs = 0;
+  double wallMs = 0;           // Program run time
+  double cpuMs = 0;            // Program user + system time
+  // Resource usage and hardware counters, once the program has run
+  std::optional<codeflow::RunProfile> profile;
+};
+
 class CodeRunner {
 public:
+  static constexpr const char* kDefaultCacheDirectory = "/tmp/codeflow/cache";
+  static constexpr const char* kDefaultPchDirectory = "/tmp/codeflow/pch";
+
   CodeRunner();
+
+  /**
+   * @param cacheDirectory Where builds are cached by content (see
+   *        CompileCache); empty disables the cache
+   * @param cacheBytes Size budget of the cache
+   * @param pchDirectory Where precompiled headers for common include sets
+   *        are kept (see PchCache); empty disables them
+   */
+  CodeRunner(const std::string& cacheDirectory, std::size_t cacheBytes,
+             const std::string& pchDirectory = kDefaultPchDirectory);
   
   /**
-   * Compile and run C++ code
+   * Compile and run C++ code. Safe to call from many threads at once: each
+   * run gets its own temporary directory, and the compiler and program are
+   * started without a shell by codeflow::runProcess: vfork, then in the
+   * child setpgid, close_range and setrlimit before execvpe, so the limits
+   * hold from the first instruction. A step that fails before exec is
+   * reported back over a close-on-exec pipe and ends the run with that
+   * error, not a signal.
    * @param cppCode Source code to compile and run
-   * @return JSON string with result: {"success":bool, "output":string, "error":string}
+   * @param cancelled Polled throughout; setting it kills the compiler or
+   *        program that is running
+   * @param onOutput Given the program's output as it is printed (see
+   *        codeflow::OutputHandler); the program is then line-buffered,
+   *        so lines arrive as they are written rather than at exit. Of a
+   *        sanitizer re-run, only stderr is passed on.
+   * @param mode Which builds to run; the result is that of the last one
+   */
+  RunResult run(const std::string& cppCode,
+                const std::atomic<bool>* cancelled = nullptr,
+                const codeflow::OutputHandler& onOutput = {},
+                ExecutionMode mode = ExecutionMode::Tiered);
+
+  /**
+   * run() as JSON: {"success":bool, "output":string, "error":string,
+   * "stage":string, "tier":string, "escalated":bool, "fastSignal":int,
+   * "exitCode":int, "signal":int, "timedOut":bool,
+   * "truncated":bool, "compileCached":bool, "compileMs":num, "wallMs":num, "cpuMs":num,
+   * "profile":object|null}, the profile as codeflow::profileJson writes it
    */
-  std::string runCode(const std::string& cppCode);
+  std::string runCode(const std::string& cppCode,
+                      const std::atomic<bool>* cancelled = nullptr,
+                      const codeflow::OutputHandler& onOutput = {},
+                      ExecutionMode mode = ExecutionMode::Tiered);
+
+  /**
+   * Hits and misses of the compile cache; a hit skips the compiler, for
+   * failed builds too
+   */
+  codeflow::CompileCacheStats getCacheStats() const;
+
+  /**
+   * Precompiled header use, with median compile times with and without one
+   * @param sanitized Of the sanitizer builds rather than the fast ones
+   */
+  codeflow::PchStats getPchStats(bool sanitized = false) const;
+
+  /**
+   * Build the precompiled headers ahead of the first compiles that need
+   * them, for fast builds first
+   * @return Number of include sets ready, over both kinds of build
+   */
+  std::size_t warmPrecompiledHeaders();
 
 private:
+  codeflow::CompileCache compileCache;
+  // Each set of flags needs its own precompiled headers
+  codeflow::PchCache fastPch;
+  codeflow::PchCache sanitizedPch;
+
+  /**
+   * Build main.cpp in directory, with or without sanitizers, and run it
+   */
+  RunResult runTier(bool sanitized, const std::string& directory,
+                    const std::string& cppCode,
+                    const std::atomic<bool>* cancelled,
+                    const codeflow::OutputHandler& onOutput);
+
   /**
    * Wrap result in JSON format
    */
-  std::string wrapJson(bool success, const std::string& output, const std::string& error);
+  std::string wrapJson(const RunResult& result);
   
   /**
    * Escape string for JSON
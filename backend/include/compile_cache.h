@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace codeflow {
+
+struct CompileCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+    std::size_t budgetBytes = 0;
+};
+
+// Build results on disk, addressed by what determines them: the source, the
+// compiler's identity and the flags. An entry holds either the program or,
+// for a failed build, the compiler's diagnostics, so resubmitting the same
+// code skips the compiler either way. Entries also keep their inputs, which
+// are compared on every hit, so a hash collision is a miss, not a wrong
+// binary.
+//
+//   <directory>/<key>/inputs       compiler, flags and source
+//   <directory>/<key>/program      or
+//   <directory>/<key>/diagnostics
+//
+// The total size is kept under a budget by evicting the least recently used
+// entries. Entries found on disk at startup are adopted, oldest first by
+// modification time (refreshed on every hit). Thread-safe; compiles happen
+// outside the cache, which only locks around its own file operations.
+class CompileCache {
+public:
+    static constexpr std::size_t kDefaultBudgetBytes = 256 * 1024 * 1024;
+
+    struct Inputs {
+        std::string_view compiler; // Compiler identity, e.g. its --version
+        std::string_view flags;
+        std::string_view source;
+    };
+
+    enum class Result { Miss, Program, Diagnostics };
+
+    // An empty directory disables the cache: every lookup misses and
+    // nothing is stored
+    explicit CompileCache(std::string directory,
+                          std::size_t budgetBytes = kDefaultBudgetBytes);
+    CompileCache(const CompileCache&) = delete;
+    CompileCache& operator=(const CompileCache&) = delete;
+
+    // On Program, the cached binary is linked (or copied) to programPath;
+    // on Diagnostics, diagnostics holds the failed build's output
+    Result lookup(const Inputs& inputs, const std::string& programPath,
+                  std::string& diagnostics);
+
+    // Record a successful build of programPath, or a failed one
+    void storeProgram(const Inputs& inputs, const std::string& programPath);
+    void storeDiagnostics(const Inputs& inputs, std::string_view diagnostics);
+
+    void setBudget(std::size_t budgetBytes);
+    CompileCacheStats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::size_t bytes;
+    };
+
+    std::string directory;
+    std::size_t budgetBytes;
+    mutable std::mutex mutex;
+    std::list<Entry> lru; // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+    std::size_t totalBytes = 0;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t evictions = 0;
+
+    static std::string keyOf(const Inputs& inputs);
+    static std::string serialize(const Inputs& inputs);
+    void adoptExisting();
+    // Move a finished entry directory into place and account for it
+    void publish(const std::string& key, const std::string& staging);
+    void evictOverBudget();
+};
+
+}  // namespace codeflow
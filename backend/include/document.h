@@ -0,0 +1,123 @@
+#pragma once
+
+#include "scope_index.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace codeflow {
+
+// Symbols extracted from one document: variable name -> STL type, plus the
+// headers it includes, and its scopes for resolving "obj." at a cursor
+// (null until indexed).
+struct DocumentSymbols {
+    std::unordered_map<std::string, std::string> symbolTable;
+    std::unordered_set<std::string> includedLibraries;
+    std::shared_ptr<const ScopeIndex> scopes;
+};
+
+// What one span of source contributes to DocumentSymbols, in source order
+struct ExtractedSymbols {
+    std::vector<std::string> includes;
+    std::vector<std::pair<std::string, std::string>> declarations; // {var, type}
+
+    bool empty() const { return includes.empty() && declarations.empty(); }
+};
+
+// Find #include <...> headers and STL container declarations in text.
+// Header names drop a trailing .h or .hpp.
+void extractSymbols(std::string_view text, ExtractedSymbols& out);
+
+// Names declared at the start of each of the first maxLines lines ("int x",
+// "const vector<int>& v", "auto it"), in source order without duplicates.
+// Deliberately loose: it feeds local-variable completion, not type
+// resolution. The views point into text.
+void extractDeclaredNames(std::string_view text, std::vector<std::string_view>& out,
+                          std::size_t maxLines = 200);
+
+// LSP-style edit: replace removedLength bytes at offset with text. Offsets
+// are UTF-8 byte offsets into the document.
+struct TextEdit {
+    std::size_t offset = 0;
+    std::size_t removedLength = 0;
+    std::string text;
+};
+
+// Editable document that remembers what each line contributed, so an edit
+// re-scans only the lines it touches and patches the symbol table in place.
+// Declarations are matched per line: one split across lines
+// ("map<int,\n     string> m;") is not in symbols().symbolTable, though the
+// scope index sees it. When a name is declared more than once the most
+// recently scanned declaration wins (the last one in the file after reset()).
+//
+// Lines are kept in blocks of about kBlockLines that know only their lengths,
+// so an edit costs the lines it touches plus a walk over the blocks, not a
+// pass over every later line. The text stays one contiguous string for
+// text(), so the bytes after the edit are still moved once.
+class Document {
+public:
+    Document();
+
+    // Replace the whole buffer and re-scan every line
+    void reset(std::string_view text);
+
+    // Apply one edit; false (and no change) if it is out of range. Marks
+    // the scope index stale.
+    bool apply(const TextEdit& edit);
+
+    // Scopes of the current text, built on the first call after a reset or
+    // edit: a whole pass, so edits leave it to the lookups that need it.
+    // Safe from concurrent readers, which share one build.
+    std::shared_ptr<const ScopeIndex> scopes() const;
+
+    const DocumentSymbols& symbols() const { return current; }
+    const std::string& text() const { return buffer; }
+    std::size_t lineCount() const { return lines; }
+
+    // Approximate heap footprint, maintained incrementally
+    std::size_t memoryUsage() const;
+
+    static constexpr std::size_t kBlockLines = 128;
+
+private:
+    // Consecutive lines. Lengths count each line's newline; only the last
+    // line of the document has none.
+    struct LineBlock {
+        std::size_t bytes = 0;
+        std::vector<std::size_t> lengths;
+        std::vector<ExtractedSymbols> symbols; // What each line contributed
+    };
+
+    std::string buffer;
+    std::vector<LineBlock> blocks; // Never empty
+    std::size_t lines = 0;
+
+    // Aggregates of all lines, from which `current` is derived
+    std::unordered_map<std::string, unsigned> includeCounts;
+    std::unordered_map<std::string, std::vector<std::string>> declaredTypes;
+    DocumentSymbols current; // Its scopes stay null; see scopes()
+    std::size_t symbolBytes = 0;
+    mutable std::mutex scopesMutex;
+    mutable std::shared_ptr<const ScopeIndex> scopeIndex; // Null when stale
+
+    // The line holding offset: its block, its index there and its first byte
+    struct LinePosition {
+        std::size_t block;
+        std::size_t line;
+        std::size_t start;
+    };
+    LinePosition lineAt(std::size_t offset) const;
+    // Split a block grown past 2 * kBlockLines, or merge a small one with
+    // the next
+    void rebalance(std::size_t block);
+    void addContribution(const ExtractedSymbols& symbols);
+    void removeContribution(const ExtractedSymbols& symbols);
+};
+
+}  // namespace codeflow
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace codeflow {
+
+// Timed stages. Query stages are sampled (see EngineMetrics::sample); the
+// others are timed every time.
+enum class Stage : std::uint8_t {
+    Query,             // A whole suggestion query, as the next four add up
+    ContextResolution, // The type before "." and whether its header is in
+    TrieLookup,        // Keyword completions from the trie
+    Filtering,         // Matching catalogue names against the prefix
+    Ranking,           // Usage boosts, sorting and trimming
+    Marshalling,       // Converting results to JavaScript values
+    Reindex,           // Parsing a document's symbols after a change
+    Compile,           // g++, on a compile cache miss
+    Run,               // The compiled program
+};
+inline constexpr std::size_t kStageCount = 9;
+
+enum class Counter : std::uint8_t {
+    Queries,          // Every query, timed or not
+    CompileCacheHits, // Builds (or diagnostics) reused without g++
+};
+inline constexpr std::size_t kCounterCount = 2;
+
+// Log-linear ("HDR") latency histogram in nanoseconds: one bucket per
+// value below 16 ns, then 8 per power of two, so a recorded value is known
+// to within 12.5%. Values past 2^41 ns (36 minutes) share the last bucket.
+struct LatencyHistogram {
+    static constexpr int kSubBucketBits = 3;
+    static constexpr int kSubBuckets = 1 << kSubBucketBits;
+    static constexpr int kMaxExponent = 40;
+    static constexpr std::size_t kBuckets =
+        kSubBuckets * (kMaxExponent - kSubBucketBits + 2);
+
+    std::array<std::uint64_t, kBuckets> buckets{};
+    std::uint64_t count = 0;
+    std::uint64_t sumNs = 0;
+
+    static std::size_t bucketOf(std::uint64_t ns);
+    // Smallest value above the bucket: all of its values are below this
+    static std::uint64_t bucketLimit(std::size_t bucket);
+
+    // Values below limitNs; exact when limitNs is a power of two
+    std::uint64_t countBelow(std::uint64_t limitNs) const;
+
+    // Highest value of the bucket holding the q quantile (0 < q <= 1);
+    // 0 when empty
+    std::uint64_t quantileNs(double q) const;
+};
+
+// Stage histograms and counters for the whole process, shared by every
+// engine and code runner in it.
+//
+// Recording never locks or waits: each thread writes a shard of its own
+// with relaxed loads and stores (it is the only writer), and readers sum
+// the shards. A thread's shard passes to the next new thread when it
+// exits, so there are as many shards as there were concurrent threads,
+// and totals never go back.
+class EngineMetrics {
+public:
+    // A keyword query takes 120-200 ns, and timing its stages costs about
+    // as much again (clock reads and cold histogram lines), so only a
+    // sample of queries is timed: 1 in 256 keeps that near 1% of the query
+    // (codeflow_bench_engine measures it)
+    static constexpr std::uint32_t kDefaultSampleEvery = 256;
+
+    static EngineMetrics& global() {
+        // Never destroyed: threads may still record while the process exits
+        static EngineMetrics* metrics = new EngineMetrics();
+        return *metrics;
+    }
+
+    EngineMetrics(const EngineMetrics&) = delete;
+    EngineMetrics& operator=(const EngineMetrics&) = delete;
+
+    void record(Stage stage, std::uint64_t ns);
+
+    void add(Counter counter, std::uint64_t n = 1) {
+        if (enabled.load(std::memory_order_relaxed))
+            bump(local().counters[static_cast<std::size_t>(counter)], n);
+    }
+
+    // Whether to time this operation: true for one call in sampleEvery()
+    // on average, at jittered intervals so that periodic callers are not
+    // always or never timed
+    bool sample() {
+        if (!enabled.load(std::memory_order_relaxed))
+            return false;
+        return countDown(local());
+    }
+
+    // add(counter) and sample() with one shard lookup
+    bool tick(Counter counter) {
+        if (!enabled.load(std::memory_order_relaxed))
+            return false;
+        Shard& shard = local();
+        bump(shard.counters[static_cast<std::size_t>(counter)], 1);
+        return countDown(shard);
+    }
+
+    // 0 times no sampled stage at all
+    void setSampleEvery(std::uint32_t every);
+    std::uint32_t sampleEvery() const;
+
+    // Off, nothing is counted or timed (for measuring what metrics cost)
+    void setEnabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+
+    LatencyHistogram histogram(Stage stage) const;
+    std::uint64_t count(Counter counter) const;
+
+    // Prometheus-style names ("trie_lookup") and one-line descriptions
+    static const char* name(Stage stage);
+    static const char* name(Counter counter);
+    static const char* description(Counter counter);
+
+private:
+    struct alignas(64) Shard {
+        struct Histogram {
+            std::atomic<std::uint64_t> sumNs{0};
+            std::array<std::atomic<std::uint64_t>, LatencyHistogram::kBuckets>
+                buckets{};
+        };
+
+        std::atomic<Shard*> next{nullptr};
+        std::atomic<bool> leased{true};
+        std::uint64_t random; // xorshift state; the owner's only
+        // Calls until the next sample; setSampleEvery resets it
+        std::atomic<std::uint32_t> countdown{1};
+        std::array<std::atomic<std::uint64_t>, kCounterCount> counters{};
+        std::array<Histogram, kStageCount> histograms{};
+
+        explicit Shard(std::uint64_t seed) : random(seed | 1) {}
+    };
+
+    static inline thread_local Shard* current = nullptr;
+
+    EngineMetrics() = default;
+
+    Shard& local() { return current ? *current : claim(); }
+    Shard& claim();
+    bool countDown(Shard& shard) {
+        std::uint32_t left = shard.countdown.load(std::memory_order_relaxed);
+        shard.countdown.store(left - 1, std::memory_order_relaxed);
+        return left == 1 && resample(shard);
+    }
+    // Sets the next countdown; whether this call is sampled
+    bool resample(Shard& shard);
+
+    // Single writer, so no read-modify-write is needed
+    static void bump(std::atomic<std::uint64_t>& value, std::uint64_t n) {
+        value.store(value.load(std::memory_order_relaxed) + n,
+                    std::memory_order_relaxed);
+    }
+
+    std::atomic<Shard*> shards{nullptr};
+    std::atomic<std::uint32_t> every{kDefaultSampleEvery};
+    std::atomic<bool> enabled{true};
+};
+
+// Times one operation as `whole`, recorded when the timer goes out of
+// scope, and its consecutive stages with lap(). With laps, the whole ends
+// at the last one, which saves a clock read. An untimed timer reads no
+// clock; pass EngineMetrics::global().sample() to time a sample.
+class StageTimer {
+public:
+    explicit StageTimer(Stage whole, bool timed = true)
+        : whole(whole), timed(timed) {
+        if (timed)
+            start = last = now();
+    }
+    ~StageTimer() {
+        if (timed)
+            EngineMetrics::global().record(whole,
+                                           (lapped ? last : now()) - start);
+    }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+    // Record the time since the previous lap (or the start) as stage
+    void lap(Stage stage) {
+        if (!timed)
+            return;
+        std::uint64_t at = now();
+        EngineMetrics::global().record(stage, at - last);
+        last = at;
+        lapped = true;
+    }
+
+private:
+    static std::uint64_t now() {
+        return static_cast<std::uint64_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+    }
+
+    Stage whole;
+    bool timed;
+    bool lapped = false;
+    std::uint64_t start = 0;
+    std::uint64_t last = 0;
+};
+
+}  // namespace codeflow
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace codeflow {
+
+// Contiguous array that either owns its elements or views read-only memory
+// owned elsewhere (a mapped index file). Reads go through data() either way;
+// edit() copies a viewed array into owned storage first, so a mapped
+// structure can still be modified after loading.
+//
+// Copies share the viewed memory, which must outlive every copy.
+template <typename T>
+class FlatArray {
+public:
+    FlatArray() = default;
+
+    void view(std::span<const T> external) {
+        owned.clear();
+        owned.shrink_to_fit();
+        viewed = external;
+        isView = true;
+    }
+
+    bool isViewed() const { return isView; }
+
+    const T* data() const { return isView ? viewed.data() : owned.data(); }
+    std::size_t size() const { return isView ? viewed.size() : owned.size(); }
+    bool empty() const { return size() == 0; }
+
+    const T& operator[](std::size_t i) const { return data()[i]; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+
+    std::vector<T>& edit() {
+        if (isView) {
+            owned.assign(viewed.begin(), viewed.end());
+            viewed = {};
+            isView = false;
+        }
+        return owned;
+    }
+
+    // Heap bytes owned by this array (viewed memory is not counted)
+    std::size_t memoryUsage() const { return owned.capacity() * sizeof(T); }
+
+private:
+    std::vector<T> owned;
+    std::span<const T> viewed;
+    bool isView = false;
+};
+
+}  // namespace codeflow
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "symbol_pool.h"
+#include "tokenizer.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace codeflow {
+
+// Characters a name contains, one bit per class: a-z (case-folded), 0-9,
+// '_' and one bit for anything else. A name can only match a pattern whose
+// mask is a subset of its own.
+std::uint64_t fuzzyMask(std::string_view text);
+
+// Case-insensitive subsequence pattern, so "pb" matches "push_back" and
+// "emb" matches "emplace_back". Matches are scored by the best alignment:
+// characters at the start of the name or of a snake_case or camelCase word
+// score more, runs of consecutive characters score more, and gaps cost.
+class FuzzyPattern {
+public:
+    // Longer patterns match nothing
+    static constexpr std::size_t kMaxLength = 32;
+
+    explicit FuzzyPattern(std::string_view pattern);
+
+    bool empty() const { return lower.empty(); }
+    std::uint64_t mask() const { return bits; }
+
+    // False if the pattern is not a subsequence of text
+    bool match(std::string_view text, float& score) const;
+
+private:
+    std::string lower;
+    std::uint64_t bits;
+};
+
+struct FuzzyHit {
+    SymbolId symbol;
+    SymbolId type; // "method", "class", "header", "keyword", ...
+    float score;
+};
+
+// Every distinct name of an index with its character mask, stored as
+// columns so the prefilter streams over the masks alone (several per
+// instruction with SSE2 or AVX2) and only survivors are scored.
+class FuzzyIndex {
+public:
+    FuzzyIndex();
+
+    // Replace the contents with (name, type) pairs; a name listed more
+    // than once keeps its first type
+    void assign(const std::vector<std::pair<SymbolId, SymbolId>>& entries);
+
+    // Best maxResults matches, best first: by score, then shorter names,
+    // then alphabetically
+    void search(const FuzzyPattern& pattern, std::size_t maxResults,
+                std::vector<FuzzyHit>& out) const;
+
+    // Entries whose mask contains all bits of mask, in index order
+    void filter(std::uint64_t mask, std::vector<std::uint32_t>& out) const;
+
+    std::size_t size() const { return masks.size(); }
+
+    // Force a level (clamped to what the CPU supports); mainly for testing
+    void setSimdLevel(SimdLevel level);
+
+    std::size_t memoryUsage() const;
+
+private:
+    std::vector<std::uint64_t> masks;
+    std::vector<SymbolId> symbols;
+    std::vector<SymbolId> types;
+    std::vector<std::uint8_t> lengths; // Capped at 255, for tie-breaks
+    SimdLevel level;
+};
+
+}  // namespace codeflow
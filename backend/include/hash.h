@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace codeflow {
+
+// Word-at-a-time multiplicative hash, for index checksums and cache keys.
+// Fast rather than strong: it detects corruption and spreads keys, but is
+// no defence against crafted collisions, so callers that need certainty
+// compare the inputs too.
+inline std::uint64_t hash64(std::string_view data, std::uint64_t seed) {
+    std::uint64_t h = seed ^ data.size();
+    std::size_t i = 0;
+    for (; i + 8 <= data.size(); i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data.data() + i, 8);
+        h = (h ^ word) * 0x9e3779b97f4a7c15ull;
+        h ^= h >> 29;
+    }
+    for (; i < data.size(); ++i)
+        h = (h ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+    return h ^ (h >> 32);
+}
+
+}  // namespace codeflow
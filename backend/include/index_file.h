@@ -0,0 +1,33 @@
+#pragma once
+
+#include "stl_index.h"
+#include <cstdint>
+#include <string>
+
+namespace codeflow {
+
+// Precompiled StlIndex file. The trie pools, catalogue columns and string
+// table are stored exactly as they are laid out in memory, so loading is an
+// mmap plus a checksum and bounds check: nothing is parsed, only the string
+// table is copied, and every process that maps the file shares one
+// page-cache copy of the rest.
+//
+// Layout: IndexFileHeader, a table of IndexSection entries, then each
+// section's array at an 8-byte aligned offset. The checksum covers
+// everything after the header. Files are native-endian and tied to this
+// build's struct layout; both are checked on load.
+constexpr std::uint32_t kIndexFileVersion = 2;
+
+// Write index to path (via a temporary file renamed into place)
+bool writeIndexFile(const StlIndex& index, const std::string& path,
+                    std::string* error = nullptr);
+
+// Map path read-only and make index a view over it. index.storage holds the
+// mapping, which is unmapped once the last index viewing it is destroyed;
+// mapping an unchanged file while it is still mapped reuses the mapping.
+// The string table is copied into the SymbolPool (once per distinct table).
+// On failure index is left untouched.
+bool mapIndexFile(const std::string& path, StlIndex& index,
+                  std::string* error = nullptr);
+
+}  // namespace codeflow
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace codeflow {
+
+// Minimal JSON document model for the data files the engine loads. Objects
+// keep their members in source order; lookups are linear, which is fine for
+// the handful of keys per object in those files.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> items;                          // Array
+    std::vector<std::pair<std::string, JsonValue>> members; // Object
+
+    bool isString() const { return type == Type::String; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    // Member of an object, or nullptr
+    const JsonValue* find(std::string_view key) const;
+
+    // String member of an object, or fallback
+    std::string_view stringOr(std::string_view key, std::string_view fallback = {}) const;
+};
+
+// Parse a complete JSON text. On failure returns false and, if error is
+// given, describes the first problem and its byte offset.
+bool parseJson(std::string_view text, JsonValue& out, std::string* error = nullptr);
+
+// Append value as a JSON string, quoted and escaped as JSON.stringify does
+// (value is UTF-8 and copied through unchanged apart from escapes)
+void appendJsonString(std::string& out, std::string_view value);
+
+// Append value as JSON.stringify formats it: the shortest text that reads
+// back as the same double, or null if it is not finite
+void appendJsonNumber(std::string& out, double value);
+
+}  // namespace codeflow
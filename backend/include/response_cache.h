@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace codeflow {
+
+struct ResponseCacheStats {
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+    std::uint64_t expirations = 0; // Misses on an entry past its TTL
+    std::uint64_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0; // Bodies and their bookkeeping
+    std::size_t budgetBytes = 0;
+    std::int64_t ttlMs = 0;
+};
+
+// 64-bit hash of the fields a response depends on, added in order. Each
+// field is hashed with its length, so ("ab", "c") and ("a", "bc") differ.
+class ResponseKey {
+public:
+    ResponseKey& add(std::string_view field);
+    ResponseKey& add(std::uint64_t value);
+    std::uint64_t hash() const { return state; }
+
+private:
+    std::uint64_t state = 0x6a09e667f3bcc908ull;
+};
+
+// Response bodies ready to send, by ResponseKey hash. Entries expire a TTL
+// after they are stored; least recently used entries are evicted to keep
+// the bodies and their bookkeeping under a byte budget.
+//
+// Lock-striped: the top bits of a key pick one of kShards shards, each with
+// its own lock, LRU list and an equal share of the budget, so lookups on
+// different threads rarely wait for each other. Bodies are immutable and
+// shared; one handed out stays valid after its entry is evicted, so it can
+// be sent without a copy. Keys are not verified: two queries whose keys
+// collide would share a response, which at 64 bits is accepted.
+class ResponseCache {
+public:
+    using Body = std::shared_ptr<const std::string>;
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::size_t kShards = 16;
+    static constexpr std::size_t kDefaultBudgetBytes = 32 * 1024 * 1024;
+    static constexpr std::chrono::milliseconds kDefaultTtl{5 * 60 * 1000};
+
+    explicit ResponseCache(std::size_t budgetBytes = kDefaultBudgetBytes,
+                           std::chrono::milliseconds ttl = kDefaultTtl);
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    // The body stored under key, or null if there is none or it expired
+    Body get(std::uint64_t key);
+
+    // Store body under key, replacing any entry. A body larger than a
+    // shard's share of the budget is not stored.
+    void put(std::uint64_t key, Body body);
+
+    void clear();
+
+    // Existing entries keep the TTL they were stored with
+    void setBudget(std::size_t budgetBytes);
+    void setTtl(std::chrono::milliseconds ttl);
+    ResponseCacheStats stats() const;
+
+    // Memory an entry holding body is charged: the body's text plus list
+    // and hash nodes, bucket, the shared string and allocator headers
+    static std::size_t entryBytes(const std::string& body);
+
+private:
+    struct Entry {
+        std::uint64_t key;
+        Clock::time_point expires;
+        Body body;
+        std::size_t bytes;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::list<Entry> lru; // Most recently used first
+        std::unordered_map<std::uint64_t, std::list<Entry>::iterator> entries;
+        std::size_t bytes = 0;
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t expirations = 0;
+        std::uint64_t evictions = 0;
+    };
+
+    static_assert((kShards & (kShards - 1)) == 0, "kShards is a power of two");
+    static constexpr int kShardBits = std::countr_zero(kShards);
+
+    std::array<Shard, kShards> shards;
+    std::atomic<std::size_t> budgetBytes;
+    std::atomic<Clock::rep> ttlTicks;
+
+    Shard& shardOf(std::uint64_t key) { return shards[key >> (64 - kShardBits)]; }
+    std::size_t shardBudget() const {
+        return budgetBytes.load(std::memory_order_relaxed) / kShards;
+    }
+    static void erase(Shard& shard, std::list<Entry>::iterator entry);
+    static void evictOverBudget(Shard& shard, std::size_t budget);
+};
+
+}  // namespace codeflow
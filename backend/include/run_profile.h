@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <sys/types.h>
+
+struct rusage;
+
+namespace codeflow {
+
+// What wait4 reports for a finished child (and the children it waited for)
+struct ResourceUsage {
+    double userMs = 0;
+    double systemMs = 0;
+    std::int64_t maxRssKb = 0;
+    std::int64_t minorFaults = 0; // Served without I/O
+    std::int64_t majorFaults = 0; // Needed a read from disk
+    std::int64_t voluntarySwitches = 0;   // Blocked, e.g. on I/O or sleep
+    std::int64_t involuntarySwitches = 0; // Preempted
+
+    static ResourceUsage from(const struct rusage& usage);
+};
+
+// Hardware counter totals; an event the CPU or kernel does not offer is
+// empty. User space only, so the kernel's work on the program's behalf
+// (page faults, system calls) is not counted.
+struct CounterValues {
+    std::optional<std::uint64_t> cycles;
+    std::optional<std::uint64_t> instructions;
+    std::optional<std::uint64_t> branchMisses;
+    std::optional<std::uint64_t> l1dReadMisses;
+    std::optional<std::uint64_t> llcMisses;
+    // Some counters were multiplexed with other users of the PMU; their
+    // totals are extrapolated from the time they ran
+    bool scaled = false;
+    // Why no counter could be opened; empty when any was
+    std::string unavailable;
+
+    bool available() const { return unavailable.empty(); }
+};
+
+// perf_event_open counters on one process and everything it starts later.
+// Degrades to CounterValues::unavailable when perf events are not
+// permitted (kernel.perf_event_paranoid, seccomp in containers) or the
+// machine has no PMU, as in most VMs.
+//
+// With enableOnExec the counters start disabled and begin counting at the
+// process's next exec, so a forked child that has not exec'd yet is
+// measured from its first instruction. Otherwise counting starts now.
+class HardwareCounters {
+public:
+    explicit HardwareCounters(pid_t pid, bool enableOnExec = false);
+    ~HardwareCounters();
+    HardwareCounters(const HardwareCounters&) = delete;
+    HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+    // Totals so far; valid after the process has exited
+    CounterValues read() const;
+
+private:
+    static constexpr int kEvents = 5;
+    int fds[kEvents];
+    std::string error;
+};
+
+// Resource usage and counters of one program run
+struct RunProfile {
+    double wallMs = 0;
+    ResourceUsage usage;
+    CounterValues counters;
+};
+
+// {"wallMs":..,"userMs":..,"systemMs":..,"maxRssKb":..,"minorFaults":..,
+//  "majorFaults":..,"voluntaryContextSwitches":..,
+//  "involuntaryContextSwitches":..,"counters":{"available":bool,
+//  "cycles":n|null,"instructions":n|null,"branchMisses":n|null,
+//  "l1dReadMisses":n|null,"llcMisses":n|null,"instructionsPerCycle":n|null,
+//  "scaled":bool,"unavailableReason":string|null}}
+std::string profileJson(const RunProfile& profile);
+
+}  // namespace codeflow
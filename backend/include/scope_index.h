@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codeflow {
+
+// Declarations of one C++ source by scope, for resolving names at a cursor.
+// One pass over the token stream builds a tree of file, namespace, class,
+// function and block scopes, each with the names it declares: variables,
+// parameters (range-for and catch variables included), data members,
+// functions, classes, enums and using/typedef aliases.
+//
+// Not a parser: declarations are recognised by their shape ("T x", "T x =
+// init", "T x(args)", "auto x = init", "using A = T", "typedef T A"), which
+// is enough for completion and never fails on code that does not compile.
+// Names are looked up as C++ does, innermost scope first: blocks and
+// functions see what is declared before the cursor, classes all their
+// members (and their first base's), and an out-of-class member function
+// its class.
+class ScopeIndex {
+public:
+    static constexpr std::uint32_t kNone = ~std::uint32_t(0);
+
+    enum class ScopeKind : std::uint8_t { File, Namespace, Class, Function, Block };
+
+    enum class SymbolKind : std::uint8_t {
+        Variable,
+        Parameter, // Of a function or lambda, or a catch clause
+        Field,     // Data member
+        Function,  // type is the return type
+        Type,      // class, struct, union or enum
+        Alias,     // using A = T or typedef T A; type is T
+    };
+
+    // Byte range of the source
+    struct Span {
+        std::uint32_t offset = 0;
+        std::uint32_t length = 0;
+
+        bool empty() const { return length == 0; }
+    };
+
+    struct Symbol {
+        Span name;
+        Span type;        // As written: "const std::vector<int>&", "auto"
+        Span init;        // After "=", or a range-for variable's range
+        Span declaration; // Type through declarator, for display
+        std::uint32_t scope;
+        std::uint32_t visibleFrom; // Block scopes see it from here on
+        std::uint32_t shadowed;    // Earlier declaration in the same scope
+        std::uint32_t body;        // Type: its class scope, if it has one
+        SymbolKind kind;
+        bool element; // Range-for variable: an element of init
+    };
+
+    struct Scope {
+        ScopeKind kind;
+        std::uint32_t parent; // kNone for the file scope
+        std::uint32_t begin;  // Offset of the '{'; 0 for the file
+        std::uint32_t end;    // Past the '}', or past the source if unclosed
+        Span name;            // Namespace, class or function name
+        Span owner;           // "Point" of a "Point::norm() {" body
+        Span base;            // A class's first base class
+        std::uint32_t firstSymbol = 0; // Its symbols in symbolsIn()
+        std::uint32_t symbolCount = 0;
+    };
+
+    // What an expression's type resolves to. The views point into the
+    // source, the expression or static storage.
+    struct Type {
+        std::string_view name; // Unqualified, no arguments: "vector", "Point"
+        std::string_view args; // Template arguments as written: "string, int"
+        std::uint32_t classScope = kNone; // A class defined in the source
+        bool pointer = false;
+
+        bool known() const { return !name.empty(); }
+    };
+
+    ScopeIndex() = default;
+    ScopeIndex(const ScopeIndex&) = delete;
+    ScopeIndex& operator=(const ScopeIndex&) = delete;
+
+    // Index source, which must outlive the index (or the next build)
+    void build(std::string_view source);
+
+    // Index a copy of source kept by the index
+    void buildCopy(std::string_view source);
+
+    std::string_view source() const { return text; }
+    std::string_view view(Span span) const {
+        return text.substr(span.offset, span.length);
+    }
+
+    const std::vector<Scope>& scopes() const { return scopeList; }
+    const std::vector<Symbol>& symbols() const { return symbolList; }
+
+    // Symbols declared directly in a scope, in source order
+    std::span<const std::uint32_t> symbolsIn(std::uint32_t scope) const;
+
+    // Innermost scope around offset
+    std::uint32_t scopeAt(std::size_t offset) const;
+
+    // The declaration name refers to at offset, or null
+    const Symbol* lookup(std::string_view name, std::size_t offset) const;
+
+    // A member of a class scope or of its bases, or null
+    const Symbol* member(std::uint32_t classScope, std::string_view name) const;
+
+    // The class scope of a class's first base, or kNone if it has none
+    // defined in the source
+    std::uint32_t baseOf(std::uint32_t classScope) const;
+
+    // Type of an expression at offset: a name ("v"), member accesses
+    // ("p.items", "it->second", "this->size"), subscripts and the calls
+    // that return an element ("v[0]", "q.front()"), a function call, a
+    // construction ("Point{1, 2}", "make_shared<Node>()"). auto variables
+    // take their initializer's type and range-for variables the element
+    // type of their range; aliases resolve to what they name.
+    Type typeOf(std::string_view expression, std::size_t offset) const;
+
+    // The object of the member access the cursor is in: "p.items" for
+    // "p.items.pu|" or "p.items->|"; empty if the cursor is not after "."
+    // or "->" and an identifier being typed
+    static std::string_view memberObject(std::string_view code, std::size_t cursor);
+
+    // Element type of a standard container or string; for the maps the
+    // value type when subscripted, else pair<const K, V>
+    static Type elementOf(const Type& container, bool subscript);
+
+    // A written type's name and template arguments; qualifiers, cv, "*" and
+    // "&" dropped ("const std::map<K, V>&" is map with args "K, V")
+    static Type parseType(std::string_view text);
+
+    std::size_t memoryUsage() const;
+
+private:
+    struct Builder;
+
+    std::string copy;
+    std::string_view text;
+    std::vector<Scope> scopeList;
+    std::vector<Symbol> symbolList;
+    std::vector<std::uint32_t> byScope;   // Symbol indices grouped by scope
+    std::vector<std::uint32_t> slots;     // (scope, name) -> latest symbol
+    std::vector<std::uint32_t> typeSlots; // Type or alias name -> symbol
+
+    void clear();
+    std::uint32_t& slot(std::vector<std::uint32_t>& table, std::uint32_t scope,
+                        std::string_view name, bool scoped);
+    std::uint32_t head(const std::vector<std::uint32_t>& table,
+                       std::uint32_t scope, std::string_view name,
+                       bool scoped) const;
+    const Symbol* find(std::uint32_t scope, std::string_view name,
+                       std::size_t offset) const;
+    // The type or alias name refers to at offset, else one declared
+    // anywhere
+    const Symbol* typeNamed(std::string_view name, std::size_t offset) const;
+    // The class whose members are in scope at offset
+    std::uint32_t classAt(std::size_t offset) const;
+
+    Type resolve(std::string_view expression, std::size_t offset, int depth) const;
+    Type typeOfSymbol(const Symbol& symbol, int depth) const;
+    Type canonical(Type type, std::size_t offset, int depth) const;
+    Type memberType(const Type& object, std::string_view name, bool call,
+                    std::size_t offset, int depth) const;
+};
+
+}  // namespace codeflow
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "document.h"
+#include "usage_counts.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace codeflow {
+
+// Handle for one open editor document
+using SessionId = std::uint32_t;
+
+struct SessionStats {
+    std::size_t liveSessions = 0;
+    std::size_t bytes = 0;
+    std::size_t budgetBytes = 0;
+    std::uint64_t evictions = 0;
+};
+
+// One open document. Its own lock lets different sessions be queried and
+// edited in parallel.
+struct Session {
+    // Distinct symbols whose acceptances a session remembers
+    static constexpr std::size_t kUsageSlots = 64;
+
+    mutable std::shared_mutex mutex;
+    Document document;
+    UsageCounts usage{kUsageSlots}; // Lock-free; not guarded by mutex
+    std::atomic<long long> lastUsed{0};
+    std::size_t bytes = 0; // Guarded by the store's lock
+};
+
+// Per-document state for many concurrent editors. Each session owns only its
+// document; the STL index is shared by the engine. When the total footprint
+// exceeds the budget, the least recently used sessions are evicted and
+// behave as closed from then on.
+class SessionStore {
+public:
+    static constexpr std::size_t kDefaultBudgetBytes = 64 * 1024 * 1024;
+
+    explicit SessionStore(std::size_t budgetBytes = kDefaultBudgetBytes);
+
+    SessionId open();
+    bool close(SessionId id);
+    bool contains(SessionId id) const;
+
+    // Run fn(const Document&, const UsageCounts&) under the session's read
+    // lock; false if the session is unknown
+    template <typename Fn>
+    bool read(SessionId id, Fn&& fn) const {
+        auto session = find(id);
+        if (!session)
+            return false;
+        std::shared_lock<std::shared_mutex> lock(session->mutex);
+        std::forward<Fn>(fn)(std::as_const(session->document),
+                             std::as_const(session->usage));
+        return true;
+    }
+
+    // Count an accepted completion of name in the session, without taking
+    // its lock; false if the session is unknown
+    bool recordUse(SessionId id, std::string_view name, std::uint32_t at);
+
+    // Run fn(Document&) -> bool under the session's write lock and re-account
+    // its memory; false if the session is unknown or fn reports failure
+    template <typename Fn>
+    bool write(SessionId id, Fn&& fn) {
+        auto session = find(id);
+        if (!session)
+            return false;
+        bool ok;
+        std::size_t bytes;
+        {
+            std::unique_lock<std::shared_mutex> lock(session->mutex);
+            ok = std::forward<Fn>(fn)(session->document);
+            bytes = session->document.memoryUsage();
+        }
+        account(id, *session, bytes);
+        return ok;
+    }
+
+    void setBudget(std::size_t budgetBytes);
+    SessionStats stats() const;
+
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<SessionId, std::shared_ptr<Session>> entries;
+    std::size_t totalBytes = 0;
+    std::size_t budgetBytes;
+    std::uint64_t evictions = 0;
+    SessionId nextId = 1;
+
+    static long long now();
+    std::shared_ptr<Session> find(SessionId id) const;
+    void account(SessionId id, Session& session, std::size_t bytes);
+    void evictOverBudget(SessionId keep);
+};
+
+}  // namespace codeflow
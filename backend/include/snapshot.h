@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace codeflow {
+
+// Immutable value published RCU-style. Writers build a complete new value off
+// to the side and publish() it; readers never wait for a rebuild and never
+// observe a partially built value.
+//
+// read() keeps a per-thread reference for each instance, tagged with the
+// generation it was taken at, so the steady-state read is a single acquire
+// load of a shared counter: no lock and no reference-count write that would
+// bounce a cache line between cores. Only the first read on a thread after a
+// publish copies the new reference, under a lock held for a pointer copy.
+//
+// Lifetime: the pointer read() returns stays valid until the same thread's
+// next read() of the same instance, as long as the thread reads fewer than
+// kThreadSlots other Snapshot<T> instances in between (it keeps references
+// for the kThreadSlots instances it read most recently). In exchange, a
+// thread holds on to one value per instance it read, possibly superseded,
+// until it reads that instance again, reads kThreadSlots others or exits.
+// Use acquire() to hold a value longer, or on threads that read rarely.
+template <typename T>
+class Snapshot {
+public:
+    explicit Snapshot(std::shared_ptr<const T> initial = std::make_shared<const T>())
+        : current(std::move(initial)), generation(nextGeneration()) {}
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    const T* read() const {
+        std::uint64_t at;
+        return read(at);
+    }
+
+    // read(), also giving the generation of the value returned: equal
+    // generations mean the same value
+    const T* read(std::uint64_t& at) const {
+        Slot& slot = slotFor();
+        if (slot.generation != generation.load(std::memory_order_acquire)) {
+            std::shared_ptr<const T> previous = std::move(slot.value);
+            std::lock_guard<std::mutex> lock(swapMutex);
+            slot.value = current;
+            // Under the lock publish() holds, so it names this value
+            slot.generation = generation.load(std::memory_order_relaxed);
+        }
+        at = slot.generation;
+        return slot.value.get();
+    }
+
+    // Owning reference, for values that must outlive the next read()
+    std::shared_ptr<const T> acquire() const {
+        std::lock_guard<std::mutex> lock(swapMutex);
+        return current;
+    }
+
+    void publish(std::shared_ptr<const T> next) {
+        {
+            std::lock_guard<std::mutex> lock(swapMutex);
+            current.swap(next);
+            generation.store(nextGeneration(), std::memory_order_release);
+        }
+        // The previous value (now in `next`) is released outside the lock
+    }
+
+    // Instances whose values a thread keeps between reads
+    static constexpr std::size_t kThreadSlots = 4;
+
+private:
+    struct Slot {
+        std::uint64_t owner = 0; // The instance's id; 0 for a free slot
+        std::uint64_t generation = 0;
+        std::uint64_t lastUse = 0;
+        std::shared_ptr<const T> value;
+    };
+
+    mutable std::mutex swapMutex;
+    std::shared_ptr<const T> current;
+    std::atomic<std::uint64_t> generation;
+    // Ids come from the generation counter, so they are never reused and a
+    // destroyed instance's slots can never be mistaken for a new one's
+    const std::uint64_t id = nextGeneration();
+
+    // This thread's slot for this instance; on a miss, the least recently
+    // used one is taken over
+    Slot& slotFor() const {
+        static thread_local std::array<Slot, kThreadSlots> slots;
+        static thread_local std::uint64_t uses = 0;
+        Slot* victim = &slots[0];
+        for (Slot& slot : slots) {
+            if (slot.owner == id) {
+                slot.lastUse = ++uses;
+                return slot;
+            }
+            if (slot.lastUse < victim->lastUse)
+                victim = &slot;
+        }
+        victim->value.reset();
+        victim->owner = id;
+        victim->generation = 0;
+        victim->lastUse = ++uses;
+        return *victim;
+    }
+
+    // Generations are unique across all snapshots of T, so a thread's cached
+    // value can never be mistaken for another instance's.
+    static std::uint64_t nextGeneration() {
+        static std::atomic<std::uint64_t> counter{0};
+        return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+};
+
+}  // namespace codeflow
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "flat_array.h"
+#include "fuzzy.h"
+#include "symbol_pool.h"
+#include "trie.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codeflow {
+
+// One STL type (a container, or a header of free functions) and the rows of
+// its methods in the catalogue columns
+struct CatalogType {
+    SymbolId name;
+    SymbolId header;       // Header that declares it
+    SymbolId description;
+    std::uint32_t firstMethod;
+    std::uint32_t methodCount;
+};
+
+// Global-context entry from constants.json (ALL_STL_TYPES, TEMPLATE_ARGS)
+struct CatalogItem {
+    SymbolId text;
+    SymbolId sig;
+    SymbolId doc;
+    SymbolId kind; // "class", "type", ...
+};
+
+struct SymbolPair {
+    SymbolId first;
+    SymbolId second;
+};
+
+// Method as read from a data file; empty fields are stored as kNoSymbol
+struct MethodRecord {
+    std::string_view name;
+    std::string_view sig;
+    std::string_view doc;
+    std::string_view complexity;
+};
+
+// Columnar store of STL metadata. Types are sorted by name; each method is a
+// row and each field a separate column, so scanning a type's names touches
+// only the name column. Every string is a SymbolPool id. A catalogue can
+// also be a view over a mapped index file, whose ids are relative to a
+// symbol base; the accessors below always return absolute ids.
+class StlCatalog {
+public:
+    // Type by name, or nullptr
+    const CatalogType* findType(std::string_view name) const;
+    std::span<const CatalogType> types() const { return {typeTable.data(), typeTable.size()}; }
+
+    std::size_t methodCount() const { return methodNames.size(); }
+    SymbolId typeName(const CatalogType& type) const { return resolve(type.name); }
+    SymbolId typeHeader(const CatalogType& type) const { return resolve(type.header); }
+    SymbolId typeDescription(const CatalogType& type) const { return resolve(type.description); }
+    SymbolId methodName(std::uint32_t row) const { return resolve(methodNames[row]); }
+    SymbolId methodSig(std::uint32_t row) const { return resolve(methodSigs[row]); }
+    SymbolId methodDoc(std::uint32_t row) const { return resolve(methodDocs[row]); }
+    SymbolId methodComplexity(std::uint32_t row) const { return resolve(methodComplexities[row]); }
+
+    // Constants
+    std::size_t headerCount() const { return headerList.size(); }
+    SymbolId header(std::size_t i) const { return resolve(headerList[i]); }
+    std::size_t itemCount() const { return itemList.size(); }
+    CatalogItem item(std::size_t i) const { return resolve(itemList[i]); }
+    std::size_t templateArgCount() const { return templateArgList.size(); }
+    CatalogItem templateArg(std::size_t i) const { return resolve(templateArgList[i]); }
+    std::size_t headerContainerCount() const { return headerContainerList.size(); }
+    SymbolPair headerContainer(std::size_t i) const { return resolve(headerContainerList[i]); }
+    std::size_t typeKeyCount() const { return typeKeyList.size(); }
+    SymbolPair typeKey(std::size_t i) const { return resolve(typeKeyList[i]); }
+
+    // Add or update a type. Methods already listed under the same name are
+    // updated in place (empty fields keep their old value); new ones are
+    // appended. Empty header or description keep the current value; a new
+    // type defaults its header to its own name.
+    void mergeType(std::string_view name, std::string_view header,
+                   std::string_view description, const std::vector<MethodRecord>& methods);
+
+    void addHeader(std::string_view header);
+    // ALL_STL_TYPES and TEMPLATE_ARGS entries; a repeated text and kind
+    // replaces the earlier entry
+    void addItem(std::string_view text, std::string_view sig, std::string_view doc,
+                 std::string_view kind);
+    void addTemplateArg(std::string_view text, std::string_view sig, std::string_view doc,
+                        std::string_view kind);
+    void addHeaderContainer(std::string_view header, std::string_view container);
+    void addTypeKey(std::string_view type, std::string_view key);
+
+    // Raw columns for serialization; ids are relative to symbolBase()
+    struct Columns {
+        std::span<const CatalogType> types;
+        std::span<const SymbolId> names, sigs, docs, complexities;
+        std::span<const SymbolId> headers;
+        std::span<const CatalogItem> items, templateArgs;
+        std::span<const SymbolPair> headerContainers, typeKeys;
+    };
+    Columns columns() const;
+    SymbolId symbolBase() const { return base; }
+
+    // Serve every column from external memory (see FlatArray::view)
+    void view(const Columns& external, SymbolId symbolBase);
+
+    std::size_t memoryUsage() const;
+
+private:
+    FlatArray<CatalogType> typeTable;
+    FlatArray<SymbolId> methodNames;
+    FlatArray<SymbolId> methodSigs;
+    FlatArray<SymbolId> methodDocs;
+    FlatArray<SymbolId> methodComplexities;
+    FlatArray<SymbolId> headerList;
+    FlatArray<CatalogItem> itemList;
+    FlatArray<CatalogItem> templateArgList;
+    FlatArray<SymbolPair> headerContainerList;
+    FlatArray<SymbolPair> typeKeyList;
+    SymbolId base = 0;
+
+    SymbolId resolve(SymbolId id) const { return id == kNoSymbol ? kNoSymbol : id + base; }
+    SymbolPair resolve(SymbolPair pair) const { return {resolve(pair.first), resolve(pair.second)}; }
+    CatalogItem resolve(const CatalogItem& item) const {
+        return {resolve(item.text), resolve(item.sig), resolve(item.doc), resolve(item.kind)};
+    }
+    void makeEditable();
+};
+
+// STL methods, keywords and constants. Published as an immutable snapshot;
+// reloads build a new one and swap it in.
+struct StlIndex {
+    Trie trie;
+    StlCatalog catalog;
+    FuzzyIndex fuzzy; // Every name above; see buildFuzzyIndex
+    // Keeps the mapped file alive while trie and catalog view it
+    std::shared_ptr<const void> storage;
+
+    // Heap bytes held by the index itself (interned and mapped text excluded)
+    std::size_t memoryUsage() const;
+};
+
+// Loaders for the source data files. Each merges into index and returns
+// false (leaving index unchanged) if the text is not in the expected format.
+
+// data/stl_functions.json: { "container": ["method", ...], ... }
+bool mergeStlFunctions(std::string_view json, StlIndex& index);
+
+// backend/data/stl/<type>.json: { header, description, methods: [{name, sig,
+// doc, complexity}] }
+bool mergeStlDefinition(std::string_view typeName, std::string_view json, StlIndex& index);
+
+// backend/data/constants.json
+bool mergeConstants(std::string_view json, StlIndex& index);
+
+// One keyword per line; blank lines and lines starting with '#' are skipped
+void addKeywords(std::string_view text, StlIndex& index);
+
+// Rebuild index.fuzzy from the trie and catalogue. Derived data, so it is not
+// stored in index files; call it once an index is complete, before
+// publishing it.
+void buildFuzzyIndex(StlIndex& index);
+
+}  // namespace codeflow
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "run_profile.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace codeflow {
+
+// Resource limits applied to a child process; 0 leaves a limit as inherited
+struct ProcessLimits {
+    std::uint64_t cpuSeconds = 0;        // RLIMIT_CPU: SIGXCPU, then SIGKILL a second later
+    std::uint64_t addressSpaceBytes = 0; // RLIMIT_AS
+    std::uint64_t processes = 0;         // RLIMIT_NPROC (per user; not enforced for root)
+    std::uint64_t fileSizeBytes = 0;     // RLIMIT_FSIZE
+    bool coreDumps = false;              // RLIMIT_CORE is 0 unless set
+};
+
+// Output as it is read: stream 1 is stdout, 2 is stderr. Runs on the thread
+// that called runProcess; while it blocks, the pipes are not read, so a child
+// that keeps writing blocks too. The timeout is checked between calls.
+using OutputHandler = std::function<void(int stream, std::string_view data)>;
+
+struct ProcessOptions {
+    std::string workingDirectory; // Empty to inherit
+    // The child's whole environment, as NAME=value; nothing is inherited
+    std::vector<std::string> environment;
+    ProcessLimits limits;
+    std::chrono::milliseconds timeout{0}; // Wall clock; 0 for none
+    std::size_t maxOutputBytes = 1 << 20; // Per stream; the rest is discarded
+    // Polled while the child runs; setting it kills the child
+    const std::atomic<bool>* cancelled = nullptr;
+    // Sees everything kept in ProcessResult::out and err, as it arrives
+    OutputHandler onOutput;
+    // Count cycles, instructions and cache misses (see HardwareCounters).
+    // They are attached once the child has exec'd, so the first
+    // microseconds of its dynamic loader go uncounted.
+    bool hardwareCounters = false;
+};
+
+struct ProcessResult {
+    bool started = false;
+    std::string error; // Why it could not be started
+    int exitCode = -1; // When it exited normally
+    int signal = 0;    // When a signal ended it
+    bool timedOut = false;
+    bool cancelled = false;
+    bool truncated = false; // Output beyond maxOutputBytes was dropped
+    double wallMs = 0;
+    double cpuMs = 0; // User + system, including children it waited for
+    ResourceUsage usage;
+    CounterValues counters; // Unavailable unless requested
+    std::string out;
+    std::string err;
+
+    bool succeeded() const { return started && signal == 0 && exitCode == 0; }
+};
+
+// Split a flag string on whitespace; no quoting
+std::vector<std::string> splitArguments(std::string_view flags);
+
+// PATH (inherited) and a UTF-8 locale: enough for compilers and programs,
+// without handing them the server's secrets
+std::vector<std::string> minimalEnvironment();
+
+// Run argv[0] (searched in PATH) with argv, without a shell, and wait for
+// it. stdin is /dev/null; stdout and stderr are read separately.
+//
+// The child is started with vfork in a process group of its own, with
+// default signal dispositions and no inherited file descriptors beyond
+// 0-2, and sets its limits before calling exec, so they cover the dynamic
+// loader too. If any of that fails, started is false and error names the
+// step. A timeout or cancellation kills the whole group, also once the
+// child has closed its output, as does the child's exit, so nothing it
+// started outlives it.
+//
+// Safe to call from many threads at once: pipes are created close-on-exec
+// and no process-wide state is touched; only the calling thread waits for
+// the child to exec.
+ProcessResult runProcess(const std::vector<std::string>& argv,
+                         const ProcessOptions& options);
+
+}  // namespace codeflow
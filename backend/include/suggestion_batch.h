@@ -0,0 +1,62 @@
+#pragma once
+
+#include "suggestion_engine.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace codeflow {
+
+// Wire format of getSuggestionsBatch: one buffer the JavaScript side reads
+// through typed arrays (src/native/suggestionBatch.js), so it is laid out in
+// native byte order with every field 4-byte aligned.
+//
+//   u32 magic, queryCount, recordCount, stringBytes
+//   u32 ends[queryCount]            end record of each query's results
+//   BatchRecord records[recordCount]
+//   u8  strings[stringBytes]        UTF-8, deduplicated, not terminated
+//   u8  padding to a multiple of 4 bytes
+//
+// Offsets in records are relative to the start of the string table.
+constexpr std::uint32_t kBatchMagic = 0x42534643; // "CFSB"
+
+struct BatchRecord {
+    std::uint32_t text;
+    std::uint32_t type;
+    float score;
+    std::uint32_t lengths; // text length | type length << 16
+};
+static_assert(sizeof(BatchRecord) == 16);
+
+// Packs a SuggestionBatch in two steps so the caller can allocate the exact
+// output (e.g. a JavaScript ArrayBuffer) in between. Strings are
+// deduplicated by address: suggestions view interned or static storage, so
+// equal names share one entry. Reuse one packer to keep its buffers warm.
+class BatchPacker {
+public:
+    // Lay out batch, which must stay alive until write(); returns the
+    // packed size in bytes
+    std::size_t plan(const SuggestionBatch& batch);
+
+    // Write the planned batch into out, which holds at least plan() bytes
+    // and is 4-byte aligned
+    void write(std::uint8_t* out) const;
+
+private:
+    struct StringEntry {
+        std::uint32_t offset = 0;
+        std::uint32_t length = 0;
+    };
+
+    const SuggestionBatch* batch = nullptr;
+    std::vector<std::string_view> strings;
+    std::vector<std::uint32_t> stringOffsets; // Two per record: text, type
+    std::unordered_map<const char*, StringEntry> seen;
+    std::uint32_t stringBytes = 0;
+
+    std::uint32_t intern(std::string_view text);
+};
+
+}  // namespace codeflow
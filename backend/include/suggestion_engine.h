@@ -1,22 +1,99 @@
 #pragma once
 
+#include "document.h"
+#include "engine_metrics.h"
+#include "response_cache.h"
+#include "session_store.h"
+#include "snapshot.h"
+#include "stl_index.h"
+#include "symbol_pool.h"
 #include "tokenizer.h"
-#include "trie.h"
+#include "usage_counts.h"
+#include "workspace_index.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 
 namespace codeflow
 {
 
+  // Text route records derive from a suggestion (decorate()) rather than
+  // storing it: the display string, and for headers and locals also doc and
+  // sig
+  enum class Decoration : std::uint8_t
+  {
+    None,          // display = text
+    Signature,     // display = sig, or text if there is none
+    Call,          // display = "text()"
+    QualifiedCall, // display = "std::text()"
+    Header,        // display = "<text>", sig = "#include <text>"
+    Local          // doc = "Local variable: text", sig = text
+  };
+
+  // Views into interned or static storage, valid for the life of the
+  // process; results carry no heap-allocated text. Strings are materialized
+  // only at the N-API boundary. Empty metadata fields are unknown.
   struct Suggestion
   {
-    std::string text;
-    std::string type; // "method", "variable", "keyword", etc.
-    std::string description;
-    float score; // Ranking score (frequency + recency)
+    std::string_view text{};
+    std::string_view type{}; // "method", "variable", "keyword", etc.
+    std::string_view description{}; // Doc string
+    float score = 0; // Ranking score (frequency + recency)
+    SymbolId symbol = kNoSymbol;
+    std::string_view sig{};
+    std::string_view complexity{};
+    std::string_view container{}; // Catalogue type the method belongs to
+    std::string_view header{};    // Header that declares it
+    Decoration decoration = Decoration::None;
+  };
+
+  // The display, doc and sig of a complete() record, with s.decoration
+  // applied
+  void decorate(const Suggestion &s, std::string &display, std::string &doc,
+                std::string &sig);
+
+  // complete() results as the JSON array POST /api/getSuggestions sends:
+  // records of text, display, type, doc, sig, complexity, container, header
+  // and score, in that order, leaving out empty fields
+  void appendRecordsJson(std::string &out,
+                         const std::vector<Suggestion> &suggestions);
+
+  // One query of a getSuggestionsBatch call. Session 0 is the default
+  // document (updateSymbols); an empty code on a session uses the session's
+  // own text. code is only borrowed for the duration of the call.
+  struct SuggestionQuery
+  {
+    SessionId session = 0;
+    std::string prefix;
+    std::string contextType;
+    std::string_view code;
+    int cursorPosition = 0;
+  };
+
+  // How complete() matches candidates against the typed text
+  enum class MatchMode : std::uint8_t
+  {
+    Prefix, // Case-insensitive prefix
+    Fuzzy   // Case-insensitive subsequence, ranked by alignment score
+  };
+
+  // Results of a batch, flattened: query q owns
+  // results[q == 0 ? 0 : ends[q - 1], ends[q])
+  struct SuggestionBatch
+  {
+    std::vector<Suggestion> results;
+    std::vector<std::uint32_t> ends;
+
+    void clear()
+    {
+      results.clear();
+      ends.clear();
+    }
   };
 
   class SuggestionEngine
@@ -28,13 +105,72 @@ namespace codeflow
     void loadSTLData(const std::string &stlJsonPath);
     void loadKeywords(const std::string &keywordsPath);
 
+    // Replace the STL index with a precompiled index file (see
+    // index_file.h). Returns false and keeps the current index if the file
+    // is missing, stale or corrupt.
+    bool loadIndex(const std::string &indexPath, std::string *error = nullptr);
+
     // Main API: Get contextual suggestions
     std::vector<Suggestion> getSuggestions(const std::string &prefix,
                                            const std::string &contextType,
-                                           const std::string &code,
+                                           std::string_view code,
                                            int cursorPosition,
                                            int maxResults = 10);
 
+    // Answer many queries in one call against a single index snapshot,
+    // appending to out (cleared first). Unknown or evicted sessions get no
+    // results.
+    void getSuggestionsBatch(const std::vector<SuggestionQuery> &queries,
+                             int maxResults, SuggestionBatch &out);
+
+    // No cursor: member access resolves where the object was last declared
+    static constexpr std::size_t kNoCursor = std::string::npos;
+
+    // Completion as served by POST /api/getSuggestions, with full catalogue
+    // metadata. contextType is "global", "include_header", "template_arg",
+    // or for member access the object: a variable ("v"), an expression
+    // ("p.items", "it->second") or a type name. The object's type is
+    // resolved through the scopes around cursor, a byte offset into code;
+    // members of a class the code defines are suggested as well as those
+    // of catalogue types and of classes in the workspace index. Headers are
+    // resolved through the catalogue, and <bits/...> includes everything.
+    // Global scope also offers the workspace's functions, classes and
+    // variables. Local variable and member suggestions point into code,
+    // workspace ones into the snapshot current when the call began.
+    std::vector<Suggestion> complete(const std::string &prefix,
+                                     const std::string &contextType,
+                                     const std::string &code,
+                                     int maxResults = 20,
+                                     MatchMode mode = MatchMode::Prefix,
+                                     std::size_t cursor = kNoCursor) const;
+
+    // complete() as the JSON body of a POST /api/getSuggestions response
+    // (appendRecordsJson), from the response cache when an equivalent query
+    // was answered within its TTL: same index, language, mode, maxResults,
+    // prefix, workspace snapshot and set of included headers, and the same
+    // resolved type (or user class members) for member access or the same
+    // local names in global scope, and no acceptance recorded or usage
+    // loaded since. hit, if given, tells which. Within the TTL, cached
+    // results keep the usage decay they were ranked with.
+    ResponseCache::Body completeJson(const std::string &language,
+                                     const std::string &prefix,
+                                     const std::string &contextType,
+                                     const std::string &code,
+                                     int maxResults = 20,
+                                     MatchMode mode = MatchMode::Prefix,
+                                     bool *hit = nullptr,
+                                     std::size_t cursor = kNoCursor);
+    ResponseCache &responseCache() { return responses; }
+
+    // Symbols of the project's other files, for complete() and
+    // completeJson(); empty until opened
+    WorkspaceIndex &workspaceIndex() { return workspace; }
+
+    // Fuzzy match against every name in the index (types, methods,
+    // headers, keywords), regardless of includes; "pb" finds push_back
+    std::vector<Suggestion> fuzzySearch(const std::string &pattern,
+                                        int maxResults = 20) const;
+
     // Update symbol table from code
     void updateSymbols(const std::string &code);
 
@@ -50,31 +186,114 @@ namespace codeflow
     // Validate if a type has included header
     bool isHeaderIncluded(const std::string &type) const;
 
+    // Per-document sessions sharing the STL index. Unknown or evicted
+    // sessions make update/close return false and queries return nothing.
+    SessionId openSession();
+    bool updateSession(SessionId session, const std::string &code);
+    // Apply edits in order, re-indexing only the lines they touch. Stops at
+    // the first out-of-range edit and returns false; resync with
+    // updateSession in that case.
+    bool editSession(SessionId session, const std::vector<TextEdit> &edits);
+    std::vector<Suggestion> getSessionSuggestions(SessionId session,
+                                                  const std::string &prefix,
+                                                  const std::string &contextType,
+                                                  std::string_view code,
+                                                  int cursorPosition,
+                                                  int maxResults = 10);
+    bool closeSession(SessionId session);
+    bool hasSession(SessionId session) const;
+
+    // Global memory budget for session state; idle sessions are evicted LRU
+    void setSessionMemoryBudget(std::size_t bytes);
+    SessionStats getSessionStats() const;
+
+    // Feedback: the user picked text from the completion list. Counted
+    // globally and, for a live session, in that session too; both decay
+    // over time and lift the symbol in later rankings. Lock-free. False if
+    // text is not a known symbol.
+    bool recordAccepted(const std::string &text, SessionId session = 0);
+
+    // Decayed acceptance count of text, globally or in one session
+    float getUsageScore(const std::string &text, SessionId session = 0) const;
+    std::size_t getLearnedSymbolCount() const;
+
+    // Persist the global counts (see UsageCounts::save); load after the
+    // index, since unknown names are skipped
+    bool saveUsage(const std::string &path, std::string *error = nullptr) const;
+    bool loadUsage(const std::string &path, std::string *error = nullptr);
+
   private:
-    Trie trie;
+    Snapshot<StlIndex> index;
+    Snapshot<DocumentSymbols> document; // Default document for updateSymbols
+    SessionStore sessions;
+    UsageCounts usage; // Global acceptance counts; outlive index reloads
+    // Bumped whenever usage changes, which completeJson's ranking depends on
+    std::atomic<std::uint64_t> usageEpoch{0};
     Tokenizer tokenizer;
-    std::unordered_map<std::string, std::vector<std::string>> typeToMethods;
-    std::unordered_map<std::string, std::string> symbolTable;
-    std::unordered_set<std::string> includedLibraries;
-    std::mutex mutex;
+    std::mutex writeMutex; // Serializes index rebuilds; readers never take it
+    ResponseCache responses; // completeJson bodies
+    WorkspaceIndex workspace;
+
+    struct CompletionScope;
+
+    // Read what complete() needs from code into scope
+    static void scanScope(const StlCatalog &catalog,
+                          const WorkspaceSymbols &workspace,
+                          const std::string &contextType,
+                          std::string_view code, std::size_t cursor,
+                          CompletionScope &scope);
+
+    // complete() once the code is scanned; timer is the query's
+    std::vector<Suggestion> completeIn(const StlCatalog &catalog,
+                                       const CompletionScope &scope,
+                                       const std::string &prefix,
+                                       const std::string &contextType,
+                                       int maxResults, MatchMode mode,
+                                       StageTimer &timer) const;
 
     // Context-aware filtering
     std::vector<std::string>
     filterByContext(const std::vector<std::string> &candidates,
-                    const std::string &contextType);
+                    const std::string &contextType) const;
+
+    // Ranking bonus from learned usage, in [0, kMaxUsageBoost): global
+    // acceptances plus the session's, which weigh more
+    float usageBoost(std::string_view name, const UsageCounts *session,
+                     std::uint32_t at) const;
 
-    // Ranking with frequency + recency
+    // Ranking with frequency + recency: learned usage first, then shorter
+    // names
     void rankSuggestions(std::vector<Suggestion> &suggestions,
-                         bool useML = false);
+                         const UsageCounts *session = nullptr) const;
 
-    // Parse JSON STL data
-    void parseSTLJson(const std::string &jsonData);
+    // Suggestions for one document against the given index; scopes are the
+    // document's, if indexed, and session its usage counts, if it has its
+    // own
+    std::vector<Suggestion> suggest(const StlIndex &stl,
+                                    const DocumentSymbols &doc,
+                                    const ScopeIndex *scopes,
+                                    const UsageCounts *session,
+                                    const std::string &prefix,
+                                    const std::string &contextType,
+                                    std::string_view code, int cursorPosition,
+                                    int maxResults);
+
+    // Extract includes and STL variable declarations from code
+    static std::shared_ptr<DocumentSymbols> parseDocument(const std::string &code);
 
     // Extract object name before dot
-    std::string extractObjectName(const std::string &code, int cursorPosition);
+    std::string extractObjectName(std::string_view code, int cursorPosition);
 
     // Get type for object
-    std::string getTypeForObject(const std::string &objectName) const;
+    static std::string getTypeForObject(const DocumentSymbols &symbols,
+                                        const std::string &objectName);
+
+    // Type of the object of the "obj." or "obj->" the cursor is after,
+    // resolved through scopes (or code's, if scopes is null or was indexed
+    // from other text); empty if there is none
+    static std::string typeAtCursor(const ScopeIndex *scopes,
+                                    std::string_view code,
+                                    std::size_t cursor);
   };
 
 } // namespace codeflow
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace codeflow {
+
+// Index of an interned string in the SymbolPool
+using SymbolId = std::uint32_t;
+
+constexpr SymbolId kNoSymbol = UINT32_MAX;
+
+// Process-wide table of interned strings. Each distinct string is stored
+// once and referred to by a 32-bit id; the trie, the per-type method lists
+// and suggestion results all share the same copy.
+//
+// Interned text never moves and is never freed, so views returned by view()
+// stay valid for the life of the process and can be passed around without
+// copying. Interning takes a lock; view() does not, and is safe from any
+// thread that obtained the id through a synchronized channel (a published
+// snapshot, for instance). Only long-lived vocabulary (STL names, keywords)
+// belongs here, not per-document identifiers.
+class SymbolPool {
+public:
+    static SymbolPool& global();
+
+    SymbolPool();
+    SymbolPool(const SymbolPool&) = delete;
+    SymbolPool& operator=(const SymbolPool&) = delete;
+
+    // Id of text, adding it on first use
+    SymbolId intern(std::string_view text);
+
+    // Register a string table (a mapped index file) under consecutive ids,
+    // returned as the first one. String i is text[offsets[i], offsets[i + 1]);
+    // offsets has count + 1 entries. The text is copied, so the caller may
+    // unmap it afterwards; strings already in the pool share their stored
+    // copy and keep their existing id for intern() and find(). Attaching a
+    // table identical to an earlier one returns the earlier ids, so reloading
+    // the same index does not grow the pool.
+    SymbolId attach(const char* text, const std::uint32_t* offsets, std::size_t count);
+
+    // Id of text if it has been interned, otherwise kNoSymbol
+    SymbolId find(std::string_view text) const;
+
+    std::string_view view(SymbolId id) const {
+        auto [block, offset] = locate(id);
+        const Entry& entry = blocks[block][offset];
+        return {entry.data, entry.length};
+    }
+
+    std::size_t size() const;
+
+    // Bytes held by the text chunks, entry blocks and lookup tables
+    std::size_t memoryUsage() const;
+
+private:
+    struct Entry {
+        const char* data;
+        std::uint32_t length;
+    };
+
+    // Entry block k holds kFirstBlock << k entries, so a fixed directory of
+    // a few dozen pointers addresses every id and entries never move.
+    static constexpr std::size_t kFirstBlock = 256;
+    static constexpr std::size_t kMaxBlocks = 24; // Covers every 32-bit id
+    static constexpr std::size_t kMinChunk = 4 * 1024;
+    static constexpr std::size_t kMaxChunk = 1024 * 1024;
+
+    mutable std::mutex mutex;
+    std::unique_ptr<Entry[]> blocks[kMaxBlocks];
+    std::size_t blockBytes = 0;
+    // Text chunks double in size up to kMaxChunk
+    std::vector<std::unique_ptr<char[]>> chunks;
+    char* openChunk = nullptr;
+    std::size_t chunkSize = 0;
+    std::size_t chunkUsed = 0;
+    std::size_t chunkBytes = 0;
+    std::unordered_map<std::string_view, SymbolId> ids;
+    std::size_t nextId = 0;
+    // First id and size of each attached table, by hash of its text
+    std::unordered_multimap<std::size_t, std::pair<SymbolId, std::size_t>> tables;
+
+    void reserveEntry(SymbolId id);
+    // Block index and offset within the block of an id
+    static std::pair<unsigned, std::size_t> locate(SymbolId id) {
+        std::uint64_t slot = id / kFirstBlock + 1;
+        unsigned block = static_cast<unsigned>(std::bit_width(slot)) - 1;
+        return {block, id - kFirstBlock * ((std::size_t{1} << block) - 1)};
+    }
+
+    const char* store(std::string_view text);
+    bool sameTable(SymbolId first, const char* text, const std::uint32_t* offsets,
+                   std::size_t count) const;
+};
+
+}  // namespace codeflow
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace codeflow {
+
+// Handle for one submitted task; never reused
+using TaskId = std::uint64_t;
+
+struct ThreadPoolStats {
+    std::size_t threads = 0;
+    std::size_t queued = 0;
+    std::size_t running = 0;
+    std::uint64_t completed = 0;
+    std::uint64_t cancelled = 0;
+};
+
+// Fixed-size pool of worker threads for blocking engine work (compiles,
+// program runs, document parses), so callers such as the Node main thread
+// never wait on it.
+//
+// Every task runs exactly once and receives a cancellation flag. A task
+// cancelled while queued is removed and run straight away on the cancelling
+// thread with the flag already set, so it can report the cancellation
+// without waiting for a free worker. A task cancelled while running sees the
+// flag change and may stop early.
+class ThreadPool {
+public:
+    using Task = std::function<void(const std::atomic<bool>& cancelled)>;
+
+    static constexpr std::size_t kDefaultThreads = 4;
+
+    explicit ThreadPool(std::size_t threads = kDefaultThreads);
+
+    // Cancels queued tasks (running them on this thread), flags running
+    // ones and waits for them to return
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    TaskId submit(Task task);
+
+    // False if the task already finished (or never existed)
+    bool cancel(TaskId id);
+
+    ThreadPoolStats stats() const;
+
+private:
+    struct Entry {
+        TaskId id;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        Task task;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Entry> queue;
+    std::unordered_map<TaskId, std::shared_ptr<std::atomic<bool>>> running;
+    std::vector<std::thread> workers;
+    TaskId nextId = 1;
+    std::uint64_t completed = 0;
+    std::uint64_t cancelledCount = 0;
+    bool stopping = false;
+
+    void work();
+};
+
+}  // namespace codeflow
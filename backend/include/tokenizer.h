@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <vector>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace codeflow {
 
@@ -14,38 +16,70 @@ struct Token {
         PUNCTUATION,
         LITERAL,
         WHITESPACE,
-        UNKNOWN
+        UNKNOWN,
+        COMMENT,      // Line or block comment, delimiters included
+        PREPROCESSOR  // Whole directive line, continuations included
     };
-    
+
     Type type;
     std::string value;
     int position;
 };
 
+// Token boundaries as a view into the scanned buffer; no text is copied
+struct TokenView {
+    Token::Type type;
+    std::uint32_t offset;
+    std::uint32_t length;
+
+    std::string_view text(std::string_view source) const {
+        return source.substr(offset, length);
+    }
+};
+
+// Instruction set used to classify bytes in bulk
+enum class SimdLevel {
+    Scalar,
+    SSE2,  // 16 bytes per step
+    AVX2   // 32 bytes per step
+};
+
 class Tokenizer {
 public:
     Tokenizer();
-    
+
     // Tokenize C++ code
-    std::vector<Token> tokenize(const std::string& code);
-    
+    std::vector<Token> tokenize(const std::string& code) const;
+
+    // Zero-copy tokenization into out (cleared first). Whitespace is skipped;
+    // comments, raw strings and preprocessor lines come out as single tokens.
+    // Non-ASCII bytes are treated as identifier characters (UTF-8 names).
+    void scan(std::string_view code, std::vector<TokenView>& out) const;
+    std::vector<TokenView> scan(std::string_view code) const;
+
+    // Best level the running CPU supports
+    static SimdLevel detectSimdLevel();
+
+    // Force a level (clamped to what the CPU supports); mainly for testing
+    void setSimdLevel(SimdLevel level);
+    SimdLevel simdLevel() const { return level; }
+
     // Get symbol table (variable names and their types)
     std::unordered_map<std::string, std::string> getSymbolTable() const;
-    
+
     // Parse type from assignment (e.g., "vector v" -> extract "vector")
     std::string extractTypeFromContext(
         const std::string& code,
         int cursorPosition
-    );
-    
+    ) const;
+
 private:
     std::unordered_map<std::string, std::string> symbolTable;
-    std::unordered_map<std::string, bool> keywords;
-    
+    std::vector<std::string_view> keywordSlots;
+    SimdLevel level;
+
     void initializeKeywords();
-    bool isKeyword(const std::string& word) const;
-    bool isIdentifierStart(char c) const;
-    bool isIdentifierPart(char c) const;
+    bool isKeyword(std::string_view word) const;
     bool isOperator(char c) const;
 };
 
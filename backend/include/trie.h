@@ -1,46 +1,121 @@
 #pragma once
 
+#include "flat_array.h"
+#include "symbol_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
-#include <memory>
 
 namespace codeflow {
 
+// Stable index of a node inside the trie's node pool. The root is node 0.
+using NodeId = std::uint32_t;
+
+// Child link: the edge label plus the index of the child node.
+struct TrieEdge {
+    char label;
+    NodeId child;
+};
+
+// Nodes are stored by value in one contiguous pool. A node's children occupy
+// the block [edgeBegin, edgeBegin + edgeCount) of the edge pool, sorted by
+// label; a terminal node refers to its word in the global SymbolPool. The
+// block [rankedBegin, rankedBegin + rankedCount) of the ranked pool holds the
+// best terminal nodes of the subtree, best first.
 struct TrieNode {
-    std::unordered_map<char, std::shared_ptr<TrieNode>> children;
-    std::string word;
-    bool isEnd = false;
-    int frequency = 0;
     long long lastUsed = 0;
+    std::uint32_t edgeBegin = 0;
+    std::uint16_t edgeCount = 0;
+    std::uint16_t edgeCapacity = 0;
+    std::uint32_t rankedBegin = 0;
+    std::uint16_t rankedCount = 0;
+    std::uint16_t rankedCapacity = 0;
+    SymbolId symbol = kNoSymbol;
+    int frequency = 0;
+
+    bool isEnd() const { return symbol != kNoSymbol; }
 };
 
 class Trie {
 public:
+    static constexpr NodeId kNoNode = UINT32_MAX;
+
+    // Completions precomputed per node; larger requests fall back to a walk
+    static constexpr std::size_t kTopK = 16;
+
     Trie();
-    
-    // Insert a word with frequency and metadata
-    void insert(const std::string& word, int frequency = 1, long long lastUsed = 0);
-    
+
+    // Insert a word with frequency and metadata; the word is interned
+    void insert(std::string_view word, int frequency = 1, long long lastUsed = 0);
+
     // Search for prefix and return ranked suggestions
     std::vector<std::string> search(
         const std::string& prefix,
         int maxResults = 8
-    );
-    
+    ) const;
+
+    // Best completions of prefix (at most kTopK), best first. The span points
+    // into the trie and is invalidated by the next insert.
+    std::span<const NodeId> completions(std::string_view prefix) const;
+
+    // Best maxResults completions of prefix written to out, best first.
+    // Requests beyond kTopK rank the whole subtree.
+    void completions(std::string_view prefix, std::size_t maxResults,
+                     std::vector<NodeId>& out) const;
+
+    // Word, interned id and frequency of a terminal node
+    std::string_view word(NodeId node) const { return wordOf(nodes[node]); }
+    SymbolId symbol(NodeId node) const { return symbolOf(nodes[node]); }
+    int frequency(NodeId node) const { return nodes[node].frequency; }
+
+    // Serve the trie straight from external pools, e.g. a mapped index file.
+    // Node symbols there are relative to symbolBase. The memory must outlive
+    // the trie; the first insert copies it into owned storage.
+    void view(std::span<const TrieNode> nodePool, std::span<const TrieEdge> edgePool,
+              std::span<const NodeId> rankedPool, std::size_t words, SymbolId symbolBase);
+
+    // Raw pools, for serialization. Node symbols are relative to
+    // symbolBase() (0 unless the trie is a view).
+    std::span<const TrieNode> nodePool() const { return {nodes.data(), nodes.size()}; }
+    std::span<const TrieEdge> edgePool() const { return {edges.data(), edges.size()}; }
+    std::span<const NodeId> rankedPool() const { return {ranked.data(), ranked.size()}; }
+    SymbolId symbolBase() const { return base; }
+
     // Get all words (for loading from data)
     std::vector<std::string> getAllWords() const;
-    
+
     // Load words from vector
     void loadWords(const std::vector<std::string>& words);
-    
+
+    // Number of distinct words stored
+    std::size_t size() const { return wordCount; }
+
+    // Bytes held by the node, edge and ranked pools (words live in the
+    // shared SymbolPool, and viewed pools are not counted)
+    std::size_t memoryUsage() const;
+
 private:
-    std::shared_ptr<TrieNode> root;
-    std::vector<std::string> dfs(
-        std::shared_ptr<TrieNode> node,
-        int& count,
-        int maxResults
-    );
+    FlatArray<TrieNode> nodes;
+    FlatArray<TrieEdge> edges;
+    FlatArray<NodeId> ranked;
+    std::size_t wordCount = 0;
+    SymbolId base = 0;
+
+    NodeId findChild(NodeId node, char c) const;
+    NodeId addChild(NodeId node, char c);
+    NodeId findNode(std::string_view prefix) const;
+    std::string_view wordOf(const TrieNode& node) const;
+    SymbolId symbolOf(const TrieNode& node) const {
+        return node.isEnd() ? node.symbol + base : kNoSymbol;
+    }
+    void makeEditable();
+    bool ranksBefore(NodeId a, NodeId b) const;
+    void promote(NodeId node, NodeId terminal);
+    void rebuildRanking(NodeId node);
+    void collect(NodeId node, std::vector<NodeId>& out) const;
 };
 
 }  // namespace codeflow
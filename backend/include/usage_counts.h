@@ -0,0 +1,83 @@
+#pragma once
+
+#include "symbol_pool.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace codeflow {
+
+// How often each symbol has been picked from the completion list, as an
+// exponentially decaying count: an acceptance is worth 1 when it happens
+// and half that after every half-life. Symbols are kept in a fixed-size
+// open-addressed table of relaxed atomics, so reading never locks and never
+// blocks queries; once the table is full, new symbols are not tracked.
+// Existing symbols still are.
+//
+// Counts are keyed by a hash of the name, not by SymbolId: a name
+// interned before an index file was mapped has a second id in the index.
+class UsageCounts {
+public:
+    static constexpr std::size_t kDefaultCapacity = 1 << 14;
+    static constexpr double kDefaultHalfLifeSeconds = 7 * 24 * 3600.0;
+
+    // capacity is rounded up to a power of two
+    explicit UsageCounts(std::size_t capacity = kDefaultCapacity,
+                         double halfLifeSeconds = kDefaultHalfLifeSeconds);
+    UsageCounts(const UsageCounts&) = delete;
+    UsageCounts& operator=(const UsageCounts&) = delete;
+
+    // Wall-clock seconds since the Unix epoch, the time base of counts (so
+    // they can be saved and decay across restarts)
+    static std::uint32_t now();
+
+    // Add weight acceptances of name at time at; false if the symbol pool
+    // does not know name (it is not a completion) or the table is full.
+    // Looks name up in the pool, so it may briefly lock.
+    bool record(std::string_view name, std::uint32_t at, float weight = 1.0f);
+
+    // Decayed count of name at time at; 0 if it was never recorded.
+    // Lock-free.
+    float score(std::string_view name, std::uint32_t at) const;
+
+    // Distinct symbols recorded
+    std::size_t size() const { return used.load(std::memory_order_relaxed); }
+    std::size_t capacity() const { return mask + 1; }
+    std::size_t memoryUsage() const;
+
+    // Write every count to path by name, as "count last-used name" lines
+    // (symbol ids are only stable within a process), through a temporary
+    // file renamed into place. Counts recorded meanwhile may or may not be
+    // included.
+    bool save(const std::string& path, std::string* error = nullptr) const;
+
+    // Add the counts saved at path. Names the symbol pool does not know
+    // (dropped from the index since) are skipped, so load after the index.
+    bool load(const std::string& path, std::string* error = nullptr);
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> key{0}; // Name hash; 0 marks a free slot
+        std::atomic<SymbolId> symbol{kNoSymbol}; // For the name, when saving
+        // Last-used time in the high half, count as of then (float bits) in
+        // the low half, so both change in one compare-exchange
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::size_t mask;
+    double halfLife;
+    std::atomic<std::size_t> used{0};
+
+    static std::uint64_t keyOf(std::string_view name);
+    // Slot holding key, or null if it has none
+    const Slot* find(std::uint64_t key) const;
+    // Slot holding key, claiming a free one; null if the table is full
+    Slot* claim(std::uint64_t key, SymbolId symbol);
+    float decayed(std::uint64_t value, std::uint32_t at) const;
+};
+
+}  // namespace codeflow
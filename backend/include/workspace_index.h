@@ -0,0 +1,176 @@
+#pragma once
+
+#include "scope_index.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace codeflow {
+
+// A declaration in a workspace file: a function, class, variable or alias
+// at namespace scope, or a member of a class declared there. Views point
+// into the WorkspaceFile's text.
+struct WorkspaceSymbol {
+    std::string_view name;
+    std::string_view type;        // As written; a function's return type
+    std::string_view declaration; // Type through declarator, for display
+    std::string_view container;   // A member's class, else empty
+    ScopeIndex::SymbolKind kind;
+    std::uint32_t firstMember = 0; // Type: its members in symbols
+    std::uint32_t memberCount = 0;
+};
+
+// What one file contributes. Immutable once indexed and shared between
+// snapshots, so an update re-indexes only the files that changed.
+struct WorkspaceFile {
+    std::string path; // Relative to the workspace root
+    std::string text; // The characters the symbols view
+    std::vector<WorkspaceSymbol> symbols;
+    std::uint64_t bytes = 0; // Size of the source
+
+    WorkspaceFile() = default;
+    WorkspaceFile(const WorkspaceFile&) = delete;
+    WorkspaceFile& operator=(const WorkspaceFile&) = delete;
+
+    std::size_t memoryUsage() const;
+};
+
+// Every indexed file, by path, and their namespace-scope symbols by name
+struct WorkspaceSymbols {
+    struct Ref {
+        std::uint32_t file;
+        std::uint32_t symbol;
+    };
+
+    std::vector<std::shared_ptr<const WorkspaceFile>> files;
+    std::vector<Ref> byName; // Sorted by name, ignoring ASCII case
+    std::size_t symbolCount = 0;
+    std::uint64_t bytes = 0;
+
+    const WorkspaceFile& file(Ref ref) const { return *files[ref.file]; }
+    const WorkspaceSymbol& symbol(Ref ref) const {
+        return files[ref.file]->symbols[ref.symbol];
+    }
+
+    // Symbols whose name starts with prefix, ignoring ASCII case
+    std::span<const Ref> withPrefix(std::string_view prefix) const;
+
+    // The class (or alias) or variable named name, exactly; null if there
+    // is none
+    const Ref* findType(std::string_view name) const;
+    const Ref* findVariable(std::string_view name) const;
+
+    // A class's members
+    std::span<const WorkspaceSymbol> members(Ref type) const;
+};
+
+struct WorkspaceStats {
+    std::size_t files = 0;
+    std::size_t symbols = 0;
+    std::uint64_t bytes = 0; // Source indexed
+    std::size_t memoryBytes = 0;
+    bool watching = false;
+    std::size_t watchedDirectories = 0;
+    // The last full index: walking the tree, mapping and indexing
+    std::size_t indexedFiles = 0;
+    std::uint64_t indexedBytes = 0;
+    std::size_t skippedFiles = 0; // Over kMaxFileBytes or unreadable
+    double indexMs = 0;
+    double filesPerSecond = 0;
+    double megabytesPerSecond = 0;
+    // Watch events since: batches applied and files re-indexed or dropped
+    std::uint64_t updates = 0;
+    std::uint64_t updatedFiles = 0;
+};
+
+// Symbols of the C and C++ sources under a workspace root, for completing
+// names the request's code does not declare itself.
+//
+// open() walks the root on a thread pool, maps each source and header
+// read-only and indexes it with ScopeIndex, keeping only the symbols' text.
+// watch() then follows changes with inotify on a background thread: once a
+// burst of events has been quiet for kSettleMs, the files they name are
+// re-indexed and published with the unchanged ones. Readers get immutable
+// snapshots (Snapshot<WorkspaceSymbols>) and never wait for indexing.
+class WorkspaceIndex {
+public:
+    static constexpr std::size_t kMaxFileBytes = 4 * 1024 * 1024;
+    static constexpr int kSettleMs = 50;
+
+    WorkspaceIndex() = default;
+    ~WorkspaceIndex();
+    WorkspaceIndex(const WorkspaceIndex&) = delete;
+    WorkspaceIndex& operator=(const WorkspaceIndex&) = delete;
+
+    // Index every source and header under root (.h, .hpp, .hh, .hxx, .ipp,
+    // .c, .cc, .cpp, .cxx, .c++) on threads workers (0: one per core),
+    // replacing the current index and stopping any watch. Hidden directories
+    // and node_modules are skipped, symbolic links not followed. False if
+    // root is not a directory.
+    bool open(const std::string& root, std::size_t threads = 0,
+              std::string* error = nullptr);
+
+    // Follow changes under the root until stopWatching(), close() or
+    // destruction. False if inotify is unavailable.
+    bool watch(std::string* error = nullptr);
+    void stopWatching();
+
+    // Stop watching and publish an empty index
+    void close();
+
+    // Re-index the sources at these paths, relative to the root: a file is
+    // indexed again or dropped if it is gone; a directory's files likewise
+    // and any new ones under it. What the watcher does for each burst.
+    void update(const std::vector<std::string>& paths);
+
+    // The current snapshot; see Snapshot::read for how long it stays valid
+    const WorkspaceSymbols* read(std::uint64_t& generation) const {
+        return published.read(generation);
+    }
+    std::shared_ptr<const WorkspaceSymbols> acquire() const {
+        return published.acquire();
+    }
+
+    WorkspaceStats stats() const;
+
+    // The symbols of one source
+    static std::shared_ptr<const WorkspaceFile> indexText(std::string path,
+                                                          std::string_view text);
+
+    // Whether path names a source or header, by its extension
+    static bool isSource(std::string_view path);
+
+private:
+    Snapshot<WorkspaceSymbols> published;
+    std::mutex writeMutex; // Serializes open, update and close
+    mutable std::mutex statsMutex;
+    std::string rootPath;
+    WorkspaceStats counters; // Under statsMutex; files and symbols derived
+
+    // Watcher state: the descriptors and thread belong to watch() and
+    // stopWatching() (serialized by watchMutex), the map to the watcher
+    // thread while it runs
+    std::mutex watchMutex;
+    int inotifyFd = -1;
+    int wakeFd = -1;
+    std::thread watcher;
+    std::unordered_map<int, std::string> watches; // Descriptor -> directory
+
+    // The file at path (relative to the root), read through a mapping;
+    // null if it cannot be read or is too large
+    std::shared_ptr<const WorkspaceFile> indexFile(const std::string& path) const;
+    void publish(std::vector<std::shared_ptr<const WorkspaceFile>> files);
+    void watchLoop();
+    void watchTree(const std::string& directory);
+    void unwatchTree(const std::string& directory);
+};
+
+}  // namespace codeflow
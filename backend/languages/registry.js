@@ -7,6 +7,15 @@
 
 const config = require('../config');
 
+// Per build tier, shared by compileCmd and pchCmd: a precompiled header is
+// only used by compiles with the flags it was built with. Fast builds are
+// what a judge would run; sanitizer builds explain their crashes, at several
+// times the compile and run time.
+const CPP_FLAGS = {
+  fast: '-std=c++20 -O1',
+  sanitized: '-std=c++20 -O1 -g -D_GLIBCXX_DEBUG -fsanitize=address,undefined -fno-omit-frame-pointer'
+};
+
 const LANGUAGE_REGISTRY = {
   cpp: {
     id: 'cpp',
@@ -15,9 +24,21 @@ const LANGUAGE_REGISTRY = {
     filename: 'main.cpp',
     outputFilename: 'program',
     isCompiled: true,
-    compileCmd: (srcFile, binFile) => `${config.TOOLCHAINS.CXX} -std=c++20 -O2 -o "${binFile}" "${srcFile}" 2>&1`,
-    runCmd: (binFile) => `"${binFile}"`,
-    dockerRunCmd: './program',
+    // Build tiers, cheapest first; see the job queue's execution modes
+    tiers: ['fast', 'sanitized'],
+    compileCmd: (srcFile, binFile, pchHeader = null, tier = 'fast') =>
+      `${config.TOOLCHAINS.CXX} ${CPP_FLAGS[tier]}${pchHeader ? ` -include "${pchHeader}"` : ''} -o "${binFile}" "${srcFile}" 2>&1`,
+    pchCmd: (header, output, tier = 'fast') =>
+      `${config.TOOLCHAINS.CXX} ${CPP_FLAGS[tier]} -x c++-header "${header}" -o "${output}" 2>&1`,
+    // Sanitizer builds run without ulimit -v, since ASan reserves terabytes
+    // of address space; resident memory is capped instead. An ASan report
+    // ends in abort() so it reads as a crash, and stdbuf's preload must not
+    // stop ASan from starting.
+    sanitizerEnv: { ASAN_OPTIONS: 'hard_rss_limit_mb=256:abort_on_error=1:verify_asan_link_order=0' },
+    // Line-buffered, so output streams as it is printed rather than in 4 KB
+    // blocks once stdout is a pipe
+    runCmd: (binFile) => `stdbuf -oL "${binFile}"`,
+    dockerRunCmd: 'stdbuf -oL ./program',
     compileTimeoutMs: config.COMPILE_TIMEOUT_MS,
     executionTimeoutMs: config.EXECUTION_TIMEOUT_MS
   },
@@ -30,8 +51,8 @@ const LANGUAGE_REGISTRY = {
     outputFilename: null,
     isCompiled: false,
     compileCmd: null,
-    runCmd: (srcFile) => `${config.TOOLCHAINS.PYTHON} "${srcFile}"`,
-    dockerRunCmd: 'python3 script.py',
+    runCmd: (srcFile) => `${config.TOOLCHAINS.PYTHON} -u "${srcFile}"`,
+    dockerRunCmd: 'python3 -u script.py',
     compileTimeoutMs: 0,
     executionTimeoutMs: config.EXECUTION_TIMEOUT_MS
   },
@@ -23,7 +23,6 @@ const compression = require('compression');
 const config = require('./config');
 const {
   STL_DB,
-  containerTries,
   ALL_HEADERS,
   ALL_STL_TYPES,
   TEMPLATE_ARGS,
@@ -33,8 +32,10 @@ const {
 const { getSupportedLanguageKeys } = require('./languages/registry');
 const { TokenBucketLimiter } = require('./src/security/rateLimiter');
 const { LRUCache } = require('./src/cache/lruCache');
-const { defaultQueue } = require('./src/queue/jobQueue');
+const { defaultQueue, EXECUTION_MODES } = require('./src/queue/jobQueue');
 const { performReadinessCheck } = require('./src/probes/readiness');
+const native = require('./src/native/nativeEngine');
+const { httpRequestSeconds, renderMetrics } = require('./src/probes/metrics');
 
 const app = express();
 app.set('trust proxy', 1);
@@ -110,9 +111,18 @@ const runCodeLimiter = new TokenBucketLimiter({
 const suggestionsCache = new LRUCache({ capacity: 2000, ttlMs: 5 * 60 * 1000 });
 const statsCache = new LRUCache({ capacity: 1000, ttlMs: 5 * 60 * 1000 });
 
-// Request timing
+// Request timing, recorded per route pattern for /metrics (not per path,
+// so ids in paths don't make a series each)
 app.use((req, res, next) => {
   req._startTime = Date.now();
+  const start = process.hrtime.bigint();
+  res.on('finish', () => {
+    const route = req.route ? req.baseUrl + req.route.path : 'unmatched';
+    httpRequestSeconds.observe(
+      { method: req.method, route, status: res.statusCode },
+      Number(process.hrtime.bigint() - start) / 1e9
+    );
+  });
   next();
 });
 
@@ -198,6 +208,29 @@ function getAllowedContainers(includes) {
   return [...allowed];
 }
 
+/**
+ * UTF-8 byte offset of the cursor in code, for the native engine: from
+ * cursorPosition (a string index) or 1-based line and column, as the editor
+ * sends them. Undefined if the request has neither.
+ */
+function cursorOffset(code, { cursorPosition, line, column }) {
+  let index;
+  if (Number.isInteger(cursorPosition) && cursorPosition >= 0) {
+    index = cursorPosition;
+  } else if (Number.isInteger(line) && Number.isInteger(column) && line >= 1 && column >= 1) {
+    index = 0;
+    for (let l = 1; l < line && index !== -1; l++) {
+      index = code.indexOf('\n', index);
+      if (index !== -1) index++;
+    }
+    if (index === -1) return undefined;
+    index += column - 1;
+  } else {
+    return undefined;
+  }
+  return Buffer.byteLength(code.slice(0, index));
+}
+
 function parseAllVariables(code) {
   const symbolTable = {};
   if (!code) return symbolTable;
@@ -274,6 +307,12 @@ function inferVariableType(varName, code) {
   return null;
 }
 
+/** Methods of a container whose name starts with prefix (case-insensitive) */
+function searchMethods(methods = [], prefix) {
+  const p = prefix.toLowerCase();
+  return methods.filter(m => m.name.toLowerCase().startsWith(p));
+}
+
 /**
  * Extract simple declared variable names from code
  */
@@ -340,13 +379,24 @@ const healthHandler = (req, res) => {
     status: 'ok',
     version: '2.0.0',
     timestamp: new Date().toISOString(),
+    engine: native.engine ? 'native' : 'javascript',
     containers: Object.keys(STL_DB).length,
     totalMethods: Object.values(STL_DB).reduce((s, c) => s + (c.methods?.length || 0), 0),
     cache: {
       suggestions: suggestionsCache.getStats(),
-      stats: statsCache.getStats()
+      stats: statsCache.getStats(),
+      compile: defaultQueue.compileCache.getStats(),
+      nativeCompile: native.engine ? native.engine.getCompileCacheStats() : null,
+      nativeSuggestions: native.engine ? native.engine.getResponseCacheStats() : null
+    },
+    pch: {
+      queue: defaultQueue.pchCache.getStats(),
+      native: native.engine ? native.engine.getPchStats() : null
     },
     queue: defaultQueue.getMetrics(),
+    nativePool: native.engine ? native.engine.getPoolStats() : null,
+    learnedSymbols: native.engine ? native.engine.getLearnedSymbolCount() : null,
+    workspaceIndex: native.engine ? native.engine.getWorkspaceStats() : null,
     memoryUsageMB: {
       rss: (process.memoryUsage().rss / (1024 * 1024)).toFixed(1),
       heapUsed: (process.memoryUsage().heapUsed / (1024 * 1024)).toFixed(1)
@@ -357,17 +407,52 @@ const healthHandler = (req, res) => {
 app.get('/health', healthHandler);
 app.get('/api/health', healthHandler);
 
+/**
+ * GET /metrics
+ * Prometheus scrape endpoint: request, job and native engine stage latency
+ */
+app.get('/metrics', (req, res) => {
+  res.type('text/plain; version=0.0.4; charset=utf-8');
+  res.send(renderMetrics({ engine: native.engine, queue: defaultQueue }));
+});
+
 // ─────────────────────────────────────────────
 // AUTOCOMPLETE & STATS WITH LRU CACHING
 // ─────────────────────────────────────────────
 
 /**
  * POST /api/getSuggestions
- * Body: { prefix, contextType, code, cursorPosition }
+ * Body: { prefix, contextType, code, cursorPosition } or { ..., line, column }
+ *
+ * Served by the native engine when the addon and symbol index are available
+ * (X-Engine: native); the JavaScript implementation below is the fallback.
+ * The engine resolves a member access's object (contextType) through the
+ * scopes around the cursor, and also completes members of classes the code
+ * defines. With WORKSPACE_INDEX, global completions and member accesses
+ * also see the declarations of the other sources under WORKSPACE_ROOT.
  */
 app.post('/api/getSuggestions', suggestionsLimiter, (req, res) => {
   try {
     const { prefix = '', contextType = 'global', code = '', language = 'cpp' } = req.body;
+    // Subsequence matching ("pb" -> push_back); the JavaScript fallback only
+    // matches prefixes
+    const fuzzy = req.body.fuzzy === true;
+
+    if (native.engine) {
+      res.set('X-Engine', 'native');
+      // The engine caches the serialized body, keyed on what the results
+      // depend on (see completeJson in backend/include/suggestion_engine.h),
+      // so a hit is sent as is
+      const source = String(code);
+      const cursor = cursorOffset(source, req.body);
+      const { body, hit } = native.engine.completeJson(
+        String(language), String(prefix), String(contextType), source, 20, { fuzzy, cursor }
+      );
+      res.set('X-Cache', hit ? 'HIT' : 'MISS');
+      res.type('application/json');
+      return res.send(body);
+    }
+    res.set('X-Engine', 'javascript');
 
     const includes = parseIncludes(code);
     const sortedIncludesKey = includes.slice().sort().join(',');
@@ -426,14 +511,13 @@ app.post('/api/getSuggestions', suggestionsLimiter, (req, res) => {
         return res.json([]);
       }
 
-      const trie = containerTries[resolvedType];
-      if (!trie) {
+      const containerInfo = STL_DB[resolvedType];
+      if (!containerInfo) {
         res.set('X-Cache', 'BYPASS');
         return res.json([]);
       }
 
-      const methods = trie.search(prefix);
-      const containerInfo = STL_DB[resolvedType];
+      const methods = searchMethods(containerInfo.methods, prefix);
 
       const scored = methods.map(m => {
         let score = 50;
@@ -495,9 +579,9 @@ app.post('/api/getSuggestions', suggestionsLimiter, (req, res) => {
 
     // 3b. Add algorithm functions if <algorithm> is included
     if (allowedContainers.includes('algorithm')) {
-      const algoTrie = containerTries['algorithm'];
-      if (algoTrie) {
-        const algos = algoTrie.search(prefix);
+      const algoInfo = STL_DB['algorithm'];
+      if (algoInfo) {
+        const algos = searchMethods(algoInfo.methods, prefix);
         for (const a of algos.slice(0, 10)) {
           results.push({
             text: a.name,
@@ -542,6 +626,25 @@ app.post('/api/getSuggestions', suggestionsLimiter, (req, res) => {
   }
 });
 
+/**
+ * POST /api/acceptCompletion
+ * Body: { text }
+ *
+ * The user picked `text` from the suggestion list. The native engine counts
+ * it and ranks it higher in later POST /api/getSuggestions responses; the
+ * counts decay over time and are snapshotted to disk in the background.
+ */
+app.post('/api/acceptCompletion', suggestionsLimiter, (req, res) => {
+  const { text } = req.body;
+  if (typeof text !== 'string' || text.length === 0 || text.length > 256) {
+    return res.status(400).json({ error: 'text must be a non-empty string' });
+  }
+  if (!native.engine) {
+    return res.json({ recorded: false });
+  }
+  res.json({ recorded: native.engine.recordAccepted(text) });
+});
+
 /**
  * POST /api/getStats
  * Body: { code }
@@ -627,6 +730,21 @@ function validateRunCodeInput(req, res, next) {
   next();
 }
 
+/**
+ * X-Execution-Mode: comma-separated options. "async" answers 202 with a jobId
+ * at once; "tiered", "fast" or "sanitized" picks how C++ is built (see
+ * executeJobInSandbox). Unknown options are listed in `unknown`.
+ */
+function parseExecutionModeHeader(header) {
+  const options = String(header || '').split(',').map(option => option.trim().toLowerCase()).filter(Boolean);
+  const modes = options.filter(option => EXECUTION_MODES.includes(option));
+  return {
+    async: options.includes('async'),
+    executionMode: modes[modes.length - 1],
+    unknown: options.filter(option => option !== 'async' && !EXECUTION_MODES.includes(option))
+  };
+}
+
 /**
  * POST /api/runCode
  * Body: { code, language }
@@ -637,22 +755,33 @@ app.post('/api/runCode', validateRunCodeInput, runCodeLimiter.middleware(), asyn
   const { code } = req.body;
   const cleanLang = req.cleanLanguage || 'cpp';
   const clientIp = req.headers['x-forwarded-for'] || req.ip || '127.0.0.1';
+  const executionHeader = parseExecutionModeHeader(req.headers['x-execution-mode']);
+  if (executionHeader.unknown.length > 0) {
+    return res.status(400).json({
+      success: false,
+      output: '',
+      error: `Unknown X-Execution-Mode option "${executionHeader.unknown[0]}". Allowed: async, ${EXECUTION_MODES.join(', ')}`
+    });
+  }
 
   // 1. Enqueue job into JobQueue
   const job = defaultQueue.enqueue({
     code,
     language: cleanLang,
-    clientIp
+    clientIp,
+    executionMode: executionHeader.executionMode
   });
 
-  const isAsyncMode = req.query.async === 'true' || req.headers['x-execution-mode'] === 'async';
+  const isAsyncMode = req.query.async === 'true' || executionHeader.async;
 
   if (isAsyncMode) {
     return res.status(202).json({
       jobId: job.id,
       status: job.status,
+      executionMode: job.executionMode,
       createdAt: job.createdAt,
-      pollUrl: `/api/jobs/${job.id}`
+      pollUrl: `/api/jobs/${job.id}`,
+      streamUrl: `/api/runCode/${job.id}`
     });
   }
 
@@ -674,6 +803,9 @@ app.post('/api/runCode', validateRunCodeInput, runCodeLimiter.middleware(), asyn
       success: result.success,
       output: result.output || '',
       error: result.error || '',
+      tier: result.tier || null,
+      escalated: Boolean(result.escalated),
+      profile: result.profile || null,
       jobId: finishedJob.id
     });
   } catch (err) {
@@ -684,7 +816,8 @@ app.post('/api/runCode', validateRunCodeInput, runCodeLimiter.middleware(), asyn
 
 /**
  * GET /api/jobs/:jobId & GET /api/runCode/:jobId
- * Poll status of an async execution job
+ * Poll status of an async execution job, or follow it as Server-Sent Events
+ * when the client accepts text/event-stream (or passes ?stream=sse)
  */
 const getJobHandler = (req, res) => {
   const { jobId } = req.params;
@@ -692,10 +825,14 @@ const getJobHandler = (req, res) => {
   if (!job) {
     return res.status(404).json({ error: `Job ${jobId} not found or expired` });
   }
+  if (req.query.stream === 'sse' || (req.headers.accept || '').includes('text/event-stream')) {
+    return streamJob(req, res, job);
+  }
   res.json({
     id: job.id,
     status: job.status,
     language: job.language,
+    executionMode: job.executionMode,
     createdAt: job.createdAt,
     startedAt: job.startedAt,
     finishedAt: job.finishedAt,
@@ -704,6 +841,62 @@ const getJobHandler = (req, res) => {
   });
 };
 
+/**
+ * Server-Sent Events for one job: `status` ({ phase }), `stdout` and `stderr`
+ * (text chunks), `truncated` ({ reason, ... }) and finally `exit` (the
+ * outcome), after which the response ends. Event ids let a reconnecting
+ * EventSource resume via Last-Event-ID. Each chunk is written as soon as the
+ * program prints it; if the client reads slower than the program writes, the
+ * socket's backpressure stops the reader, which in turn pauses the program.
+ */
+function streamJob(req, res, job) {
+  const lastEventId = parseInt(req.headers['last-event-id'], 10);
+  const reader = job.stream.reader(Number.isInteger(lastEventId) ? lastEventId : -1);
+
+  // no-transform keeps the compression middleware from buffering events
+  res.writeHead(200, {
+    'Content-Type': 'text/event-stream; charset=utf-8',
+    'Cache-Control': 'no-cache, no-transform',
+    'Connection': 'keep-alive',
+    'X-Accel-Buffering': 'no'
+  });
+  res.write('retry: 1000\n\n');
+
+  let waitingForSocket = false;
+  let finished = false;
+  const flush = () => {
+    if (waitingForSocket || finished) return;
+    let event;
+    while ((event = job.stream.next(reader))) {
+      const data = JSON.stringify(event.data);
+      const writable = res.write(`id: ${event.seq}\nevent: ${event.type}\ndata: ${data}\n\n`);
+      if (event.type === 'exit') {
+        finish();
+        return res.end();
+      }
+      if (!writable) {
+        waitingForSocket = true;
+        return res.once('drain', () => {
+          waitingForSocket = false;
+          flush();
+        });
+      }
+    }
+  };
+  const heartbeat = setInterval(() => res.write(': ping\n\n'), config.STREAM_HEARTBEAT_MS);
+  const finish = () => {
+    if (finished) return;
+    finished = true;
+    clearInterval(heartbeat);
+    job.stream.removeListener('data', flush);
+    job.stream.release(reader);
+  };
+
+  job.stream.on('data', flush);
+  req.on('close', finish);
+  flush();
+}
+
 app.get('/api/jobs/:jobId', getJobHandler);
 app.get('/api/runCode/:jobId', getJobHandler);
 
@@ -832,6 +1025,47 @@ app.use((err, req, res, next) => {
 });
 
 if (require.main === module) {
+  if (native.engine) {
+    // Written on a native worker thread; queries and feedback don't wait
+    let saving = false;
+    let warned = false;
+    setInterval(() => {
+      if (saving || native.engine.getLearnedSymbolCount() === 0) return;
+      saving = true;
+      native.engine.saveUsageAsync(config.USAGE_SNAPSHOT_PATH)
+        .then(saved => {
+          if (!saved && !warned) {
+            warned = true;
+            console.warn(`Could not write usage snapshot to ${config.USAGE_SNAPSHOT_PATH}`);
+          }
+        })
+        .catch(() => {})
+        .finally(() => { saving = false; });
+    }, config.USAGE_SNAPSHOT_INTERVAL_MS).unref();
+
+    // Build the native runner's precompiled headers off the request path
+    if (config.PCH_DIR) {
+      native.engine.warmPrecompiledHeadersAsync().catch(() => {});
+    }
+
+    // Index the workspace's sources in the background; completions see
+    // them once it resolves, and changes from then on as they are saved
+    if (config.WORKSPACE_INDEX) {
+      native.engine.openWorkspaceAsync(config.WORKSPACE_ROOT, { watch: true })
+        .then(stats => {
+          console.log(`   Indexed ${stats.files} workspace files (${stats.symbols} symbols) in ` +
+                      `${stats.indexMs.toFixed(0)} ms: ${stats.filesPerSecond.toFixed(0)} files/s, ` +
+                      `${stats.megabytesPerSecond.toFixed(1)} MB/s`);
+        })
+        .catch(err => console.warn(`Workspace index unavailable: ${err.message}`));
+    }
+  }
+
+  // Likewise the job queue's, for every language and build tier in turn
+  if (config.PCH_DIR) {
+    defaultQueue.warmPrecompiledHeaders().catch(() => {});
+  }
+
   app.listen(config.PORT, () => {
     const totalMethods = Object.values(STL_DB).reduce((s, c) => s + (c.methods?.length || 0), 0);
     console.log(`\n⚡ IntelliCPP Backend v2.0 (High-Concurrency Ready)`);
@@ -841,7 +1075,7 @@ if (require.main === module) {
     console.log(`   Languages:  ${getSupportedLanguageKeys().join(', ')}`);
     console.log(`   Workspace:  ${config.WORKSPACE_ROOT}`);
     console.log(`   Queue:      InMemory (Concurrency: ${defaultQueue.concurrency})`);
-    console.log(`   Endpoints:  /ready /live /health /api/getSuggestions /api/getStats /api/runCode /api/jobs/:id\n`);
+    console.log(`   Endpoints:  /ready /live /health /metrics /api/getSuggestions /api/acceptCompletion /api/getStats /api/runCode /api/jobs/:id\n`);
   });
 }
 
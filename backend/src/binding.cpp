@@ -1,6 +1,12 @@
 #include "../include/code_runner.h"
+#include "../include/engine_metrics.h"
+#include "../include/suggestion_batch.h"
 #include "../include/suggestion_engine.h"
+#include "../include/thread_pool.h"
+#include <chrono>
+#include <memory>
 #include <napi.h>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -12,14 +18,84 @@ class SuggestionEngineWrapper : public ObjectWrap<SuggestionEngineWrapper> {
 private:
   codeflow::SuggestionEngine engine;
   CodeRunner codeRunner;
+  // Reused by getSuggestionsBatch, which runs on the JavaScript thread only
+  codeflow::SuggestionBatch batch;
+  codeflow::BatchPacker packer;
+  // Declared last so it is destroyed first, while the engine and runner its
+  // tasks use are still alive
+  codeflow::ThreadPool pool;
+
+  // Output chunks queued for runCodeAsync's onOutput before the program
+  // blocks
+  static constexpr size_t kOutputQueueChunks = 64;
+
+  // Passes a run's output to JavaScript, holding back a UTF-8 sequence split
+  // across reads until the rest of it arrives
+  struct OutputForwarder {
+    Napi::ThreadSafeFunction *function;
+    std::string pending[2];
+
+    void operator()(int stream, std::string_view data) {
+      std::string &text = pending[stream - 1];
+      text.append(data);
+      size_t complete = completeUtf8(text);
+      send(stream, text.substr(0, complete));
+      text.erase(0, complete);
+    }
+
+    // Length of text without a trailing incomplete UTF-8 sequence
+    static size_t completeUtf8(const std::string &text) {
+      for (size_t back = 1; back <= 3 && back <= text.size(); ++back) {
+        auto byte = static_cast<unsigned char>(text[text.size() - back]);
+        if ((byte & 0xC0) == 0x80)
+          continue; // Continuation byte; look for its lead
+        size_t length = byte >= 0xF0   ? 4
+                        : byte >= 0xE0 ? 3
+                        : byte >= 0xC0 ? 2
+                                       : 1;
+        return length > back ? text.size() - back : text.size();
+      }
+      return text.size();
+    }
+
+    void flush() {
+      for (int stream = 1; stream <= 2; ++stream) {
+        send(stream, std::move(pending[stream - 1]));
+        pending[stream - 1].clear();
+      }
+    }
+
+    void send(int stream, std::string text) {
+      if (text.empty())
+        return;
+      auto *chunk = new std::pair<int, std::string>(stream, std::move(text));
+      auto deliver = [](Napi::Env env, Napi::Function callback,
+                        std::pair<int, std::string> *raw) {
+        std::unique_ptr<std::pair<int, std::string>> chunk(raw);
+        if (env == nullptr)
+          return; // Environment shutting down
+        callback.Call({Napi::String::New(env, chunk->first == 1 ? "stdout"
+                                                                : "stderr"),
+                       Napi::String::New(env, chunk->second)});
+      };
+      if (function->BlockingCall(chunk, deliver) != napi_ok)
+        delete chunk;
+    }
+  };
 
 public:
   static Napi::Object Init(Napi::Env env, Napi::Object exports) {
     std::vector<ClassPropertyDescriptor<SuggestionEngineWrapper>> methods = {
         InstanceMethod("getSuggestions",
                        &SuggestionEngineWrapper::GetSuggestions),
+        InstanceMethod("getSuggestionsBatch",
+                       &SuggestionEngineWrapper::GetSuggestionsBatch),
+        InstanceMethod("complete", &SuggestionEngineWrapper::Complete),
+        InstanceMethod("completeJson", &SuggestionEngineWrapper::CompleteJson),
+        InstanceMethod("fuzzySearch", &SuggestionEngineWrapper::FuzzySearch),
         InstanceMethod("loadKeywords", &SuggestionEngineWrapper::LoadKeywords),
         InstanceMethod("loadSTLData", &SuggestionEngineWrapper::LoadSTLData),
+        InstanceMethod("loadIndex", &SuggestionEngineWrapper::LoadIndex),
         InstanceMethod("updateSymbols",
                        &SuggestionEngineWrapper::UpdateSymbols),
         InstanceMethod("getSymbolCount",
@@ -31,6 +107,46 @@ public:
         InstanceMethod("isHeaderIncluded",
                        &SuggestionEngineWrapper::IsHeaderIncluded),
         InstanceMethod("runCode", &SuggestionEngineWrapper::RunCode),
+        InstanceMethod("getSuggestionsAsync",
+                       &SuggestionEngineWrapper::GetSuggestionsAsync),
+        InstanceMethod("updateSymbolsAsync",
+                       &SuggestionEngineWrapper::UpdateSymbolsAsync),
+        InstanceMethod("runCodeAsync", &SuggestionEngineWrapper::RunCodeAsync),
+        InstanceMethod("cancel", &SuggestionEngineWrapper::Cancel),
+        InstanceMethod("getPoolStats", &SuggestionEngineWrapper::GetPoolStats),
+        InstanceMethod("getMetrics", &SuggestionEngineWrapper::GetMetrics),
+        InstanceMethod("getCompileCacheStats",
+                       &SuggestionEngineWrapper::GetCompileCacheStats),
+        InstanceMethod("getPchStats", &SuggestionEngineWrapper::GetPchStats),
+        InstanceMethod("getResponseCacheStats",
+                       &SuggestionEngineWrapper::GetResponseCacheStats),
+        InstanceMethod("openWorkspaceAsync",
+                       &SuggestionEngineWrapper::OpenWorkspaceAsync),
+        InstanceMethod("getWorkspaceStats",
+                       &SuggestionEngineWrapper::GetWorkspaceStats),
+        InstanceMethod("closeWorkspace", &SuggestionEngineWrapper::CloseWorkspace),
+        InstanceMethod("warmPrecompiledHeadersAsync",
+                       &SuggestionEngineWrapper::WarmPrecompiledHeadersAsync),
+        InstanceMethod("openSession", &SuggestionEngineWrapper::OpenSession),
+        InstanceMethod("updateSession",
+                       &SuggestionEngineWrapper::UpdateSession),
+        InstanceMethod("editSession", &SuggestionEngineWrapper::EditSession),
+        InstanceMethod("getSessionSuggestions",
+                       &SuggestionEngineWrapper::GetSessionSuggestions),
+        InstanceMethod("closeSession", &SuggestionEngineWrapper::CloseSession),
+        InstanceMethod("hasSession", &SuggestionEngineWrapper::HasSession),
+        InstanceMethod("setSessionMemoryBudget",
+                       &SuggestionEngineWrapper::SetSessionMemoryBudget),
+        InstanceMethod("getSessionStats",
+                       &SuggestionEngineWrapper::GetSessionStats),
+        InstanceMethod("recordAccepted",
+                       &SuggestionEngineWrapper::RecordAccepted),
+        InstanceMethod("getUsageScore", &SuggestionEngineWrapper::GetUsageScore),
+        InstanceMethod("getLearnedSymbolCount",
+                       &SuggestionEngineWrapper::GetLearnedSymbolCount),
+        InstanceMethod("saveUsageAsync",
+                       &SuggestionEngineWrapper::SaveUsageAsync),
+        InstanceMethod("loadUsage", &SuggestionEngineWrapper::LoadUsage),
     };
 
     Napi::Function constructor = DefineClass(env, "SuggestionEngine", methods);
@@ -38,9 +154,118 @@ public:
     return exports;
   }
 
-  SuggestionEngineWrapper(const Napi::CallbackInfo &info) : ObjectWrap(info) {}
+  // new SuggestionEngine({ workerThreads, compileCacheDir,
+  // compileCacheBytes, pchDir, responseCacheBytes, responseCacheTtlMs })
+  // sizes the pool behind the *Async methods, places runCode's compile cache
+  // and precompiled headers (an empty directory disables either) and bounds
+  // completeJson's response cache
+  SuggestionEngineWrapper(const Napi::CallbackInfo &info)
+      : ObjectWrap(info),
+        codeRunner(CompileCacheDir(info), CompileCacheBytes(info),
+                   PchDir(info)),
+        pool(WorkerThreads(info)) {
+    Napi::Value bytes = Option(info, "responseCacheBytes");
+    if (bytes.IsNumber() && bytes.As<Napi::Number>().DoubleValue() >= 0)
+      engine.responseCache().setBudget(
+          static_cast<size_t>(bytes.As<Napi::Number>().DoubleValue()));
+    Napi::Value ttl = Option(info, "responseCacheTtlMs");
+    if (ttl.IsNumber() && ttl.As<Napi::Number>().DoubleValue() >= 0)
+      engine.responseCache().setTtl(std::chrono::milliseconds(
+          ttl.As<Napi::Number>().Int64Value()));
+  }
 
 private:
+  static Napi::Value Option(const Napi::CallbackInfo &info, const char *name) {
+    if (info.Length() > 0 && info[0].IsObject())
+      return info[0].As<Napi::Object>().Get(name);
+    return info.Env().Undefined();
+  }
+
+  static std::string CompileCacheDir(const Napi::CallbackInfo &info) {
+    Napi::Value dir = Option(info, "compileCacheDir");
+    if (dir.IsString())
+      return dir.As<Napi::String>();
+    return CodeRunner::kDefaultCacheDirectory;
+  }
+
+  static std::string PchDir(const Napi::CallbackInfo &info) {
+    Napi::Value dir = Option(info, "pchDir");
+    if (dir.IsString())
+      return dir.As<Napi::String>();
+    return CodeRunner::kDefaultPchDirectory;
+  }
+
+  static size_t CompileCacheBytes(const Napi::CallbackInfo &info) {
+    Napi::Value bytes = Option(info, "compileCacheBytes");
+    if (bytes.IsNumber() && bytes.As<Napi::Number>().DoubleValue() >= 0)
+      return static_cast<size_t>(bytes.As<Napi::Number>().DoubleValue());
+    return codeflow::CompileCache::kDefaultBudgetBytes;
+  }
+
+  static size_t WorkerThreads(const Napi::CallbackInfo &info) {
+    Napi::Value threads = Option(info, "workerThreads");
+    if (threads.IsNumber() && threads.As<Napi::Number>().Int32Value() > 0)
+      return threads.As<Napi::Number>().Uint32Value();
+    return codeflow::ThreadPool::kDefaultThreads;
+  }
+
+  // Runs work(cancelled) on the pool and settles the returned Promise with
+  // convert(env, result) on the JavaScript thread. The Promise carries a
+  // taskId for cancel(); a cancelled task rejects with an AbortError. The
+  // wrapper is referenced until the Promise settles.
+  template <typename Result, typename Work, typename Convert>
+  Napi::Value Schedule(Napi::Env env, Work work, Convert convert) {
+    struct Outcome {
+      Result result{};
+      std::string error;
+      bool cancelled = false;
+    };
+
+    Napi::Promise::Deferred deferred = Napi::Promise::Deferred::New(env);
+    Napi::ThreadSafeFunction settler = Napi::ThreadSafeFunction::New(
+        env, Napi::Function::New(env, [](const Napi::CallbackInfo &) {}),
+        "codeflow.async", 0, 1);
+    Ref();
+
+    codeflow::TaskId id = pool.submit([this, work, convert, deferred, settler](
+                                          const std::atomic<bool> &cancelled) {
+      auto outcome = std::make_unique<Outcome>();
+      if (!cancelled.load()) {
+        try {
+          outcome->result = work(cancelled);
+        } catch (const std::exception &e) {
+          outcome->error = e.what();
+        }
+      }
+      outcome->cancelled = cancelled.load();
+
+      auto settle = [this, convert, deferred](Napi::Env env, Napi::Function,
+                                              Outcome *raw) {
+        std::unique_ptr<Outcome> outcome(raw);
+        if (env == nullptr)
+          return; // Environment shutting down
+        if (outcome->cancelled) {
+          Napi::Error error = Napi::Error::New(env, "Task cancelled");
+          error.Set("name", Napi::String::New(env, "AbortError"));
+          error.Set("code", Napi::String::New(env, "ABORT_ERR"));
+          deferred.Reject(error.Value());
+        } else if (!outcome->error.empty()) {
+          deferred.Reject(Napi::Error::New(env, outcome->error).Value());
+        } else {
+          deferred.Resolve(convert(env, outcome->result));
+        }
+        Unref();
+      };
+      if (settler.NonBlockingCall(outcome.get(), settle) == napi_ok)
+        outcome.release();
+      settler.Release();
+    });
+
+    Napi::Promise promise = deferred.Promise();
+    promise.Set("taskId", static_cast<double>(id));
+    return promise;
+  }
+
   Napi::Value GetSuggestions(const Napi::CallbackInfo &info) {
     Napi::Env env = info.Env();
 
@@ -62,15 +287,222 @@ private:
     auto suggestions = engine.getSuggestions(prefix, contextType, code,
                                              cursorPosition, maxResults);
 
-    Napi::Array result = Napi::Array::New(env);
+    return ToSuggestionArray(env, suggestions);
+  }
+
+  static Napi::Array
+  ToSuggestionArray(Napi::Env env,
+                    const std::vector<codeflow::Suggestion> &suggestions) {
+    // Suggestions hold views into interned text; copy into JS strings here
+    codeflow::StageTimer timer(codeflow::Stage::Marshalling,
+                               codeflow::EngineMetrics::global().sample());
+    Napi::Array result = Napi::Array::New(env, suggestions.size());
     for (size_t i = 0; i < suggestions.size(); ++i) {
+      const codeflow::Suggestion &s = suggestions[i];
       Napi::Object suggestion = Napi::Object::New(env);
-      suggestion.Set("text", suggestions[i].text);
-      suggestion.Set("type", suggestions[i].type);
-      suggestion.Set("score", suggestions[i].score);
+      suggestion.Set("text", Napi::String::New(env, s.text.data(), s.text.size()));
+      suggestion.Set("type", Napi::String::New(env, s.type.data(), s.type.size()));
+      suggestion.Set("score", s.score);
       result[i] = suggestion;
     }
+    return result;
+  }
+
+  // getSuggestionsBatch([{ session, prefix, contextType, cursor, code }],
+  // maxResults): results for every query in one packed ArrayBuffer, read
+  // with src/native/suggestionBatch.js. Session 0 (or none) is the default
+  // document. code may be a string, or a Uint8Array/Buffer (including views
+  // of a SharedArrayBuffer) that is read in place instead of copied.
+  Napi::Value GetSuggestionsBatch(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsArray()) {
+      Napi::TypeError::New(env, "Expected an array of queries")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    Napi::Array list = info[0].As<Napi::Array>();
+    int maxResults =
+        info.Length() > 1 ? info[1].As<Napi::Number>().Int32Value() : 10;
+
+    uint32_t count = list.Length();
+    std::vector<codeflow::SuggestionQuery> queries(count);
+    std::vector<std::string> copies; // String sources; never reallocated
+    copies.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      Napi::Object q = list.Get(i).As<Napi::Object>();
+      codeflow::SuggestionQuery &query = queries[i];
 
+      Napi::Value session = q.Get("session");
+      if (session.IsNumber())
+        query.session = session.As<Napi::Number>().Uint32Value();
+      Napi::Value prefix = q.Get("prefix");
+      if (prefix.IsString())
+        query.prefix = prefix.As<Napi::String>().Utf8Value();
+      Napi::Value contextType = q.Get("contextType");
+      if (contextType.IsString())
+        query.contextType = contextType.As<Napi::String>().Utf8Value();
+      Napi::Value cursor = q.Get("cursor");
+      if (cursor.IsNumber())
+        query.cursorPosition = cursor.As<Napi::Number>().Int32Value();
+
+      Napi::Value code = q.Get("code");
+      if (code.IsTypedArray() &&
+          code.As<Napi::TypedArray>().TypedArrayType() == napi_uint8_array) {
+        Napi::Uint8Array bytes = code.As<Napi::Uint8Array>();
+        query.code = std::string_view(
+            reinterpret_cast<const char *>(bytes.Data()), bytes.ByteLength());
+      } else if (code.IsString()) {
+        copies.push_back(code.As<Napi::String>().Utf8Value());
+        query.code = copies.back();
+      }
+    }
+
+    engine.getSuggestionsBatch(queries, maxResults, batch);
+    codeflow::StageTimer timer(codeflow::Stage::Marshalling,
+                               codeflow::EngineMetrics::global().sample());
+    Napi::ArrayBuffer packed = Napi::ArrayBuffer::New(env, packer.plan(batch));
+    packer.write(static_cast<uint8_t *>(packed.Data()));
+    return packed;
+  }
+
+  // The options of complete() and completeJson(): { fuzzy, cursor }, cursor
+  // a UTF-8 byte offset into code
+  static void ReadCompleteOptions(const Napi::Value &value,
+                                  codeflow::MatchMode &mode, size_t &cursor) {
+    if (!value.IsObject())
+      return;
+    Napi::Object options = value.As<Napi::Object>();
+    Napi::Value fuzzy = options.Get("fuzzy");
+    if (fuzzy.IsBoolean() && fuzzy.As<Napi::Boolean>().Value())
+      mode = codeflow::MatchMode::Fuzzy;
+    Napi::Value at = options.Get("cursor");
+    if (at.IsNumber() && at.As<Napi::Number>().Int64Value() >= 0)
+      cursor = static_cast<size_t>(at.As<Napi::Number>().Int64Value());
+  }
+
+  // complete(prefix, contextType, code, maxResults, { fuzzy, cursor }):
+  // records shaped like the POST /api/getSuggestions response
+  Napi::Value Complete(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+      Napi::TypeError::New(env, "Expected at least 2 arguments")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string prefix = info[0].As<Napi::String>();
+    std::string contextType = info[1].As<Napi::String>();
+    std::string code =
+        info.Length() > 2 ? info[2].As<Napi::String>().Utf8Value() : "";
+    int maxResults =
+        info.Length() > 3 ? info[3].As<Napi::Number>().Int32Value() : 20;
+    codeflow::MatchMode mode = codeflow::MatchMode::Prefix;
+    size_t cursor = codeflow::SuggestionEngine::kNoCursor;
+    if (info.Length() > 4)
+      ReadCompleteOptions(info[4], mode, cursor);
+
+    // Local-variable and member records point into code, which outlives the
+    // conversion
+    auto suggestions =
+        engine.complete(prefix, contextType, code, maxResults, mode, cursor);
+    return ToRecordArray(env, suggestions);
+  }
+
+  // completeJson(language, prefix, contextType, code, maxResults,
+  // { fuzzy, cursor }): complete()'s records as a Buffer of the JSON response body, from the
+  // engine's response cache when it can be, and whether it was:
+  // { body, hit }. The Buffer shares the cached bytes rather than copying
+  // them, so it must not be written to.
+  Napi::Value CompleteJson(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+      Napi::TypeError::New(env, "Expected at least 3 arguments")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string language = info[0].As<Napi::String>();
+    std::string prefix = info[1].As<Napi::String>();
+    std::string contextType = info[2].As<Napi::String>();
+    std::string code =
+        info.Length() > 3 ? info[3].As<Napi::String>().Utf8Value() : "";
+    int maxResults =
+        info.Length() > 4 ? info[4].As<Napi::Number>().Int32Value() : 20;
+    codeflow::MatchMode mode = codeflow::MatchMode::Prefix;
+    size_t cursor = codeflow::SuggestionEngine::kNoCursor;
+    if (info.Length() > 5)
+      ReadCompleteOptions(info[5], mode, cursor);
+
+    bool hit = false;
+    auto body = std::make_unique<codeflow::ResponseCache::Body>(
+        engine.completeJson(language, prefix, contextType, code, maxResults,
+                            mode, &hit, cursor));
+    // The Buffer holds a reference to the body until it is collected
+    Napi::Buffer<char> bytes = Napi::Buffer<char>::New(
+        env, const_cast<char *>((*body)->data()), (*body)->size(),
+        [](Napi::Env, char *, codeflow::ResponseCache::Body *held) {
+          delete held;
+        },
+        body.get());
+    body.release();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("body", bytes);
+    result.Set("hit", hit);
+    return result;
+  }
+
+  // fuzzySearch(pattern, maxResults): every indexed name, ranked by fuzzy
+  // match; records shaped like complete()'s
+  Napi::Value FuzzySearch(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected a pattern")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string pattern = info[0].As<Napi::String>();
+    int maxResults =
+        info.Length() > 1 ? info[1].As<Napi::Number>().Int32Value() : 20;
+    return ToRecordArray(env, engine.fuzzySearch(pattern, maxResults));
+  }
+
+  // Full records: text, display, type, doc, sig, complexity, container,
+  // header, score. Unknown metadata fields are left out, as the JavaScript
+  // route leaves them undefined.
+  static Napi::Array
+  ToRecordArray(Napi::Env env,
+                const std::vector<codeflow::Suggestion> &suggestions) {
+    codeflow::StageTimer timer(codeflow::Stage::Marshalling,
+                               codeflow::EngineMetrics::global().sample());
+    Napi::Array result = Napi::Array::New(env, suggestions.size());
+    std::string display, doc, sig;
+    for (size_t i = 0; i < suggestions.size(); ++i) {
+      const codeflow::Suggestion &s = suggestions[i];
+      codeflow::decorate(s, display, doc, sig);
+
+      Napi::Object record = Napi::Object::New(env);
+      auto set = [&](const char *key, std::string_view value) {
+        if (!value.empty())
+          record.Set(key, Napi::String::New(env, value.data(), value.size()));
+      };
+      set("text", s.text);
+      set("display", display);
+      set("type", s.type);
+      set("doc", doc);
+      set("sig", sig);
+      set("complexity", s.complexity);
+      set("container", s.container);
+      set("header", s.header);
+      record.Set("score", s.score);
+      result[i] = record;
+    }
     return result;
   }
 
@@ -104,6 +536,21 @@ private:
     return env.Undefined();
   }
 
+  // Map a precompiled index file; false if it is missing or invalid, in
+  // which case the JSON loaders still work
+  Napi::Value LoadIndex(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string path = info[0].As<Napi::String>();
+    return Napi::Boolean::New(env, engine.loadIndex(path));
+  }
+
   Napi::Value UpdateSymbols(const Napi::CallbackInfo &info) {
     Napi::Env env = info.Env();
 
@@ -173,10 +620,531 @@ private:
     }
 
     std::string code = info[0].As<Napi::String>();
-    std::string result = codeRunner.runCode(code);
+    ExecutionMode mode = ExecutionMode::Tiered;
+    if (!ReadExecutionMode(info, 1, mode))
+      return env.Null();
+    std::string result = codeRunner.runCode(code, nullptr, {}, mode);
 
     return Napi::String::New(env, result);
   }
+
+  // An optional "tiered", "fast" or "sanitized" at info[index]; false with a
+  // TypeError thrown for anything else
+  static bool ReadExecutionMode(const Napi::CallbackInfo &info, size_t index,
+                                ExecutionMode &mode) {
+    if (info.Length() <= index || info[index].IsUndefined() ||
+        info[index].IsNull())
+      return true;
+    if (info[index].IsString() &&
+        parseExecutionMode(info[index].As<Napi::String>(), mode))
+      return true;
+    Napi::TypeError::New(info.Env(),
+                         "Execution mode must be tiered, fast or sanitized")
+        .ThrowAsJavaScriptException();
+    return false;
+  }
+
+  // getSuggestionsAsync(prefix, contextType, code, cursorPosition, maxResults)
+  Napi::Value GetSuggestionsAsync(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+      Napi::TypeError::New(env, "Expected at least 2 arguments")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string prefix = info[0].As<Napi::String>();
+    std::string contextType = info[1].As<Napi::String>();
+    std::string code =
+        info.Length() > 2 ? info[2].As<Napi::String>().Utf8Value() : "";
+    int cursorPosition =
+        info.Length() > 3 ? info[3].As<Napi::Number>().Int32Value() : 0;
+    int maxResults =
+        info.Length() > 4 ? info[4].As<Napi::Number>().Int32Value() : 10;
+
+    return Schedule<std::vector<codeflow::Suggestion>>(
+        env,
+        [this, prefix, contextType, code, cursorPosition,
+         maxResults](const std::atomic<bool> &) {
+          return engine.getSuggestions(prefix, contextType, code,
+                                       cursorPosition, maxResults);
+        },
+        ToSuggestionArray);
+  }
+
+  Napi::Value UpdateSymbolsAsync(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string code = info[0].As<Napi::String>();
+    return Schedule<bool>(
+        env,
+        [this, code](const std::atomic<bool> &) {
+          engine.updateSymbols(code);
+          return true;
+        },
+        [](Napi::Env env, bool) { return env.Undefined(); });
+  }
+
+  // runCodeAsync(code, onOutput?, mode?): resolves with the same JSON string
+  // as runCode. onOutput(stream, text), stream being "stdout" or "stderr",
+  // gets the program's output as it is printed.
+  Napi::Value RunCodeAsync(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string code = info[0].As<Napi::String>();
+    ExecutionMode mode = ExecutionMode::Tiered;
+    if (!ReadExecutionMode(info, 2, mode))
+      return env.Null();
+    std::shared_ptr<Napi::ThreadSafeFunction> onOutput;
+    if (info.Length() > 1 && info[1].IsFunction()) {
+      // Bounded: a program printing faster than JavaScript takes the chunks
+      // blocks in write rather than growing the queue. Released whenever
+      // the task is dropped, run or not.
+      onOutput.reset(
+          new Napi::ThreadSafeFunction(Napi::ThreadSafeFunction::New(
+              env, info[1].As<Napi::Function>(), "codeflow.runOutput",
+              kOutputQueueChunks, 1)),
+          [](Napi::ThreadSafeFunction *function) {
+            function->Release();
+            delete function;
+          });
+    }
+    return Schedule<std::string>(
+        env,
+        [this, code, onOutput, mode](const std::atomic<bool> &cancelled) {
+          if (!onOutput)
+            return codeRunner.runCode(code, &cancelled, {}, mode);
+          OutputForwarder forward{onOutput.get()};
+          std::string result = codeRunner.runCode(
+              code, &cancelled,
+              [&forward](int stream, std::string_view data) {
+                forward(stream, data);
+              },
+              mode);
+          forward.flush();
+          return result;
+        },
+        [](Napi::Env env, const std::string &result) {
+          return Napi::String::New(env, result);
+        });
+  }
+
+  // cancel(taskId): false if the task already settled
+  Napi::Value Cancel(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    double id = info[0].As<Napi::Number>().DoubleValue();
+    if (id < 1)
+      return Napi::Boolean::New(env, false);
+    return Napi::Boolean::New(
+        env, pool.cancel(static_cast<codeflow::TaskId>(id)));
+  }
+
+  Napi::Value GetPoolStats(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    codeflow::ThreadPoolStats stats = pool.stats();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("threads", static_cast<double>(stats.threads));
+    result.Set("queued", static_cast<double>(stats.queued));
+    result.Set("running", static_cast<double>(stats.running));
+    result.Set("completed", static_cast<double>(stats.completed));
+    result.Set("cancelled", static_cast<double>(stats.cancelled));
+    return result;
+  }
+
+  // getMetrics(): the process-wide stage histograms and counters (shared by
+  // every engine instance), as { sampleEvery, counters: [{ name, help,
+  // value }], stages: [{ name, count, sumNs, p50Ns, p99Ns, p999Ns, buckets:
+  // [[leNs, cumulative count]] }] }. Buckets are the powers of two from
+  // 128 ns to 2^35 ns (34 s), for a Prometheus histogram.
+  Napi::Value GetMetrics(const Napi::CallbackInfo &info) {
+    using codeflow::EngineMetrics;
+    Napi::Env env = info.Env();
+    const EngineMetrics &metrics = EngineMetrics::global();
+
+    Napi::Array counters = Napi::Array::New(env, codeflow::kCounterCount);
+    for (size_t i = 0; i < codeflow::kCounterCount; ++i) {
+      auto counter = static_cast<codeflow::Counter>(i);
+      Napi::Object entry = Napi::Object::New(env);
+      entry.Set("name", EngineMetrics::name(counter));
+      entry.Set("help", EngineMetrics::description(counter));
+      entry.Set("value", static_cast<double>(metrics.count(counter)));
+      counters[i] = entry;
+    }
+
+    Napi::Array stages = Napi::Array::New(env, codeflow::kStageCount);
+    for (size_t i = 0; i < codeflow::kStageCount; ++i) {
+      auto stage = static_cast<codeflow::Stage>(i);
+      codeflow::LatencyHistogram histogram = metrics.histogram(stage);
+      Napi::Object entry = Napi::Object::New(env);
+      entry.Set("name", EngineMetrics::name(stage));
+      entry.Set("count", static_cast<double>(histogram.count));
+      entry.Set("sumNs", static_cast<double>(histogram.sumNs));
+      entry.Set("p50Ns", static_cast<double>(histogram.quantileNs(0.5)));
+      entry.Set("p99Ns", static_cast<double>(histogram.quantileNs(0.99)));
+      entry.Set("p999Ns", static_cast<double>(histogram.quantileNs(0.999)));
+      Napi::Array buckets = Napi::Array::New(env);
+      for (int exponent = 7; exponent <= 35; ++exponent) {
+        std::uint64_t limit = std::uint64_t{1} << exponent;
+        Napi::Array bucket = Napi::Array::New(env, 2);
+        bucket[0u] = static_cast<double>(limit);
+        bucket[1u] = static_cast<double>(histogram.countBelow(limit));
+        buckets[static_cast<uint32_t>(exponent - 7)] = bucket;
+      }
+      entry.Set("buckets", buckets);
+      stages[i] = entry;
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("sampleEvery", static_cast<double>(metrics.sampleEvery()));
+    result.Set("counters", counters);
+    result.Set("stages", stages);
+    return result;
+  }
+
+  Napi::Value GetCompileCacheStats(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    codeflow::CompileCacheStats stats = codeRunner.getCacheStats();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("hits", static_cast<double>(stats.hits));
+    result.Set("misses", static_cast<double>(stats.misses));
+    result.Set("evictions", static_cast<double>(stats.evictions));
+    result.Set("entries", static_cast<double>(stats.entries));
+    result.Set("bytes", static_cast<double>(stats.bytes));
+    result.Set("budgetBytes", static_cast<double>(stats.budgetBytes));
+    return result;
+  }
+
+  Napi::Value GetResponseCacheStats(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    codeflow::ResponseCacheStats stats = engine.responseCache().stats();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("hits", static_cast<double>(stats.hits));
+    result.Set("misses", static_cast<double>(stats.misses));
+    result.Set("expirations", static_cast<double>(stats.expirations));
+    result.Set("evictions", static_cast<double>(stats.evictions));
+    result.Set("entries", static_cast<double>(stats.entries));
+    result.Set("bytes", static_cast<double>(stats.bytes));
+    result.Set("budgetBytes", static_cast<double>(stats.budgetBytes));
+    result.Set("ttlMs", static_cast<double>(stats.ttlMs));
+    return result;
+  }
+
+  static Napi::Object WorkspaceStatsObject(Napi::Env env,
+                                           const codeflow::WorkspaceStats &stats) {
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("files", static_cast<double>(stats.files));
+    result.Set("symbols", static_cast<double>(stats.symbols));
+    result.Set("bytes", static_cast<double>(stats.bytes));
+    result.Set("memoryBytes", static_cast<double>(stats.memoryBytes));
+    result.Set("watching", stats.watching);
+    result.Set("watchedDirectories",
+               static_cast<double>(stats.watchedDirectories));
+    result.Set("indexedFiles", static_cast<double>(stats.indexedFiles));
+    result.Set("indexedBytes", static_cast<double>(stats.indexedBytes));
+    result.Set("skippedFiles", static_cast<double>(stats.skippedFiles));
+    result.Set("indexMs", stats.indexMs);
+    result.Set("filesPerSecond", stats.filesPerSecond);
+    result.Set("megabytesPerSecond", stats.megabytesPerSecond);
+    result.Set("updates", static_cast<double>(stats.updates));
+    result.Set("updatedFiles", static_cast<double>(stats.updatedFiles));
+    return result;
+  }
+
+  // openWorkspaceAsync(root, { watch, threads }) indexes the sources under
+  // root for complete() and completeJson(), then (watch: true) follows
+  // changes to them. Resolves with getWorkspaceStats(); rejects if root is
+  // not a directory or the watch cannot start.
+  Napi::Value OpenWorkspaceAsync(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string root = info[0].As<Napi::String>();
+    bool watch = false;
+    size_t threads = 0;
+    if (info.Length() > 1 && info[1].IsObject()) {
+      Napi::Object options = info[1].As<Napi::Object>();
+      watch = options.Get("watch").ToBoolean();
+      Napi::Value count = options.Get("threads");
+      if (count.IsNumber() && count.As<Napi::Number>().Int32Value() > 0)
+        threads = count.As<Napi::Number>().Uint32Value();
+    }
+    return Schedule<codeflow::WorkspaceStats>(
+        env,
+        [this, root, watch, threads](const std::atomic<bool> &) {
+          codeflow::WorkspaceIndex &workspace = engine.workspaceIndex();
+          std::string error;
+          if (!workspace.open(root, threads, &error) ||
+              (watch && !workspace.watch(&error)))
+            throw std::runtime_error(error);
+          return workspace.stats();
+        },
+        WorkspaceStatsObject);
+  }
+
+  Napi::Value GetWorkspaceStats(const Napi::CallbackInfo &info) {
+    return WorkspaceStatsObject(info.Env(), engine.workspaceIndex().stats());
+  }
+
+  Napi::Value CloseWorkspace(const Napi::CallbackInfo &info) {
+    engine.workspaceIndex().close();
+    return info.Env().Undefined();
+  }
+
+  // Of the fast builds, with the sanitizer builds' under "sanitized"
+  Napi::Value GetPchStats(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    auto toObject = [env](const codeflow::PchStats &stats) {
+      Napi::Object result = Napi::Object::New(env);
+      result.Set("profilesReady", static_cast<double>(stats.profilesReady));
+      result.Set("compilesWithPch", static_cast<double>(stats.compilesWithPch));
+      result.Set("compilesWithoutPch",
+                 static_cast<double>(stats.compilesWithoutPch));
+      result.Set("medianWithPchMs", stats.medianWithPchMs);
+      result.Set("medianWithoutPchMs", stats.medianWithoutPchMs);
+      return result;
+    };
+    Napi::Object result = toObject(codeRunner.getPchStats());
+    result.Set("sanitized", toObject(codeRunner.getPchStats(true)));
+    return result;
+  }
+
+  // Resolves with the number of include sets ready
+  Napi::Value WarmPrecompiledHeadersAsync(const Napi::CallbackInfo &info) {
+    return Schedule<size_t>(
+        info.Env(),
+        [this](const std::atomic<bool> &) {
+          return codeRunner.warmPrecompiledHeaders();
+        },
+        [](Napi::Env env, size_t ready) {
+          return Napi::Number::New(env, static_cast<double>(ready));
+        });
+  }
+
+  Napi::Value OpenSession(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    return Napi::Number::New(env, engine.openSession());
+  }
+
+  Napi::Value UpdateSession(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2) {
+      Napi::TypeError::New(env, "Expected 2 arguments")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    codeflow::SessionId session = info[0].As<Napi::Number>().Uint32Value();
+    std::string code = info[1].As<Napi::String>();
+    bool updated = engine.updateSession(session, code);
+
+    return Napi::Boolean::New(env, updated);
+  }
+
+  // editSession(id, [{ offset, removedLength, text }, ...]) with UTF-8 byte
+  // offsets, applied in order
+  Napi::Value EditSession(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[1].IsArray()) {
+      Napi::TypeError::New(env, "Expected a session id and an array of edits")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    codeflow::SessionId session = info[0].As<Napi::Number>().Uint32Value();
+    Napi::Array list = info[1].As<Napi::Array>();
+
+    std::vector<codeflow::TextEdit> edits(list.Length());
+    for (uint32_t i = 0; i < list.Length(); ++i) {
+      Napi::Object edit = list.Get(i).As<Napi::Object>();
+      edits[i].offset = edit.Get("offset").As<Napi::Number>().Uint32Value();
+      edits[i].removedLength =
+          edit.Get("removedLength").As<Napi::Number>().Uint32Value();
+      edits[i].text = edit.Get("text").As<Napi::String>().Utf8Value();
+    }
+
+    return Napi::Boolean::New(env, engine.editSession(session, edits));
+  }
+
+  Napi::Value GetSessionSuggestions(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3) {
+      Napi::TypeError::New(env, "Expected at least 3 arguments")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    codeflow::SessionId session = info[0].As<Napi::Number>().Uint32Value();
+    std::string prefix = info[1].As<Napi::String>();
+    std::string contextType = info[2].As<Napi::String>();
+    std::string code =
+        info.Length() > 3 ? info[3].As<Napi::String>().Utf8Value() : "";
+    int cursorPosition =
+        info.Length() > 4 ? info[4].As<Napi::Number>().Int32Value() : 0;
+    int maxResults =
+        info.Length() > 5 ? info[5].As<Napi::Number>().Int32Value() : 10;
+
+    auto suggestions = engine.getSessionSuggestions(
+        session, prefix, contextType, code, cursorPosition, maxResults);
+
+    return ToSuggestionArray(env, suggestions);
+  }
+
+  Napi::Value CloseSession(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    codeflow::SessionId session = info[0].As<Napi::Number>().Uint32Value();
+    return Napi::Boolean::New(env, engine.closeSession(session));
+  }
+
+  Napi::Value HasSession(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    codeflow::SessionId session = info[0].As<Napi::Number>().Uint32Value();
+    return Napi::Boolean::New(env, engine.hasSession(session));
+  }
+
+  Napi::Value SetSessionMemoryBudget(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    double bytes = info[0].As<Napi::Number>().DoubleValue();
+    engine.setSessionMemoryBudget(static_cast<size_t>(bytes < 0 ? 0 : bytes));
+
+    return env.Undefined();
+  }
+
+  Napi::Value GetSessionStats(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+    codeflow::SessionStats stats = engine.getSessionStats();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("liveSessions", static_cast<double>(stats.liveSessions));
+    result.Set("bytes", static_cast<double>(stats.bytes));
+    result.Set("budgetBytes", static_cast<double>(stats.budgetBytes));
+    result.Set("evictions", static_cast<double>(stats.evictions));
+    return result;
+  }
+
+  // recordAccepted(text, session?): false if text is not a known symbol
+  Napi::Value RecordAccepted(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected at least 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string text = info[0].As<Napi::String>();
+    codeflow::SessionId session =
+        info.Length() > 1 && info[1].IsNumber()
+            ? info[1].As<Napi::Number>().Uint32Value()
+            : 0;
+    return Napi::Boolean::New(env, engine.recordAccepted(text, session));
+  }
+
+  Napi::Value GetUsageScore(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected at least 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string text = info[0].As<Napi::String>();
+    codeflow::SessionId session =
+        info.Length() > 1 && info[1].IsNumber()
+            ? info[1].As<Napi::Number>().Uint32Value()
+            : 0;
+    return Napi::Number::New(env, engine.getUsageScore(text, session));
+  }
+
+  Napi::Value GetLearnedSymbolCount(const Napi::CallbackInfo &info) {
+    return Napi::Number::New(
+        info.Env(), static_cast<double>(engine.getLearnedSymbolCount()));
+  }
+
+  // Resolves with whether the snapshot was written; queries and feedback
+  // keep running meanwhile
+  Napi::Value SaveUsageAsync(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string path = info[0].As<Napi::String>();
+    return Schedule<bool>(
+        env,
+        [this, path](const std::atomic<bool> &) {
+          return engine.saveUsage(path);
+        },
+        [](Napi::Env env, bool saved) { return Napi::Boolean::New(env, saved); });
+  }
+
+  Napi::Value LoadUsage(const Napi::CallbackInfo &info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1) {
+      Napi::TypeError::New(env, "Expected 1 argument")
+          .ThrowAsJavaScriptException();
+      return env.Null();
+    }
+
+    std::string path = info[0].As<Napi::String>();
+    return Napi::Boolean::New(env, engine.loadUsage(path));
+  }
 };
 
 Napi::Object InitAll(Napi::Env env, Napi::Object exports) {
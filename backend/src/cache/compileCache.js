@@ -0,0 +1,219 @@
+/**
+ * Content-Addressed Compile Cache
+ * Build results on disk, keyed by everything that determines them: language,
+ * compile command, compiler version and source. An entry holds either the
+ * binary or, for a failed build, the compiler diagnostics, so resubmitting
+ * the same code skips the compiler either way.
+ *
+ *   <directory>/<sha256>/inputs       what was hashed, compared on every hit
+ *   <directory>/<sha256>/program      or
+ *   <directory>/<sha256>/diagnostics
+ *
+ * Total size is bounded by evicting least recently used entries. Entries left
+ * by a previous run are adopted at startup, ordered by modification time
+ * (refreshed on every hit).
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+const { execSync } = require('child_process');
+
+const INPUTS_FILE = 'inputs';
+const PROGRAM_FILE = 'program';
+const DIAGNOSTICS_FILE = 'diagnostics';
+const STAGING_PREFIX = '.staging-';
+
+// First line of `<compiler> --version`, read once per binary
+const compilerVersions = new Map();
+function compilerVersion(command) {
+  const binary = command.trim().split(/\s+/)[0];
+  if (!compilerVersions.has(binary)) {
+    let version = `${binary} (unknown version)`;
+    try {
+      version = execSync(`${binary} --version`, { timeout: 5000, stdio: ['ignore', 'pipe', 'ignore'] })
+        .toString().split('\n')[0] || version;
+    } catch (_) {}
+    compilerVersions.set(binary, version);
+  }
+  return compilerVersions.get(binary);
+}
+
+function directoryBytes(dir) {
+  let bytes = 0;
+  for (const name of fs.readdirSync(dir)) {
+    try {
+      bytes += fs.statSync(path.join(dir, name)).size;
+    } catch (_) {}
+  }
+  return bytes;
+}
+
+// Hard link when both paths share a filesystem, otherwise copy
+function linkOrCopy(from, to) {
+  fs.rmSync(to, { force: true });
+  try {
+    fs.linkSync(from, to);
+  } catch (_) {
+    fs.copyFileSync(from, to);
+    fs.chmodSync(to, 0o755);
+  }
+}
+
+class CompileCache {
+  /**
+   * @param {Object} options
+   * @param {string|null} options.directory - Cache root; null disables the cache
+   * @param {number} [options.maxBytes=256MB] - Size budget
+   */
+  constructor({ directory, maxBytes = 256 * 1024 * 1024 } = {}) {
+    this.directory = directory || null;
+    this.maxBytes = maxBytes;
+    this.entries = new Map(); // key => bytes, least recently used first
+    this.totalBytes = 0;
+    this.hits = 0;
+    this.misses = 0;
+    this.evictions = 0;
+
+    if (this.directory) {
+      try {
+        this.adoptExisting();
+      } catch (_) {
+        this.directory = null;
+      }
+    }
+  }
+
+  /**
+   * Describe one build; `compileCmd` is the language's command template and
+   * `tier` its build tier, for languages with several
+   */
+  inputsFor(langConfig, code, tier) {
+    const command = langConfig.compileCmd('SOURCE', 'PROGRAM', null, tier);
+    const inputs = [langConfig.id, command, compilerVersion(command), code].join('\0');
+    return {
+      key: crypto.createHash('sha256').update(inputs).digest('hex'),
+      inputs
+    };
+  }
+
+  adoptExisting() {
+    fs.mkdirSync(this.directory, { recursive: true, mode: 0o700 });
+    const found = [];
+    for (const name of fs.readdirSync(this.directory)) {
+      const entryDir = path.join(this.directory, name);
+      if (name.startsWith(STAGING_PREFIX)) {
+        fs.rmSync(entryDir, { recursive: true, force: true }); // Left by a crash
+        continue;
+      }
+      try {
+        const { mtimeMs } = fs.statSync(path.join(entryDir, INPUTS_FILE));
+        found.push({ name, mtimeMs, bytes: directoryBytes(entryDir) });
+      } catch (_) {}
+    }
+    found.sort((a, b) => a.mtimeMs - b.mtimeMs);
+    for (const { name, bytes } of found) {
+      this.entries.set(name, bytes);
+      this.totalBytes += bytes;
+    }
+    this.evictOverBudget();
+  }
+
+  /**
+   * Returns { program: true } once the cached binary is linked to binFile,
+   * { diagnostics } for a cached failed build, or null on a miss
+   */
+  lookup({ key, inputs }, binFile) {
+    if (!this.directory) return null;
+    const entryDir = path.join(this.directory, key);
+    try {
+      if (!this.entries.has(key) || fs.readFileSync(path.join(entryDir, INPUTS_FILE), 'utf8') !== inputs) {
+        this.misses++;
+        return null;
+      }
+
+      let result;
+      const programPath = path.join(entryDir, PROGRAM_FILE);
+      if (fs.existsSync(programPath)) {
+        linkOrCopy(programPath, binFile);
+        result = { program: true };
+      } else {
+        result = { diagnostics: fs.readFileSync(path.join(entryDir, DIAGNOSTICS_FILE), 'utf8') };
+      }
+
+      const bytes = this.entries.get(key);
+      this.entries.delete(key);
+      this.entries.set(key, bytes);
+      const now = new Date();
+      fs.utimesSync(path.join(entryDir, INPUTS_FILE), now, now);
+      this.hits++;
+      return result;
+    } catch (_) {
+      this.misses++;
+      return null;
+    }
+  }
+
+  storeProgram(build, binFile) {
+    this.store(build, (staging) => linkOrCopy(binFile, path.join(staging, PROGRAM_FILE)));
+  }
+
+  storeDiagnostics(build, diagnostics) {
+    this.store(build, (staging) => fs.writeFileSync(path.join(staging, DIAGNOSTICS_FILE), diagnostics));
+  }
+
+  // Fill a staging directory and rename it into place, so readers never see
+  // a half-written entry
+  store({ key, inputs }, fill) {
+    if (!this.directory) return;
+    let staging = null;
+    try {
+      staging = fs.mkdtempSync(path.join(this.directory, STAGING_PREFIX));
+      fs.writeFileSync(path.join(staging, INPUTS_FILE), inputs);
+      fill(staging);
+
+      const entryDir = path.join(this.directory, key);
+      if (this.entries.has(key)) {
+        this.totalBytes -= this.entries.get(key);
+        this.entries.delete(key);
+      }
+      fs.rmSync(entryDir, { recursive: true, force: true });
+      const bytes = directoryBytes(staging);
+      fs.renameSync(staging, entryDir);
+      this.entries.set(key, bytes);
+      this.totalBytes += bytes;
+      this.evictOverBudget();
+    } catch (_) {
+      if (staging) fs.rmSync(staging, { recursive: true, force: true });
+    }
+  }
+
+  evictOverBudget() {
+    for (const [key, bytes] of this.entries) {
+      if (this.totalBytes <= this.maxBytes) break;
+      fs.rmSync(path.join(this.directory, key), { recursive: true, force: true });
+      this.entries.delete(key);
+      this.totalBytes -= bytes;
+      this.evictions++;
+    }
+  }
+
+  getStats() {
+    const total = this.hits + this.misses;
+    return {
+      enabled: Boolean(this.directory),
+      entries: this.entries.size,
+      bytes: this.totalBytes,
+      maxBytes: this.maxBytes,
+      hits: this.hits,
+      misses: this.misses,
+      evictions: this.evictions,
+      hitRate: total > 0 ? ((this.hits / total) * 100).toFixed(1) + '%' : '0.0%'
+    };
+  }
+}
+
+module.exports = {
+  CompileCache,
+  compilerVersion
+};
@@ -0,0 +1,231 @@
+/**
+ * Precompiled Headers for Common Include Sets
+ * Most C++ submissions start with <bits/stdc++.h> or a few of <iostream>,
+ * <vector>, <string> and <algorithm>. For a language with a `pchCmd`, the
+ * first profile whose headers all appear in a submission's header prefix
+ * (the #include <...> lines before its first other line) is force-included
+ * with -include, so the compiler loads its .gch instead of parsing the
+ * headers. Headers the submission did not include are never added.
+ *
+ * Profiles are built in the background, on first use or by warm(), keyed by
+ * the language's compile flags and compiler version, and reused by later
+ * processes. Until a profile's build finishes, submissions matching it
+ * compile without it. Mirrors PchCache in the native runner.
+ */
+
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+const { spawn } = require('child_process');
+
+// Most comprehensive first; the first match is used
+const PROFILES = [
+  { name: 'stdcpp', headers: ['bits/stdc++.h'] },
+  { name: 'algorithm_iostream_string_vector', headers: ['algorithm', 'iostream', 'string', 'vector'] },
+  { name: 'iostream_vector', headers: ['iostream', 'vector'] },
+  { name: 'iostream_string', headers: ['iostream', 'string'] },
+  { name: 'iostream', headers: ['iostream'] }
+];
+
+const MAX_SAMPLES = 128;
+
+// A build still running after this long is killed, as in the native runner
+const BUILD_TIMEOUT_MS = 5 * 60 * 1000;
+
+/**
+ * System headers of the submission's header prefix, in order
+ */
+function headerPrefix(code) {
+  const headers = [];
+  let inComment = false;
+  for (let line of code.split('\n')) {
+    // Comments may sit between includes; text after a closing */ counts
+    for (;;) {
+      if (inComment) {
+        const close = line.indexOf('*/');
+        if (close < 0) {
+          line = '';
+          break;
+        }
+        line = line.slice(close + 2);
+        inComment = false;
+      }
+      line = line.trimStart();
+      if (!line.startsWith('/*')) break;
+      line = line.slice(2);
+      inComment = true;
+    }
+    if (!line.trim() || line.startsWith('//')) continue;
+
+    const include = /^#\s*include\s*<([^>]+)>/.exec(line);
+    if (!include) break;
+    headers.push(include[1].trim());
+  }
+  return headers;
+}
+
+/**
+ * Profile to use for the submission, or null
+ */
+function matchProfile(code) {
+  const prefix = headerPrefix(code);
+  if (prefix.length === 0) return null;
+  return PROFILES.find(profile => profile.headers.every(h => prefix.includes(h))) || null;
+}
+
+function median(samples) {
+  if (samples.length === 0) return 0;
+  const sorted = [...samples].sort((a, b) => a - b);
+  return sorted[Math.floor(sorted.length / 2)];
+}
+
+class PchCache {
+  /**
+   * @param {Object} options
+   * @param {string|null} options.directory - Root directory; null disables precompiled headers
+   * @param {string} [options.commandPrefix] - Shell text run before each
+   *   build, such as the ulimits compiles run under
+   * @param {number} [options.buildTimeoutMs] - Builds are killed after this long
+   */
+  constructor({ directory, commandPrefix = '', buildTimeoutMs = BUILD_TIMEOUT_MS } = {}) {
+    this.directory = directory || null;
+    this.commandPrefix = commandPrefix;
+    this.buildTimeoutMs = buildTimeoutMs;
+    this.states = new Map(); // `${dir}/${profile}` => 'building' | 'ready' | 'failed'
+    this.builds = new Map(); // `${dir}/${profile}` => Promise<boolean>, while building
+    this.withPch = [];
+    this.withoutPch = [];
+    this.compilesWithPch = 0;
+    this.compilesWithoutPch = 0;
+  }
+
+  /**
+   * Header to force-include when compiling code, or null. Starts building
+   * the matching profile if it has not been built yet; the compile does not
+   * wait for it. Each build tier has headers of its own.
+   */
+  headerFor(langConfig, code, compilerVersion, tier) {
+    if (!this.directory || typeof langConfig.pchCmd !== 'function') return null;
+    const profile = matchProfile(code);
+    if (!profile) return null;
+
+    const header = this.headerPath(langConfig, profile, compilerVersion, tier);
+    this.ensureBuilt(langConfig, profile, header, tier);
+    return this.states.get(header) === 'ready' ? header : null;
+  }
+
+  /**
+   * Build every profile of one build tier, one at a time. Resolves to the
+   * number that are ready.
+   */
+  async warm(langConfig, compilerVersion, tier) {
+    if (!this.directory || typeof langConfig.pchCmd !== 'function') return 0;
+    let ready = 0;
+    for (const profile of PROFILES) {
+      const header = this.headerPath(langConfig, profile, compilerVersion, tier);
+      if (await this.ensureBuilt(langConfig, profile, header, tier)) ready++;
+    }
+    return ready;
+  }
+
+  headerPath(langConfig, profile, compilerVersion, tier) {
+    const key = crypto.createHash('sha256')
+      .update([langConfig.pchCmd('HEADER', 'OUTPUT', tier), compilerVersion].join('\0'))
+      .digest('hex').slice(0, 16);
+    return path.join(this.directory, key, `${profile.name}.h`);
+  }
+
+  /**
+   * Resolves to whether header is ready, starting its build if no build has
+   * been tried yet
+   */
+  ensureBuilt(langConfig, profile, header, tier) {
+    if (!this.states.has(header)) {
+      if (fs.existsSync(header) && fs.existsSync(`${header}.gch`)) {
+        this.states.set(header, 'ready');
+      } else {
+        this.states.set(header, 'building');
+        this.builds.set(header, this.build(langConfig, profile, header, tier).then((built) => {
+          this.states.set(header, built ? 'ready' : 'failed');
+          this.builds.delete(header);
+          return built;
+        }));
+      }
+    }
+    return this.builds.get(header) || Promise.resolve(this.states.get(header) === 'ready');
+  }
+
+  /**
+   * Compile the profile's header in a process group of its own, under
+   * commandPrefix and buildTimeoutMs. Resolves to whether it succeeded.
+   */
+  build(langConfig, profile, header, tier) {
+    const gch = `${header}.gch`;
+    // Compiled next to the final name, then renamed, so a concurrent process
+    // never loads half a .gch
+    const staging = `${gch}.tmp${process.pid}`;
+    const discard = () => {
+      fs.rmSync(staging, { force: true });
+      return false;
+    };
+    try {
+      fs.mkdirSync(path.dirname(header), { recursive: true, mode: 0o700 });
+      fs.writeFileSync(header, profile.headers.map(h => `#include <${h}>\n`).join(''));
+    } catch (_) {
+      return Promise.resolve(false);
+    }
+
+    return new Promise((resolve) => {
+      const command = `${this.commandPrefix}${langConfig.pchCmd(header, staging, tier)}`;
+      const child = spawn('/bin/sh', ['-c', command], { detached: true, stdio: 'ignore' });
+      const timeout = setTimeout(() => {
+        try {
+          process.kill(-child.pid, 'SIGKILL');
+        } catch (_) {}
+      }, this.buildTimeoutMs);
+      let settled = false;
+      const finish = (succeeded) => {
+        if (settled) return;
+        settled = true;
+        clearTimeout(timeout);
+        if (!succeeded) return resolve(discard());
+        try {
+          fs.renameSync(staging, gch);
+          resolve(true);
+        } catch (_) {
+          resolve(discard());
+        }
+      };
+      child.on('error', () => finish(false));
+      child.on('exit', (code) => finish(code === 0));
+    });
+  }
+
+  /**
+   * Compile time of one submission, for the medians in getStats()
+   */
+  recordCompile(usedPch, ms) {
+    const samples = usedPch ? this.withPch : this.withoutPch;
+    const count = usedPch ? this.compilesWithPch++ : this.compilesWithoutPch++;
+    if (samples.length < MAX_SAMPLES) samples.push(ms);
+    else samples[count % MAX_SAMPLES] = ms;
+  }
+
+  getStats() {
+    return {
+      enabled: Boolean(this.directory),
+      profilesReady: [...this.states.values()].filter(state => state === 'ready').length,
+      compilesWithPch: this.compilesWithPch,
+      compilesWithoutPch: this.compilesWithoutPch,
+      medianWithPchMs: median(this.withPch),
+      medianWithoutPchMs: median(this.withoutPch)
+    };
+  }
+}
+
+module.exports = {
+  PchCache,
+  PROFILES,
+  headerPrefix,
+  matchProfile
+};
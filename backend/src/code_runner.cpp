@@ -1,9 +1,77 @@
 #include "../include/code_runner.h"
+#include "../include/engine_metrics.h"
+#include "../include/subprocess.h"
+#include <chrono>
+#include <csignal>
 #include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <locale>
+#include <sys/stat.h>
 
-CodeRunner::CodeRunner() {
+namespace {
+
+// Flags of each tier's builds; part of the cache key. Fast builds are what
+// a judge would run; sanitizer builds explain their crashes.
+constexpr const char *kFastFlags = "-std=c++20 -O1";
+constexpr const char *kSanitizedFlags =
+    "-std=c++20 -D_GLIBCXX_DEBUG -fsanitize=address,undefined";
+
+// cc1plus on <bits/stdc++.h> with the debug library needs well over the
+// program's budget
+const codeflow::ProcessLimits kCompileLimits{
+    .cpuSeconds = 60,
+    .addressSpaceBytes = 4ull << 30,
+    .processes = 64,
+    .fileSizeBytes = 256ull << 20,
+};
+constexpr std::chrono::seconds kCompileTimeout{90};
+
+const codeflow::ProcessLimits kFastRunLimits{
+    .cpuSeconds = 5,
+    .addressSpaceBytes = 512ull << 20,
+    .processes = 64,
+    .fileSizeBytes = 10ull << 20,
+};
+// No address-space limit: ASan reserves terabytes of shadow memory up
+// front. Its hard_rss_limit_mb bounds what the program actually uses.
+const codeflow::ProcessLimits kSanitizedRunLimits{
+    .cpuSeconds = 5,
+    .processes = 64,
+    .fileSizeBytes = 10ull << 20,
+};
+constexpr std::chrono::seconds kRunTimeout{5};
+constexpr const char *kRunAsanOptions = "ASAN_OPTIONS=hard_rss_limit_mb=256";
+// A streamed program runs under stdbuf, whose LD_PRELOAD would otherwise
+// make ASan refuse to start
+constexpr const char *kStreamedAsanOptions =
+    "ASAN_OPTIONS=hard_rss_limit_mb=256:verify_asan_link_order=0";
+
+// First line of `g++ --version`, read once: a compiler upgrade changes the
+// cache key
+const std::string &compilerIdentity() {
+  static const std::string identity = [] {
+    codeflow::ProcessOptions options;
+    options.environment = codeflow::minimalEnvironment();
+    options.timeout = std::chrono::seconds(10);
+    std::string out = codeflow::runProcess({"g++", "--version"}, options).out;
+    std::string line = out.substr(0, out.find('\n'));
+    return line.empty() ? std::string("g++ (unknown version)") : line;
+  }();
+  return identity;
+}
+
+} // namespace
+
+CodeRunner::CodeRunner()
+    : CodeRunner(kDefaultCacheDirectory,
+                 codeflow::CompileCache::kDefaultBudgetBytes) {}
+
+CodeRunner::CodeRunner(const std::string &cacheDirectory,
+                       std::size_t cacheBytes, const std::string &pchDirectory)
+    : compileCache(cacheDirectory, cacheBytes),
+      fastPch(pchDirectory, "g++", kFastFlags, compilerIdentity()),
+      sanitizedPch(pchDirectory, "g++", kSanitizedFlags, compilerIdentity()) {
   // Set locale to ensure proper UTF-8 handling
   try {
     std::locale::global(std::locale("en_US.UTF-8"));
@@ -18,13 +86,30 @@ CodeRunner::CodeRunner() {
   }
 }
 
-std::string CodeRunner::wrapJson(bool success, const std::string &output,
-                                 const std::string &error) {
-  std::string result =
-      "{\"success\":" + std::string(success ? "true" : "false") +
-      ",\"output\":" + escapeJsonString(output) +
-      ",\"error\":" + escapeJsonString(error) + "}";
-  return result;
+std::string CodeRunner::wrapJson(const RunResult &result) {
+  auto number = [](double value) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return std::string(buffer);
+  };
+  auto flag = [](bool value) { return std::string(value ? "true" : "false"); };
+  return "{\"success\":" + flag(result.success) +
+         ",\"output\":" + escapeJsonString(result.output) +
+         ",\"error\":" + escapeJsonString(result.error) +
+         ",\"stage\":" + escapeJsonString(result.stage) +
+         ",\"tier\":" + escapeJsonString(result.tier) +
+         ",\"escalated\":" + flag(result.escalated) +
+         ",\"fastSignal\":" + std::to_string(result.fastSignal) +
+         ",\"exitCode\":" + std::to_string(result.exitCode) +
+         ",\"signal\":" + std::to_string(result.signal) +
+         ",\"timedOut\":" + flag(result.timedOut) +
+         ",\"truncated\":" + flag(result.truncated) +
+         ",\"compileCached\":" + flag(result.compileCached) +
+         ",\"compileMs\":" + number(result.compileMs) +
+         ",\"wallMs\":" + number(result.wallMs) +
+         ",\"cpuMs\":" + number(result.cpuMs) + ",\"profile\":" +
+         (result.profile ? codeflow::profileJson(*result.profile) : "null") +
+         "}";
 }
 
 std::string CodeRunner::escapeJsonString(const std::string &str) {
@@ -53,7 +138,7 @@ std::string CodeRunner::escapeJsonString(const std::string &str) {
       result += "\\f";
       break;
     default:
-      if (c < 32) {
+      if (static_cast<unsigned char>(c) < 32) {
         char buf[7];
         snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)c);
         result += buf;
@@ -66,65 +151,267 @@ std::string CodeRunner::escapeJsonString(const std::string &str) {
   return result;
 }
 
-std::string CodeRunner::runCode(const std::string &cppCode) {
-  // Create temporary directory if it doesn't exist
-  system("mkdir -p /tmp/codeflow");
+namespace {
+
+// Per-run working directory under /tmp/codeflow, removed with everything in
+// it when the run ends
+class RunDirectory {
+public:
+  RunDirectory() {
+    ::mkdir("/tmp/codeflow", 0700);
+    char pattern[] = "/tmp/codeflow/run-XXXXXX";
+    if (::mkdtemp(pattern) != nullptr) {
+      path = pattern;
+    }
+  }
+  ~RunDirectory() {
+    if (!path.empty()) {
+      std::error_code ignored;
+      std::filesystem::remove_all(path, ignored);
+    }
+  }
+  RunDirectory(const RunDirectory &) = delete;
+  RunDirectory &operator=(const RunDirectory &) = delete;
+
+  std::string path;
+};
+
+bool isCancelled(const std::atomic<bool> *cancelled) {
+  return cancelled != nullptr && cancelled->load();
+}
+
+// Ended by a fault a sanitizer build can explain, rather than killed for a
+// timeout or a limit
+bool crashed(const RunResult &result) {
+  switch (result.signal) {
+  case SIGSEGV:
+  case SIGBUS:
+  case SIGFPE:
+  case SIGILL:
+  case SIGABRT:
+  case SIGTRAP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace
+
+bool parseExecutionMode(const std::string &name, ExecutionMode &mode) {
+  if (name == "tiered")
+    mode = ExecutionMode::Tiered;
+  else if (name == "fast")
+    mode = ExecutionMode::Fast;
+  else if (name == "sanitized")
+    mode = ExecutionMode::Sanitized;
+  else
+    return false;
+  return true;
+}
+
+std::string CodeRunner::runCode(const std::string &cppCode,
+                                const std::atomic<bool> *cancelled,
+                                const codeflow::OutputHandler &onOutput,
+                                ExecutionMode mode) {
+  return wrapJson(run(cppCode, cancelled, onOutput, mode));
+}
+
+RunResult CodeRunner::run(const std::string &cppCode,
+                          const std::atomic<bool> *cancelled,
+                          const codeflow::OutputHandler &onOutput,
+                          ExecutionMode mode) {
+  RunResult result;
+  if (isCancelled(cancelled)) {
+    result.error = "Cancelled";
+    return result;
+  }
+
+  RunDirectory dir;
+  if (dir.path.empty()) {
+    result.error = "Failed to create temporary directory";
+    return result;
+  }
 
   // Write code to temporary file
-  std::string tempFile = "/tmp/codeflow/main.cpp";
-  std::ofstream outfile(tempFile);
+  std::ofstream outfile(dir.path + "/main.cpp");
   if (!outfile.is_open()) {
-    return wrapJson(false, "", "Failed to create temporary file");
+    result.error = "Failed to create temporary file";
+    return result;
   }
   outfile << cppCode;
   outfile.close();
 
-  // Try to compile with g++ and sanitizers
-  std::string compileCmd =
-      "g++ -std=c++20 -D_GLIBCXX_DEBUG -fsanitize=address,undefined "
-      "/tmp/codeflow/main.cpp -o /tmp/codeflow/program 2>&1";
-  FILE *compileStream = popen(compileCmd.c_str(), "r");
-  if (!compileStream) {
-    return wrapJson(false, "", "Failed to execute compiler");
-  }
+  bool sanitized = mode == ExecutionMode::Sanitized;
+  result = runTier(sanitized, dir.path, cppCode, cancelled, onOutput);
+  if (mode != ExecutionMode::Tiered || !crashed(result) ||
+      isCancelled(cancelled))
+    return result;
 
-  std::string compileOutput;
-  char buffer[256];
-  while (fgets(buffer, sizeof(buffer), compileStream) != nullptr) {
-    compileOutput += buffer;
-  }
-  int compileStatus = pclose(compileStream);
+  // Rebuilt with sanitizers to say why it crashed. Its output was streamed
+  // already; the sanitizer's report goes to stderr.
+  codeflow::OutputHandler reportOnly;
+  if (onOutput)
+    reportOnly = [&onOutput](int stream, std::string_view data) {
+      if (stream == 2)
+        onOutput(stream, data);
+    };
+  RunResult diagnosed =
+      runTier(true, dir.path, cppCode, cancelled, reportOnly);
+  diagnosed.escalated = true;
+  diagnosed.fastSignal = result.signal;
+  return diagnosed;
+}
 
-  // If compilation failed, return error
-  if (compileStatus != 0) {
-    return wrapJson(false, "", compileOutput);
-  }
+RunResult CodeRunner::runTier(bool sanitized, const std::string &directory,
+                              const std::string &cppCode,
+                              const std::atomic<bool> *cancelled,
+                              const codeflow::OutputHandler &onOutput) {
+  RunResult result;
+  result.tier = sanitized ? "sanitized" : "fast";
+  const char *flags = sanitized ? kSanitizedFlags : kFastFlags;
+  codeflow::PchCache &pch = sanitized ? sanitizedPch : fastPch;
+  // Relative, so diagnostics don't name the run directory
+  const std::string program = sanitized ? "program-sanitized" : "program";
+  const std::string programFile = directory + "/" + program;
+
+  // The same code built before: reuse the program, or its diagnostics
+  result.stage = "compile";
+  const codeflow::CompileCache::Inputs inputs{compilerIdentity(), flags,
+                                              cppCode};
+  switch (compileCache.lookup(inputs, programFile, result.error)) {
+  case codeflow::CompileCache::Result::Diagnostics:
+    result.compileCached = true;
+    codeflow::EngineMetrics::global().add(codeflow::Counter::CompileCacheHits);
+    return result;
+  case codeflow::CompileCache::Result::Program:
+    result.compileCached = true;
+    codeflow::EngineMetrics::global().add(codeflow::Counter::CompileCacheHits);
+    break;
+  case codeflow::CompileCache::Result::Miss: {
+    // Compile with g++, loading the common headers precompiled when the
+    // code starts with a known include set. Temporary files go to the run
+    // directory.
+    std::vector<std::string> command{"g++"};
+    for (std::string &flag : codeflow::splitArguments(flags))
+      command.push_back(std::move(flag));
+    std::string header = pch.headerFor(cppCode);
+    if (!header.empty()) {
+      command.push_back("-include");
+      command.push_back(header);
+    }
+    command.insert(command.end(), {"main.cpp", "-o", program});
 
-  // Run the compiled program with timeout
-  std::string runCmd = "timeout 5 /tmp/codeflow/program 2>&1";
-  FILE *runStream = popen(runCmd.c_str(), "r");
-  if (!runStream) {
-    return wrapJson(false, "", "Failed to execute program");
+    codeflow::ProcessOptions options;
+    options.workingDirectory = directory;
+    options.environment = codeflow::minimalEnvironment();
+    options.environment.push_back("TMPDIR=" + directory);
+    options.limits = kCompileLimits;
+    options.timeout = kCompileTimeout;
+    options.cancelled = cancelled;
+    codeflow::ProcessResult compiled = codeflow::runProcess(command, options);
+    result.compileMs = compiled.wallMs;
+    pch.recordCompile(!header.empty(), compiled.wallMs);
+    if (compiled.started)
+      codeflow::EngineMetrics::global().record(
+          codeflow::Stage::Compile,
+          static_cast<std::uint64_t>(compiled.wallMs * 1e6));
+    if (!compiled.started) {
+      result.error = "Failed to execute compiler: " + compiled.error;
+      return result;
+    }
+    if (compiled.cancelled) {
+      result.error = "Cancelled";
+      return result;
+    }
+    // A build killed by a signal or the timeout is not cached; it may
+    // succeed next time
+    result.error = compiled.err + compiled.out;
+    if (compiled.timedOut) {
+      result.error = "Compilation timeout";
+      return result;
+    }
+    if (!compiled.succeeded()) {
+      if (compiled.signal == 0)
+        compileCache.storeDiagnostics(inputs, result.error);
+      else if (result.error.empty())
+        result.error = "Compiler killed by signal " +
+                       std::to_string(compiled.signal);
+      return result;
+    }
+    result.error.clear();
+    compileCache.storeProgram(inputs, programFile);
+    break;
+  }
   }
 
-  std::string output;
-  while (fgets(buffer, sizeof(buffer), runStream) != nullptr) {
-    output += buffer;
+  if (isCancelled(cancelled)) {
+    result.error = "Cancelled";
+    return result;
   }
-  int runStatus = pclose(runStream);
 
-  // Check if program timed out
-  if (runStatus == 124) {
-    return wrapJson(false, "", "Program execution timeout");
+  // Run the compiled program with a timeout and resource limits
+  result.stage = "run";
+  codeflow::ProcessOptions options;
+  options.workingDirectory = directory;
+  options.environment = codeflow::minimalEnvironment();
+  options.limits = sanitized ? kSanitizedRunLimits : kFastRunLimits;
+  options.timeout = kRunTimeout;
+  options.cancelled = cancelled;
+  options.hardwareCounters = true;
+  std::vector<std::string> command{programFile};
+  if (onOutput) {
+    // stdio fully buffers a pipe; line buffering lets output stream
+    command.insert(command.begin(), {"stdbuf", "-oL", "-eL"});
+    options.environment.push_back(kStreamedAsanOptions);
+    options.onOutput = onOutput;
+  } else {
+    options.environment.push_back(kRunAsanOptions);
   }
+  codeflow::ProcessResult ran = codeflow::runProcess(command, options);
 
-  // Return result
-  if (runStatus == 0) {
-    return wrapJson(true, output, "");
+  result.output = std::move(ran.out);
+  result.exitCode = ran.exitCode;
+  result.signal = ran.signal;
+  result.timedOut = ran.timedOut;
+  result.truncated = ran.truncated;
+  result.wallMs = ran.wallMs;
+  result.cpuMs = ran.cpuMs;
+  if (ran.started) {
+    result.profile = codeflow::RunProfile{ran.wallMs, ran.usage, ran.counters};
+    codeflow::EngineMetrics::global().record(
+        codeflow::Stage::Run, static_cast<std::uint64_t>(ran.wallMs * 1e6));
+  }
+  if (!ran.started) {
+    result.error = "Failed to execute program: " + ran.error;
+  } else if (ran.cancelled) {
+    result.error = "Cancelled";
+  } else if (ran.timedOut) {
+    result.error = "Program execution timeout";
+  } else if (ran.signal != 0) {
+    result.error = "Program killed by signal " + std::to_string(ran.signal) +
+                   (ran.err.empty() ? "" : "\n" + ran.err);
+  } else if (ran.exitCode != 0) {
+    result.error = "Program exited with code " + std::to_string(ran.exitCode) +
+                   (ran.err.empty() ? "" : "\n" + ran.err);
   } else {
-    std::string error = "Program exited with code " + std::to_string(runStatus);
-    return wrapJson(false, output, error);
+    result.success = true;
+    result.error = std::move(ran.err);
   }
+  return result;
+}
+
+codeflow::CompileCacheStats CodeRunner::getCacheStats() const {
+  return compileCache.stats();
+}
+
+codeflow::PchStats CodeRunner::getPchStats(bool sanitized) const {
+  return sanitized ? sanitizedPch.stats() : fastPch.stats();
+}
+
+std::size_t CodeRunner::warmPrecompiledHeaders() {
+  std::size_t ready = fastPch.warm();
+  return ready + sanitizedPch.warm();
 }
 
 std::string CodeRunner::escapeJson(const std::string &str) {
@@ -0,0 +1,244 @@
+#include "../include/compile_cache.h"
+#include "../include/hash.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace codeflow {
+
+namespace {
+
+constexpr const char *kInputsFile = "inputs";
+constexpr const char *kProgramFile = "program";
+constexpr const char *kDiagnosticsFile = "diagnostics";
+constexpr const char *kStagingPrefix = ".staging-";
+
+bool readFile(const fs::path &path, std::string &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  out = buffer.str();
+  return true;
+}
+
+bool writeFile(const fs::path &path, std::string_view data) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(data.data(), static_cast<std::streamsize>(data.size()));
+  return static_cast<bool>(file);
+}
+
+// Hard link when source and target share a filesystem, otherwise copy
+bool linkOrCopy(const fs::path &from, const fs::path &to) {
+  std::error_code error;
+  fs::remove(to, error);
+  if (::link(from.c_str(), to.c_str()) == 0)
+    return true;
+  return fs::copy_file(from, to, error);
+}
+
+std::size_t directoryBytes(const fs::path &path) {
+  std::size_t bytes = 0;
+  std::error_code error;
+  for (const auto &file : fs::directory_iterator(path, error)) {
+    std::error_code ignored;
+    std::uintmax_t size = file.file_size(ignored);
+    if (!ignored)
+      bytes += static_cast<std::size_t>(size);
+  }
+  return bytes;
+}
+
+} // namespace
+
+CompileCache::CompileCache(std::string directory, std::size_t budgetBytes)
+    : directory(std::move(directory)), budgetBytes(budgetBytes) {
+  if (!this->directory.empty())
+    adoptExisting();
+}
+
+std::string CompileCache::serialize(const Inputs &inputs) {
+  std::string out;
+  out.reserve(inputs.compiler.size() + inputs.flags.size() +
+              inputs.source.size() + 2);
+  out.append(inputs.compiler).push_back('\0');
+  out.append(inputs.flags).push_back('\0');
+  out.append(inputs.source);
+  return out;
+}
+
+std::string CompileCache::keyOf(const Inputs &inputs) {
+  std::string data = serialize(inputs);
+  // Two seeds give a 128-bit key; collisions are caught by comparing inputs
+  // on lookup
+  char key[33];
+  std::snprintf(key, sizeof(key), "%016llx%016llx",
+                static_cast<unsigned long long>(
+                    hash64(data, 0xcbf29ce484222325ull)),
+                static_cast<unsigned long long>(
+                    hash64(data, 0x84222325cbf29ce4ull)));
+  return key;
+}
+
+void CompileCache::adoptExisting() {
+  std::error_code error;
+  fs::create_directories(directory, error);
+  fs::permissions(directory, fs::perms::owner_all, error);
+
+  std::vector<std::pair<fs::file_time_type, Entry>> found;
+  for (const auto &item : fs::directory_iterator(directory, error)) {
+    std::string name = item.path().filename().string();
+    std::error_code ignored;
+    if (name.starts_with(kStagingPrefix)) {
+      fs::remove_all(item.path(), ignored); // Left by a crash
+      continue;
+    }
+    auto modified = fs::last_write_time(item.path() / kInputsFile, ignored);
+    if (ignored || !item.is_directory(ignored))
+      continue;
+    found.push_back({modified, {name, directoryBytes(item.path())}});
+  }
+  std::sort(found.begin(), found.end(), [](const auto &a, const auto &b) {
+    return a.first > b.first;
+  });
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &[modified, entry] : found) {
+    totalBytes += entry.bytes;
+    lru.push_back(std::move(entry));
+    entries[lru.back().key] = std::prev(lru.end());
+  }
+  evictOverBudget();
+}
+
+CompileCache::Result CompileCache::lookup(const Inputs &inputs,
+                                          const std::string &programPath,
+                                          std::string &diagnostics) {
+  if (directory.empty())
+    return Result::Miss;
+  std::string key = keyOf(inputs);
+  fs::path entry = fs::path(directory) / key;
+
+  // Held while reading the entry, so it cannot be evicted halfway
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = entries.find(key);
+  std::string stored;
+  if (it == entries.end() || !readFile(entry / kInputsFile, stored) ||
+      stored != serialize(inputs)) {
+    misses++;
+    return Result::Miss;
+  }
+
+  Result result;
+  std::error_code error;
+  if (fs::exists(entry / kProgramFile, error)) {
+    if (!linkOrCopy(entry / kProgramFile, programPath)) {
+      misses++;
+      return Result::Miss;
+    }
+    result = Result::Program;
+  } else if (readFile(entry / kDiagnosticsFile, diagnostics)) {
+    result = Result::Diagnostics;
+  } else {
+    misses++;
+    return Result::Miss;
+  }
+
+  lru.splice(lru.begin(), lru, it->second);
+  fs::last_write_time(entry / kInputsFile, fs::file_time_type::clock::now(),
+                      error);
+  hits++;
+  return result;
+}
+
+void CompileCache::storeProgram(const Inputs &inputs,
+                                const std::string &programPath) {
+  if (directory.empty())
+    return;
+  std::string staging = directory + "/" + kStagingPrefix + "XXXXXX";
+  if (::mkdtemp(staging.data()) == nullptr)
+    return;
+  if (writeFile(fs::path(staging) / kInputsFile, serialize(inputs)) &&
+      linkOrCopy(programPath, fs::path(staging) / kProgramFile)) {
+    publish(keyOf(inputs), staging);
+    return;
+  }
+  std::error_code ignored;
+  fs::remove_all(staging, ignored);
+}
+
+void CompileCache::storeDiagnostics(const Inputs &inputs,
+                                    std::string_view diagnostics) {
+  if (directory.empty())
+    return;
+  std::string staging = directory + "/" + kStagingPrefix + "XXXXXX";
+  if (::mkdtemp(staging.data()) == nullptr)
+    return;
+  if (writeFile(fs::path(staging) / kInputsFile, serialize(inputs)) &&
+      writeFile(fs::path(staging) / kDiagnosticsFile, diagnostics)) {
+    publish(keyOf(inputs), staging);
+    return;
+  }
+  std::error_code ignored;
+  fs::remove_all(staging, ignored);
+}
+
+void CompileCache::publish(const std::string &key, const std::string &staging) {
+  std::size_t bytes = directoryBytes(staging);
+  fs::path target = fs::path(directory) / key;
+  std::error_code error;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  // Replaces an entry stored meanwhile by a concurrent build of the same
+  // inputs (or one whose key collides)
+  auto it = entries.find(key);
+  if (it != entries.end()) {
+    totalBytes -= it->second->bytes;
+    lru.erase(it->second);
+    entries.erase(it);
+  }
+  fs::remove_all(target, error);
+  fs::rename(staging, target, error);
+  if (error) {
+    fs::remove_all(staging, error);
+    return;
+  }
+  lru.push_front({key, bytes});
+  entries[key] = lru.begin();
+  totalBytes += bytes;
+  evictOverBudget();
+}
+
+void CompileCache::evictOverBudget() {
+  while (totalBytes > budgetBytes && !lru.empty()) {
+    const Entry &victim = lru.back();
+    std::error_code ignored;
+    fs::remove_all(fs::path(directory) / victim.key, ignored);
+    totalBytes -= victim.bytes;
+    entries.erase(victim.key);
+    lru.pop_back();
+    evictions++;
+  }
+}
+
+void CompileCache::setBudget(std::size_t budget) {
+  std::lock_guard<std::mutex> lock(mutex);
+  budgetBytes = budget;
+  evictOverBudget();
+}
+
+CompileCacheStats CompileCache::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return {hits, misses, evictions, entries.size(), totalBytes, budgetBytes};
+}
+
+} // namespace codeflow
@@ -0,0 +1,547 @@
+#include "../include/document.h"
+#include <algorithm>
+#include <array>
+
+namespace codeflow {
+
+namespace {
+
+// Rough cost of one aggregated symbol beyond its characters: hash nodes in
+// the per-name and published maps plus their string headers.
+constexpr std::size_t kSymbolOverhead = 6 * sizeof(void *) + 2 * sizeof(std::string);
+
+// STL types whose variables get member completions
+constexpr std::array<std::string_view, 14> kContainerTypes = {
+    "vector", "stack",        "queue",        "deque",
+    "map",    "unordered_map", "set",          "unordered_set",
+    "string", "list",          "forward_list", "priority_queue",
+    "array",  "bitset"};
+
+// ASCII-only classification; std::isalnum and friends consult the locale
+bool isWordChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+bool isHeaderChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' ||
+         c == '/' || c == '.' || c == '+';
+}
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' ||
+         c == '\v';
+}
+
+bool isDeclarationEnd(char c) {
+  return c == '=' || c == ';' || c == '(' || c == '{';
+}
+
+bool isContainerType(std::string_view word) {
+  return std::find(kContainerTypes.begin(), kContainerTypes.end(), word) !=
+         kContainerTypes.end();
+}
+
+std::size_t skipSpaces(std::string_view text, std::size_t pos) {
+  while (pos < text.size() && isSpace(text[pos]))
+    pos++;
+  return pos;
+}
+
+std::size_t skipWord(std::string_view text, std::size_t pos) {
+  while (pos < text.size() && isWordChar(text[pos]))
+    pos++;
+  return pos;
+}
+
+// Past the closing quote of the literal at pos, or past the end of its line
+// if it is unterminated: ordinary literals cannot span lines
+std::size_t skipQuoted(std::string_view text, std::size_t pos) {
+  char quote = text[pos++];
+  while (pos < text.size() && text[pos] != quote && text[pos] != '\n') {
+    pos += text[pos] == '\\' ? 2 : 1;
+  }
+  return std::min(pos + 1, text.size());
+}
+
+// Whether the quote at pos opens a raw string: R"...", u8R"...", LR"..."
+bool opensRawString(std::string_view text, std::size_t pos) {
+  std::size_t start = pos;
+  while (start > 0 && isWordChar(text[start - 1]))
+    start--;
+  std::string_view prefix = text.substr(start, pos - start);
+  return prefix == "R" || prefix == "u8R" || prefix == "uR" ||
+         prefix == "UR" || prefix == "LR";
+}
+
+// Past the raw string whose opening quote is at pos (R"delim(...)delim"),
+// or the end of text if it is not closed
+std::size_t skipRawString(std::string_view text, std::size_t pos) {
+  constexpr std::size_t kMaxDelimiter = 16;
+  std::size_t open = text.find('(', pos + 1);
+  if (open == std::string_view::npos || open - pos - 1 > kMaxDelimiter)
+    return skipQuoted(text, pos);
+  std::string_view delimiter = text.substr(pos + 1, open - pos - 1);
+  for (std::size_t close = text.find(')', open + 1);
+       close != std::string_view::npos; close = text.find(')', close + 1)) {
+    std::size_t quote = close + 1 + delimiter.size();
+    if (quote < text.size() && text[quote] == '"' &&
+        text.substr(close + 1, delimiter.size()) == delimiter)
+      return quote + 1;
+  }
+  return text.size();
+}
+
+// Past the '>' closing the template argument list opened at pos. Nested
+// lists are tracked by depth, so ">>" closes two levels. npos if the list is
+// not closed before a statement boundary.
+std::size_t skipTemplateArgs(std::string_view text, std::size_t pos) {
+  int depth = 0;
+  for (; pos < text.size(); ++pos) {
+    char c = text[pos];
+    if (c == '<') {
+      depth++;
+    } else if (c == '>') {
+      if (--depth == 0)
+        return pos + 1;
+    } else if (c == ';' || c == '{' || c == '}' || c == '=') {
+      break;
+    }
+  }
+  return std::string_view::npos;
+}
+
+// Words that may precede a declaration's type
+constexpr std::array<std::string_view, 12> kDeclarationQualifiers = {
+    "const",    "static",  "unsigned", "signed",    "long",   "short",
+    "volatile", "mutable", "register", "constexpr", "inline", "extern"};
+
+// Statement keywords that look like a type followed by a name
+constexpr std::array<std::string_view, 9> kNotTypes = {
+    "return", "using", "namespace", "else", "delete",
+    "throw",  "case",  "goto",      "new"};
+
+constexpr std::array<std::string_view, 5> kNotNames = {"main", "include",
+                                                       "define", "if", "return"};
+
+template <std::size_t N>
+bool isOneOf(const std::array<std::string_view, N> &words,
+             std::string_view word) {
+  return std::find(words.begin(), words.end(), word) != words.end();
+}
+
+bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Name following the type that starts at pos ("std::map<K, V>::iterator&
+// it"), or empty
+std::string_view nameAfterType(std::string_view line, std::size_t pos) {
+  auto skipBlanks = [&] {
+    while (pos < line.size() && isBlank(line[pos]))
+      pos++;
+  };
+  pos = skipWord(line, pos);
+
+  bool separated = false;
+  while (true) {
+    std::size_t start = pos;
+    skipBlanks();
+    if (line.substr(pos).starts_with("::")) {
+      pos += 2;
+      skipBlanks();
+      pos = skipWord(line, pos);
+      continue;
+    }
+    if (pos < line.size() && line[pos] == '<') {
+      pos = skipTemplateArgs(line, pos);
+      if (pos == std::string_view::npos)
+        return {};
+      separated = true;
+      continue;
+    }
+    separated |= pos > start;
+    break;
+  }
+  while (pos < line.size() &&
+         (line[pos] == '*' || line[pos] == '&' || isBlank(line[pos]))) {
+    pos++;
+    separated = true;
+  }
+  if (!separated)
+    return {};
+
+  std::size_t nameEnd = skipWord(line, pos);
+  std::string_view name = line.substr(pos, nameEnd - pos);
+  if (name.empty() || (name[0] >= '0' && name[0] <= '9') ||
+      isOneOf(kNotNames, name))
+    return {};
+  return name;
+}
+
+// Name declared at the start of line, or empty
+std::string_view declaredName(std::string_view line) {
+  std::size_t pos = 0;
+  while (pos < line.size() && isBlank(line[pos]))
+    pos++;
+  if (line.substr(pos).starts_with("/*") || line.substr(pos).starts_with("*"))
+    return {};
+
+  // Skip qualifiers; in "unsigned long n" the last one is the type
+  std::size_t qualifier = std::string_view::npos;
+  while (true) {
+    std::size_t wordEnd = skipWord(line, pos);
+    std::string_view word = line.substr(pos, wordEnd - pos);
+    if (word.empty() || (word[0] >= '0' && word[0] <= '9'))
+      return {};
+    if (!isOneOf(kDeclarationQualifiers, word) || wordEnd >= line.size() ||
+        !isBlank(line[wordEnd])) {
+      if (isOneOf(kNotTypes, word))
+        return {};
+      break;
+    }
+    qualifier = pos;
+    pos = wordEnd;
+    while (pos < line.size() && isBlank(line[pos]))
+      pos++;
+  }
+
+  std::string_view name = nameAfterType(line, pos);
+  if (name.empty() && qualifier != std::string_view::npos)
+    name = nameAfterType(line, qualifier);
+  return name;
+}
+
+} // namespace
+
+void extractDeclaredNames(std::string_view text,
+                          std::vector<std::string_view> &out,
+                          std::size_t maxLines) {
+  for (std::size_t line = 0; line < maxLines && !text.empty(); ++line) {
+    std::size_t end = text.find('\n');
+    std::string_view current = text.substr(0, end);
+    text = end == std::string_view::npos ? std::string_view()
+                                         : text.substr(end + 1);
+    current = current.substr(0, current.find("//"));
+
+    std::string_view name = declaredName(current);
+    if (!name.empty() && std::find(out.begin(), out.end(), name) == out.end())
+      out.push_back(name);
+  }
+}
+
+void extractSymbols(std::string_view text, ExtractedSymbols &out) {
+  // Single forward pass; each position is examined a bounded number of times.
+  // Comments and string literals are skipped, so names inside them are not
+  // picked up.
+  std::size_t pos = 0;
+  const std::size_t size = text.size();
+  while (pos < size) {
+    char c = text[pos];
+
+    if (c == '/' && pos + 1 < size && text[pos + 1] == '/') {
+      // Rest of the line is a comment
+      pos = text.find('\n', pos + 2);
+      continue;
+    }
+    if (c == '/' && pos + 1 < size && text[pos + 1] == '*') {
+      std::size_t close = text.find("*/", pos + 2);
+      if (close == std::string_view::npos)
+        return;
+      pos = close + 2;
+      continue;
+    }
+    if (c == '"' && opensRawString(text, pos)) {
+      pos = skipRawString(text, pos);
+      continue;
+    }
+    if (c == '"' || c == '\'') {
+      pos = skipQuoted(text, pos);
+      continue;
+    }
+
+    // ✅ Parse includes: #include <vector>, #include <stack>, etc.
+    if (c == '#') {
+      std::size_t cursor = skipSpaces(text, pos + 1);
+      if (text.substr(cursor, 7) == "include") {
+        cursor = skipSpaces(text, cursor + 7);
+        if (cursor < size && text[cursor] == '<') {
+          cursor = skipSpaces(text, cursor + 1);
+          std::size_t nameStart = cursor;
+          while (cursor < size && isHeaderChar(text[cursor]))
+            cursor++;
+          std::size_t nameEnd = cursor;
+          cursor = skipSpaces(text, cursor);
+          if (nameEnd > nameStart && cursor < size && text[cursor] == '>') {
+            // <stdio.h> and <foo.hpp> are recorded without the extension
+            std::string_view name = text.substr(nameStart, nameEnd - nameStart);
+            for (std::string_view extension : {".h", ".hpp"}) {
+              if (name.ends_with(extension)) {
+                name.remove_suffix(extension.size());
+                break;
+              }
+            }
+            out.includes.emplace_back(name);
+            pos = cursor + 1;
+            continue;
+          }
+        }
+      }
+      pos++;
+      continue;
+    }
+
+    if (!isWordChar(c)) {
+      pos++;
+      continue;
+    }
+
+    // Numbers, whose ' separates digits (1'000'000) rather than opening a
+    // character literal
+    if (c >= '0' && c <= '9') {
+      pos = skipWord(text, pos);
+      while (pos + 1 < size && text[pos] == '\'' && isWordChar(text[pos + 1]))
+        pos = skipWord(text, pos + 1);
+      continue;
+    }
+
+    // ✅ Parse variable declarations - specifically for STL containers
+    // Patterns: vector<int> v;  map<int, vector<int>> m;  string s;
+    std::size_t wordEnd = skipWord(text, pos);
+    std::string_view type = text.substr(pos, wordEnd - pos);
+    pos = wordEnd;
+    if (!isContainerType(type))
+      continue;
+
+    std::size_t cursor = wordEnd;
+    bool templated = false;
+    std::size_t after = skipSpaces(text, cursor);
+    if (after < size && text[after] == '<') {
+      cursor = skipTemplateArgs(text, after);
+      if (cursor == std::string_view::npos)
+        continue;
+      templated = true;
+    }
+
+    // The variable name must be separated from a bare type by whitespace
+    std::size_t nameStart = skipSpaces(text, cursor);
+    if (nameStart == cursor && !templated)
+      continue;
+    if (nameStart >= size || !isWordChar(text[nameStart]))
+      continue;
+    std::size_t nameEnd = skipWord(text, nameStart);
+    std::size_t terminator = skipSpaces(text, nameEnd);
+    if (terminator < size && isDeclarationEnd(text[terminator])) {
+      out.declarations.emplace_back(text.substr(nameStart, nameEnd - nameStart),
+                                    type);
+      pos = terminator + 1;
+    }
+  }
+}
+
+Document::Document() { reset({}); }
+
+void Document::reset(std::string_view text) {
+  buffer.assign(text);
+  includeCounts.clear();
+  declaredTypes.clear();
+  current = DocumentSymbols();
+  symbolBytes = 0;
+  scopeIndex.reset();
+
+  blocks.clear();
+  lines = 0;
+  std::string_view view(buffer);
+  for (std::size_t start = 0;;) {
+    std::size_t newline = view.find('\n', start);
+    std::size_t end = newline == std::string_view::npos ? view.size() : newline;
+    if (blocks.empty() || blocks.back().lengths.size() == kBlockLines)
+      blocks.emplace_back();
+    LineBlock &block = blocks.back();
+    block.lengths.push_back(end - start + (newline != std::string_view::npos));
+    block.bytes += block.lengths.back();
+    extractSymbols(view.substr(start, end - start), block.symbols.emplace_back());
+    addContribution(block.symbols.back());
+    ++lines;
+    if (newline == std::string_view::npos)
+      break;
+    start = newline + 1;
+  }
+}
+
+bool Document::apply(const TextEdit &edit) {
+  if (edit.offset > buffer.size() ||
+      edit.removedLength > buffer.size() - edit.offset) {
+    return false;
+  }
+
+  // Lines touched by the removed range, including the ones it ends in
+  const LinePosition first = lineAt(edit.offset);
+  const LinePosition last = lineAt(edit.offset + edit.removedLength);
+  std::size_t removedLines = 0;
+  for (std::size_t b = first.block; b <= last.block; ++b) {
+    const LineBlock &block = blocks[b];
+    std::size_t from = b == first.block ? first.line : 0;
+    std::size_t to = b == last.block ? last.line + 1 : block.symbols.size();
+    for (std::size_t line = from; line < to; ++line)
+      removeContribution(block.symbols[line]);
+    removedLines += to - from;
+  }
+  const std::size_t lastLength = blocks[last.block].lengths[last.line];
+  const bool lastHasNewline = last.block + 1 < blocks.size() ||
+                              last.line + 1 < blocks[last.block].lengths.size();
+
+  scopeIndex.reset();
+  buffer.replace(edit.offset, edit.removedLength, edit.text);
+
+  // Re-split and re-scan only the damaged region. The last line keeps the
+  // newline it had, if any.
+  const std::size_t regionEnd = last.start + lastLength + edit.text.size() -
+                                edit.removedLength - lastHasNewline;
+  std::vector<std::size_t> lengths;
+  std::vector<ExtractedSymbols> scanned;
+  std::string_view view(buffer);
+  for (std::size_t start = first.start;;) {
+    std::size_t newline = view.find('\n', start);
+    bool inside = newline < regionEnd;
+    std::size_t end = inside ? newline : regionEnd;
+    lengths.push_back(end - start + (inside || lastHasNewline));
+    extractSymbols(view.substr(start, end - start), scanned.emplace_back());
+    addContribution(scanned.back());
+    if (!inside)
+      break;
+    start = newline + 1;
+  }
+
+  // Splice the new lines over the old ones: the first block keeps the
+  // lines before them and takes over the last block's lines after them
+  lines = lines - removedLines + lengths.size();
+  LineBlock &head = blocks[first.block];
+  LineBlock &tail = blocks[last.block];
+  const auto keep = static_cast<std::ptrdiff_t>(last.line + 1);
+  lengths.insert(lengths.end(), tail.lengths.begin() + keep, tail.lengths.end());
+  scanned.insert(scanned.end(),
+                 std::make_move_iterator(tail.symbols.begin() + keep),
+                 std::make_move_iterator(tail.symbols.end()));
+  const auto from = static_cast<std::ptrdiff_t>(first.line);
+  head.lengths.erase(head.lengths.begin() + from, head.lengths.end());
+  head.symbols.erase(head.symbols.begin() + from, head.symbols.end());
+  head.lengths.insert(head.lengths.end(), lengths.begin(), lengths.end());
+  head.symbols.insert(head.symbols.end(),
+                      std::make_move_iterator(scanned.begin()),
+                      std::make_move_iterator(scanned.end()));
+  head.bytes = 0;
+  for (std::size_t length : head.lengths)
+    head.bytes += length;
+  blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(first.block) + 1,
+               blocks.begin() + static_cast<std::ptrdiff_t>(last.block) + 1);
+  rebalance(first.block);
+  return true;
+}
+std::shared_ptr<const ScopeIndex> Document::scopes() const {
+  std::lock_guard<std::mutex> lock(scopesMutex);
+  if (!scopeIndex) {
+    auto built = std::make_shared<ScopeIndex>();
+    built->buildCopy(buffer);
+    scopeIndex = std::move(built);
+  }
+  return scopeIndex;
+}
+
+std::size_t Document::memoryUsage() const {
+  std::lock_guard<std::mutex> lock(scopesMutex);
+  return sizeof(Document) + buffer.capacity() +
+         blocks.capacity() * sizeof(LineBlock) +
+         lines * (sizeof(std::size_t) + sizeof(ExtractedSymbols)) +
+         symbolBytes + (scopeIndex ? scopeIndex->memoryUsage() : 0);
+}
+
+Document::LinePosition Document::lineAt(std::size_t offset) const {
+  std::size_t block = 0, start = 0;
+  while (block + 1 < blocks.size() && start + blocks[block].bytes <= offset)
+    start += blocks[block++].bytes;
+  const std::vector<std::size_t> &lengths = blocks[block].lengths;
+  std::size_t line = 0;
+  while (line + 1 < lengths.size() && start + lengths[line] <= offset)
+    start += lengths[line++];
+  return {block, line, start};
+}
+
+void Document::rebalance(std::size_t block) {
+  LineBlock &grown = blocks[block];
+  if (grown.lengths.size() > 2 * kBlockLines) {
+    std::vector<LineBlock> pieces;
+    for (std::size_t at = kBlockLines; at < grown.lengths.size();
+         at += kBlockLines) {
+      const auto from = static_cast<std::ptrdiff_t>(at);
+      const auto to = static_cast<std::ptrdiff_t>(
+          std::min(at + kBlockLines, grown.lengths.size()));
+      LineBlock &piece = pieces.emplace_back();
+      piece.lengths.assign(grown.lengths.begin() + from,
+                           grown.lengths.begin() + to);
+      piece.symbols.assign(std::make_move_iterator(grown.symbols.begin() + from),
+                           std::make_move_iterator(grown.symbols.begin() + to));
+      for (std::size_t length : piece.lengths)
+        piece.bytes += length;
+      grown.bytes -= piece.bytes;
+    }
+    grown.lengths.resize(kBlockLines);
+    grown.symbols.resize(kBlockLines);
+    blocks.insert(blocks.begin() + static_cast<std::ptrdiff_t>(block) + 1,
+                  std::make_move_iterator(pieces.begin()),
+                  std::make_move_iterator(pieces.end()));
+  } else if (grown.lengths.size() < kBlockLines / 2 &&
+             block + 1 < blocks.size() &&
+             grown.lengths.size() + blocks[block + 1].lengths.size() <=
+                 2 * kBlockLines) {
+    LineBlock &next = blocks[block + 1];
+    grown.lengths.insert(grown.lengths.end(), next.lengths.begin(),
+                         next.lengths.end());
+    grown.symbols.insert(grown.symbols.end(),
+                         std::make_move_iterator(next.symbols.begin()),
+                         std::make_move_iterator(next.symbols.end()));
+    grown.bytes += next.bytes;
+    blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(block) + 1);
+  }
+}
+
+void Document::addContribution(const ExtractedSymbols &symbols) {
+  for (const auto &lib : symbols.includes) {
+    if (includeCounts[lib]++ == 0) {
+      current.includedLibraries.insert(lib);
+      symbolBytes += kSymbolOverhead + lib.size();
+    }
+  }
+  for (const auto &[var, type] : symbols.declarations) {
+    auto &types = declaredTypes[var];
+    if (types.empty())
+      symbolBytes += kSymbolOverhead + var.size();
+    types.push_back(type);
+    symbolBytes += type.size();
+    current.symbolTable[var] = type;
+  }
+}
+
+void Document::removeContribution(const ExtractedSymbols &symbols) {
+  for (const auto &lib : symbols.includes) {
+    auto it = includeCounts.find(lib);
+    if (--it->second == 0) {
+      includeCounts.erase(it);
+      current.includedLibraries.erase(lib);
+      symbolBytes -= kSymbolOverhead + lib.size();
+    }
+  }
+  for (const auto &[var, type] : symbols.declarations) {
+    auto it = declaredTypes.find(var);
+    auto &types = it->second;
+    types.erase(std::find(types.rbegin(), types.rend(), type).base() - 1);
+    symbolBytes -= type.size();
+    if (types.empty()) {
+      declaredTypes.erase(it);
+      current.symbolTable.erase(var);
+      symbolBytes -= kSymbolOverhead + var.size();
+    } else {
+      current.symbolTable[var] = types.back();
+    }
+  }
+}
+
+} // namespace codeflow
@@ -0,0 +1,212 @@
+#include "../include/engine_metrics.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+namespace codeflow {
+
+static_assert(std::is_same_v<std::chrono::steady_clock::period, std::nano>,
+              "StageTimer reads steady_clock ticks as nanoseconds");
+
+namespace {
+
+// xorshift64
+std::uint64_t next(std::uint64_t &state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+// Returns the shard when its thread exits
+struct Lease {
+  std::atomic<bool> *leased = nullptr;
+  ~Lease() {
+    if (leased)
+      leased->store(false, std::memory_order_release);
+  }
+};
+
+} // namespace
+
+std::size_t LatencyHistogram::bucketOf(std::uint64_t ns) {
+  if (ns < 2 * kSubBuckets)
+    return static_cast<std::size_t>(ns);
+  int exponent = std::bit_width(ns) - 1;
+  if (exponent > kMaxExponent)
+    return kBuckets - 1;
+  std::size_t sub = (ns >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+  return kSubBuckets * (exponent - kSubBucketBits + 1) + sub;
+}
+
+std::uint64_t LatencyHistogram::bucketLimit(std::size_t bucket) {
+  if (bucket < 2 * kSubBuckets)
+    return bucket + 1;
+  int exponent = static_cast<int>(bucket / kSubBuckets) + kSubBucketBits - 1;
+  std::uint64_t sub = bucket % kSubBuckets;
+  return (kSubBuckets + sub + 1) << (exponent - kSubBucketBits);
+}
+
+std::uint64_t LatencyHistogram::countBelow(std::uint64_t limitNs) const {
+  std::uint64_t below = 0;
+  for (std::size_t i = 0; i < kBuckets && bucketLimit(i) <= limitNs; ++i)
+    below += buckets[i];
+  return below;
+}
+
+std::uint64_t LatencyHistogram::quantileNs(double q) const {
+  if (count == 0)
+    return 0;
+  std::uint64_t rank = static_cast<std::uint64_t>(
+      std::ceil(q * static_cast<double>(count)));
+  rank = std::max<std::uint64_t>(rank, 1);
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < kBuckets; ++i) {
+    seen += buckets[i];
+    if (seen >= rank)
+      return bucketLimit(i) - 1;
+  }
+  return bucketLimit(kBuckets - 1) - 1;
+}
+
+EngineMetrics::Shard &EngineMetrics::claim() {
+  thread_local Lease lease;
+  Shard *shard = nullptr;
+
+  // A shard a finished thread left behind, else a new one. Acquiring the
+  // lease makes its last owner's writes visible.
+  for (Shard *s = shards.load(std::memory_order_acquire); s;
+       s = s->next.load(std::memory_order_relaxed)) {
+    bool free = false;
+    if (s->leased.compare_exchange_strong(free, true,
+                                          std::memory_order_acquire)) {
+      shard = s;
+      break;
+    }
+  }
+  if (!shard) {
+    shard = new Shard(reinterpret_cast<std::uintptr_t>(&lease) *
+                      0x9E3779B97F4A7C15ull);
+    Shard *head = shards.load(std::memory_order_relaxed);
+    do {
+      shard->next.store(head, std::memory_order_relaxed);
+    } while (!shards.compare_exchange_weak(head, shard,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+  }
+  lease.leased = &shard->leased;
+  current = shard;
+  return *shard;
+}
+
+void EngineMetrics::record(Stage stage, std::uint64_t ns) {
+  if (!enabled.load(std::memory_order_relaxed))
+    return;
+  Shard::Histogram &histogram =
+      local().histograms[static_cast<std::size_t>(stage)];
+  bump(histogram.buckets[LatencyHistogram::bucketOf(ns)], 1);
+  bump(histogram.sumNs, ns);
+}
+
+bool EngineMetrics::resample(Shard &shard) {
+  std::uint32_t mean = every.load(std::memory_order_relaxed);
+  if (mean == 0) {
+    // Until setSampleEvery turns sampling back on
+    shard.countdown.store(UINT32_MAX, std::memory_order_relaxed);
+    return false;
+  }
+  // Uniform over [1, 2 * mean), so mean calls apart on average
+  std::uint64_t span = 2 * static_cast<std::uint64_t>(mean) - 1;
+  shard.countdown.store(
+      static_cast<std::uint32_t>(((next(shard.random) >> 32) * span) >> 32) + 1,
+      std::memory_order_relaxed);
+  return true;
+}
+
+void EngineMetrics::setSampleEvery(std::uint32_t sampleEvery) {
+  every.store(sampleEvery, std::memory_order_relaxed);
+  // Draw every thread's next sample at the new rate. A thread counting
+  // down meanwhile may overwrite this; it then keeps the old interval once.
+  for (Shard *s = shards.load(std::memory_order_acquire); s;
+       s = s->next.load(std::memory_order_relaxed))
+    s->countdown.store(1, std::memory_order_relaxed);
+}
+
+std::uint32_t EngineMetrics::sampleEvery() const {
+  return every.load(std::memory_order_relaxed);
+}
+
+LatencyHistogram EngineMetrics::histogram(Stage stage) const {
+  LatencyHistogram total;
+  for (Shard *s = shards.load(std::memory_order_acquire); s;
+       s = s->next.load(std::memory_order_relaxed)) {
+    const Shard::Histogram &part =
+        s->histograms[static_cast<std::size_t>(stage)];
+    total.sumNs += part.sumNs.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < LatencyHistogram::kBuckets; ++i)
+      total.buckets[i] += part.buckets[i].load(std::memory_order_relaxed);
+  }
+  // From the buckets, so quantiles agree with it under concurrent writes
+  for (std::uint64_t n : total.buckets)
+    total.count += n;
+  return total;
+}
+
+std::uint64_t EngineMetrics::count(Counter counter) const {
+  std::uint64_t total = 0;
+  for (Shard *s = shards.load(std::memory_order_acquire); s;
+       s = s->next.load(std::memory_order_relaxed))
+    total +=
+        s->counters[static_cast<std::size_t>(counter)].load(
+            std::memory_order_relaxed);
+  return total;
+}
+
+const char *EngineMetrics::name(Stage stage) {
+  switch (stage) {
+  case Stage::Query:
+    return "query";
+  case Stage::ContextResolution:
+    return "context_resolution";
+  case Stage::TrieLookup:
+    return "trie_lookup";
+  case Stage::Filtering:
+    return "filtering";
+  case Stage::Ranking:
+    return "ranking";
+  case Stage::Marshalling:
+    return "marshalling";
+  case Stage::Reindex:
+    return "reindex";
+  case Stage::Compile:
+    return "compile";
+  case Stage::Run:
+    return "run";
+  }
+  return "unknown";
+}
+
+const char *EngineMetrics::name(Counter counter) {
+  switch (counter) {
+  case Counter::Queries:
+    return "queries";
+  case Counter::CompileCacheHits:
+    return "compile_cache_hits";
+  }
+  return "unknown";
+}
+
+const char *EngineMetrics::description(Counter counter) {
+  switch (counter) {
+  case Counter::Queries:
+    return "Suggestion queries answered by the native engine";
+  case Counter::CompileCacheHits:
+    return "Native runCode builds reused from the compile cache";
+  }
+  return "";
+}
+
+} // namespace codeflow
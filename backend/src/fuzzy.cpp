@@ -0,0 +1,287 @@
+#include "../include/fuzzy.h"
+#include <algorithm>
+#include <unordered_set>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CODEFLOW_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace codeflow {
+
+namespace {
+
+// Alignment scores, in the spirit of fzf: every matched character is worth
+// kMatch plus a bonus for where it lands
+constexpr int kMatch = 16;
+constexpr int kBonusStart = 12;    // First character of the name
+constexpr int kBonusBoundary = 10; // After '_', ':' or another separator
+constexpr int kBonusCamel = 9;     // Upper case after lower case
+constexpr int kBonusDigit = 4;     // Digit after a letter
+constexpr int kConsecutive = 8;    // Directly after the previous match
+constexpr int kGapOpen = 3;
+constexpr int kGapExtend = 1;
+constexpr int kMaxLeadingPenalty = 3;
+
+// Longer names are matched greedily instead of aligned
+constexpr std::size_t kMaxAligned = 64;
+constexpr int kNone = -(1 << 20);
+
+constexpr int kUnderscoreBit = 36;
+constexpr int kOtherBit = 37;
+
+char lowerAscii(char c) { return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c; }
+bool isLowerAscii(char c) { return c >= 'a' && c <= 'z'; }
+bool isUpperAscii(char c) { return c >= 'A' && c <= 'Z'; }
+bool isDigitAscii(char c) { return c >= '0' && c <= '9'; }
+bool isAlnumAscii(char c) {
+  return isLowerAscii(c) || isUpperAscii(c) || isDigitAscii(c);
+}
+
+int boundaryBonus(std::string_view text, std::size_t i) {
+  if (i == 0)
+    return kBonusStart;
+  char prev = text[i - 1];
+  char c = text[i];
+  if (!isAlnumAscii(prev) && static_cast<unsigned char>(prev) < 0x80)
+    return kBonusBoundary;
+  if (isLowerAscii(prev) && isUpperAscii(c))
+    return kBonusCamel;
+  if (!isDigitAscii(prev) && isDigitAscii(c))
+    return kBonusDigit;
+  return 0;
+}
+
+// Leftmost match, scored without alignment; kNone if there is none
+int greedyScore(std::string_view lower, std::string_view text) {
+  int score = 0;
+  std::size_t last = 0;
+  std::size_t p = 0;
+  for (std::size_t i = 0; i < text.size() && p < lower.size(); ++i) {
+    if (lowerAscii(text[i]) != lower[p])
+      continue;
+    score += kMatch + boundaryBonus(text, i);
+    if (p == 0)
+      score -= std::min<int>(int(i), kMaxLeadingPenalty);
+    else if (i == last + 1)
+      score += kConsecutive;
+    else
+      score -= kGapOpen + kGapExtend * int(i - last - 2);
+    last = i;
+    p++;
+  }
+  return p == lower.size() ? score : kNone;
+}
+
+void filterScalar(const std::uint64_t *masks, std::size_t count,
+                  std::uint64_t mask, std::vector<std::uint32_t> &out) {
+  for (std::size_t i = 0; i < count; ++i) {
+    if ((masks[i] & mask) == mask)
+      out.push_back(static_cast<std::uint32_t>(i));
+  }
+}
+
+#ifdef CODEFLOW_X86_SIMD
+
+// SSE2 has no 64-bit compare: compare both 32-bit halves instead
+std::size_t filterSse2(const std::uint64_t *masks, std::size_t count,
+                       std::uint64_t mask, std::vector<std::uint32_t> &out) {
+  const __m128i want = _mm_set1_epi64x(static_cast<long long>(mask));
+  std::size_t i = 0;
+  for (; i + 2 <= count; i += 2) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(masks + i));
+    __m128i eq = _mm_cmpeq_epi32(_mm_and_si128(v, want), want);
+    int halves = _mm_movemask_ps(_mm_castsi128_ps(eq));
+    if ((halves & 0x3) == 0x3)
+      out.push_back(static_cast<std::uint32_t>(i));
+    if ((halves & 0xc) == 0xc)
+      out.push_back(static_cast<std::uint32_t>(i + 1));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) std::size_t
+filterAvx2(const std::uint64_t *masks, std::size_t count, std::uint64_t mask,
+           std::vector<std::uint32_t> &out) {
+  const __m256i want = _mm256_set1_epi64x(static_cast<long long>(mask));
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i v =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(masks + i));
+    __m256i eq = _mm256_cmpeq_epi64(_mm256_and_si256(v, want), want);
+    unsigned hits =
+        static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+    while (hits) {
+      out.push_back(static_cast<std::uint32_t>(i + __builtin_ctz(hits)));
+      hits &= hits - 1;
+    }
+  }
+  return i;
+}
+
+#endif // CODEFLOW_X86_SIMD
+
+} // namespace
+
+std::uint64_t fuzzyMask(std::string_view text) {
+  std::uint64_t bits = 0;
+  for (char c : text) {
+    c = lowerAscii(c);
+    if (isLowerAscii(c))
+      bits |= std::uint64_t(1) << (c - 'a');
+    else if (isDigitAscii(c))
+      bits |= std::uint64_t(1) << (26 + (c - '0'));
+    else if (c == '_')
+      bits |= std::uint64_t(1) << kUnderscoreBit;
+    else
+      bits |= std::uint64_t(1) << kOtherBit;
+  }
+  return bits;
+}
+
+FuzzyPattern::FuzzyPattern(std::string_view pattern)
+    : lower(pattern), bits(fuzzyMask(pattern)) {
+  for (char &c : lower)
+    c = lowerAscii(c);
+}
+
+bool FuzzyPattern::match(std::string_view text, float &score) const {
+  const std::size_t n = lower.size();
+  const std::size_t m = text.size();
+  if (n == 0) {
+    score = 0;
+    return true;
+  }
+  if (n > kMaxLength || n > m)
+    return false;
+
+  // Cheap rejection, and the score for names too long to align
+  int best = greedyScore(lower, text);
+  if (best == kNone)
+    return false;
+  if (m > kMaxAligned) {
+    score = static_cast<float>(best);
+    return true;
+  }
+
+  // row[j]: best score of the pattern so far with its last character at j
+  int prev[kMaxAligned];
+  int row[kMaxAligned];
+  for (std::size_t j = 0; j < m; ++j) {
+    row[j] = lowerAscii(text[j]) == lower[0]
+                 ? kMatch + boundaryBonus(text, j) -
+                       std::min<int>(int(j), kMaxLeadingPenalty)
+                 : kNone;
+  }
+  for (std::size_t i = 1; i < n; ++i) {
+    std::copy(row, row + m, prev);
+    // Best prev[k] for k <= j - 2, less the cost of the gap up to j
+    int gapped = kNone;
+    for (std::size_t j = 0; j < m; ++j) {
+      if (j >= 2)
+        gapped = std::max(gapped - kGapExtend, prev[j - 2] - kGapOpen);
+      row[j] = kNone;
+      if (j < i || lowerAscii(text[j]) != lower[i])
+        continue;
+      int from = std::max(prev[j - 1] + kConsecutive, gapped);
+      if (from > kNone / 2)
+        row[j] = from + kMatch + boundaryBonus(text, j);
+    }
+  }
+  best = *std::max_element(row, row + m);
+  score = static_cast<float>(best);
+  return best > kNone / 2;
+}
+
+FuzzyIndex::FuzzyIndex() : level(Tokenizer::detectSimdLevel()) {}
+
+void FuzzyIndex::assign(
+    const std::vector<std::pair<SymbolId, SymbolId>> &entries) {
+  masks.clear();
+  symbols.clear();
+  types.clear();
+  lengths.clear();
+  masks.reserve(entries.size());
+  symbols.reserve(entries.size());
+  types.reserve(entries.size());
+  lengths.reserve(entries.size());
+
+  const SymbolPool &pool = SymbolPool::global();
+  std::unordered_set<SymbolId> seen;
+  for (const auto &[symbol, type] : entries) {
+    if (symbol == kNoSymbol || !seen.insert(symbol).second)
+      continue;
+    std::string_view text = pool.view(symbol);
+    masks.push_back(fuzzyMask(text));
+    symbols.push_back(symbol);
+    types.push_back(type);
+    lengths.push_back(static_cast<std::uint8_t>(std::min<std::size_t>(text.size(), 255)));
+  }
+}
+
+void FuzzyIndex::filter(std::uint64_t mask,
+                        std::vector<std::uint32_t> &out) const {
+  out.clear();
+  std::size_t done = 0;
+#ifdef CODEFLOW_X86_SIMD
+  if (level == SimdLevel::AVX2)
+    done = filterAvx2(masks.data(), masks.size(), mask, out);
+  else if (level == SimdLevel::SSE2)
+    done = filterSse2(masks.data(), masks.size(), mask, out);
+#endif
+  std::size_t before = out.size();
+  filterScalar(masks.data() + done, masks.size() - done, mask, out);
+  for (std::size_t i = before; i < out.size(); ++i)
+    out[i] += static_cast<std::uint32_t>(done);
+}
+
+void FuzzyIndex::search(const FuzzyPattern &pattern, std::size_t maxResults,
+                        std::vector<FuzzyHit> &out) const {
+  out.clear();
+  if (pattern.empty() || maxResults == 0)
+    return;
+
+  thread_local std::vector<std::uint32_t> candidates;
+  filter(pattern.mask(), candidates);
+
+  struct Scored {
+    float score;
+    std::uint32_t entry;
+  };
+  thread_local std::vector<Scored> scored;
+  scored.clear();
+  const SymbolPool &pool = SymbolPool::global();
+  for (std::uint32_t entry : candidates) {
+    float score;
+    if (pattern.match(pool.view(symbols[entry]), score))
+      scored.push_back({score, entry});
+  }
+
+  auto better = [&](const Scored &a, const Scored &b) {
+    if (a.score != b.score)
+      return a.score > b.score;
+    if (lengths[a.entry] != lengths[b.entry])
+      return lengths[a.entry] < lengths[b.entry];
+    return pool.view(symbols[a.entry]) < pool.view(symbols[b.entry]);
+  };
+  std::size_t keep = std::min(maxResults, scored.size());
+  std::partial_sort(scored.begin(), scored.begin() + keep, scored.end(), better);
+
+  out.reserve(keep);
+  for (std::size_t i = 0; i < keep; ++i) {
+    std::uint32_t entry = scored[i].entry;
+    out.push_back({symbols[entry], types[entry], scored[i].score});
+  }
+}
+
+void FuzzyIndex::setSimdLevel(SimdLevel requested) {
+  level = std::min(requested, Tokenizer::detectSimdLevel());
+}
+
+std::size_t FuzzyIndex::memoryUsage() const {
+  return masks.capacity() * sizeof(std::uint64_t) +
+         (symbols.capacity() + types.capacity()) * sizeof(SymbolId) +
+         lengths.capacity();
+}
+
+} // namespace codeflow
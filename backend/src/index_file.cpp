@@ -0,0 +1,495 @@
+#include "../include/index_file.h"
+#include "../include/hash.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace codeflow {
+
+namespace {
+
+constexpr char kMagic[8] = {'C', 'F', 'I', 'N', 'D', 'E', 'X', '\0'};
+constexpr std::uint32_t kByteOrderMark = 0x01020304;
+constexpr std::size_t kAlignment = 8;
+
+enum SectionId : std::uint32_t {
+  kStrings,
+  kStringOffsets,
+  kTrieNodes,
+  kTrieEdges,
+  kTrieRanked,
+  kTypes,
+  kMethodNames,
+  kMethodSigs,
+  kMethodDocs,
+  kMethodComplexities,
+  kHeaders,
+  kItems,
+  kTemplateArgs,
+  kHeaderContainers,
+  kTypeKeys,
+  kSectionCount
+};
+
+struct IndexFileHeader {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t byteOrder;
+  std::uint32_t layout;
+  std::uint32_t sectionCount;
+  std::uint64_t fileSize;
+  std::uint64_t checksum; // Of everything after this header
+  std::uint64_t wordCount;
+};
+
+struct IndexSection {
+  std::uint32_t id;
+  std::uint32_t elementSize;
+  std::uint64_t offset;
+  std::uint64_t count;
+};
+
+static_assert(sizeof(TrieNode) == 32 && sizeof(TrieEdge) == 8 &&
+                  sizeof(CatalogType) == 20 && sizeof(CatalogItem) == 16 &&
+                  sizeof(SymbolPair) == 8,
+              "index file layout changed; bump kIndexFileVersion");
+
+// Struct sizes of this build; a file written by a build with a different
+// layout is rejected rather than misread
+constexpr std::uint32_t layoutFingerprint() {
+  return static_cast<std::uint32_t>(sizeof(TrieNode) | sizeof(TrieEdge) << 8 |
+                                    sizeof(CatalogType) << 16 |
+                                    sizeof(CatalogItem) << 24);
+}
+
+// Detects truncation and corruption, not tampering
+std::uint64_t checksum(const unsigned char *data, std::size_t size) {
+  return hash64({reinterpret_cast<const char *>(data), size},
+                0xcbf29ce484222325ull);
+}
+
+std::size_t alignUp(std::size_t n) {
+  return (n + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+bool fail(std::string *error, const std::string &message) {
+  if (error)
+    *error = message;
+  return false;
+}
+
+// Dense file-local ids for the symbols an index refers to
+class SymbolTable {
+public:
+  SymbolId local(SymbolId id) {
+    if (id == kNoSymbol)
+      return kNoSymbol;
+    auto [it, added] =
+        ids.try_emplace(id, static_cast<SymbolId>(order.size()));
+    if (added)
+      order.push_back(id);
+    return it->second;
+  }
+
+  const std::vector<SymbolId> &symbols() const { return order; }
+
+private:
+  std::unordered_map<SymbolId, SymbolId> ids;
+  std::vector<SymbolId> order;
+};
+
+// Section arrays in file order, as spans over the mapped bytes
+struct Sections {
+  std::span<const char> strings;
+  std::span<const std::uint32_t> stringOffsets;
+  std::span<const TrieNode> nodes;
+  std::span<const TrieEdge> edges;
+  std::span<const NodeId> ranked;
+  StlCatalog::Columns catalog;
+};
+
+template <typename T>
+bool section(const unsigned char *data, const IndexSection *table,
+             std::uint32_t id, std::span<const T> &out, std::string *error) {
+  const IndexSection &s = table[id];
+  if (s.id != id || s.elementSize != sizeof(T) || s.offset % kAlignment)
+    return fail(error, "bad section " + std::to_string(id));
+  out = {reinterpret_cast<const T *>(data + s.offset),
+         static_cast<std::size_t>(s.count)};
+  return true;
+}
+
+bool readSections(const unsigned char *data, std::size_t size, Sections &out,
+                  std::string *error) {
+  if (size < sizeof(IndexFileHeader))
+    return fail(error, "file too small");
+  IndexFileHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+    return fail(error, "not an index file");
+  if (header.version != kIndexFileVersion)
+    return fail(error, "unsupported version " + std::to_string(header.version));
+  if (header.byteOrder != kByteOrderMark || header.layout != layoutFingerprint())
+    return fail(error, "built for a different platform");
+  if (header.fileSize != size || header.sectionCount != kSectionCount)
+    return fail(error, "truncated or malformed header");
+  if (checksum(data + sizeof(header), size - sizeof(header)) != header.checksum)
+    return fail(error, "checksum mismatch");
+
+  const auto *table =
+      reinterpret_cast<const IndexSection *>(data + sizeof(header));
+  if (sizeof(header) + kSectionCount * sizeof(IndexSection) > size)
+    return fail(error, "truncated section table");
+  for (std::uint32_t i = 0; i < kSectionCount; ++i) {
+    const IndexSection &s = table[i];
+    if (s.offset > size || s.count > (size - s.offset) / std::max(s.elementSize, 1u))
+      return fail(error, "section out of bounds");
+  }
+
+  StlCatalog::Columns &c = out.catalog;
+  return section(data, table, kStrings, out.strings, error) &&
+         section(data, table, kStringOffsets, out.stringOffsets, error) &&
+         section(data, table, kTrieNodes, out.nodes, error) &&
+         section(data, table, kTrieEdges, out.edges, error) &&
+         section(data, table, kTrieRanked, out.ranked, error) &&
+         section(data, table, kTypes, c.types, error) &&
+         section(data, table, kMethodNames, c.names, error) &&
+         section(data, table, kMethodSigs, c.sigs, error) &&
+         section(data, table, kMethodDocs, c.docs, error) &&
+         section(data, table, kMethodComplexities, c.complexities, error) &&
+         section(data, table, kHeaders, c.headers, error) &&
+         section(data, table, kItems, c.items, error) &&
+         section(data, table, kTemplateArgs, c.templateArgs, error) &&
+         section(data, table, kHeaderContainers, c.headerContainers, error) &&
+         section(data, table, kTypeKeys, c.typeKeys, error);
+}
+
+// Every index inside the file must stay inside its target array, and child
+// nodes must follow their parent so a walk can never cycle. One linear pass;
+// nothing is decoded.
+bool checkReferences(const Sections &s, std::string *error) {
+  const auto &offsets = s.stringOffsets;
+  if (offsets.empty() || offsets.back() > s.strings.size())
+    return fail(error, "bad string table");
+  for (std::size_t i = 1; i < offsets.size(); ++i) {
+    if (offsets[i] < offsets[i - 1])
+      return fail(error, "bad string table");
+  }
+  std::size_t symbols = offsets.size() - 1;
+  auto validSymbol = [symbols](SymbolId id) {
+    return id == kNoSymbol || id < symbols;
+  };
+
+  if (s.nodes.empty())
+    return fail(error, "empty trie");
+  for (std::size_t i = 0; i < s.nodes.size(); ++i) {
+    const TrieNode &n = s.nodes[i];
+    if (!validSymbol(n.symbol) ||
+        std::size_t{n.edgeBegin} + n.edgeCount > s.edges.size() ||
+        std::size_t{n.rankedBegin} + n.rankedCount > s.ranked.size())
+      return fail(error, "bad trie node");
+    for (std::uint32_t e = 0; e < n.edgeCount; ++e) {
+      NodeId child = s.edges[n.edgeBegin + e].child;
+      if (child <= i || child >= s.nodes.size())
+        return fail(error, "bad trie edge");
+    }
+    for (std::uint32_t r = 0; r < n.rankedCount; ++r) {
+      NodeId ranked = s.ranked[n.rankedBegin + r];
+      if (ranked >= s.nodes.size() || !s.nodes[ranked].isEnd())
+        return fail(error, "bad ranked completion");
+    }
+  }
+
+  const auto &c = s.catalog;
+  std::size_t rows = c.names.size();
+  if (c.sigs.size() != rows || c.docs.size() != rows ||
+      c.complexities.size() != rows)
+    return fail(error, "ragged catalogue columns");
+  for (const CatalogType &type : c.types) {
+    if (std::size_t{type.firstMethod} + type.methodCount > rows ||
+        type.name == kNoSymbol || !validSymbol(type.name) ||
+        !validSymbol(type.header) || !validSymbol(type.description))
+      return fail(error, "bad catalogue type");
+  }
+  for (auto column : {c.names, c.sigs, c.docs, c.complexities, c.headers}) {
+    for (SymbolId id : column) {
+      if (!validSymbol(id))
+        return fail(error, "bad catalogue symbol");
+    }
+  }
+  for (auto items : {c.items, c.templateArgs}) {
+    for (const CatalogItem &item : items) {
+      if (!validSymbol(item.text) || !validSymbol(item.sig) ||
+          !validSymbol(item.doc) || !validSymbol(item.kind))
+        return fail(error, "bad catalogue item");
+    }
+  }
+  for (auto pairs : {c.headerContainers, c.typeKeys}) {
+    for (const SymbolPair &pair : pairs) {
+      if (!validSymbol(pair.first) || !validSymbol(pair.second))
+        return fail(error, "bad catalogue pair");
+    }
+  }
+  return true;
+}
+
+// A mapped file, shared by every index viewing it and unmapped with the
+// last one. The string table is copied into the pool on attach, so no
+// interned view points into it.
+struct Mapping {
+  dev_t device;
+  ino_t inode;
+  off_t size;
+  struct timespec modified;
+  const unsigned char *data;
+  SymbolId symbolBase;
+  std::uint64_t wordCount;
+
+  ~Mapping() { ::munmap(const_cast<unsigned char *>(data), size); }
+};
+
+std::mutex mappingsMutex;
+std::vector<std::weak_ptr<const Mapping>> mappings;
+
+} // namespace
+
+bool writeIndexFile(const StlIndex &index, const std::string &path,
+                    std::string *error) {
+  SymbolTable symbols;
+  const Trie &trie = index.trie;
+  const StlCatalog &catalog = index.catalog;
+
+  // Rewrite every id to its file-local number
+  auto nodePool = trie.nodePool();
+  std::vector<TrieNode> nodes(nodePool.begin(), nodePool.end());
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    nodes[i].symbol = symbols.local(trie.symbol(static_cast<NodeId>(i)));
+  }
+
+  // Insert times become their rank, so ranking is unchanged but the same
+  // inputs always produce the same file
+  std::vector<long long> times;
+  for (const TrieNode &n : nodes) {
+    times.push_back(n.lastUsed);
+  }
+  std::sort(times.begin(), times.end());
+  times.erase(std::unique(times.begin(), times.end()), times.end());
+  for (TrieNode &n : nodes) {
+    n.lastUsed = std::lower_bound(times.begin(), times.end(), n.lastUsed) -
+                 times.begin();
+  }
+
+  std::vector<CatalogType> types;
+  for (const CatalogType &type : catalog.types()) {
+    types.push_back({symbols.local(catalog.typeName(type)),
+                     symbols.local(catalog.typeHeader(type)),
+                     symbols.local(catalog.typeDescription(type)),
+                     type.firstMethod, type.methodCount});
+  }
+  std::size_t rows = catalog.methodCount();
+  std::vector<SymbolId> names(rows), sigs(rows), docs(rows), complexities(rows);
+  for (std::uint32_t row = 0; row < rows; ++row) {
+    names[row] = symbols.local(catalog.methodName(row));
+    sigs[row] = symbols.local(catalog.methodSig(row));
+    docs[row] = symbols.local(catalog.methodDoc(row));
+    complexities[row] = symbols.local(catalog.methodComplexity(row));
+  }
+  std::vector<SymbolId> headers;
+  for (std::size_t i = 0; i < catalog.headerCount(); ++i) {
+    headers.push_back(symbols.local(catalog.header(i)));
+  }
+  auto localItems = [&](std::size_t count, auto get) {
+    std::vector<CatalogItem> items;
+    for (std::size_t i = 0; i < count; ++i) {
+      CatalogItem item = get(i);
+      items.push_back({symbols.local(item.text), symbols.local(item.sig),
+                       symbols.local(item.doc), symbols.local(item.kind)});
+    }
+    return items;
+  };
+  auto items = localItems(catalog.itemCount(),
+                          [&](std::size_t i) { return catalog.item(i); });
+  auto templateArgs = localItems(catalog.templateArgCount(), [&](std::size_t i) {
+    return catalog.templateArg(i);
+  });
+  auto localPairs = [&](std::size_t count, auto get) {
+    std::vector<SymbolPair> pairs;
+    for (std::size_t i = 0; i < count; ++i) {
+      SymbolPair pair = get(i);
+      pairs.push_back({symbols.local(pair.first), symbols.local(pair.second)});
+    }
+    return pairs;
+  };
+  auto headerContainers =
+      localPairs(catalog.headerContainerCount(),
+                 [&](std::size_t i) { return catalog.headerContainer(i); });
+  auto typeKeys = localPairs(catalog.typeKeyCount(), [&](std::size_t i) {
+    return catalog.typeKey(i);
+  });
+
+  std::string strings;
+  std::vector<std::uint32_t> offsets{0};
+  for (SymbolId id : symbols.symbols()) {
+    strings += SymbolPool::global().view(id);
+    offsets.push_back(static_cast<std::uint32_t>(strings.size()));
+  }
+
+  // Lay the sections out after the header and section table
+  IndexSection table[kSectionCount];
+  std::size_t end = sizeof(IndexFileHeader) + sizeof(table);
+  auto place = [&](std::uint32_t id, std::size_t elementSize,
+                   std::size_t count) {
+    end = alignUp(end);
+    table[id] = {id, static_cast<std::uint32_t>(elementSize), end, count};
+    end += elementSize * count;
+  };
+  auto edgePool = trie.edgePool();
+  auto rankedPool = trie.rankedPool();
+  place(kStrings, 1, strings.size());
+  place(kStringOffsets, sizeof(std::uint32_t), offsets.size());
+  place(kTrieNodes, sizeof(TrieNode), nodes.size());
+  place(kTrieEdges, sizeof(TrieEdge), edgePool.size());
+  place(kTrieRanked, sizeof(NodeId), rankedPool.size());
+  place(kTypes, sizeof(CatalogType), types.size());
+  place(kMethodNames, sizeof(SymbolId), rows);
+  place(kMethodSigs, sizeof(SymbolId), rows);
+  place(kMethodDocs, sizeof(SymbolId), rows);
+  place(kMethodComplexities, sizeof(SymbolId), rows);
+  place(kHeaders, sizeof(SymbolId), headers.size());
+  place(kItems, sizeof(CatalogItem), items.size());
+  place(kTemplateArgs, sizeof(CatalogItem), templateArgs.size());
+  place(kHeaderContainers, sizeof(SymbolPair), headerContainers.size());
+  place(kTypeKeys, sizeof(SymbolPair), typeKeys.size());
+
+  // Zero-filled, so struct padding is deterministic
+  std::vector<unsigned char> file(alignUp(end), 0);
+  auto copy = [&](std::uint32_t id, const void *data) {
+    if (table[id].count)
+      std::memcpy(file.data() + table[id].offset, data,
+                  table[id].count * table[id].elementSize);
+  };
+  copy(kStrings, strings.data());
+  copy(kStringOffsets, offsets.data());
+  copy(kTrieNodes, nodes.data());
+  auto *edgesOut =
+      reinterpret_cast<TrieEdge *>(file.data() + table[kTrieEdges].offset);
+  for (std::size_t i = 0; i < edgePool.size(); ++i) {
+    edgesOut[i].label = edgePool[i].label;
+    edgesOut[i].child = edgePool[i].child;
+  }
+  copy(kTrieRanked, rankedPool.data());
+  copy(kTypes, types.data());
+  copy(kMethodNames, names.data());
+  copy(kMethodSigs, sigs.data());
+  copy(kMethodDocs, docs.data());
+  copy(kMethodComplexities, complexities.data());
+  copy(kHeaders, headers.data());
+  copy(kItems, items.data());
+  copy(kTemplateArgs, templateArgs.data());
+  copy(kHeaderContainers, headerContainers.data());
+  copy(kTypeKeys, typeKeys.data());
+  std::memcpy(file.data() + sizeof(IndexFileHeader), table, sizeof(table));
+
+  IndexFileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kIndexFileVersion;
+  header.byteOrder = kByteOrderMark;
+  header.layout = layoutFingerprint();
+  header.sectionCount = kSectionCount;
+  header.fileSize = file.size();
+  header.checksum = checksum(file.data() + sizeof(header),
+                             file.size() - sizeof(header));
+  header.wordCount = trie.size();
+  std::memcpy(file.data(), &header, sizeof(header));
+
+  // Readers mapping the old file keep their pages; the rename is atomic
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char *>(file.data()),
+              static_cast<std::streamsize>(file.size()));
+    if (!out)
+      return fail(error, "cannot write " + temporary);
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return fail(error, "cannot rename " + temporary + " to " + path);
+  }
+  return true;
+}
+
+bool mapIndexFile(const std::string &path, StlIndex &index,
+                  std::string *error) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return fail(error, "cannot open " + path);
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+    ::close(fd);
+    return fail(error, "cannot stat " + path);
+  }
+
+  std::lock_guard<std::mutex> lock(mappingsMutex);
+  std::erase_if(mappings, [](const auto &m) { return m.expired(); });
+  std::shared_ptr<const Mapping> mapping;
+  for (const auto &weak : mappings) {
+    auto m = weak.lock();
+    if (m && m->device == info.st_dev && m->inode == info.st_ino &&
+        m->size == info.st_size &&
+        m->modified.tv_sec == info.st_mtim.tv_sec &&
+        m->modified.tv_nsec == info.st_mtim.tv_nsec) {
+      mapping = std::move(m);
+      break;
+    }
+  }
+
+  std::size_t size = static_cast<std::size_t>(info.st_size);
+  Sections sections;
+  if (mapping) {
+    ::close(fd);
+    readSections(mapping->data, size, sections, nullptr);
+  } else {
+    void *data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+      return fail(error, "cannot map " + path);
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    if (!readSections(bytes, size, sections, error) ||
+        !checkReferences(sections, error)) {
+      ::munmap(data, size);
+      return false;
+    }
+
+    IndexFileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    SymbolId base;
+    try {
+      base = SymbolPool::global().attach(sections.strings.data(),
+                                         sections.stringOffsets.data(),
+                                         sections.stringOffsets.size() - 1);
+    } catch (const std::length_error &) {
+      ::munmap(data, size);
+      return fail(error, "symbol pool is full");
+    }
+    mapping.reset(new Mapping{info.st_dev, info.st_ino, info.st_size,
+                              info.st_mtim, bytes, base, header.wordCount});
+    mappings.push_back(mapping);
+  }
+
+  index.trie.view(sections.nodes, sections.edges, sections.ranked,
+                  mapping->wordCount, mapping->symbolBase);
+  index.catalog.view(sections.catalog, mapping->symbolBase);
+  index.storage = std::move(mapping);
+  return true;
+}
+
+} // namespace codeflow
@@ -0,0 +1,378 @@
+#include "../include/json.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace codeflow {
+
+namespace {
+
+// Bounds recursion on hostile input; the data files nest three levels deep
+constexpr int kMaxDepth = 64;
+
+class Parser {
+public:
+  explicit Parser(std::string_view text) : text(text) {}
+
+  bool parseDocument(JsonValue &out) {
+    skipWhitespace();
+    if (!parseValue(out, 0))
+      return false;
+    skipWhitespace();
+    if (pos != text.size())
+      return fail("trailing characters");
+    return true;
+  }
+
+  std::string message;
+  std::size_t pos = 0;
+
+private:
+  std::string_view text;
+
+  bool fail(const char *what) {
+    if (message.empty())
+      message = what;
+    return false;
+  }
+
+  void skipWhitespace() {
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' ||
+                                 text[pos] == '\r' || text[pos] == '\t')) {
+      pos++;
+    }
+  }
+
+  bool consume(std::string_view literal) {
+    if (text.substr(pos, literal.size()) != literal)
+      return false;
+    pos += literal.size();
+    return true;
+  }
+
+  bool parseValue(JsonValue &out, int depth) {
+    if (depth > kMaxDepth)
+      return fail("nesting too deep");
+    if (pos >= text.size())
+      return fail("unexpected end of input");
+
+    switch (text[pos]) {
+    case '{':
+      return parseObject(out, depth);
+    case '[':
+      return parseArray(out, depth);
+    case '"':
+      out.type = JsonValue::Type::String;
+      return parseString(out.string);
+    case 't':
+      out.type = JsonValue::Type::Bool;
+      out.boolean = true;
+      return consume("true") || fail("invalid literal");
+    case 'f':
+      out.type = JsonValue::Type::Bool;
+      out.boolean = false;
+      return consume("false") || fail("invalid literal");
+    case 'n':
+      out.type = JsonValue::Type::Null;
+      return consume("null") || fail("invalid literal");
+    default:
+      return parseNumber(out);
+    }
+  }
+
+  bool parseObject(JsonValue &out, int depth) {
+    out.type = JsonValue::Type::Object;
+    pos++; // '{'
+    skipWhitespace();
+    if (pos < text.size() && text[pos] == '}') {
+      pos++;
+      return true;
+    }
+    while (true) {
+      skipWhitespace();
+      if (pos >= text.size() || text[pos] != '"')
+        return fail("expected member name");
+      auto &member = out.members.emplace_back();
+      if (!parseString(member.first))
+        return false;
+      skipWhitespace();
+      if (pos >= text.size() || text[pos] != ':')
+        return fail("expected ':'");
+      pos++;
+      skipWhitespace();
+      if (!parseValue(member.second, depth + 1))
+        return false;
+      skipWhitespace();
+      if (pos < text.size() && text[pos] == ',') {
+        pos++;
+        continue;
+      }
+      if (pos < text.size() && text[pos] == '}') {
+        pos++;
+        return true;
+      }
+      return fail("expected ',' or '}'");
+    }
+  }
+
+  bool parseArray(JsonValue &out, int depth) {
+    out.type = JsonValue::Type::Array;
+    pos++; // '['
+    skipWhitespace();
+    if (pos < text.size() && text[pos] == ']') {
+      pos++;
+      return true;
+    }
+    while (true) {
+      skipWhitespace();
+      if (!parseValue(out.items.emplace_back(), depth + 1))
+        return false;
+      skipWhitespace();
+      if (pos < text.size() && text[pos] == ',') {
+        pos++;
+        continue;
+      }
+      if (pos < text.size() && text[pos] == ']') {
+        pos++;
+        return true;
+      }
+      return fail("expected ',' or ']'");
+    }
+  }
+
+  static int hexDigit(char c) {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+  bool parseHex4(unsigned &value) {
+    if (text.size() - pos < 4)
+      return fail("truncated \\u escape");
+    value = 0;
+    for (int i = 0; i < 4; ++i) {
+      int digit = hexDigit(text[pos++]);
+      if (digit < 0)
+        return fail("invalid \\u escape");
+      value = value * 16 + static_cast<unsigned>(digit);
+    }
+    return true;
+  }
+
+  static void appendUtf8(std::string &out, unsigned cp) {
+    if (cp < 0x80) {
+      out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+      out += static_cast<char>(0xC0 | (cp >> 6));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+      out += static_cast<char>(0xE0 | (cp >> 12));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+      out += static_cast<char>(0xF0 | (cp >> 18));
+      out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+      out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+  }
+
+  bool parseString(std::string &out) {
+    pos++; // Opening quote
+    while (pos < text.size()) {
+      // Copy the unescaped run in one go
+      std::size_t run = pos;
+      while (run < text.size() && text[run] != '"' && text[run] != '\\' &&
+             static_cast<unsigned char>(text[run]) >= 0x20) {
+        run++;
+      }
+      out.append(text.substr(pos, run - pos));
+      pos = run;
+      if (pos >= text.size())
+        break;
+
+      char c = text[pos++];
+      if (c == '"')
+        return true;
+      if (c != '\\')
+        return fail("control character in string");
+      if (pos >= text.size())
+        break;
+
+      switch (text[pos++]) {
+      case '"':
+        out += '"';
+        break;
+      case '\\':
+        out += '\\';
+        break;
+      case '/':
+        out += '/';
+        break;
+      case 'b':
+        out += '\b';
+        break;
+      case 'f':
+        out += '\f';
+        break;
+      case 'n':
+        out += '\n';
+        break;
+      case 'r':
+        out += '\r';
+        break;
+      case 't':
+        out += '\t';
+        break;
+      case 'u': {
+        unsigned cp;
+        if (!parseHex4(cp))
+          return false;
+        if (cp >= 0xD800 && cp < 0xDC00 && consume("\\u")) {
+          unsigned low;
+          if (!parseHex4(low))
+            return false;
+          if (low >= 0xDC00 && low < 0xE000)
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+        }
+        appendUtf8(out, cp);
+        break;
+      }
+      default:
+        return fail("invalid escape");
+      }
+    }
+    return fail("unterminated string");
+  }
+
+  bool parseNumber(JsonValue &out) {
+    std::size_t start = pos;
+    if (pos < text.size() && text[pos] == '-')
+      pos++;
+    auto digits = [&] {
+      std::size_t first = pos;
+      while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9')
+        pos++;
+      return pos > first;
+    };
+    if (!digits())
+      return fail("unexpected character");
+    if (pos < text.size() && text[pos] == '.') {
+      pos++;
+      if (!digits())
+        return fail("invalid number");
+    }
+    if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+      pos++;
+      if (pos < text.size() && (text[pos] == '+' || text[pos] == '-'))
+        pos++;
+      if (!digits())
+        return fail("invalid number");
+    }
+    out.type = JsonValue::Type::Number;
+    // from_chars is locale-independent; out-of-range values keep 0
+    std::from_chars(text.data() + start, text.data() + pos, out.number);
+    return true;
+  }
+};
+
+} // namespace
+
+const JsonValue *JsonValue::find(std::string_view key) const {
+  for (const auto &member : members) {
+    if (member.first == key)
+      return &member.second;
+  }
+  return nullptr;
+}
+
+std::string_view JsonValue::stringOr(std::string_view key,
+                                     std::string_view fallback) const {
+  const JsonValue *value = find(key);
+  return value && value->isString() ? std::string_view(value->string)
+                                    : fallback;
+}
+
+bool parseJson(std::string_view text, JsonValue &out, std::string *error) {
+  out = JsonValue();
+  Parser parser(text);
+  if (parser.parseDocument(out))
+    return true;
+  if (error)
+    *error = parser.message + " at offset " + std::to_string(parser.pos);
+  return false;
+}
+
+void appendJsonString(std::string &out, std::string_view value) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  out += '"';
+  for (char c : value) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\b':
+      out += "\\b";
+      break;
+    case '\f':
+      out += "\\f";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out += "\\u00";
+        out += kHex[static_cast<unsigned char>(c) >> 4];
+        out += kHex[c & 0xf];
+      } else {
+        out += c;
+      }
+    }
+  }
+  out += '"';
+}
+
+void appendJsonNumber(std::string &out, double value) {
+  if (!std::isfinite(value)) {
+    out += "null";
+    return;
+  }
+  if (value == 0) {
+    out += '0'; // Also -0
+    return;
+  }
+  char buffer[64];
+  const double magnitude = std::fabs(value);
+  if (magnitude >= 1e-6 && magnitude < 1e21) {
+    char *end = std::to_chars(buffer, buffer + sizeof buffer, value,
+                              std::chars_format::fixed)
+                    .ptr;
+    out.append(buffer, end);
+    return;
+  }
+  // JavaScript writes 1e+21 and 1.5e-7, without the exponent's leading zeros
+  char *end = std::to_chars(buffer, buffer + sizeof buffer, value,
+                            std::chars_format::scientific)
+                  .ptr;
+  char *exponent = std::find(buffer, end, 'e') + 2; // Past the sign
+  out.append(buffer, exponent);
+  while (exponent + 1 < end && *exponent == '0')
+    ++exponent;
+  out.append(exponent, end);
+}
+
+} // namespace codeflow
@@ -0,0 +1,67 @@
+/**
+ * Native Suggestion Engine Loader
+ * Loads the C++ addon and maps the precompiled symbol index (see
+ * `npm run build:index`). Either may be missing in development or on
+ * serverless hosts; `engine` is then null and callers use the JavaScript path.
+ * Learned completion counts saved by a previous run are loaded after the
+ * index, whose names they refer to.
+ */
+
+const fs = require('fs');
+const path = require('path');
+const config = require('../../config');
+
+const ADDON_PATHS = [
+  path.join(__dirname, '../../build/Release/codeflow_native.node'),
+  path.join(__dirname, '../../../dist/codeflow_native.node')
+];
+
+const INDEX_PATHS = [
+  process.env.CODEFLOW_INDEX_PATH,
+  path.join(__dirname, '../../../dist/codeflow_index.bin'),
+  path.join(__dirname, '../../build/Release/codeflow_index.bin')
+].filter(Boolean);
+
+let addon = null;
+let engine = null;
+let indexPath = null;
+let loadError = null;
+
+if (process.env.CODEFLOW_DISABLE_NATIVE === 'true') {
+  loadError = 'disabled by CODEFLOW_DISABLE_NATIVE';
+} else {
+  try {
+    const addonPath = ADDON_PATHS.find(p => fs.existsSync(p));
+    if (addonPath) {
+      addon = require(addonPath);
+      const candidate = new addon.SuggestionEngine({
+        workerThreads: config.NATIVE_WORKER_THREADS,
+        compileCacheDir: config.COMPILE_CACHE_DIR && path.join(config.COMPILE_CACHE_DIR, 'native'),
+        compileCacheBytes: config.COMPILE_CACHE_MAX_MB * 1024 * 1024,
+        pchDir: config.PCH_DIR && path.join(config.PCH_DIR, 'native'),
+        responseCacheBytes: config.RESPONSE_CACHE_MAX_MB * 1024 * 1024,
+        responseCacheTtlMs: config.RESPONSE_CACHE_TTL_MS
+      });
+      indexPath = INDEX_PATHS.find(p => fs.existsSync(p) && candidate.loadIndex(p)) || null;
+      if (indexPath) {
+        engine = candidate;
+        if (fs.existsSync(config.USAGE_SNAPSHOT_PATH)) {
+          engine.loadUsage(config.USAGE_SNAPSHOT_PATH);
+        }
+      } else {
+        loadError = 'symbol index not found or invalid';
+      }
+    } else {
+      loadError = 'addon not built';
+    }
+  } catch (err) {
+    loadError = err.message;
+  }
+}
+
+module.exports = {
+  addonLoaded: Boolean(addon && addon.SuggestionEngine),
+  engine,
+  indexPath,
+  loadError
+};
@@ -0,0 +1,81 @@
+/**
+ * Suggestion Batch Decoder
+ * Reads the packed ArrayBuffer returned by SuggestionEngine#getSuggestionsBatch
+ * (layout in include/suggestion_batch.h). Nothing is decoded up front:
+ * records are read from typed-array views on access, and each distinct
+ * string is decoded once, the first time it is asked for.
+ */
+
+const BATCH_MAGIC = 0x42534643; // "CFSB"
+const HEADER_WORDS = 4;
+const RECORD_WORDS = 4;
+
+const utf8 = new TextDecoder('utf-8');
+
+class SuggestionBatch {
+  /**
+   * @param {ArrayBuffer} buffer - Result of getSuggestionsBatch
+   */
+  constructor(buffer) {
+    const words = new Uint32Array(buffer);
+    if (words.length < HEADER_WORDS || words[0] !== BATCH_MAGIC) {
+      throw new Error('Not a suggestion batch');
+    }
+    this.queryCount = words[1];
+    this.recordCount = words[2];
+    this.words = words;
+    this.scores = new Float32Array(buffer);
+    this.recordBase = HEADER_WORDS + this.queryCount;
+    this.strings = new Uint8Array(buffer, (this.recordBase + this.recordCount * RECORD_WORDS) * 4, words[3]);
+    this.decoded = new Map();
+  }
+
+  /** Index of query q's first record */
+  start(q) {
+    return q === 0 ? 0 : this.words[HEADER_WORDS + q - 1];
+  }
+
+  /** Number of results for query q */
+  count(q) {
+    return this.words[HEADER_WORDS + q] - this.start(q);
+  }
+
+  text(q, i) {
+    const r = this.recordBase + (this.start(q) + i) * RECORD_WORDS;
+    return this._string(this.words[r], this.words[r + 3] & 0xffff);
+  }
+
+  type(q, i) {
+    const r = this.recordBase + (this.start(q) + i) * RECORD_WORDS;
+    return this._string(this.words[r + 1], this.words[r + 3] >>> 16);
+  }
+
+  score(q, i) {
+    return this.scores[this.recordBase + (this.start(q) + i) * RECORD_WORDS + 2];
+  }
+
+  /** { text, type, score } for result i of query q */
+  get(q, i) {
+    return { text: this.text(q, i), type: this.type(q, i), score: this.score(q, i) };
+  }
+
+  /** All results of query q, shaped like getSuggestions() */
+  results(q) {
+    const out = new Array(this.count(q));
+    for (let i = 0; i < out.length; i++) out[i] = this.get(q, i);
+    return out;
+  }
+
+  _string(offset, length) {
+    // Strings are deduplicated natively, so (offset, length) names one string
+    const key = offset * 0x10000 + length;
+    let value = this.decoded.get(key);
+    if (value === undefined) {
+      value = utf8.decode(this.strings.subarray(offset, offset + length));
+      this.decoded.set(key, value);
+    }
+    return value;
+  }
+}
+
+module.exports = { SuggestionBatch, BATCH_MAGIC };
@@ -0,0 +1,227 @@
+#include "../include/pch_cache.h"
+#include "../include/subprocess.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace codeflow {
+
+namespace {
+
+std::string_view trimLeft(std::string_view text) {
+  std::size_t start = text.find_first_not_of(" \t\r");
+  return start == std::string_view::npos ? std::string_view()
+                                         : text.substr(start);
+}
+
+// The header of an #include <...> line, or empty for any other line
+std::string_view systemInclude(std::string_view line) {
+  if (line.empty() || line[0] != '#')
+    return {};
+  line = trimLeft(line.substr(1));
+  if (!line.starts_with("include"))
+    return {};
+  line = trimLeft(line.substr(7));
+  std::size_t close = line.find('>');
+  if (line.empty() || line[0] != '<' || close == std::string_view::npos)
+    return {};
+  return line.substr(1, close - 1);
+}
+
+double median(std::vector<double> samples) {
+  if (samples.empty())
+    return 0;
+  auto middle = samples.begin() + samples.size() / 2;
+  std::nth_element(samples.begin(), middle, samples.end());
+  return *middle;
+}
+
+} // namespace
+
+const std::vector<PchCache::Profile> &PchCache::profiles() {
+  static const std::vector<Profile> all = {
+      {"stdcpp", {"bits/stdc++.h"}},
+      {"algorithm_iostream_string_vector",
+       {"algorithm", "iostream", "string", "vector"}},
+      {"iostream_vector", {"iostream", "vector"}},
+      {"iostream_string", {"iostream", "string"}},
+      {"iostream", {"iostream"}},
+  };
+  return all;
+}
+
+PchCache::PchCache(std::string directory, std::string compiler,
+                   std::string flags, std::string_view compilerIdentity)
+    : compiler(std::move(compiler)), flags(std::move(flags)),
+      states(new std::atomic<int>[profiles().size()]) {
+  for (std::size_t i = 0; i < profiles().size(); ++i)
+    states[i].store(Unbuilt, std::memory_order_relaxed);
+  withPch.reserve(kSamples);
+  withoutPch.reserve(kSamples);
+  if (directory.empty())
+    return;
+
+  std::string profile(compilerIdentity);
+  profile.append(1, '\0').append(this->compiler).append(1, '\0').append(
+      this->flags);
+  char key[17];
+  std::snprintf(key, sizeof(key), "%016zx", std::hash<std::string>{}(profile));
+  std::error_code error;
+  fs::create_directories(fs::path(directory) / key, error);
+  if (error)
+    return;
+  this->directory = (fs::path(directory) / key).string();
+
+  for (std::size_t i = 0; i < profiles().size(); ++i) {
+    if (fs::exists(headerPath(i), error) &&
+        fs::exists(headerPath(i) + ".gch", error))
+      states[i].store(Ready, std::memory_order_relaxed);
+  }
+}
+
+std::vector<std::string> PchCache::headerPrefix(std::string_view source) {
+  std::vector<std::string> headers;
+  bool inComment = false;
+  while (!source.empty()) {
+    std::size_t end = source.find('\n');
+    std::string_view line = source.substr(0, end);
+    source = end == std::string_view::npos ? std::string_view()
+                                           : source.substr(end + 1);
+
+    // Comments may sit between includes; text after a closing */ counts
+    while (true) {
+      if (inComment) {
+        std::size_t close = line.find("*/");
+        if (close == std::string_view::npos) {
+          line = {};
+          break;
+        }
+        line = line.substr(close + 2);
+        inComment = false;
+      }
+      line = trimLeft(line);
+      if (!line.starts_with("/*"))
+        break;
+      line = line.substr(2);
+      inComment = true;
+    }
+    if (line.empty() || line.starts_with("//"))
+      continue;
+
+    std::string_view header = systemInclude(line);
+    if (header.empty())
+      break;
+    headers.emplace_back(trimLeft(header));
+  }
+  return headers;
+}
+
+int PchCache::match(std::string_view source) {
+  std::vector<std::string> prefix = headerPrefix(source);
+  if (prefix.empty())
+    return -1;
+  const auto &all = profiles();
+  for (std::size_t i = 0; i < all.size(); ++i) {
+    bool covered = std::all_of(
+        all[i].headers.begin(), all[i].headers.end(), [&](auto header) {
+          return std::find(prefix.begin(), prefix.end(), header) !=
+                 prefix.end();
+        });
+    if (covered)
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
+std::string PchCache::headerPath(std::size_t profile) const {
+  return directory + "/" + profiles()[profile].name + ".h";
+}
+
+std::string PchCache::headerFor(std::string_view source) {
+  if (directory.empty())
+    return {};
+  int profile = match(source);
+  if (profile < 0 || !ensureBuilt(static_cast<std::size_t>(profile)))
+    return {};
+  return headerPath(static_cast<std::size_t>(profile));
+}
+
+std::size_t PchCache::warm() {
+  std::size_t ready = 0;
+  if (directory.empty())
+    return ready;
+  for (std::size_t i = 0; i < profiles().size(); ++i)
+    ready += ensureBuilt(i);
+  return ready;
+}
+
+bool PchCache::ensureBuilt(std::size_t profile) {
+  int state = states[profile].load(std::memory_order_acquire);
+  if (state == Unbuilt &&
+      states[profile].compare_exchange_strong(state, Building,
+                                              std::memory_order_acquire)) {
+    bool built = build(profile);
+    states[profile].store(built ? Ready : Failed, std::memory_order_release);
+    return built;
+  }
+  return state == Ready;
+}
+
+bool PchCache::build(std::size_t profile) {
+  std::string header = headerPath(profile);
+  {
+    std::ofstream out(header, std::ios::trunc);
+    for (std::string_view name : profiles()[profile].headers)
+      out << "#include <" << name << ">\n";
+    if (!out)
+      return false;
+  }
+
+  // Compiled next to the final name, then renamed, so a concurrent process
+  // never loads half a .gch
+  std::string staging =
+      header + ".gch.tmp" + std::to_string(static_cast<long>(::getpid()));
+  std::vector<std::string> command{compiler};
+  for (std::string &flag : splitArguments(flags))
+    command.push_back(std::move(flag));
+  command.insert(command.end(), {"-x", "c++-header", header, "-o", staging});
+  ProcessOptions options;
+  options.environment = minimalEnvironment();
+  options.timeout = std::chrono::minutes(5);
+  options.maxOutputBytes = 64 * 1024;
+  bool compiled = runProcess(command, options).succeeded();
+  if (compiled && std::rename(staging.c_str(), (header + ".gch").c_str()) == 0)
+    return true;
+  std::remove(staging.c_str());
+  return false;
+}
+
+void PchCache::recordCompile(bool usedPch, double milliseconds) {
+  std::lock_guard<std::mutex> lock(sampleMutex);
+  std::vector<double> &samples = usedPch ? withPch : withoutPch;
+  std::uint64_t &count = usedPch ? compilesWithPch : compilesWithoutPch;
+  if (samples.size() < kSamples)
+    samples.push_back(milliseconds);
+  else
+    samples[count % kSamples] = milliseconds;
+  count++;
+}
+
+PchStats PchCache::stats() const {
+  PchStats result;
+  for (std::size_t i = 0; i < profiles().size(); ++i)
+    result.profilesReady += states[i].load(std::memory_order_relaxed) == Ready;
+  std::lock_guard<std::mutex> lock(sampleMutex);
+  result.compilesWithPch = compilesWithPch;
+  result.compilesWithoutPch = compilesWithoutPch;
+  result.medianWithPchMs = median(withPch);
+  result.medianWithoutPchMs = median(withoutPch);
+  return result;
+}
+
+} // namespace codeflow
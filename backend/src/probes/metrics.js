@@ -0,0 +1,130 @@
+/**
+ * Prometheus Metrics
+ * GET /metrics in the Prometheus text format (version 0.0.4): the native
+ * engine's per-stage latency histograms and counters (engine.getMetrics(),
+ * see backend/include/engine_metrics.h), HTTP request latency per route,
+ * the job queue's compile and run phases, and its job counts.
+ *
+ * Native query stages are timed for a sample of queries (sampleEvery), so
+ * their _count is that sample; codeflow_engine_queries_total counts them
+ * all.
+ */
+
+// Upper bounds in seconds, as the Prometheus client libraries default to,
+// extended for compiles and program runs
+const DEFAULT_BUCKETS = [0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60];
+
+function escapeLabel(value) {
+  return String(value).replace(/\\/g, '\\\\').replace(/"/g, '\\"').replace(/\n/g, '\\n');
+}
+
+function formatLabels(labels) {
+  const pairs = Object.entries(labels).map(([name, value]) => `${name}="${escapeLabel(value)}"`);
+  return pairs.length ? `{${pairs.join(',')}}` : '';
+}
+
+/**
+ * Cumulative latency histogram with one series per label set
+ */
+class Histogram {
+  constructor(name, help, buckets = DEFAULT_BUCKETS) {
+    this.name = name;
+    this.help = help;
+    this.buckets = buckets;
+    this.series = new Map();
+  }
+
+  observe(labels, seconds) {
+    const key = formatLabels(labels);
+    let series = this.series.get(key);
+    if (!series) {
+      series = { labels, counts: new Array(this.buckets.length).fill(0), count: 0, sum: 0 };
+      this.series.set(key, series);
+    }
+    const bucket = this.buckets.findIndex(limit => seconds <= limit);
+    if (bucket >= 0) series.counts[bucket]++;
+    series.count++;
+    series.sum += seconds;
+  }
+
+  render() {
+    const lines = [`# HELP ${this.name} ${this.help}`, `# TYPE ${this.name} histogram`];
+    for (const { labels, counts, count, sum } of this.series.values()) {
+      let cumulative = 0;
+      this.buckets.forEach((limit, i) => {
+        cumulative += counts[i];
+        lines.push(`${this.name}_bucket${formatLabels({ ...labels, le: limit })} ${cumulative}`);
+      });
+      lines.push(`${this.name}_bucket${formatLabels({ ...labels, le: '+Inf' })} ${count}`);
+      lines.push(`${this.name}_sum${formatLabels(labels)} ${sum}`);
+      lines.push(`${this.name}_count${formatLabels(labels)} ${count}`);
+    }
+    return lines;
+  }
+}
+
+const httpRequestSeconds = new Histogram(
+  'codeflow_http_request_duration_seconds',
+  'HTTP request latency by method, route and status'
+);
+
+const jobPhaseSeconds = new Histogram(
+  'codeflow_job_phase_duration_seconds',
+  'Job queue compile (cache misses only) and run phases'
+);
+
+/**
+ * The native engine's metrics; the stage histogram's buckets are the
+ * powers of two getMetrics() reports, in seconds
+ */
+function renderEngineMetrics(metrics) {
+  const name = 'codeflow_engine_stage_duration_seconds';
+  const lines = [
+    `# HELP ${name} Native engine time per stage; query stages are sampled, 1 in codeflow_engine_sample_every`,
+    `# TYPE ${name} histogram`
+  ];
+  for (const stage of metrics.stages) {
+    for (const [limitNs, cumulative] of stage.buckets) {
+      lines.push(`${name}_bucket${formatLabels({ stage: stage.name, le: limitNs / 1e9 })} ${cumulative}`);
+    }
+    lines.push(`${name}_bucket${formatLabels({ stage: stage.name, le: '+Inf' })} ${stage.count}`);
+    lines.push(`${name}_sum${formatLabels({ stage: stage.name })} ${stage.sumNs / 1e9}`);
+    lines.push(`${name}_count${formatLabels({ stage: stage.name })} ${stage.count}`);
+  }
+  for (const counter of metrics.counters) {
+    lines.push(`# HELP codeflow_engine_${counter.name}_total ${counter.help}`);
+    lines.push(`# TYPE codeflow_engine_${counter.name}_total counter`);
+    lines.push(`codeflow_engine_${counter.name}_total ${counter.value}`);
+  }
+  lines.push('# HELP codeflow_engine_sample_every One query in this many has its stages timed (0: none)');
+  lines.push('# TYPE codeflow_engine_sample_every gauge');
+  lines.push(`codeflow_engine_sample_every ${metrics.sampleEvery}`);
+  return lines;
+}
+
+/**
+ * The whole scrape: engine is the native engine or null, queue a job queue
+ */
+function renderMetrics({ engine, queue }) {
+  const lines = [...httpRequestSeconds.render(), ...jobPhaseSeconds.render()];
+
+  if (queue) {
+    const { queued, running, completed, failed } = queue.getMetrics();
+    lines.push('# HELP codeflow_jobs Tracked jobs by status');
+    lines.push('# TYPE codeflow_jobs gauge');
+    for (const [status, count] of Object.entries({ queued, running, completed, failed })) {
+      lines.push(`codeflow_jobs${formatLabels({ status })} ${count}`);
+    }
+  }
+  if (engine) {
+    lines.push(...renderEngineMetrics(engine.getMetrics()));
+  }
+  return lines.join('\n') + '\n';
+}
+
+module.exports = {
+  Histogram,
+  httpRequestSeconds,
+  jobPhaseSeconds,
+  renderMetrics
+};
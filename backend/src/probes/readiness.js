@@ -5,24 +5,9 @@
 
 const { execSync } = require('child_process');
 const fs = require('fs');
-const path = require('path');
 const config = require('../../config');
 const { STL_DB } = require('../../data');
-
-let nativeAddonLoaded = false;
-let nativeAddonError = null;
-
-try {
-  const addonPath = path.join(__dirname, '../../build/Release/codeflow_native.node');
-  if (fs.existsSync(addonPath)) {
-    const native = require(addonPath);
-    if (native && native.SuggestionEngine) {
-      nativeAddonLoaded = true;
-    }
-  }
-} catch (err) {
-  nativeAddonError = err.message;
-}
+const native = require('../native/nativeEngine');
 
 /**
  * Check if a command/binary is executable on the host
@@ -58,8 +43,9 @@ function performReadinessCheck() {
       containersCount: Object.keys(STL_DB).length
     },
     native_cpp_addon: {
-      loaded: nativeAddonLoaded,
-      error: nativeAddonError
+      loaded: native.addonLoaded,
+      indexPath: native.indexPath,
+      error: native.loadError
     },
     workspace_directory: {
       path: config.WORKSPACE_ROOT,
@@ -9,22 +9,99 @@
 const crypto = require('crypto');
 const fs = require('fs');
 const path = require('path');
-const { execSync, exec } = require('child_process');
+const { execSync, spawn } = require('child_process');
 const EventEmitter = require('events');
+const os = require('os');
 
 const config = require('../../config');
-const { getLanguage } = require('../../languages/registry');
+const { LANGUAGE_REGISTRY, getLanguage } = require('../../languages/registry');
+const { CompileCache, compilerVersion } = require('../cache/compileCache');
+const { PchCache } = require('../cache/pchCache');
+const { OutputStream } = require('./outputStream');
+const { jobPhaseSeconds } = require('../probes/metrics');
+
+// Faults a sanitizer build can explain, rather than the kills for timeouts
+// and limits
+const CRASH_SIGNALS = ['SIGSEGV', 'SIGBUS', 'SIGFPE', 'SIGILL', 'SIGABRT', 'SIGTRAP'];
+
+/**
+ * Name of the crash signal that ended a program, reported by Node or, for a
+ * program the shell waited for, as exit status 128 + its number; else null
+ */
+function crashSignal(code, signal) {
+  if (CRASH_SIGNALS.includes(signal)) return signal;
+  if (!(code > 128)) return null;
+  return CRASH_SIGNALS.find(name => os.constants.signals[name] === code - 128) || null;
+}
+
+const EXECUTION_MODES = ['tiered', 'fast', 'sanitized'];
+
+// How long a killed program's pipes are read before they are closed
+const PIPE_DRAIN_MS = 1000;
+
+// Shell prefix applying config.ULIMITS to the command after it; the address
+// space limit is optional since ASan builds cannot run under it
+function ulimitPrefix(virtualMemory) {
+  const { VIRTUAL_MEM_KB, MAX_FILE_SIZE_BLOCKS, MAX_CPU_TIME_SEC, DISABLE_CORE_DUMP, MAX_PIDS } = config.ULIMITS;
+  return `ulimit ${virtualMemory ? `-v ${VIRTUAL_MEM_KB} ` : ''}-f ${MAX_FILE_SIZE_BLOCKS} -c ${DISABLE_CORE_DUMP} -t ${MAX_CPU_TIME_SEC} -u ${MAX_PIDS} 2>/dev/null; `;
+}
+
+// Limits for precompiled header builds. A .gch takes hundreds of MB of
+// address space and file, more than a submission gets, so only CPU time,
+// processes and core dumps are capped, one option per ulimit as dash
+// requires.
+const PCH_BUILD_CPU_SEC = 120;
+function pchLimitPrefix() {
+  const { DISABLE_CORE_DUMP, MAX_PIDS } = config.ULIMITS;
+  return [`-c ${DISABLE_CORE_DUMP}`, `-t ${PCH_BUILD_CPU_SEC}`, `-u ${MAX_PIDS}`]
+    .map(limit => `ulimit ${limit} 2>/dev/null; `).join('');
+}
+
+// Runs a program and writes its rusage and hardware counters as JSON
+// (backend/tools/run_profiled.cpp); Node itself reports neither for a child
+const PROFILER_PATHS = [
+  process.env.CODEFLOW_PROFILER_PATH,
+  path.join(__dirname, '../../build/Release/codeflow_run_profiled'),
+  path.join(__dirname, '../../../dist/codeflow_run_profiled')
+].filter(Boolean);
+
+function findProfiler() {
+  return PROFILER_PATHS.find(p => fs.existsSync(p)) || null;
+}
+
+// The profile the wrapper wrote, or null when it did not run or was killed
+// before the program exited
+function readProfile(file) {
+  try {
+    return JSON.parse(fs.readFileSync(file, 'utf8'));
+  } catch (_) {
+    return null;
+  }
+}
 
 class InMemoryJobQueue extends EventEmitter {
   /**
    * @param {Object} options
    * @param {number} [options.concurrency=4] - Maximum concurrent execution workers
    * @param {number} [options.maxCompletedRetention=500] - Max finished jobs kept in memory
+   * @param {CompileCache} [options.compileCache] - Build cache; none by default
+   * @param {PchCache} [options.pchCache] - Precompiled headers; none by default
+   * @param {string|null} [options.profilerPath] - codeflow_run_profiled; null
+   *   runs programs without a profile
    */
-  constructor({ concurrency = 4, maxCompletedRetention = 500 } = {}) {
+  constructor({
+    concurrency = 4,
+    maxCompletedRetention = 500,
+    compileCache = new CompileCache(),
+    pchCache = new PchCache(),
+    profilerPath = findProfiler()
+  } = {}) {
     super();
     this.concurrency = concurrency;
     this.maxCompletedRetention = maxCompletedRetention;
+    this.compileCache = compileCache;
+    this.pchCache = pchCache;
+    this.profilerPath = profilerPath;
 
     this.queue = []; // Array of job objects
     this.jobs = new Map(); // Map: jobId => jobObject
@@ -34,8 +111,12 @@ class InMemoryJobQueue extends EventEmitter {
 
   /**
    * Enqueue a new code execution job
+   * @param {string} [options.executionMode] - tiered, fast or sanitized; see executeJobInSandbox
    */
-  enqueue({ code, language = 'cpp', clientIp = '127.0.0.1' }) {
+  enqueue({ code, language = 'cpp', clientIp = '127.0.0.1', executionMode = config.DEFAULT_EXECUTION_MODE }) {
+    if (!EXECUTION_MODES.includes(executionMode)) {
+      throw new Error(`Unknown execution mode "${executionMode}"; expected ${EXECUTION_MODES.join(', ')}`);
+    }
     const jobId = `job_${Date.now()}_${crypto.randomBytes(6).toString('hex')}`;
     const job = {
       id: jobId,
@@ -43,13 +124,20 @@ class InMemoryJobQueue extends EventEmitter {
       language,
       code,
       clientIp,
+      executionMode,
       codeLength: code.length,
       createdAt: new Date().toISOString(),
       startedAt: null,
       finishedAt: null,
       durationMs: 0,
-      result: null // { success, output, error, exitCode }
+      result: null, // { success, output, error, exitCode }
+      // Status changes and output as they happen, for streaming clients
+      stream: new OutputStream({
+        capacityBytes: config.STREAM_BUFFER_BYTES,
+        maxTotalBytes: config.MAX_EXEC_BUFFER_BYTES
+      })
     };
+    job.stream.status('queued');
 
     this.jobs.set(jobId, job);
     this.queue.push(job);
@@ -129,6 +217,7 @@ class InMemoryJobQueue extends EventEmitter {
       job.finishedAt = new Date().toISOString();
       job.durationMs = Date.now() - startTime;
       this.totalProcessed++;
+      this.closeStream(job);
       this.emit('job:completed', job);
     } catch (err) {
       job.result = {
@@ -141,6 +230,7 @@ class InMemoryJobQueue extends EventEmitter {
       job.finishedAt = new Date().toISOString();
       job.durationMs = Date.now() - startTime;
       this.totalProcessed++;
+      this.closeStream(job);
       this.emit('job:failed', job);
     } finally {
       this.activeWorkers--;
@@ -150,111 +240,308 @@ class InMemoryJobQueue extends EventEmitter {
   }
 
   /**
-   * Execute code inside isolated temporary sandbox with ulimits or Docker
+   * End a finished job's stream with its outcome. Program output has already
+   * been streamed; errors that were not (compiler diagnostics, timeouts) are
+   * sent in the exit event.
    */
-  executeJobInSandbox(job) {
-    return new Promise((resolve) => {
-      const { code, language } = job;
-      const langConfig = getLanguage(language);
-      if (!langConfig) {
-        return resolve({
-          success: false,
-          output: '',
-          error: `Unsupported language: "${language}"`,
-          exitCode: 1,
-          errorCategory: 'unsupported_language'
-        });
-      }
+  closeStream(job) {
+    const { result } = job;
+    const streamed = result.errorCategory === 'none' ||
+      (result.errorCategory === 'runtime_error' && job.stream.bytesByType.stderr > 0);
+    job.stream.close({
+      status: job.status,
+      success: result.success,
+      exitCode: result.exitCode,
+      errorCategory: result.errorCategory || 'internal_error',
+      error: streamed ? '' : result.error,
+      truncated: Boolean(result.truncated),
+      tier: result.tier || null,
+      escalated: Boolean(result.escalated),
+      profile: result.profile || null,
+      durationMs: job.durationMs
+    });
+  }
 
-      const tmpDir = path.join('/tmp', 'intellicpp_' + job.id);
-      const cleanup = () => {
-        try {
-          if (fs.existsSync(tmpDir)) {
-            fs.rmSync(tmpDir, { recursive: true, force: true });
-          }
-        } catch (_) {}
+  /**
+   * Execute code inside isolated temporary sandbox with ulimits or Docker.
+   *
+   * For languages with build tiers the job's execution mode decides which
+   * builds run: "tiered" (the default) runs the fast build and, if the
+   * program crashes, rebuilds it with sanitizers and runs it again so the
+   * result carries a diagnostic; "fast" and "sanitized" run one build only.
+   */
+  async executeJobInSandbox(job) {
+    const { code, language } = job;
+    const langConfig = getLanguage(language);
+    if (!langConfig) {
+      return {
+        success: false,
+        output: '',
+        error: `Unsupported language: "${language}"`,
+        exitCode: 1,
+        errorCategory: 'unsupported_language'
       };
+    }
 
-      const { VIRTUAL_MEM_KB, MAX_FILE_SIZE_BLOCKS, MAX_CPU_TIME_SEC, DISABLE_CORE_DUMP, MAX_PIDS } = config.ULIMITS;
-      const HOST_ULIMIT_PREFIX = `ulimit -v ${VIRTUAL_MEM_KB} -f ${MAX_FILE_SIZE_BLOCKS} -c ${DISABLE_CORE_DUMP} -t ${MAX_CPU_TIME_SEC} -u ${MAX_PIDS} 2>/dev/null; `;
+    const tmpDir = path.join('/tmp', 'intellicpp_' + job.id);
+    try {
+      fs.mkdirSync(tmpDir, { recursive: true });
+      fs.writeFileSync(path.join(tmpDir, langConfig.filename), code, 'utf8');
+
+      const tiers = langConfig.tiers || [null];
+      const mode = langConfig.tiers ? job.executionMode : null;
+      const first = mode === 'sanitized' ? 'sanitized' : tiers[0];
+      const result = await this.buildAndRun(job, langConfig, tmpDir, first, { streamStdout: true });
+      if (mode !== 'tiered' || !result.crashSignal || first === 'sanitized') {
+        return { ...result, tier: first, escalated: false };
+      }
 
+      // Its output was streamed already; the sanitizer's report goes to stderr
+      const diagnosed = await this.buildAndRun(job, langConfig, tmpDir, 'sanitized', { streamStdout: false });
+      return { ...diagnosed, tier: 'sanitized', escalated: true, fastCrashSignal: result.crashSignal };
+    } catch (err) {
+      return {
+        success: false,
+        output: '',
+        error: 'Execution failed: ' + err.message,
+        exitCode: 1,
+        errorCategory: 'internal_error'
+      };
+    } finally {
       try {
-        fs.mkdirSync(tmpDir, { recursive: true });
-
-        const srcFile = path.join(tmpDir, langConfig.filename);
-        const binFile = langConfig.outputFilename ? path.join(tmpDir, langConfig.outputFilename) : null;
-        fs.writeFileSync(srcFile, code, 'utf8');
-
-        // 1. Compilation
-        if (langConfig.isCompiled && typeof langConfig.compileCmd === 'function') {
-          try {
-            const compileCmd = `${HOST_ULIMIT_PREFIX} ${langConfig.compileCmd(srcFile, binFile)}`;
-            execSync(compileCmd, { timeout: langConfig.compileTimeoutMs, maxBuffer: config.MAX_EXEC_BUFFER_BYTES });
-          } catch (compileErr) {
-            cleanup();
-            return resolve({
-              success: false,
-              output: '',
-              error: compileErr.stdout?.toString() || compileErr.message,
-              exitCode: 1,
-              errorCategory: 'compilation_error'
-            });
+        fs.rmSync(tmpDir, { recursive: true, force: true });
+      } catch (_) {}
+    }
+  }
+
+  /**
+   * Compile (unless cached) and run the source in tmpDir with one build tier
+   */
+  async buildAndRun(job, langConfig, tmpDir, tier, { streamStdout }) {
+    const { code } = job;
+    const srcFile = path.join(tmpDir, langConfig.filename);
+    const binFile = langConfig.outputFilename ? path.join(tmpDir, langConfig.outputFilename) : null;
+    const sanitized = tier === 'sanitized';
+    const tierStatus = tier ? { tier } : {};
+
+    const HOST_ULIMIT_PREFIX = ulimitPrefix(true);
+
+    // 1. Compilation, skipped when the same build is cached
+    if (langConfig.isCompiled && typeof langConfig.compileCmd === 'function') {
+      job.stream.status('compiling', tierStatus);
+      const build = this.compileCache.inputsFor(langConfig, code, tier);
+      const cached = this.compileCache.lookup(build, binFile);
+      const compileError = (error) => ({
+        success: false,
+        output: '',
+        error,
+        exitCode: 1,
+        errorCategory: 'compilation_error'
+      });
+
+      if (cached && cached.diagnostics !== undefined) {
+        return compileError(cached.diagnostics);
+      }
+      if (!cached) {
+        // Common headers load precompiled when the code starts with a
+        // known include set
+        const version = compilerVersion(langConfig.compileCmd('SOURCE', 'PROGRAM', null, tier));
+        const pchHeader = this.pchCache.headerFor(langConfig, code, version, tier);
+        const compileStart = Date.now();
+        const compiled = () => {
+          const ms = Date.now() - compileStart;
+          this.pchCache.recordCompile(Boolean(pchHeader), ms);
+          jobPhaseSeconds.observe({ phase: 'compile', tier: tier || 'none' }, ms / 1000);
+        };
+        try {
+          const compileCmd = `${HOST_ULIMIT_PREFIX} ${langConfig.compileCmd(srcFile, binFile, pchHeader, tier)}`;
+          execSync(compileCmd, { timeout: langConfig.compileTimeoutMs, maxBuffer: config.MAX_EXEC_BUFFER_BYTES });
+          compiled();
+          this.compileCache.storeProgram(build, binFile);
+        } catch (compileErr) {
+          compiled();
+          const diagnostics = compileErr.stdout?.toString() || compileErr.message;
+          // Only ordinary compile errors (exit status 1) are cached;
+          // timeouts, ulimit kills and compiler crashes may not recur
+          if (compileErr.status === 1 && !compileErr.signal) {
+            this.compileCache.storeDiagnostics(build, diagnostics);
           }
+          return compileError(diagnostics);
         }
+      }
+    }
 
-        // 2. Execution
-        let runCommand = '';
-        if (config.USE_DOCKER_SANDBOX) {
-          const { NETWORK, MEMORY, CPUS, PIDS_LIMIT, USER } = config.DOCKER_FLAGS;
-          runCommand = `docker run --rm --network=${NETWORK} --memory=${MEMORY} --cpus=${CPUS} --pids-limit=${PIDS_LIMIT} --read-only --user ${USER} -v "${tmpDir}:/workspace:rw" -w /workspace ${config.DOCKER_SANDBOX_IMAGE} ${langConfig.dockerRunCmd}`;
-        } else {
-          const targetFile = binFile || srcFile;
-          const timeoutSec = Math.ceil((langConfig.executionTimeoutMs || 5000) / 1000);
-          runCommand = `${HOST_ULIMIT_PREFIX} timeout -k 1 ${timeoutSec} ${langConfig.runCmd(targetFile)}`;
-        }
+    // 2. Execution, with a profile of the program's resource usage where
+    // the profiler is available. Inside Docker it is not.
+    const profileFile = path.join(tmpDir, `profile-${tier || 'run'}.json`);
+    const sanitizerEnv = sanitized ? Object.entries(langConfig.sanitizerEnv || {}) : [];
+    let runCommand = '';
+    if (config.USE_DOCKER_SANDBOX) {
+      const { NETWORK, MEMORY, CPUS, PIDS_LIMIT, USER } = config.DOCKER_FLAGS;
+      const envFlags = sanitizerEnv.map(([name, value]) => ` -e ${name}=${value}`).join('');
+      runCommand = `docker run --rm --network=${NETWORK} --memory=${MEMORY} --cpus=${CPUS} --pids-limit=${PIDS_LIMIT} --read-only --user ${USER}${envFlags} -v "${tmpDir}:/workspace:rw" -w /workspace ${config.DOCKER_SANDBOX_IMAGE} ${langConfig.dockerRunCmd}`;
+    } else {
+      const targetFile = binFile || srcFile;
+      const timeoutSec = Math.ceil((langConfig.executionTimeoutMs || 5000) / 1000);
+      const env = sanitizerEnv.map(([name, value]) => `${name}=${value} `).join('');
+      const profiler = this.profilerPath ? `"${this.profilerPath}" --output "${profileFile}" -- ` : '';
+      // --foreground keeps timeout in the shell's process group, which is
+      // what the hard kill signals
+      runCommand = `${ulimitPrefix(!sanitized)} ${env}timeout --foreground -k 1 ${timeoutSec} ${profiler}${langConfig.runCmd(targetFile)}`;
+    }
 
-        exec(runCommand, { timeout: config.EXECUTION_HARD_KILL_TIMEOUT_MS, maxBuffer: config.MAX_EXEC_BUFFER_BYTES }, (runErr, stdout, stderr) => {
-          cleanup();
-          if ((runErr && runErr.killed) || (runErr && runErr.code === 124)) {
-            return resolve({
-              success: false,
-              output: '',
-              error: 'Execution timed out (5s limit)',
-              exitCode: 124,
-              errorCategory: 'timeout'
-            });
+    job.stream.status('running', tierStatus);
+    const runStart = process.hrtime.bigint();
+    const { code: exitCode, signal, stdout, stderr, timedOut, truncated } =
+      await this.runStreamed(job, runCommand, { streamStdout });
+    jobPhaseSeconds.observe({ phase: 'run', tier: tier || 'none' }, Number(process.hrtime.bigint() - runStart) / 1e9);
+    const crash = crashSignal(exitCode, signal);
+    const profile = readProfile(profileFile);
+    if (timedOut || exitCode === 124) {
+      return {
+        success: false,
+        output: '',
+        error: 'Execution timed out (5s limit)',
+        exitCode: 124,
+        errorCategory: 'timeout',
+        profile
+      };
+    }
+    if (crash) {
+      return {
+        success: false,
+        output: stdout,
+        error: stderr || `Program crashed (${crash})`,
+        exitCode: exitCode ?? 128 + os.constants.signals[crash],
+        errorCategory: 'runtime_error',
+        crashSignal: crash,
+        truncated,
+        profile
+      };
+    }
+    if (exitCode !== 0 && !stdout) {
+      return {
+        success: false,
+        output: '',
+        error: stderr || `Process terminated by ${signal || `exit code ${exitCode}`}`,
+        exitCode: exitCode || 1,
+        errorCategory: 'runtime_error',
+        truncated,
+        profile
+      };
+    }
+    return {
+      success: true,
+      output: stdout,
+      error: stderr,
+      exitCode: 0,
+      errorCategory: 'none',
+      truncated,
+      profile
+    };
+  }
+
+  /**
+   * Run a shell command in a process group of its own, passing its output
+   * to job.stream as it arrives (stderr only unless streamStdout) and
+   * collecting it. When a streaming client falls behind, the pipes stop
+   * being read, which blocks the program's writes; the timeouts keep
+   * running meanwhile. Once the group is killed the pipes are read to the
+   * end without pausing, and given up on PIPE_DRAIN_MS later.
+   */
+  runStreamed(job, runCommand, { streamStdout }) {
+    return new Promise((resolve) => {
+      const child = spawn('/bin/sh', ['-c', runCommand], { detached: true, stdio: ['ignore', 'pipe', 'pipe'] });
+      const output = { stdout: '', stderr: '' };
+      let timedOut = false;
+      let truncated = false;
+      let killed = false;
+      let settled = false;
+      let exit = { code: null, signal: 'SIGKILL' };
+      let drainDeadline = null;
+      const killGroup = () => {
+        try {
+          process.kill(-child.pid, 'SIGKILL');
+        } catch (_) {}
+      };
+
+      const pipes = [child.stdout, child.stderr];
+      const resume = () => pipes.forEach(pipe => pipe.resume());
+      // A reader that stopped advancing must not keep the pipes paused, or
+      // 'close' never comes; something that escaped the group may also hold
+      // them open
+      const stop = () => {
+        if (killed) return;
+        killed = true;
+        killGroup();
+        resume();
+        drainDeadline = setTimeout(() => {
+          pipes.forEach(pipe => pipe.destroy());
+          finish(exit);
+        }, PIPE_DRAIN_MS);
+      };
+      const hardKill = setTimeout(() => {
+        timedOut = true;
+        stop();
+      }, config.EXECUTION_HARD_KILL_TIMEOUT_MS);
+
+      job.stream.on('drain', resume);
+      const finish = (outcome) => {
+        if (settled) return;
+        settled = true;
+        clearTimeout(hardKill);
+        clearTimeout(drainDeadline);
+        job.stream.removeListener('drain', resume);
+        resolve({ ...output, timedOut, truncated, ...outcome });
+      };
+
+      for (const [name, pipe] of [['stdout', child.stdout], ['stderr', child.stderr]]) {
+        pipe.setEncoding('utf8');
+        pipe.on('data', (text) => {
+          if (name === 'stdout' && !streamStdout) {
+            // Kept to the same limit, without streaming it
+            output.stdout += text.slice(0, Math.max(0, config.MAX_EXEC_BUFFER_BYTES - output.stdout.length));
+            return;
           }
-          if (runErr && runErr.code !== 0 && !stdout) {
-            return resolve({
-              success: false,
-              output: '',
-              error: stderr || runErr.message,
-              exitCode: runErr.code || 1,
-              errorCategory: 'runtime_error'
-            });
+          output[name] += job.stream.write(name, text);
+          if (job.stream.truncated) {
+            // Past MAX_EXEC_BUFFER_BYTES nothing more is kept
+            truncated = true;
+            stop();
+          } else if (!killed && job.stream.shouldPause()) {
+            pipes.forEach(p => p.pause());
           }
-          resolve({
-            success: true,
-            output: stdout || '',
-            error: stderr || '',
-            exitCode: 0,
-            errorCategory: 'none'
-          });
-        });
-
-      } catch (err) {
-        cleanup();
-        resolve({
-          success: false,
-          output: '',
-          error: 'Execution failed: ' + err.message,
-          exitCode: 1,
-          errorCategory: 'internal_error'
         });
       }
+
+      child.on('error', (err) => finish({ code: 1, signal: null, stderr: 'Execution failed: ' + err.message }));
+      child.on('exit', (code, signal) => {
+        exit = { code, signal };
+      });
+      child.on('close', (code, signal) => {
+        killGroup(); // Anything the program left running
+        finish({ code, signal });
+      });
     });
   }
 
+  /**
+   * Build the precompiled headers of every language and build tier in the
+   * background, so early submissions need not compile without them.
+   * Resolves to the number of profiles ready.
+   */
+  async warmPrecompiledHeaders() {
+    let ready = 0;
+    for (const langConfig of Object.values(LANGUAGE_REGISTRY)) {
+      if (typeof langConfig.pchCmd !== 'function') continue;
+      for (const tier of langConfig.tiers || [undefined]) {
+        const version = compilerVersion(langConfig.compileCmd('SOURCE', 'PROGRAM', null, tier));
+        ready += await this.pchCache.warm(langConfig, version, tier);
+      }
+    }
+    return ready;
+  }
+
   /**
    * Evict old completed/failed jobs if map exceeds retention limit
    */
@@ -302,9 +589,20 @@ class InMemoryJobQueue extends EventEmitter {
 }
 
 // Global default queue instance
-const defaultQueue = new InMemoryJobQueue({ concurrency: 4 });
+const defaultQueue = new InMemoryJobQueue({
+  concurrency: 4,
+  compileCache: new CompileCache({
+    directory: config.COMPILE_CACHE_DIR && path.join(config.COMPILE_CACHE_DIR, 'queue'),
+    maxBytes: config.COMPILE_CACHE_MAX_MB * 1024 * 1024
+  }),
+  pchCache: new PchCache({
+    directory: config.PCH_DIR && path.join(config.PCH_DIR, 'queue'),
+    commandPrefix: pchLimitPrefix()
+  })
+});
 
 module.exports = {
+  EXECUTION_MODES,
   InMemoryJobQueue,
   defaultQueue
 };
@@ -0,0 +1,186 @@
+/**
+ * Streamed Job Output
+ * A bounded ring of events (status changes, stdout/stderr chunks, truncation
+ * markers, the final exit) that a running job appends to and any number of
+ * readers follow, each with its own cursor.
+ *
+ * Every event carries a sequence number (the SSE event id, so a reconnecting
+ * client resumes where it left off) and the byte offset of the output before
+ * it. Once retained output exceeds `capacityBytes` the oldest events every
+ * reader has seen are dropped; a reader that connects after that gets a
+ * `truncated` event saying how many bytes it missed. Output past `maxTotalBytes` is discarded with a
+ * single `truncated` event of reason "limit", matching the buffered result.
+ *
+ * Backpressure: while some reader lags `capacityBytes` or more behind the
+ * newest output, `shouldPause()` is true and the producer stops reading the
+ * child's pipes (which in turn blocks the child in write). 'drain' is emitted
+ * once every reader is back within half the capacity. Without readers
+ * nothing pauses; old output is simply dropped.
+ */
+
+const EventEmitter = require('events');
+
+class OutputStream extends EventEmitter {
+  /**
+   * @param {Object} [options]
+   * @param {number} [options.capacityBytes=64KB] - Output kept for readers
+   * @param {number} [options.maxTotalBytes=Infinity] - Output accepted over the job's life
+   */
+  constructor({ capacityBytes = 64 * 1024, maxTotalBytes = Infinity } = {}) {
+    super();
+    this.setMaxListeners(0); // One 'data' listener per connected reader
+    this.capacityBytes = capacityBytes;
+    this.maxTotalBytes = maxTotalBytes;
+    this.events = []; // Oldest first: { seq, offset, bytes, type, data }
+    this.retainedBytes = 0;
+    this.nextSeq = 0;
+    this.totalBytes = 0; // Output accepted so far
+    this.droppedBytes = 0; // Output past maxTotalBytes
+    this.bytesByType = { stdout: 0, stderr: 0 };
+    this.readers = new Set();
+    this.paused = false;
+    this.closed = false;
+  }
+
+  append(type, data, bytes = 0) {
+    const event = { seq: this.nextSeq++, offset: this.totalBytes, bytes, type, data };
+    this.events.push(event);
+    this.totalBytes += bytes;
+    this.retainedBytes += bytes;
+
+    // Readers keep what they have not read yet; backpressure bounds that to
+    // the capacity plus the chunks already in flight when the pause came
+    let unread = this.nextSeq;
+    for (const reader of this.readers) unread = Math.min(unread, reader.seq);
+    while (this.retainedBytes > this.capacityBytes && this.events.length > 1 && this.events[0].seq < unread) {
+      this.retainedBytes -= this.events.shift().bytes;
+    }
+    if (this.readers.size > 0 && this.lag() >= this.capacityBytes) this.paused = true;
+    this.emit('data');
+    return event;
+  }
+
+  /**
+   * A phase change: queued, compiling, running; details such as the build
+   * tier go alongside
+   */
+  status(phase, details = {}) {
+    if (!this.closed) this.append('status', { phase, ...details });
+  }
+
+  /**
+   * Output from the child; text is decoded UTF-8. Returns the part that was
+   * kept, empty once maxTotalBytes has been reached.
+   */
+  write(type, text) {
+    if (this.closed || text.length === 0) return '';
+    const bytes = Buffer.byteLength(text);
+    if (this.truncated) {
+      this.droppedBytes += bytes;
+      return '';
+    }
+    const room = this.maxTotalBytes - this.totalBytes;
+    if (bytes <= room) {
+      this.append(type, text, bytes);
+      this.bytesByType[type] += bytes;
+      return text;
+    }
+
+    // Cut on a character boundary: at most `room` bytes
+    const kept = Buffer.from(text).subarray(0, room).toString().replace(/\uFFFD$/, '');
+    const keptBytes = Buffer.byteLength(kept);
+    if (keptBytes > 0) this.append(type, kept, keptBytes);
+    this.bytesByType[type] += keptBytes;
+    this.droppedBytes += bytes - keptBytes;
+    this.append('truncated', { reason: 'limit', limitBytes: this.maxTotalBytes });
+    return kept;
+  }
+
+  get truncated() {
+    return this.droppedBytes > 0;
+  }
+
+  /**
+   * Final event; the stream accepts nothing after it
+   */
+  close(result) {
+    if (this.closed) return;
+    this.append('exit', result);
+    this.closed = true;
+    this.paused = false;
+    this.emit('drain');
+  }
+
+  /**
+   * A cursor positioned after the event with id `lastSeq`, or at the start
+   */
+  reader(lastSeq = -1) {
+    const reader = { seq: lastSeq + 1, offset: this.offsetOf(lastSeq + 1) };
+    this.readers.add(reader);
+    return reader;
+  }
+
+  // Output offset before event `seq`; null once it has been dropped, unless
+  // it is the very first
+  offsetOf(seq) {
+    if (seq === 0) return 0;
+    if (seq >= this.nextSeq) return this.totalBytes;
+    const first = this.events[0];
+    return first && seq >= first.seq ? this.events[seq - first.seq].offset : null;
+  }
+
+  /**
+   * The reader's next event, or null when it has caught up. A reader that
+   * fell behind the retained events first gets a `truncated` gap event.
+   */
+  next(reader) {
+    const first = this.events[0];
+    if (!first || reader.seq >= this.nextSeq) return null;
+
+    let event;
+    if (reader.seq < first.seq) {
+      const skipped = reader.offset === null ? null : first.offset - reader.offset;
+      event = { seq: first.seq - 1, type: 'truncated', data: { reason: 'overrun', skippedBytes: skipped } };
+      reader.seq = first.seq;
+      reader.offset = first.offset;
+    } else {
+      event = this.events[reader.seq - first.seq];
+      reader.seq = event.seq + 1;
+      reader.offset = event.offset + event.bytes;
+    }
+    this.checkDrain();
+    return event;
+  }
+
+  release(reader) {
+    this.readers.delete(reader);
+    this.checkDrain();
+  }
+
+  /**
+   * Bytes of output the slowest reader has yet to read
+   */
+  lag() {
+    let lag = 0;
+    for (const reader of this.readers) {
+      const offset = reader.offset === null ? this.events[0].offset : reader.offset;
+      lag = Math.max(lag, this.totalBytes - offset);
+    }
+    return lag;
+  }
+
+  shouldPause() {
+    return this.paused;
+  }
+
+  checkDrain() {
+    if (this.paused && this.lag() <= this.capacityBytes / 2) {
+      this.paused = false;
+      this.emit('drain');
+    }
+  }
+}
+
+module.exports = {
+  OutputStream
+};
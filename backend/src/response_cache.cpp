@@ -0,0 +1,141 @@
+#include "../include/response_cache.h"
+#include "../include/hash.h"
+#include <cstring>
+
+namespace codeflow {
+
+namespace {
+
+// What malloc takes for a block of n bytes: an 8-byte header, rounded up to
+// 16 (glibc on 64-bit)
+constexpr std::size_t allocated(std::size_t n) { return (n + 8 + 15) & ~std::size_t(15); }
+
+} // namespace
+
+ResponseKey &ResponseKey::add(std::string_view field) {
+  state = hash64(field, state);
+  return *this;
+}
+
+ResponseKey &ResponseKey::add(std::uint64_t value) {
+  char bytes[sizeof value];
+  std::memcpy(bytes, &value, sizeof value);
+  return add(std::string_view(bytes, sizeof bytes));
+}
+
+ResponseCache::ResponseCache(std::size_t budgetBytes,
+                             std::chrono::milliseconds ttl)
+    : budgetBytes(budgetBytes),
+      ttlTicks(std::chrono::duration_cast<Clock::duration>(ttl).count()) {}
+
+std::size_t ResponseCache::entryBytes(const std::string &body) {
+  static const std::size_t inline_capacity = std::string().capacity();
+  // List node; hash node and its bucket; make_shared's control block
+  // holding the string; the string's text unless it fits inline
+  constexpr std::size_t bookkeeping =
+      allocated(2 * sizeof(void *) + sizeof(Entry)) +
+      allocated(sizeof(void *) +
+                sizeof(std::pair<const std::uint64_t,
+                                 std::list<Entry>::iterator>)) +
+      sizeof(void *) + allocated(2 * sizeof(void *) + sizeof(std::string));
+  return bookkeeping +
+         (body.capacity() > inline_capacity ? allocated(body.capacity() + 1)
+                                            : 0);
+}
+
+ResponseCache::Body ResponseCache::get(std::uint64_t key) {
+  Shard &shard = shardOf(key);
+  const Clock::time_point now = Clock::now();
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it == shard.entries.end()) {
+    ++shard.misses;
+    return nullptr;
+  }
+  if (it->second->expires <= now) {
+    erase(shard, it->second);
+    ++shard.expirations;
+    ++shard.misses;
+    return nullptr;
+  }
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  ++shard.hits;
+  return it->second->body;
+}
+
+void ResponseCache::put(std::uint64_t key, Body body) {
+  if (!body)
+    return;
+  const std::size_t bytes = entryBytes(*body);
+  const std::size_t budget = shardBudget();
+  if (bytes > budget)
+    return;
+  const Clock::time_point expires =
+      Clock::now() + Clock::duration(ttlTicks.load(std::memory_order_relaxed));
+
+  Shard &shard = shardOf(key);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.entries.find(key);
+  if (it != shard.entries.end())
+    erase(shard, it->second);
+  shard.lru.push_front({key, expires, std::move(body), bytes});
+  shard.entries.emplace(key, shard.lru.begin());
+  shard.bytes += bytes;
+  evictOverBudget(shard, budget);
+}
+
+void ResponseCache::erase(Shard &shard, std::list<Entry>::iterator entry) {
+  shard.bytes -= entry->bytes;
+  shard.entries.erase(entry->key);
+  shard.lru.erase(entry);
+}
+
+void ResponseCache::evictOverBudget(Shard &shard, std::size_t budget) {
+  while (shard.bytes > budget && !shard.lru.empty()) {
+    erase(shard, std::prev(shard.lru.end()));
+    ++shard.evictions;
+  }
+}
+
+void ResponseCache::clear() {
+  for (Shard &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.entries.clear();
+    shard.lru.clear();
+    shard.bytes = 0;
+  }
+}
+
+void ResponseCache::setBudget(std::size_t bytes) {
+  budgetBytes.store(bytes, std::memory_order_relaxed);
+  const std::size_t budget = shardBudget();
+  for (Shard &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    evictOverBudget(shard, budget);
+  }
+}
+
+void ResponseCache::setTtl(std::chrono::milliseconds ttl) {
+  ttlTicks.store(std::chrono::duration_cast<Clock::duration>(ttl).count(),
+                 std::memory_order_relaxed);
+}
+
+ResponseCacheStats ResponseCache::stats() const {
+  ResponseCacheStats total;
+  for (const Shard &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    total.hits += shard.hits;
+    total.misses += shard.misses;
+    total.expirations += shard.expirations;
+    total.evictions += shard.evictions;
+    total.entries += shard.entries.size();
+    total.bytes += shard.bytes;
+  }
+  total.budgetBytes = budgetBytes.load(std::memory_order_relaxed);
+  total.ttlMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    Clock::duration(ttlTicks.load(std::memory_order_relaxed)))
+                    .count();
+  return total;
+}
+
+} // namespace codeflow
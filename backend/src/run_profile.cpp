@@ -0,0 +1,172 @@
+#include "../include/run_profile.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace codeflow {
+
+namespace {
+
+struct Event {
+  std::uint32_t type;
+  std::uint64_t config;
+};
+
+constexpr std::uint64_t cacheEvent(std::uint64_t cache, std::uint64_t op,
+                                   std::uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+// In CounterValues order
+constexpr Event kCounterEvents[] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE,
+     cacheEvent(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+double milliseconds(const timeval &time) {
+  return time.tv_sec * 1000.0 + time.tv_usec / 1000.0;
+}
+
+std::string describeOpenError(int error) {
+  std::string reason =
+      std::string("perf_event_open: ") + std::strerror(error);
+  if (error == EACCES || error == EPERM) {
+    int paranoid = 0;
+    std::ifstream("/proc/sys/kernel/perf_event_paranoid") >> paranoid;
+    reason += " (kernel.perf_event_paranoid=" + std::to_string(paranoid) + ")";
+  } else if (error == ENOENT || error == EOPNOTSUPP) {
+    reason += " (no hardware counters, as in most VMs)";
+  }
+  return reason;
+}
+
+} // namespace
+
+ResourceUsage ResourceUsage::from(const struct rusage &usage) {
+  ResourceUsage result;
+  result.userMs = milliseconds(usage.ru_utime);
+  result.systemMs = milliseconds(usage.ru_stime);
+  result.maxRssKb = usage.ru_maxrss;
+  result.minorFaults = usage.ru_minflt;
+  result.majorFaults = usage.ru_majflt;
+  result.voluntarySwitches = usage.ru_nvcsw;
+  result.involuntarySwitches = usage.ru_nivcsw;
+  return result;
+}
+
+HardwareCounters::HardwareCounters(pid_t pid, bool enableOnExec) {
+  int firstError = 0;
+  for (int i = 0; i < kEvents; ++i) {
+    perf_event_attr attributes{};
+    attributes.size = sizeof(attributes);
+    attributes.type = kCounterEvents[i].type;
+    attributes.config = kCounterEvents[i].config;
+    attributes.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attributes.inherit = 1; // Threads and children the program starts
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    attributes.disabled = enableOnExec;
+    attributes.enable_on_exec = enableOnExec;
+    fds[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attributes, pid,
+                                        -1, -1, PERF_FLAG_FD_CLOEXEC));
+    if (fds[i] < 0 && firstError == 0)
+      firstError = errno;
+  }
+  for (int fd : fds) {
+    if (fd >= 0)
+      return;
+  }
+  error = describeOpenError(firstError);
+}
+
+HardwareCounters::~HardwareCounters() {
+  for (int fd : fds) {
+    if (fd >= 0)
+      ::close(fd);
+  }
+}
+
+CounterValues HardwareCounters::read() const {
+  CounterValues values;
+  values.unavailable = error;
+  std::optional<std::uint64_t> *slots[kEvents] = {
+      &values.cycles, &values.instructions, &values.branchMisses,
+      &values.l1dReadMisses, &values.llcMisses};
+  for (int i = 0; i < kEvents; ++i) {
+    std::uint64_t data[3]; // value, time enabled, time running
+    if (fds[i] < 0 || ::read(fds[i], data, sizeof(data)) != sizeof(data))
+      continue;
+    if (data[2] == 0) {
+      // Never scheduled onto the PMU: nothing to extrapolate from
+      if (data[1] != 0)
+        continue;
+      *slots[i] = data[0];
+    } else if (data[2] < data[1]) {
+      *slots[i] = static_cast<std::uint64_t>(
+          static_cast<double>(data[0]) * data[1] / data[2]);
+      values.scaled = true;
+    } else {
+      *slots[i] = data[0];
+    }
+  }
+  return values;
+}
+
+std::string profileJson(const RunProfile &profile) {
+  auto number = [](double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return std::string(buffer);
+  };
+  auto count = [](const std::optional<std::uint64_t> &value) {
+    return value ? std::to_string(*value) : std::string("null");
+  };
+  const ResourceUsage &usage = profile.usage;
+  const CounterValues &counters = profile.counters;
+
+  std::string ipc = "null";
+  if (counters.cycles && counters.instructions && *counters.cycles > 0)
+    ipc = number(static_cast<double>(*counters.instructions) /
+                 static_cast<double>(*counters.cycles));
+  std::string reason = "null";
+  if (!counters.available()) {
+    reason = "\"";
+    for (char c : counters.unavailable)
+      reason += c == '"' || c == '\\' ? '\'' : c;
+    reason += "\"";
+  }
+
+  return "{\"wallMs\":" + number(profile.wallMs) +
+         ",\"userMs\":" + number(usage.userMs) +
+         ",\"systemMs\":" + number(usage.systemMs) +
+         ",\"maxRssKb\":" + std::to_string(usage.maxRssKb) +
+         ",\"minorFaults\":" + std::to_string(usage.minorFaults) +
+         ",\"majorFaults\":" + std::to_string(usage.majorFaults) +
+         ",\"voluntaryContextSwitches\":" +
+         std::to_string(usage.voluntarySwitches) +
+         ",\"involuntaryContextSwitches\":" +
+         std::to_string(usage.involuntarySwitches) +
+         ",\"counters\":{\"available\":" +
+         (counters.available() ? "true" : "false") +
+         ",\"cycles\":" + count(counters.cycles) +
+         ",\"instructions\":" + count(counters.instructions) +
+         ",\"branchMisses\":" + count(counters.branchMisses) +
+         ",\"l1dReadMisses\":" + count(counters.l1dReadMisses) +
+         ",\"llcMisses\":" + count(counters.llcMisses) +
+         ",\"instructionsPerCycle\":" + ipc +
+         ",\"scaled\":" + (counters.scaled ? "true" : "false") +
+         ",\"unavailableReason\":" + reason + "}}";
+}
+
+} // namespace codeflow
@@ -0,0 +1,1393 @@
+#include "../include/scope_index.h"
+#include "../include/tokenizer.h"
+#include <algorithm>
+#include <array>
+
+namespace codeflow {
+
+namespace {
+
+// How many aliases, auto initializers and member accesses a resolution
+// follows; cycles ("auto a = b; auto b = a;") end here
+constexpr int kMaxDepth = 8;
+
+// Words that start a statement or expression, never a declaration's type
+constexpr std::array<std::string_view, 33> kStatementWords = {
+    "return",   "if",        "else",      "for",       "while",
+    "do",       "switch",    "case",      "default",   "break",
+    "continue", "goto",      "throw",     "delete",    "new",
+    "using",    "namespace", "typedef",   "template",  "sizeof",
+    "co_return", "co_await", "co_yield",  "static_assert", "operator",
+    "this",     "true",      "false",     "nullptr",   "public",
+    "private",  "protected", "friend"};
+
+// Words that may come before a declaration's type
+constexpr std::array<std::string_view, 18> kSpecifiers = {
+    "static",   "const",    "constexpr", "consteval",    "constinit",
+    "inline",   "extern",   "volatile",  "mutable",      "thread_local",
+    "register", "virtual",  "explicit",  "typename",     "struct",
+    "class",    "union",    "enum"};
+
+// Builtin type words that combine ("unsigned long long int")
+constexpr std::array<std::string_view, 7> kBuiltinWords = {
+    "unsigned", "signed", "long", "short", "int", "char", "double"};
+
+// Words before a '{' that opens a plain block
+constexpr std::array<std::string_view, 4> kBlockWords = {"else", "do", "try",
+                                                         "finally"};
+
+// Words between a function's parameters and its body
+constexpr std::array<std::string_view, 5> kFunctionSuffixes = {
+    "const", "noexcept", "override", "final", "mutable"};
+
+constexpr std::array<std::string_view, 4> kStringTypes = {
+    "string", "wstring", "string_view", "u8string"};
+
+constexpr std::array<std::string_view, 4> kMapTypes = {
+    "map", "multimap", "unordered_map", "unordered_multimap"};
+
+// Containers whose element is their first template argument
+constexpr std::array<std::string_view, 15> kSequenceTypes = {
+    "vector",   "deque",          "list",
+    "forward_list", "array",      "set",
+    "multiset", "unordered_set",  "unordered_multiset",
+    "stack",    "queue",          "priority_queue",
+    "span",     "valarray",       "initializer_list"};
+
+// Members returning an iterator
+constexpr std::array<std::string_view, 9> kIteratorCalls = {
+    "begin", "end",  "cbegin",      "cend",       "rbegin",
+    "rend",  "find", "lower_bound", "upper_bound"};
+
+template <std::size_t N>
+bool isOneOf(const std::array<std::string_view, N> &words,
+             std::string_view word) {
+  return std::find(words.begin(), words.end(), word) != words.end();
+}
+
+// What the builder needs to know about a word, as bits
+enum WordClass : std::uint8_t {
+  kStatement = 1, // kStatementWords
+  kSpecifier = 2, // kSpecifiers
+  kBuiltin = 4,   // kBuiltinWords
+  kBlock = 8,     // kBlockWords
+  kSuffix = 16,   // kFunctionSuffixes
+};
+
+// The word lists above as one open-addressed table, so classifying a word
+// is a hash and a compare rather than a scan of each list
+class WordClasses {
+public:
+  constexpr WordClasses() {
+    add(kStatementWords, kStatement);
+    add(kSpecifiers, kSpecifier);
+    add(kBuiltinWords, kBuiltin);
+    add(kBlockWords, kBlock);
+    add(kFunctionSuffixes, kSuffix);
+  }
+
+  std::uint8_t operator()(std::string_view word) const {
+    if (word.empty())
+      return 0;
+    for (std::size_t at = slotOf(word);; at = (at + 1) % kSlots) {
+      if (words[at].empty())
+        return 0;
+      if (words[at] == word)
+        return classes[at];
+    }
+  }
+
+private:
+  static constexpr std::size_t kSlots = 256;
+
+  static constexpr std::size_t slotOf(std::string_view word) {
+    return (word.size() * 7 + static_cast<unsigned char>(word.front()) * 31 +
+            static_cast<unsigned char>(word.back())) %
+           kSlots;
+  }
+
+  template <std::size_t N>
+  constexpr void add(const std::array<std::string_view, N> &list,
+                     std::uint8_t cls) {
+    for (std::string_view word : list) {
+      std::size_t at = slotOf(word);
+      while (!words[at].empty() && words[at] != word)
+        at = (at + 1) % kSlots;
+      words[at] = word;
+      classes[at] |= cls;
+    }
+  }
+
+  std::array<std::string_view, kSlots> words{};
+  std::array<std::uint8_t, kSlots> classes{};
+};
+
+constexpr WordClasses classOf;
+
+// ASCII-only classification; std::isalnum and friends consult the locale
+bool isWordChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_';
+}
+
+bool isSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' ||
+         c == '\v';
+}
+
+std::string_view trim(std::string_view text) {
+  while (!text.empty() && isSpace(text.front()))
+    text.remove_prefix(1);
+  while (!text.empty() && isSpace(text.back()))
+    text.remove_suffix(1);
+  return text;
+}
+
+// FNV-1a of name, seeded by the scope it is declared in
+std::uint32_t hashName(std::string_view name, std::uint32_t scope) {
+  std::uint32_t h = 2166136261u ^ (scope * 0x9e3779b9u);
+  for (char c : name)
+    h = (h ^ static_cast<unsigned char>(c)) * 16777619u;
+  return h;
+}
+
+// Table size for n entries at most half full
+std::size_t slotCount(std::size_t n) {
+  std::size_t size = 16;
+  while (size < 2 * n)
+    size *= 2;
+  return size;
+}
+
+// Template argument i of args ("string, vector<int>"), trimmed
+std::string_view templateArg(std::string_view args, std::size_t i) {
+  int depth = 0;
+  std::size_t start = 0;
+  for (std::size_t pos = 0; pos <= args.size(); ++pos) {
+    char c = pos < args.size() ? args[pos] : ',';
+    if (c == '<' || c == '(' || c == '[') {
+      depth++;
+    } else if (c == '>' || c == ')' || c == ']') {
+      depth--;
+    } else if (c == ',' && depth == 0) {
+      if (i-- == 0)
+        return trim(args.substr(start, pos - start));
+      start = pos + 1;
+    }
+  }
+  return {};
+}
+
+} // namespace
+
+// One pass over the tokens: a stack of open braces, the statement being
+// read, and its parenthesis depth. Declarations are read whole at the ';'
+// that ends them, or at the '{' that opens a class, function or block.
+struct ScopeIndex::Builder {
+  ScopeIndex &index;
+  std::string_view src;
+  const std::vector<TokenView> &tokens;
+  const std::uint32_t count;
+
+  struct Frame {
+    std::uint32_t scope;     // kNone: an initializer's or enum's braces
+    std::uint32_t statement; // The enclosing statement, resumed at '}'
+    std::uint32_t depth;
+    bool resumes;            // The statement goes on after the '}'
+    std::uint32_t type;      // Class or enum: its Type symbol ("} x;")
+    std::uint32_t open;      // Token of the '{'
+    bool enumerators;        // Unscoped enum: declare its enumerators
+  };
+
+  std::vector<Frame> frames;
+  std::uint32_t scope = 0;
+  std::uint32_t statement = 0;
+  std::uint32_t depth = 0;
+  std::uint32_t trailingType = kNone;
+
+  Builder(ScopeIndex &index, const std::vector<TokenView> &tokens)
+      : index(index), src(index.text), tokens(tokens),
+        count(static_cast<std::uint32_t>(tokens.size())) {}
+
+  char punct(std::uint32_t i) const {
+    if (i >= count)
+      return 0;
+    const TokenView &t = tokens[i];
+    return (t.type == Token::Type::OPERATOR ||
+            t.type == Token::Type::PUNCTUATION)
+               ? src[t.offset]
+               : 0;
+  }
+
+  bool isWord(std::uint32_t i) const {
+    return i < count && (tokens[i].type == Token::Type::IDENTIFIER ||
+                         tokens[i].type == Token::Type::KEYWORD);
+  }
+
+  std::string_view word(std::uint32_t i) const {
+    return isWord(i) ? tokens[i].text(src) : std::string_view();
+  }
+
+  std::uint32_t endOf(std::uint32_t i) const {
+    return tokens[i].offset + tokens[i].length;
+  }
+
+  // Tokens first..last, inclusive
+  Span span(std::uint32_t first, std::uint32_t last) const {
+    if (first > last || last >= count)
+      return {};
+    return {tokens[first].offset, endOf(last) - tokens[first].offset};
+  }
+
+  // "::" starting at i
+  bool scopeOperator(std::uint32_t i) const {
+    return punct(i) == ':' && punct(i + 1) == ':' &&
+           endOf(i) == tokens[i + 1].offset;
+  }
+
+  // A lone ':' at i, not half of "::"
+  bool colon(std::uint32_t i, std::uint32_t begin) const {
+    return punct(i) == ':' && punct(i + 1) != ':' &&
+           !(i > begin && punct(i - 1) == ':');
+  }
+
+  // Past the group opened at i by '(', '[' or '{'; end if unclosed
+  std::uint32_t skipGroup(std::uint32_t i, std::uint32_t end) const {
+    const char open = punct(i);
+    const char close = open == '(' ? ')' : open == '[' ? ']' : '}';
+    int level = 0;
+    for (; i < end; ++i) {
+      char c = punct(i);
+      if (c == open) {
+        level++;
+      } else if (c == close && --level == 0) {
+        return i + 1;
+      }
+    }
+    return end;
+  }
+
+  // Past the template argument list opened by the '<' at i; kNone if it
+  // does not close before end or a statement boundary (a comparison)
+  std::uint32_t skipTemplate(std::uint32_t i, std::uint32_t end) const {
+    int level = 0;
+    for (; i < end; ++i) {
+      switch (punct(i)) {
+      case '<':
+        level++;
+        break;
+      case '>':
+        if (--level == 0)
+          return i + 1;
+        break;
+      case '(':
+      case '[':
+        i = skipGroup(i, end) - 1;
+        break;
+      case ';':
+      case '{':
+      case '}':
+        return kNone;
+      default:
+        break;
+      }
+    }
+    return kNone;
+  }
+
+  // First token of a declaration after "template <...>" and [[attributes]]
+  std::uint32_t skipPrefix(std::uint32_t i, std::uint32_t end) const {
+    while (i < end) {
+      if (word(i) == "template" && punct(i + 1) == '<') {
+        std::uint32_t past = skipTemplate(i + 1, end);
+        if (past == kNone)
+          break;
+        i = past;
+      } else if (punct(i) == '[' && punct(i + 1) == '[') {
+        i = skipGroup(i, end);
+      } else {
+        break;
+      }
+    }
+    return i;
+  }
+
+  // Past the type starting at i ("std::map<K, V>::iterator", "unsigned
+  // long", "decltype(x)"), before any "*", "&" or name; kNone if there is
+  // none
+  std::uint32_t skipType(std::uint32_t i, std::uint32_t end) const {
+    if (scopeOperator(i))
+      i += 2;
+    std::string_view w = word(i);
+    const std::uint8_t cls = classOf(w);
+    if (w.empty() || (cls & kStatement))
+      return kNone;
+    if (cls & kBuiltin) {
+      while (i < end && (classOf(word(i)) & kBuiltin))
+        i++;
+      return i;
+    }
+    if (w == "decltype")
+      return punct(i + 1) == '(' ? skipGroup(i + 1, end) : kNone;
+    while (true) {
+      i++;
+      if (i < end && punct(i) == '<') {
+        i = skipTemplate(i, end);
+        if (i == kNone)
+          return kNone;
+      }
+      if (i + 2 < end && scopeOperator(i) && isWord(i + 2)) {
+        i += 2;
+        continue;
+      }
+      return i;
+    }
+  }
+
+  std::uint32_t openScope(ScopeKind kind, std::uint32_t brace, Span name) {
+    Scope created{kind, scope, tokens[brace].offset,
+                  static_cast<std::uint32_t>(src.size() + 1), name, {}, {}};
+    index.scopeList.push_back(created);
+    scope = static_cast<std::uint32_t>(index.scopeList.size() - 1);
+    return scope;
+  }
+
+  std::uint32_t declare(SymbolKind kind, Span name, Span type, Span declaration,
+                        std::uint32_t visibleFrom) {
+    Symbol symbol{name,  type,        {},     declaration, scope,
+                  visibleFrom, kNone, kNone,  kind,        false};
+    index.symbolList.push_back(symbol);
+    return static_cast<std::uint32_t>(index.symbolList.size() - 1);
+  }
+
+  void run() {
+    for (std::uint32_t i = 0; i < count; ++i) {
+      switch (punct(i)) {
+      case '(':
+      case '[':
+        depth++;
+        break;
+      case ')':
+      case ']':
+        if (depth > 0)
+          depth--;
+        break;
+      case ';':
+        if (depth == 0) {
+          declareStatement(statement, i);
+          statement = i + 1;
+        }
+        break;
+      case ':':
+        if (depth == 0 && endsLabel(i))
+          statement = i + 1;
+        break;
+      case '{':
+        open(i);
+        break;
+      case '}':
+        close(i);
+        break;
+      default:
+        break;
+      }
+    }
+    // The statement being typed at the end of the buffer
+    if (depth == 0)
+      declareStatement(statement, count);
+  }
+
+  // "public:", "case X:", "default:" or a label ends at the ':' at i
+  bool endsLabel(std::uint32_t i) const {
+    if (!colon(i, statement) || i == statement)
+      return false;
+    std::string_view first = word(statement);
+    if (first == "case" || first == "default")
+      return true;
+    return i == statement + 1 && !first.empty() &&
+           (first == "public" || first == "private" || first == "protected" ||
+            index.scopeList[scope].kind == ScopeKind::Block ||
+            index.scopeList[scope].kind == ScopeKind::Function);
+  }
+
+  // Whether the '{' at i, after header tokens begin..i, is an initializer
+  // ("= {", "f({", "T x{", "Foo() : a{1}, b{2}") rather than a scope
+  bool initializerBrace(std::uint32_t begin, std::uint32_t i) const {
+    if (i == begin)
+      return false;
+    const std::uint32_t prev = i - 1;
+    const char c = punct(prev);
+    if (c == '=' || c == ',' || c == '(' || c == '[' || c == '{' || c == '?')
+      return true;
+    if (word(prev) == "return")
+      return true;
+    if (!isWord(prev) && c != '>')
+      return false;
+    if (classOf(word(prev)) & (kBlock | kSuffix))
+      return false;
+
+    // A member of a constructor's initializer list follows ':' or ','
+    std::uint32_t j = prev;
+    if (c == '>') {
+      int level = 0;
+      for (; j > begin; --j) {
+        if (punct(j) == '>')
+          level++;
+        else if (punct(j) == '<' && --level == 0)
+          break;
+      }
+      if (j == begin)
+        return false;
+      j--;
+    }
+    while (j >= begin + 3 && isWord(j) && scopeOperator(j - 2) &&
+           isWord(j - 3))
+      j -= 3;
+    if (j > begin && (punct(j - 1) == ',' || colon(j - 1, begin)) &&
+        findParen(begin, j) != kNone)
+      return true;
+
+    // "T x{...}" or "T{...}", unless a '(' makes it a function body
+    return findParen(begin, i) == kNone;
+  }
+
+  // First '(' at the top level of tokens begin..end
+  std::uint32_t findParen(std::uint32_t begin, std::uint32_t end) const {
+    for (std::uint32_t i = begin; i < end; ++i) {
+      char c = punct(i);
+      if (c == '(')
+        return i;
+      if (c == '[')
+        i = skipGroup(i, end) - 1;
+    }
+    return kNone;
+  }
+
+  // First of the given word at the top level of begin..end, before any '('
+  // or '='
+  std::uint32_t findKey(std::uint32_t begin, std::uint32_t end,
+                        std::initializer_list<std::string_view> keys) const {
+    for (std::uint32_t i = begin; i < end; ++i) {
+      char c = punct(i);
+      if (c == '(' || c == '=')
+        return kNone;
+      if (c == '<') {
+        std::uint32_t past = skipTemplate(i, end);
+        if (past == kNone)
+          return kNone;
+        i = past - 1;
+        continue;
+      }
+      std::string_view w = word(i);
+      if (std::find(keys.begin(), keys.end(), w) != keys.end())
+        return i;
+    }
+    return kNone;
+  }
+
+  void open(std::uint32_t i) {
+    const std::uint32_t begin = skipPrefix(statement, i);
+    Frame frame{kNone, statement, depth, false, kNone, i, false};
+    const char prev = i > begin ? punct(i - 1) : 0;
+    std::uint32_t key;
+
+    if (prev == '=' || prev == ',' || prev == '(' || prev == '[' ||
+        prev == '{' || prev == '?' || (i > begin && word(i - 1) == "return")) {
+      frame.resumes = true;
+    } else if (word(begin) == "namespace" ||
+               (word(begin) == "inline" && word(begin + 1) == "namespace")) {
+      std::uint32_t name = i - 1;
+      frame.scope = openScope(ScopeKind::Namespace, i,
+                              isWord(name) && word(name) != "namespace"
+                                  ? span(name, name)
+                                  : Span{});
+    } else if ((key = findKey(begin, i, {"enum"})) != kNone) {
+      std::uint32_t name = key + 1;
+      const bool scoped = word(name) == "class" || word(name) == "struct";
+      if (scoped)
+        name++;
+      if (isWord(name)) {
+        frame.type = declare(SymbolKind::Type, span(name, name), {},
+                             span(key, name), endOf(name));
+      }
+      frame.enumerators = !scoped && frame.type != kNone;
+    } else if ((key = findKey(begin, i, {"class", "struct", "union"})) !=
+               kNone) {
+      openClass(begin, key, i, frame);
+    } else if (initializerBrace(begin, i)) {
+      frame.resumes = true;
+    } else if (findParen(begin, i) != kNone || prev == ']') {
+      openFunction(begin, i, frame);
+    } else {
+      frame.scope = openScope(ScopeKind::Block, i, {});
+    }
+
+    frames.push_back(frame);
+    statement = i + 1;
+    depth = 0;
+  }
+
+  void openClass(std::uint32_t begin, std::uint32_t key, std::uint32_t brace,
+                 Frame &frame) {
+    std::uint32_t name = key + 1;
+    while (name < brace &&
+           (word(name) == "alignas" || (punct(name) == '[' &&
+                                        punct(name + 1) == '['))) {
+      name = word(name) == "alignas" ? skipGroup(name + 1, brace)
+                                     : skipGroup(name, brace);
+    }
+    const bool named = isWord(name) && word(name) != "final";
+    Span base;
+    for (std::uint32_t j = name; j < brace; ++j) {
+      if (!colon(j, begin))
+        continue;
+      std::uint32_t k = j + 1;
+      while (word(k) == "public" || word(k) == "private" ||
+             word(k) == "protected" || word(k) == "virtual")
+        k++;
+      // The last name of a qualified base
+      while (isWord(k) && scopeOperator(k + 1) && isWord(k + 3))
+        k += 3;
+      if (isWord(k))
+        base = span(k, k);
+      break;
+    }
+    if (named) {
+      frame.type = declare(SymbolKind::Type, span(name, name), {},
+                           span(key, name), endOf(name));
+    }
+    frame.scope = openScope(ScopeKind::Class, brace,
+                            named ? span(name, name) : Span{});
+    index.scopeList[frame.scope].base = base;
+    if (named)
+      index.symbolList[frame.type].body = frame.scope;
+  }
+
+  void openFunction(std::uint32_t begin, std::uint32_t brace, Frame &frame) {
+    // A lambda passed as an argument: its header starts after the '(' or
+    // ',' before it
+    if (depth > 0) {
+      int level = 0;
+      for (std::uint32_t j = brace; j-- > begin;) {
+        char c = punct(j);
+        if (c == ')' || c == ']' || c == '}') {
+          level++;
+        } else if (c == '(' || c == '[' || c == '{') {
+          if (level-- == 0) {
+            begin = j + 1;
+            break;
+          }
+        } else if (c == ',' && level == 0) {
+          begin = j + 1;
+          break;
+        }
+      }
+    }
+    std::uint32_t first = begin;
+    if (word(first) == "else")
+      first++;
+    std::string_view w = word(first);
+    if (w == "if" || w == "for" || w == "while" || w == "switch" ||
+        w == "catch") {
+      std::uint32_t paren = first + 1;
+      if (word(paren) == "constexpr")
+        paren++;
+      frame.scope = openScope(ScopeKind::Block, brace, {});
+      if (punct(paren) == '(')
+        declareControl(w, paren, skipGroup(paren, brace) - 1);
+      return;
+    }
+
+    // Lambda captures, then the parameters
+    std::uint32_t paren = findParen(begin, brace);
+    const bool lambda = paren == kNone || punct(paren - 1) == ']';
+    frame.resumes = lambda || depth > 0;
+    std::uint32_t close =
+        paren == kNone ? kNone : skipGroup(paren, brace) - 1;
+
+    Span name, owner;
+    std::uint32_t nameToken = kNone;
+    if (!lambda && isWord(paren - 1)) {
+      nameToken = paren - 1;
+      name = span(nameToken, nameToken);
+      std::uint32_t start = nameToken;
+      if (start > begin && punct(start - 1) == '~')
+        start--;
+      if (start >= begin + 3 && scopeOperator(start - 2) &&
+          isWord(start - 3)) {
+        owner = span(start - 3, start - 3);
+        start -= 3;
+      }
+
+      // The return type: before the name, or after "->"
+      std::uint32_t typeFirst = begin;
+      while (typeFirst < start && ((classOf(word(typeFirst)) & kSpecifier) ||
+                                   word(typeFirst) == "friend") &&
+             word(typeFirst) != "const")
+        typeFirst++;
+      Span type = span(typeFirst, start - 1);
+      for (std::uint32_t j = close + 1; j + 1 < brace; ++j) {
+        if (punct(j) == '-' && punct(j + 1) == '>') {
+          type = span(j + 2, brace - 1);
+          break;
+        }
+      }
+      // Constructors, destructors and macros have no return type
+      if (!type.empty() && owner.empty() && punct(start) != '~') {
+        declare(SymbolKind::Function, name, type, span(typeFirst, close),
+                tokens[nameToken].offset);
+      }
+    }
+
+    frame.scope = openScope(ScopeKind::Function, brace, name);
+    index.scopeList[frame.scope].owner = owner;
+    if (close == kNone)
+      return;
+    // Parameters, split at top-level commas
+    std::uint32_t start = paren + 1;
+    for (std::uint32_t j = start; j <= close; ++j) {
+      char c = punct(j);
+      if (c == '(' || c == '[' || c == '{') {
+        j = skipGroup(j, close) - 1;
+      } else if (c == '<') {
+        std::uint32_t past = skipTemplate(j, close);
+        if (past != kNone)
+          j = past - 1;
+      } else if (j == close || c == ',') {
+        declarators(start, j, SymbolKind::Parameter);
+        start = j + 1;
+      }
+    }
+  }
+
+  // The variable of "for (init; ...)", "for (x : range)", "if (init; ...)",
+  // "while (T x = ...)" or "catch (E& e)"; open..close are its parentheses
+  void declareControl(std::string_view keyword, std::uint32_t open,
+                      std::uint32_t close) {
+    std::uint32_t split = kNone;
+    bool range = false;
+    for (std::uint32_t j = open + 1; j < close; ++j) {
+      char c = punct(j);
+      if (c == '(' || c == '[' || c == '{') {
+        j = skipGroup(j, close) - 1;
+      } else if (c == ';') {
+        split = j;
+        break;
+      } else if (keyword == "for" && colon(j, open)) {
+        split = j;
+        range = true;
+        break;
+      }
+    }
+    if (range) {
+      declarators(open + 1, split, SymbolKind::Variable, {}, true,
+                  span(split + 1, close - 1));
+    } else if (split != kNone) {
+      declarators(open + 1, split, SymbolKind::Variable);
+    } else if (keyword != "for") {
+      declarators(open + 1, close,
+                  keyword == "catch" ? SymbolKind::Parameter
+                                     : SymbolKind::Variable);
+    }
+  }
+
+  void close(std::uint32_t i) {
+    if (frames.empty())
+      return;
+    Frame frame = frames.back();
+    frames.pop_back();
+    if (frame.scope != kNone) {
+      index.scopeList[frame.scope].end = endOf(i);
+      scope = index.scopeList[frame.scope].parent;
+    }
+    if (frame.enumerators) {
+      const Span type = index.symbolList[frame.type].name;
+      for (std::uint32_t j = frame.open + 1; j < i; ++j) {
+        char c = punct(j - 1);
+        if (isWord(j) && (c == '{' || c == ','))
+          declare(SymbolKind::Variable, span(j, j), type, span(j, j), endOf(j));
+      }
+    }
+    depth = frame.depth;
+    if (frame.resumes) {
+      statement = frame.statement;
+    } else {
+      statement = i + 1;
+      trailingType = frame.type;
+    }
+  }
+
+  void declareStatement(std::uint32_t begin, std::uint32_t end) {
+    const std::uint32_t trailing = trailingType;
+    trailingType = kNone;
+    begin = skipPrefix(begin, end);
+    if (begin >= end)
+      return;
+
+    // "struct P { ... } p, q;"
+    if (trailing != kNone) {
+      declarators(begin, end, fieldOrVariable(),
+                  index.symbolList[trailing].name);
+      return;
+    }
+
+    std::string_view first = word(begin);
+    if (first == "using") {
+      if (isWord(begin + 1) && punct(begin + 2) == '=' && begin + 3 < end) {
+        declare(SymbolKind::Alias, span(begin + 1, begin + 1),
+                span(begin + 3, end - 1), span(begin, end - 1),
+                endOf(begin + 1));
+      }
+      return;
+    }
+    if (first == "typedef") {
+      std::uint32_t name = end - 1;
+      if (isWord(name) && name > begin + 1) {
+        declare(SymbolKind::Alias, span(name, name), span(begin + 1, name - 1),
+                span(begin, name), endOf(name));
+      }
+      return;
+    }
+    if (first == "friend")
+      return;
+    declarators(begin, end, fieldOrVariable());
+  }
+
+  SymbolKind fieldOrVariable() const {
+    return index.scopeList[scope].kind == ScopeKind::Class
+               ? SymbolKind::Field
+               : SymbolKind::Variable;
+  }
+
+  // "T x(...)" at namespace or class scope declares a function when the
+  // parentheses hold parameters rather than arguments
+  bool prototype(std::uint32_t open, std::uint32_t close) const {
+    ScopeKind kind = index.scopeList[scope].kind;
+    if (kind == ScopeKind::Block || kind == ScopeKind::Function)
+      return false;
+    std::uint32_t first = open + 1;
+    if (first >= close)
+      return true;
+    if (tokens[first].type == Token::Type::KEYWORD)
+      return true;
+    if (!isWord(first))
+      return false;
+    char next = punct(first + 1);
+    return isWord(first + 1) || next == '*' || next == '&' || next == '<' ||
+           next == ':';
+  }
+
+  // The declarators of "T a = 1, *b, c[4]" in begin..end. type, if given,
+  // is the type and the tokens start at the first declarator. Nothing is
+  // declared unless the first declarator parses, so expressions ("x = 1",
+  // "f(x)", "cout << x") declare nothing.
+  void declarators(std::uint32_t begin, std::uint32_t end, SymbolKind kind,
+                   Span type = {}, bool element = false, Span range = {}) {
+    std::uint32_t i = begin;
+    while (i < end && (classOf(word(i)) & kSpecifier))
+      i++;
+    const std::uint32_t typeFirst = i;
+    if (type.empty()) {
+      std::uint32_t past = skipType(i, end);
+      if (past == kNone || past >= end)
+        return;
+      type = span(i, past - 1);
+      i = past;
+    }
+
+    for (bool first = true; i < end; first = false) {
+      const std::uint32_t declaratorFirst = i;
+      while (i < end && (punct(i) == '*' || punct(i) == '&' ||
+                         word(i) == "const" || word(i) == "volatile"))
+        i++;
+      if (i >= end)
+        return;
+      if (first && punct(i) == '[' && word(declaratorFirst - 1) == "auto") {
+        declareBindings(i, end);
+        return;
+      }
+      if (!isWord(i) || (classOf(word(i)) & kStatement))
+        return;
+
+      const std::uint32_t name = i++;
+      Symbol symbol{span(name, name),
+                    first && declaratorFirst > typeFirst
+                        ? span(typeFirst, name - 1)
+                        : type,
+                    range,
+                    span(first ? typeFirst : declaratorFirst, name),
+                    scope,
+                    endOf(name),
+                    kNone,
+                    kNone,
+                    kind,
+                    element};
+
+      if (punct(i) == '(' && i < end) {
+        std::uint32_t past = skipGroup(i, end);
+        if (kind != SymbolKind::Parameter && prototype(i, past - 1)) {
+          symbol.kind = SymbolKind::Function;
+          symbol.declaration = span(typeFirst, past - 1);
+          symbol.visibleFrom = tokens[name].offset;
+          index.symbolList.push_back(symbol);
+          return;
+        }
+        i = past;
+      } else if (punct(i) == '{' && i < end) {
+        i = skipGroup(i, end);
+      }
+      while (punct(i) == '[' && i < end)
+        i = skipGroup(i, end);
+      if (i < end && colon(i, begin) && kind == SymbolKind::Field) {
+        while (i < end && punct(i) != ',')
+          i++;
+      }
+      if (i < end && punct(i) == '=') {
+        std::uint32_t init = ++i;
+        for (; i < end && punct(i) != ','; ++i) {
+          char c = punct(i);
+          if (c == '(' || c == '[' || c == '{')
+            i = skipGroup(i, end) - 1;
+        }
+        if (init < i)
+          symbol.init = span(init, i - 1);
+      }
+      if (i < end && punct(i) != ',')
+        return; // Not a declarator: an expression
+      index.symbolList.push_back(symbol);
+      if (kind == SymbolKind::Parameter)
+        return;
+      i++;
+    }
+  }
+
+  // "auto [a, b] = ...": names without a type
+  void declareBindings(std::uint32_t open, std::uint32_t end) {
+    std::uint32_t close = skipGroup(open, end) - 1;
+    for (std::uint32_t j = open + 1; j < close; ++j) {
+      if (isWord(j))
+        declare(SymbolKind::Variable, span(j, j), {}, span(j, j), endOf(j));
+    }
+  }
+};
+
+void ScopeIndex::clear() {
+  text = {};
+  scopeList.clear();
+  symbolList.clear();
+  byScope.clear();
+  slots.clear();
+  typeSlots.clear();
+}
+
+void ScopeIndex::buildCopy(std::string_view source) {
+  copy.assign(source);
+  build(copy);
+}
+
+void ScopeIndex::build(std::string_view source) {
+  static const Tokenizer tokenizer;
+  thread_local std::vector<TokenView> tokens;
+
+  clear();
+  text = source;
+  tokenizer.scan(source, tokens);
+  // Comments and directives play no part in scopes
+  tokens.erase(std::remove_if(tokens.begin(), tokens.end(),
+                              [](const TokenView &t) {
+                                return t.type == Token::Type::COMMENT ||
+                                       t.type == Token::Type::PREPROCESSOR;
+                              }),
+               tokens.end());
+
+  scopeList.push_back({ScopeKind::File, kNone, 0,
+                       static_cast<std::uint32_t>(source.size() + 1), {}, {},
+                       {}});
+  Builder builder(*this, tokens);
+  builder.run();
+
+  // Symbols grouped by scope, in source order within each (counting sort)
+  for (const Symbol &symbol : symbolList)
+    scopeList[symbol.scope].symbolCount++;
+  std::uint32_t next = 0;
+  for (Scope &scope : scopeList) {
+    scope.firstSymbol = next;
+    next += scope.symbolCount;
+    scope.symbolCount = 0;
+  }
+  byScope.resize(symbolList.size());
+  for (std::uint32_t i = 0; i < symbolList.size(); ++i) {
+    Scope &scope = scopeList[symbolList[i].scope];
+    byScope[scope.firstSymbol + scope.symbolCount++] = i;
+  }
+
+  // (scope, name) -> latest declaration, which links to earlier ones; and
+  // type names regardless of scope, for types named from elsewhere
+  slots.assign(slotCount(symbolList.size()), kNone);
+  std::size_t types = 0;
+  for (const Symbol &symbol : symbolList)
+    types += symbol.kind == SymbolKind::Type || symbol.kind == SymbolKind::Alias;
+  typeSlots.assign(slotCount(types), kNone);
+  for (std::uint32_t i = 0; i < symbolList.size(); ++i) {
+    Symbol &symbol = symbolList[i];
+    std::string_view name = view(symbol.name);
+    std::uint32_t &head = slot(slots, symbol.scope, name, true);
+    symbol.shadowed = head;
+    head = i;
+    if (symbol.kind == SymbolKind::Type || symbol.kind == SymbolKind::Alias)
+      slot(typeSlots, kNone, name, false) = i;
+  }
+}
+
+std::uint32_t &ScopeIndex::slot(std::vector<std::uint32_t> &table,
+                                std::uint32_t scope, std::string_view name,
+                                bool scoped) {
+  const std::size_t mask = table.size() - 1;
+  std::size_t at = hashName(name, scope) & mask;
+  while (table[at] != kNone) {
+    const Symbol &symbol = symbolList[table[at]];
+    if ((!scoped || symbol.scope == scope) && view(symbol.name) == name)
+      break;
+    at = (at + 1) & mask;
+  }
+  return table[at];
+}
+
+std::uint32_t ScopeIndex::head(const std::vector<std::uint32_t> &table,
+                               std::uint32_t scope, std::string_view name,
+                               bool scoped) const {
+  if (table.empty())
+    return kNone;
+  const std::size_t mask = table.size() - 1;
+  for (std::size_t at = hashName(name, scope) & mask; table[at] != kNone;
+       at = (at + 1) & mask) {
+    const Symbol &symbol = symbolList[table[at]];
+    if ((!scoped || symbol.scope == scope) && view(symbol.name) == name)
+      return table[at];
+  }
+  return kNone;
+}
+
+std::span<const std::uint32_t> ScopeIndex::symbolsIn(std::uint32_t scope) const {
+  const Scope &s = scopeList[scope];
+  return {byScope.data() + s.firstSymbol, s.symbolCount};
+}
+
+std::uint32_t ScopeIndex::scopeAt(std::size_t offset) const {
+  if (scopeList.empty())
+    return kNone;
+  // The last scope opened before offset, or one around it
+  auto after = std::partition_point(
+      scopeList.begin(), scopeList.end(),
+      [offset](const Scope &s) { return s.begin < offset; });
+  std::uint32_t scope =
+      after == scopeList.begin()
+          ? 0
+          : static_cast<std::uint32_t>(after - scopeList.begin() - 1);
+  while (scope != 0 && offset >= scopeList[scope].end)
+    scope = scopeList[scope].parent;
+  return scope;
+}
+
+const ScopeIndex::Symbol *ScopeIndex::find(std::uint32_t scope,
+                                           std::string_view name,
+                                           std::size_t offset) const {
+  // Class members are visible throughout the class
+  const bool anywhere = scopeList[scope].kind == ScopeKind::Class;
+  for (std::uint32_t at = head(slots, scope, name, true); at != kNone;
+       at = symbolList[at].shadowed) {
+    if (anywhere || symbolList[at].visibleFrom <= offset)
+      return &symbolList[at];
+  }
+  return nullptr;
+}
+
+const ScopeIndex::Symbol *ScopeIndex::typeNamed(std::string_view name,
+                                                std::size_t offset) const {
+  for (std::uint32_t s = scopeAt(offset); s != kNone; s = scopeList[s].parent) {
+    const Symbol *symbol = find(s, name, offset);
+    if (symbol &&
+        (symbol->kind == SymbolKind::Type || symbol->kind == SymbolKind::Alias))
+      return symbol;
+  }
+  // Declared in another namespace or class, or later on
+  std::uint32_t any = head(typeSlots, kNone, name, false);
+  return any == kNone ? nullptr : &symbolList[any];
+}
+
+const ScopeIndex::Symbol *ScopeIndex::lookup(std::string_view name,
+                                             std::size_t offset) const {
+  for (std::uint32_t s = scopeAt(offset); s != kNone; s = scopeList[s].parent) {
+    const Scope &scope = scopeList[s];
+    if (scope.kind == ScopeKind::Class) {
+      if (const Symbol *symbol = member(s, name))
+        return symbol;
+      continue;
+    }
+    if (const Symbol *symbol = find(s, name, offset))
+      return symbol;
+    // "Point::norm() {" sees Point's members
+    if (scope.kind == ScopeKind::Function && !scope.owner.empty()) {
+      const Symbol *owner = typeNamed(view(scope.owner), scope.begin);
+      if (owner && owner->body != kNone) {
+        if (const Symbol *symbol = member(owner->body, name))
+          return symbol;
+      }
+    }
+  }
+  return nullptr;
+}
+
+const ScopeIndex::Symbol *ScopeIndex::member(std::uint32_t classScope,
+                                             std::string_view name) const {
+  for (int depth = 0; classScope != kNone && depth < kMaxDepth; ++depth) {
+    if (const Symbol *symbol = find(classScope, name, 0))
+      return symbol;
+    classScope = baseOf(classScope);
+  }
+  return nullptr;
+}
+
+std::uint32_t ScopeIndex::baseOf(std::uint32_t classScope) const {
+  const Scope &scope = scopeList[classScope];
+  if (scope.base.empty())
+    return kNone;
+  const Symbol *base = typeNamed(view(scope.base), scope.begin);
+  return base ? base->body : kNone;
+}
+
+std::uint32_t ScopeIndex::classAt(std::size_t offset) const {
+  for (std::uint32_t s = scopeAt(offset); s != kNone; s = scopeList[s].parent) {
+    const Scope &scope = scopeList[s];
+    if (scope.kind == ScopeKind::Class)
+      return s;
+    if (scope.kind == ScopeKind::Function && !scope.owner.empty()) {
+      const Symbol *owner = typeNamed(view(scope.owner), scope.begin);
+      return owner ? owner->body : kNone;
+    }
+  }
+  return kNone;
+}
+
+ScopeIndex::Type ScopeIndex::parseType(std::string_view text) {
+  Type type;
+  text = trim(text);
+  // Leading specifiers
+  while (true) {
+    std::size_t end = 0;
+    while (end < text.size() && isWordChar(text[end]))
+      end++;
+    std::string_view first = text.substr(0, end);
+    if (end == 0 || end == text.size() ||
+        !((classOf(first) & kSpecifier) || first == "friend"))
+      break;
+    text = trim(text.substr(end));
+  }
+  // Trailing declarator parts
+  while (!text.empty()) {
+    char c = text.back();
+    if (c == '*' || c == '&' || isSpace(c)) {
+      type.pointer |= c == '*';
+      text.remove_suffix(1);
+    } else if (text.ends_with("const") &&
+               (text.size() == 5 || !isWordChar(text[text.size() - 6]))) {
+      text.remove_suffix(5);
+    } else {
+      break;
+    }
+  }
+  // The last component outside template arguments
+  int depth = 0;
+  std::size_t start = 0;
+  for (std::size_t i = 0; i + 1 < text.size(); ++i) {
+    if (text[i] == '<') {
+      depth++;
+    } else if (text[i] == '>') {
+      depth--;
+    } else if (depth == 0 && text[i] == ':' && text[i + 1] == ':') {
+      start = i + 2;
+      i++;
+    }
+  }
+  text = trim(text.substr(start));
+  std::size_t end = 0;
+  while (end < text.size() && isWordChar(text[end]))
+    end++;
+  type.name = text.substr(0, end);
+  std::string_view rest = trim(text.substr(end));
+  if (rest.starts_with('<') && rest.ends_with('>'))
+    type.args = trim(rest.substr(1, rest.size() - 2));
+  return type;
+}
+
+ScopeIndex::Type ScopeIndex::elementOf(const Type &container, bool subscript) {
+  if (isOneOf(kStringTypes, container.name))
+    return {"char", {}};
+  if (isOneOf(kMapTypes, container.name)) {
+    return subscript ? parseType(templateArg(container.args, 1))
+                     : Type{"pair", container.args};
+  }
+  if (isOneOf(kSequenceTypes, container.name))
+    return parseType(templateArg(container.args, 0));
+  if (container.pointer) {
+    Type pointee = container;
+    pointee.pointer = false;
+    return pointee;
+  }
+  return {};
+}
+
+ScopeIndex::Type ScopeIndex::canonical(Type type, std::size_t offset,
+                                       int depth) const {
+  if (!type.known() || depth > kMaxDepth)
+    return type;
+  const Symbol *symbol = typeNamed(type.name, offset);
+  if (!symbol)
+    return type;
+  if (symbol->kind == SymbolKind::Type) {
+    type.classScope = symbol->body;
+    return type;
+  }
+  Type target =
+      canonical(parseType(view(symbol->type)), symbol->visibleFrom, depth + 1);
+  target.pointer |= type.pointer;
+  return target;
+}
+
+ScopeIndex::Type ScopeIndex::typeOfSymbol(const Symbol &symbol,
+                                          int depth) const {
+  if (depth > kMaxDepth)
+    return {};
+  switch (symbol.kind) {
+  case SymbolKind::Type:
+    return {view(symbol.name), {}, symbol.body};
+  case SymbolKind::Alias:
+    return canonical(parseType(view(symbol.type)), symbol.visibleFrom,
+                     depth + 1);
+  case SymbolKind::Function:
+    return {};
+  default:
+    break;
+  }
+  Type written = parseType(view(symbol.type));
+  if (written.known() && written.name != "auto" && written.name != "decltype")
+    return canonical(written, symbol.visibleFrom, depth + 1);
+  if (symbol.init.empty())
+    return {};
+  Type deduced = resolve(view(symbol.init), symbol.visibleFrom, depth + 1);
+  if (symbol.element)
+    return canonical(elementOf(deduced, false), symbol.visibleFrom, depth + 1);
+  return deduced;
+}
+
+ScopeIndex::Type ScopeIndex::memberType(const Type &object,
+                                        std::string_view name, bool call,
+                                        std::size_t offset, int depth) const {
+  if (depth > kMaxDepth)
+    return {};
+  if (object.classScope != kNone) {
+    const Symbol *symbol = member(object.classScope, name);
+    if (!symbol)
+      return {};
+    if (symbol->kind == SymbolKind::Function) {
+      return call ? canonical(parseType(view(symbol->type)),
+                              symbol->visibleFrom, depth + 1)
+                  : Type{};
+    }
+    return typeOfSymbol(*symbol, depth + 1);
+  }
+  if (object.name == "pair" && !call && (name == "first" || name == "second"))
+    return canonical(parseType(templateArg(object.args, name == "second")),
+                     offset, depth + 1);
+  if (call && (name == "front" || name == "back" || name == "top" ||
+               name == "at"))
+    return canonical(elementOf(object, name == "at"), offset, depth + 1);
+  // Iterators behave as pointers to the element ("it->second")
+  if (call && isOneOf(kIteratorCalls, name)) {
+    Type element = canonical(elementOf(object, false), offset, depth + 1);
+    element.pointer = element.known();
+    return element;
+  }
+  if (call && name == "value" && object.name == "optional")
+    return canonical(parseType(templateArg(object.args, 0)), offset, depth + 1);
+  return {};
+}
+
+ScopeIndex::Type ScopeIndex::typeOf(std::string_view expression,
+                                    std::size_t offset) const {
+  return resolve(expression, offset, 0);
+}
+
+ScopeIndex::Type ScopeIndex::resolve(std::string_view e, std::size_t offset,
+                                     int depth) const {
+  if (depth > kMaxDepth || scopeList.empty())
+    return {};
+  std::size_t pos = 0;
+  auto skipSpaces = [&] {
+    while (pos < e.size() && isSpace(e[pos]))
+      pos++;
+  };
+  auto identifier = [&] {
+    std::size_t start = pos;
+    while (pos < e.size() && isWordChar(e[pos]))
+      pos++;
+    return e.substr(start, pos - start);
+  };
+  // Past the group opened at pos; false if it is not closed
+  auto skipGroup = [&](char open, char close) {
+    int level = 0;
+    for (; pos < e.size(); ++pos) {
+      if (e[pos] == open) {
+        level++;
+      } else if (e[pos] == close && --level == 0) {
+        pos++;
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // The primary: a name, qualified or with template arguments
+  std::string_view name, args;
+  skipSpaces();
+  while (true) {
+    name = identifier();
+    if (name.empty() || (name[0] >= '0' && name[0] <= '9'))
+      return {};
+    skipSpaces();
+    args = {};
+    if (pos < e.size() && e[pos] == '<') {
+      std::size_t open = pos;
+      if (skipGroup('<', '>'))
+        args = trim(e.substr(open + 1, pos - open - 2));
+      else
+        pos = open;
+      skipSpaces();
+    }
+    if (e.substr(pos, 2) != "::")
+      break;
+    pos += 2;
+    skipSpaces();
+  }
+
+  Type type;
+  if (pos < e.size() && (e[pos] == '(' || e[pos] == '{')) {
+    if (!skipGroup(e[pos], e[pos] == '(' ? ')' : '}'))
+      return {};
+    const Symbol *symbol = args.empty() ? lookup(name, offset) : nullptr;
+    if (name == "make_unique" || name == "make_shared") {
+      type = {name == "make_unique" ? "unique_ptr" : "shared_ptr", args};
+    } else if (symbol && symbol->kind == SymbolKind::Function) {
+      type = canonical(parseType(view(symbol->type)), symbol->visibleFrom,
+                       depth + 1);
+    } else if (symbol && symbol->kind != SymbolKind::Type &&
+               symbol->kind != SymbolKind::Alias) {
+      return {}; // A callable object
+    } else {
+      type = canonical({name, args}, offset, depth + 1); // A construction
+    }
+  } else if (name == "this") {
+    std::uint32_t cls = classAt(offset);
+    if (cls == kNone)
+      return {};
+    type = {view(scopeList[cls].name), {}, cls, true};
+  } else {
+    const Symbol *symbol = lookup(name, offset);
+    if (!symbol)
+      return {};
+    type = typeOfSymbol(*symbol, depth + 1);
+  }
+
+  // Member accesses and subscripts
+  while (true) {
+    skipSpaces();
+    if (pos >= e.size() || !type.known())
+      return type;
+    if (e[pos] == '[') {
+      if (!skipGroup('[', ']'))
+        return {};
+      type = canonical(elementOf(type, true), offset, depth + 1);
+      continue;
+    }
+    const bool arrow = e.substr(pos, 2) == "->";
+    if (e[pos] != '.' && !arrow)
+      return {}; // An operator: not a chain this resolves
+    pos += arrow ? 2 : 1;
+    if (arrow && type.pointer) {
+      type.pointer = false;
+    } else if (arrow && (type.name == "unique_ptr" ||
+                         type.name == "shared_ptr" ||
+                         type.name == "weak_ptr" || type.name == "optional")) {
+      type = canonical(parseType(templateArg(type.args, 0)), offset, depth + 1);
+    }
+    skipSpaces();
+    std::string_view member = identifier();
+    if (member.empty())
+      return {};
+    skipSpaces();
+    const bool call = pos < e.size() && e[pos] == '(';
+    if (call && !skipGroup('(', ')'))
+      return {};
+    type = memberType(type, member, call, offset, depth + 1);
+  }
+}
+
+std::string_view ScopeIndex::memberObject(std::string_view code,
+                                          std::size_t cursor) {
+  std::size_t i = std::min(cursor, code.size());
+  while (i > 0 && isWordChar(code[i - 1]))
+    i--;
+  while (i > 0 && isSpace(code[i - 1]))
+    i--;
+  if (i > 0 && code[i - 1] == '.') {
+    i--;
+  } else if (i > 1 && code[i - 2] == '-' && code[i - 1] == '>') {
+    i -= 2;
+  } else {
+    return {};
+  }
+  const std::size_t end = i;
+
+  // Back over calls, subscripts, names and the operators between them
+  while (i > 0) {
+    char c = code[i - 1];
+    if (c == ')' || c == ']') {
+      const char open = c == ')' ? '(' : '[';
+      int level = 0;
+      while (i > 0) {
+        char d = code[--i];
+        if (d == c) {
+          level++;
+        } else if (d == open && --level == 0) {
+          break;
+        }
+      }
+      if (level != 0)
+        return {};
+      continue;
+    }
+    if (!isWordChar(c))
+      break;
+    while (i > 0 && isWordChar(code[i - 1]))
+      i--;
+    if (i > 0 && code[i - 1] == '.') {
+      i--;
+    } else if (i > 1 && ((code[i - 2] == '-' && code[i - 1] == '>') ||
+                         (code[i - 2] == ':' && code[i - 1] == ':'))) {
+      i -= 2;
+    } else {
+      break;
+    }
+  }
+  return trim(code.substr(i, end - i));
+}
+
+std::size_t ScopeIndex::memoryUsage() const {
+  return sizeof(ScopeIndex) + copy.capacity() +
+         scopeList.capacity() * sizeof(Scope) +
+         symbolList.capacity() * sizeof(Symbol) +
+         (byScope.capacity() + slots.capacity() + typeSlots.capacity()) *
+             sizeof(std::uint32_t);
+}
+
+} // namespace codeflow
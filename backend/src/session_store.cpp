@@ -0,0 +1,115 @@
+#include "../include/session_store.h"
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace codeflow {
+
+namespace {
+
+// Fixed cost of a session beyond its document
+constexpr std::size_t kSessionOverhead = 128;
+
+} // namespace
+
+SessionStore::SessionStore(std::size_t budgetBytes)
+    : budgetBytes(budgetBytes) {}
+
+long long SessionStore::now() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+SessionId SessionStore::open() {
+  auto session = std::make_shared<Session>();
+  session->bytes = kSessionOverhead + session->usage.memoryUsage() +
+                   session->document.memoryUsage();
+  session->lastUsed = now();
+
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  SessionId id = nextId++;
+  totalBytes += session->bytes;
+  entries.emplace(id, std::move(session));
+  evictOverBudget(id);
+  return id;
+}
+
+bool SessionStore::close(SessionId id) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  auto it = entries.find(id);
+  if (it == entries.end())
+    return false;
+  totalBytes -= it->second->bytes;
+  entries.erase(it);
+  return true;
+}
+
+bool SessionStore::contains(SessionId id) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return entries.count(id) > 0;
+}
+
+std::shared_ptr<Session> SessionStore::find(SessionId id) const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  auto it = entries.find(id);
+  if (it == entries.end())
+    return nullptr;
+  it->second->lastUsed.store(now(), std::memory_order_relaxed);
+  return it->second;
+}
+
+bool SessionStore::recordUse(SessionId id, std::string_view name,
+                             std::uint32_t at) {
+  auto session = find(id);
+  if (!session)
+    return false;
+  session->usage.record(name, at);
+  return true;
+}
+
+void SessionStore::account(SessionId id, Session &session, std::size_t bytes) {
+  bytes += kSessionOverhead + session.usage.memoryUsage();
+
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  auto it = entries.find(id);
+  if (it == entries.end() || it->second.get() != &session)
+    return; // Closed or evicted while it was being edited
+  totalBytes = totalBytes - session.bytes + bytes;
+  session.bytes = bytes;
+  evictOverBudget(id);
+}
+
+void SessionStore::setBudget(std::size_t budget) {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+  budgetBytes = budget;
+  evictOverBudget(0);
+}
+
+SessionStats SessionStore::stats() const {
+  std::shared_lock<std::shared_mutex> lock(mutex);
+  return {entries.size(), totalBytes, budgetBytes, evictions};
+}
+
+void SessionStore::evictOverBudget(SessionId keep) {
+  if (totalBytes <= budgetBytes)
+    return;
+
+  // Oldest first; the session being touched is never a victim
+  std::vector<std::pair<long long, SessionId>> idle;
+  idle.reserve(entries.size());
+  for (const auto &[id, session] : entries) {
+    if (id != keep)
+      idle.emplace_back(session->lastUsed.load(std::memory_order_relaxed), id);
+  }
+  std::sort(idle.begin(), idle.end());
+
+  for (const auto &[lastUsed, id] : idle) {
+    if (totalBytes <= budgetBytes)
+      break;
+    auto it = entries.find(id);
+    totalBytes -= it->second->bytes;
+    entries.erase(it);
+    evictions++;
+  }
+}
+
+} // namespace codeflow
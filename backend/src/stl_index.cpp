@@ -0,0 +1,378 @@
+#include "../include/stl_index.h"
+#include "../include/json.h"
+#include <algorithm>
+
+namespace codeflow {
+
+namespace {
+
+SymbolId internOrNone(std::string_view text) {
+  return text.empty() ? kNoSymbol : SymbolPool::global().intern(text);
+}
+
+std::string_view viewOf(SymbolId id) {
+  return id == kNoSymbol ? std::string_view() : SymbolPool::global().view(id);
+}
+
+template <typename T>
+void rebase(std::vector<T> &column, SymbolId base, SymbolId T::*first,
+            SymbolId T::*second) {
+  for (T &row : column) {
+    if (row.*first != kNoSymbol)
+      row.*first += base;
+    if (row.*second != kNoSymbol)
+      row.*second += base;
+  }
+}
+
+void addOrReplace(std::vector<CatalogItem> &items, std::string_view text,
+                  std::string_view sig, std::string_view doc,
+                  std::string_view kind) {
+  CatalogItem next{internOrNone(text), internOrNone(sig), internOrNone(doc),
+                   internOrNone(kind)};
+  auto same = std::find_if(items.begin(), items.end(), [&](const CatalogItem &i) {
+    return i.text == next.text && i.kind == next.kind;
+  });
+  if (same != items.end())
+    *same = next;
+  else
+    items.push_back(next);
+}
+
+void rebase(std::vector<SymbolId> &column, SymbolId base) {
+  for (SymbolId &id : column) {
+    if (id != kNoSymbol)
+      id += base;
+  }
+}
+
+} // namespace
+
+const CatalogType *StlCatalog::findType(std::string_view name) const {
+  const CatalogType *first = typeTable.begin();
+  const CatalogType *last = typeTable.end();
+  const CatalogType *it =
+      std::lower_bound(first, last, name, [this](const CatalogType &t,
+                                                 std::string_view key) {
+        return viewOf(typeName(t)) < key;
+      });
+  return it != last && viewOf(typeName(*it)) == name ? it : nullptr;
+}
+
+void StlCatalog::makeEditable() {
+  if (!typeTable.isViewed())
+    return;
+  // Owned columns hold absolute symbol ids
+  for (CatalogType &type : typeTable.edit()) {
+    type.name = resolve(type.name);
+    type.header = resolve(type.header);
+    type.description = resolve(type.description);
+  }
+  rebase(methodNames.edit(), base);
+  rebase(methodSigs.edit(), base);
+  rebase(methodDocs.edit(), base);
+  rebase(methodComplexities.edit(), base);
+  rebase(headerList.edit(), base);
+  for (CatalogItem &item : itemList.edit()) {
+    item = resolve(item);
+  }
+  for (CatalogItem &item : templateArgList.edit()) {
+    item = resolve(item);
+  }
+  rebase(headerContainerList.edit(), base, &SymbolPair::first,
+         &SymbolPair::second);
+  rebase(typeKeyList.edit(), base, &SymbolPair::first, &SymbolPair::second);
+  base = 0;
+}
+
+void StlCatalog::mergeType(std::string_view name, std::string_view header,
+                           std::string_view description,
+                           const std::vector<MethodRecord> &methods) {
+  makeEditable();
+  auto &types = typeTable.edit();
+  auto &names = methodNames.edit();
+  auto &sigs = methodSigs.edit();
+  auto &docs = methodDocs.edit();
+  auto &complexities = methodComplexities.edit();
+
+  auto it = std::lower_bound(types.begin(), types.end(), name,
+                             [](const CatalogType &t, std::string_view key) {
+                               return viewOf(t.name) < key;
+                             });
+  if (it == types.end() || viewOf(it->name) != name) {
+    SymbolId nameId = SymbolPool::global().intern(name);
+    it = types.insert(it, {nameId, nameId, kNoSymbol,
+                           static_cast<std::uint32_t>(names.size()), 0});
+  }
+  if (!header.empty())
+    it->header = SymbolPool::global().intern(header);
+  if (!description.empty())
+    it->description = SymbolPool::global().intern(description);
+
+  for (const MethodRecord &method : methods) {
+    SymbolId nameId = SymbolPool::global().intern(method.name);
+    auto rowsBegin = names.begin() + it->firstMethod;
+    auto rowsEnd = rowsBegin + it->methodCount;
+    std::size_t row = std::find(rowsBegin, rowsEnd, nameId) - names.begin();
+
+    if (row == it->firstMethod + it->methodCount) {
+      // Append to this type's rows and shift the rows of later types
+      names.insert(names.begin() + row, nameId);
+      sigs.insert(sigs.begin() + row, kNoSymbol);
+      docs.insert(docs.begin() + row, kNoSymbol);
+      complexities.insert(complexities.begin() + row, kNoSymbol);
+      for (CatalogType &other : types) {
+        if (&other != &*it && other.firstMethod >= row)
+          other.firstMethod++;
+      }
+      it->methodCount++;
+    }
+    if (!method.sig.empty())
+      sigs[row] = internOrNone(method.sig);
+    if (!method.doc.empty())
+      docs[row] = internOrNone(method.doc);
+    if (!method.complexity.empty())
+      complexities[row] = internOrNone(method.complexity);
+  }
+}
+
+void StlCatalog::addHeader(std::string_view header) {
+  makeEditable();
+  SymbolId id = SymbolPool::global().intern(header);
+  auto &headers = headerList.edit();
+  if (std::find(headers.begin(), headers.end(), id) == headers.end())
+    headers.push_back(id);
+}
+
+void StlCatalog::addItem(std::string_view text, std::string_view sig,
+                         std::string_view doc, std::string_view kind) {
+  makeEditable();
+  addOrReplace(itemList.edit(), text, sig, doc, kind);
+}
+
+void StlCatalog::addTemplateArg(std::string_view text, std::string_view sig,
+                                std::string_view doc, std::string_view kind) {
+  makeEditable();
+  addOrReplace(templateArgList.edit(), text, sig, doc, kind);
+}
+
+void StlCatalog::addHeaderContainer(std::string_view header,
+                                    std::string_view container) {
+  makeEditable();
+  SymbolPair pair{SymbolPool::global().intern(header),
+                  SymbolPool::global().intern(container)};
+  auto &pairs = headerContainerList.edit();
+  if (std::none_of(pairs.begin(), pairs.end(), [&](const SymbolPair &p) {
+        return p.first == pair.first && p.second == pair.second;
+      }))
+    pairs.push_back(pair);
+}
+
+void StlCatalog::addTypeKey(std::string_view type, std::string_view key) {
+  makeEditable();
+  SymbolPair pair{SymbolPool::global().intern(type),
+                  SymbolPool::global().intern(key)};
+  auto &pairs = typeKeyList.edit();
+  auto same = std::find_if(pairs.begin(), pairs.end(), [&](const SymbolPair &p) {
+    return p.first == pair.first;
+  });
+  if (same != pairs.end())
+    *same = pair;
+  else
+    pairs.push_back(pair);
+}
+
+StlCatalog::Columns StlCatalog::columns() const {
+  auto span = [](const auto &column) {
+    return std::span(column.data(), column.size());
+  };
+  return {span(typeTable),
+          span(methodNames),
+          span(methodSigs),
+          span(methodDocs),
+          span(methodComplexities),
+          span(headerList),
+          span(itemList),
+          span(templateArgList),
+          span(headerContainerList),
+          span(typeKeyList)};
+}
+
+void StlCatalog::view(const Columns &external, SymbolId symbolBase) {
+  typeTable.view(external.types);
+  methodNames.view(external.names);
+  methodSigs.view(external.sigs);
+  methodDocs.view(external.docs);
+  methodComplexities.view(external.complexities);
+  headerList.view(external.headers);
+  itemList.view(external.items);
+  templateArgList.view(external.templateArgs);
+  headerContainerList.view(external.headerContainers);
+  typeKeyList.view(external.typeKeys);
+  base = symbolBase;
+}
+
+std::size_t StlCatalog::memoryUsage() const {
+  return typeTable.memoryUsage() + methodNames.memoryUsage() +
+         methodSigs.memoryUsage() + methodDocs.memoryUsage() +
+         methodComplexities.memoryUsage() + headerList.memoryUsage() +
+         itemList.memoryUsage() + templateArgList.memoryUsage() +
+         headerContainerList.memoryUsage() +
+         typeKeyList.memoryUsage();
+}
+
+std::size_t StlIndex::memoryUsage() const {
+  return trie.memoryUsage() + catalog.memoryUsage() + fuzzy.memoryUsage();
+}
+
+void buildFuzzyIndex(StlIndex &index) {
+  SymbolPool &pool = SymbolPool::global();
+  const SymbolId typeKind = pool.intern("class");
+  const SymbolId methodKind = pool.intern("method");
+  const SymbolId functionKind = pool.intern("function");
+  const SymbolId headerKind = pool.intern("header");
+  const SymbolId keywordKind = pool.intern("keyword");
+  const StlCatalog &catalog = index.catalog;
+
+  // Most specific kind first: a name keeps the first kind it is listed with
+  std::vector<std::pair<SymbolId, SymbolId>> entries;
+  for (std::size_t i = 0; i < catalog.itemCount(); ++i) {
+    CatalogItem item = catalog.item(i);
+    entries.push_back({item.text, item.kind == kNoSymbol ? typeKind : item.kind});
+  }
+  for (std::size_t i = 0; i < catalog.templateArgCount(); ++i) {
+    CatalogItem item = catalog.templateArg(i);
+    entries.push_back({item.text, item.kind == kNoSymbol ? typeKind : item.kind});
+  }
+  for (const CatalogType &type : catalog.types()) {
+    // As in completion, <algorithm> lists free functions
+    SymbolId kind = viewOf(catalog.typeName(type)) == "algorithm" ? functionKind
+                                                                  : methodKind;
+    std::uint32_t end = type.firstMethod + type.methodCount;
+    for (std::uint32_t row = type.firstMethod; row < end; ++row)
+      entries.push_back({catalog.methodName(row), kind});
+  }
+  for (std::size_t i = 0; i < catalog.headerCount(); ++i)
+    entries.push_back({catalog.header(i), headerKind});
+
+  std::span<const TrieNode> nodes = index.trie.nodePool();
+  for (NodeId node = 0; node < nodes.size(); ++node) {
+    if (nodes[node].isEnd())
+      entries.push_back({index.trie.symbol(node), keywordKind});
+  }
+
+  index.fuzzy.assign(entries);
+}
+
+bool mergeStlFunctions(std::string_view json, StlIndex &index) {
+  JsonValue root;
+  if (!parseJson(json, root) || !root.isObject())
+    return false;
+
+  for (const auto &[container, methods] : root.members) {
+    if (!methods.isArray())
+      continue;
+    std::vector<MethodRecord> records;
+    for (const JsonValue &method : methods.items) {
+      if (method.isString())
+        records.push_back({method.string, {}, {}, {}});
+    }
+    index.catalog.mergeType(container, {}, {}, records);
+    for (const MethodRecord &record : records) {
+      index.trie.insert(record.name); // Insert methods into Trie for fast prefix search
+    }
+  }
+  return true;
+}
+
+bool mergeStlDefinition(std::string_view typeName, std::string_view json,
+                        StlIndex &index) {
+  JsonValue root;
+  if (!parseJson(json, root) || !root.isObject())
+    return false;
+
+  std::vector<MethodRecord> records;
+  if (const JsonValue *methods = root.find("methods");
+      methods && methods->isArray()) {
+    for (const JsonValue &method : methods->items) {
+      std::string_view name = method.stringOr("name");
+      if (name.empty())
+        continue;
+      records.push_back({name, method.stringOr("sig"), method.stringOr("doc"),
+                         method.stringOr("complexity")});
+    }
+  }
+
+  index.catalog.mergeType(typeName, root.stringOr("header"),
+                          root.stringOr("description"), records);
+  for (const MethodRecord &record : records) {
+    index.trie.insert(record.name);
+  }
+  return true;
+}
+
+bool mergeConstants(std::string_view json, StlIndex &index) {
+  JsonValue root;
+  if (!parseJson(json, root) || !root.isObject())
+    return false;
+
+  StlCatalog &catalog = index.catalog;
+  if (const JsonValue *headers = root.find("ALL_HEADERS");
+      headers && headers->isArray()) {
+    for (const JsonValue &header : headers->items) {
+      if (header.isString())
+        catalog.addHeader(header.string);
+    }
+  }
+  if (const JsonValue *items = root.find("ALL_STL_TYPES");
+      items && items->isArray()) {
+    for (const JsonValue &item : items->items) {
+      std::string_view text = item.stringOr("text");
+      if (!text.empty()) {
+        catalog.addItem(text, item.stringOr("sig"), item.stringOr("doc"),
+                        item.stringOr("type"));
+      }
+    }
+  }
+  if (const JsonValue *items = root.find("TEMPLATE_ARGS");
+      items && items->isArray()) {
+    for (const JsonValue &item : items->items) {
+      std::string_view text = item.stringOr("text");
+      if (!text.empty()) {
+        catalog.addTemplateArg(text, item.stringOr("sig"), item.stringOr("doc"),
+                               item.stringOr("type"));
+      }
+    }
+  }
+  if (const JsonValue *map = root.find("HEADER_TO_CONTAINERS");
+      map && map->isObject()) {
+    for (const auto &[header, containers] : map->members) {
+      for (const JsonValue &container : containers.items) {
+        if (container.isString())
+          catalog.addHeaderContainer(header, container.string);
+      }
+    }
+  }
+  if (const JsonValue *map = root.find("TYPE_TO_KEY"); map && map->isObject()) {
+    for (const auto &[type, key] : map->members) {
+      if (key.isString())
+        catalog.addTypeKey(type, key.string);
+    }
+  }
+  return true;
+}
+
+void addKeywords(std::string_view text, StlIndex &index) {
+  while (!text.empty()) {
+    std::size_t end = text.find('\n');
+    std::string_view line = text.substr(0, end);
+    text = end == std::string_view::npos ? std::string_view()
+                                         : text.substr(end + 1);
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    if (!line.empty() && line[0] != '#')
+      index.trie.insert(line);
+  }
+}
+
+} // namespace codeflow
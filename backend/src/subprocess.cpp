@@ -0,0 +1,355 @@
+#include "../include/subprocess.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace codeflow {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// How often a running child is checked for cancellation
+constexpr int kPollIntervalMs = 50;
+// How often its exit is polled for once its pipes are closed, on kernels
+// without pidfd_open (before 5.3)
+constexpr int kExitPollIntervalMs = 2;
+
+// Closes on scope exit; -1 is no descriptor
+struct Fd {
+  int fd = -1;
+  ~Fd() { reset(); }
+  void reset() {
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+  }
+};
+
+std::string describeErrno(const char *what, int error) {
+  return std::string(what) + ": " + std::strerror(error);
+}
+
+// glibc types the resource as an enum, other C libraries as int
+bool limit(decltype(RLIMIT_CPU) resource, rlim_t soft, rlim_t hard) {
+  struct rlimit value {soft, hard};
+  return ::setrlimit(resource, &value) == 0;
+}
+
+bool applyLimits(const ProcessLimits &limits) {
+  bool ok = true;
+  if (limits.cpuSeconds)
+    ok &= limit(RLIMIT_CPU, limits.cpuSeconds, limits.cpuSeconds + 1);
+  if (limits.addressSpaceBytes)
+    ok &= limit(RLIMIT_AS, limits.addressSpaceBytes, limits.addressSpaceBytes);
+  if (limits.processes)
+    ok &= limit(RLIMIT_NPROC, limits.processes, limits.processes);
+  if (limits.fileSizeBytes)
+    ok &= limit(RLIMIT_FSIZE, limits.fileSizeBytes, limits.fileSizeBytes);
+  if (!limits.coreDumps)
+    ok &= limit(RLIMIT_CORE, 0, 0);
+  return ok;
+}
+
+// The steps a child takes between vfork and exec, named for error messages
+enum class ChildStep : int { Group, Stdin, Redirect, Directory, Limits, Exec };
+
+const char *describeStep(ChildStep step) {
+  switch (step) {
+  case ChildStep::Group:
+    return "setpgid";
+  case ChildStep::Stdin:
+    return "/dev/null";
+  case ChildStep::Redirect:
+    return "dup2";
+  case ChildStep::Directory:
+    return "chdir";
+  case ChildStep::Limits:
+    return "setrlimit";
+  case ChildStep::Exec:
+    break;
+  }
+  return nullptr;
+}
+
+// Sent on the report pipe by a child that could not exec
+struct ChildFailure {
+  ChildStep step;
+  int error;
+};
+
+// Everything the child needs, prepared by the parent: until exec it shares
+// the parent's memory, so it must not allocate or take locks
+struct ChildSetup {
+  char *const *argv;
+  char *const *envp;
+  const char *workingDirectory; // nullptr to inherit
+  int out;
+  int err;
+  int report; // Close-on-exec, so it reads EOF once exec succeeds
+  const ProcessLimits *limits;
+};
+
+[[noreturn]] void failChild(int report, ChildStep step) {
+  ChildFailure failure{step, errno};
+  ssize_t written = ::write(report, &failure, sizeof(failure));
+  (void)written;
+  ::_exit(127);
+}
+
+[[noreturn]] void runChild(const ChildSetup &setup) {
+  auto fail = [&](ChildStep step) { failChild(setup.report, step); };
+
+  // Own process group, so the whole tree can be killed; Node ignores
+  // SIGPIPE, which exec would otherwise pass on
+  if (::setpgid(0, 0) != 0)
+    fail(ChildStep::Group);
+  struct sigaction defaults {};
+  defaults.sa_handler = SIG_DFL;
+  for (int number = 1; number < NSIG; ++number)
+    ::sigaction(number, &defaults, nullptr);
+
+  int in = ::open("/dev/null", O_RDONLY);
+  if (in < 0)
+    fail(ChildStep::Stdin);
+  if (::dup2(in, STDIN_FILENO) < 0 || ::dup2(setup.out, STDOUT_FILENO) < 0 ||
+      ::dup2(setup.err, STDERR_FILENO) < 0)
+    fail(ChildStep::Redirect);
+#ifdef SYS_close_range
+  // Descriptors other threads opened without O_CLOEXEC
+  ::syscall(SYS_close_range, STDERR_FILENO + 1, setup.report - 1, 0);
+  ::syscall(SYS_close_range, setup.report + 1, ~0U, 0);
+#endif
+  if (setup.workingDirectory && ::chdir(setup.workingDirectory) != 0)
+    fail(ChildStep::Directory);
+  // Set before exec, so they cover the dynamic loader too
+  if (!applyLimits(*setup.limits))
+    fail(ChildStep::Limits);
+
+  sigset_t signals;
+  sigemptyset(&signals);
+  ::sigprocmask(SIG_SETMASK, &signals, nullptr);
+  ::execvpe(setup.argv[0], setup.argv, setup.envp);
+  failChild(setup.report, ChildStep::Exec);
+}
+
+// Descriptor that polls readable once pid exits, or -1
+int openPidfd(pid_t pid) {
+#ifdef SYS_pidfd_open
+  return static_cast<int>(::syscall(SYS_pidfd_open, pid, 0));
+#else
+  (void)pid;
+  return -1;
+#endif
+}
+
+// Append what is available on fd; false at end of stream
+bool drain(int fd, int stream, std::string &into, std::size_t max,
+           bool &truncated, const OutputHandler &onOutput) {
+  char buffer[64 * 1024];
+  ssize_t n = ::read(fd, buffer, sizeof(buffer));
+  if (n < 0)
+    return errno == EINTR || errno == EAGAIN;
+  if (n == 0)
+    return false;
+  std::size_t room = into.size() < max ? max - into.size() : 0;
+  std::size_t take = std::min(room, static_cast<std::size_t>(n));
+  into.append(buffer, take);
+  truncated |= take < static_cast<std::size_t>(n);
+  if (onOutput && take > 0)
+    onOutput(stream, std::string_view(buffer, take));
+  return true;
+}
+
+} // namespace
+
+std::vector<std::string> splitArguments(std::string_view flags) {
+  std::vector<std::string> arguments;
+  std::size_t start = flags.find_first_not_of(" \t\n");
+  while (start != std::string_view::npos) {
+    std::size_t end = flags.find_first_of(" \t\n", start);
+    arguments.emplace_back(flags.substr(start, end - start));
+    start = flags.find_first_not_of(" \t\n", end);
+  }
+  return arguments;
+}
+
+std::vector<std::string> minimalEnvironment() {
+  const char *path = std::getenv("PATH");
+  return {std::string("PATH=") + (path ? path : "/usr/local/bin:/usr/bin:/bin"),
+          "LANG=C.UTF-8"};
+}
+
+ProcessResult runProcess(const std::vector<std::string> &argv,
+                         const ProcessOptions &options) {
+  ProcessResult result;
+  if (argv.empty()) {
+    result.error = "no command";
+    return result;
+  }
+
+  int outPipe[2], errPipe[2];
+  if (::pipe2(outPipe, O_CLOEXEC) != 0) {
+    result.error = describeErrno("pipe", errno);
+    return result;
+  }
+  Fd outRead{outPipe[0]}, outWrite{outPipe[1]};
+  if (::pipe2(errPipe, O_CLOEXEC) != 0) {
+    result.error = describeErrno("pipe", errno);
+    return result;
+  }
+  Fd errRead{errPipe[0]}, errWrite{errPipe[1]};
+
+  int reportPipe[2];
+  if (::pipe2(reportPipe, O_CLOEXEC) != 0) {
+    result.error = describeErrno("pipe", errno);
+    return result;
+  }
+  Fd reportRead{reportPipe[0]}, reportWrite{reportPipe[1]};
+
+  std::vector<char *> args, env;
+  for (const std::string &arg : argv)
+    args.push_back(const_cast<char *>(arg.c_str()));
+  args.push_back(nullptr);
+  for (const std::string &variable : options.environment)
+    env.push_back(const_cast<char *>(variable.c_str()));
+  env.push_back(nullptr);
+  ChildSetup setup{args.data(),
+                   env.data(),
+                   options.workingDirectory.empty()
+                       ? nullptr
+                       : options.workingDirectory.c_str(),
+                   outWrite.fd,
+                   errWrite.fd,
+                   reportWrite.fd,
+                   &options.limits};
+
+  // Signals stay blocked until the child has reset their handlers, which
+  // would otherwise run on the parent's stack
+  sigset_t blocked, previous;
+  sigfillset(&blocked);
+  ::pthread_sigmask(SIG_SETMASK, &blocked, &previous);
+  const auto start = Clock::now();
+  pid_t pid = ::vfork();
+  if (pid == 0)
+    runChild(setup);
+  int forkError = errno;
+  ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+  reportWrite.reset();
+  if (pid < 0) {
+    result.error = describeErrno("vfork", forkError);
+    return result;
+  }
+
+  ChildFailure failure;
+  ssize_t reported;
+  while ((reported = ::read(reportRead.fd, &failure, sizeof(failure))) < 0 &&
+         errno == EINTR) {
+  }
+  if (reported == sizeof(failure)) {
+    while (::waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+    }
+    const char *step = describeStep(failure.step);
+    result.error = describeErrno(step ? step : argv[0].c_str(), failure.error);
+    return result;
+  }
+  result.started = true;
+  std::optional<HardwareCounters> counters;
+  if (options.hardwareCounters)
+    counters.emplace(pid);
+  outWrite.reset();
+  errWrite.reset();
+
+  // Closing its pipes does not end the child, so the deadline and cancel
+  // flag are enforced until it exits
+  Fd exited{openPidfd(pid)};
+  const auto deadline = start + options.timeout;
+  bool killed = false;
+  auto mustKill = [&] {
+    if (options.timeout.count() > 0 && Clock::now() >= deadline)
+      result.timedOut = true;
+    else if (options.cancelled && options.cancelled->load())
+      result.cancelled = true;
+    else
+      return false;
+    return true;
+  };
+  auto pollTimeout = [&](int interval) {
+    if (options.timeout.count() <= 0)
+      return interval;
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - Clock::now());
+    return std::clamp<int>(static_cast<int>(left.count()) + 1, 0, interval);
+  };
+
+  pollfd fds[2] = {{outRead.fd, POLLIN, 0}, {errRead.fd, POLLIN, 0}};
+  std::string *streams[2] = {&result.out, &result.err};
+  while (!killed && (fds[0].fd >= 0 || fds[1].fd >= 0)) {
+    if (mustKill()) {
+      killed = true;
+      break;
+    }
+
+    int ready = ::poll(fds, 2, pollTimeout(kPollIntervalMs));
+    if (ready < 0 && errno != EINTR)
+      break;
+    for (int i = 0; i < 2 && ready > 0; ++i) {
+      if (fds[i].fd >= 0 && fds[i].revents != 0 &&
+          !drain(fds[i].fd, i + 1, *streams[i], options.maxOutputBytes,
+                 result.truncated, options.onOutput))
+        fds[i].fd = -1; // poll skips negative descriptors
+    }
+  }
+  if (killed)
+    ::kill(-pid, SIGKILL);
+
+  // Wait without reaping, so the group id cannot be reused before whatever
+  // the child left running is killed
+  siginfo_t info;
+  for (;;) {
+    info.si_pid = 0;
+    int waited = ::waitid(P_PID, pid, &info, WEXITED | WNOWAIT | WNOHANG);
+    if ((waited == 0 && info.si_pid != 0) || (waited != 0 && errno != EINTR))
+      break;
+    if (!killed && mustKill()) {
+      killed = true;
+      ::kill(-pid, SIGKILL);
+    }
+    // Killed, it exits promptly; keep polling without a deadline
+    pollfd exitReady{exited.fd, POLLIN, 0};
+    int interval = exited.fd >= 0 ? kPollIntervalMs : kExitPollIntervalMs;
+    ::poll(&exitReady, exited.fd >= 0 ? 1 : 0,
+           killed ? interval : pollTimeout(interval));
+  }
+  ::kill(-pid, SIGKILL);
+
+  int status = 0;
+  struct rusage usage {};
+  while (::wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+  }
+  result.wallMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  result.usage = ResourceUsage::from(usage);
+  result.cpuMs = result.usage.userMs + result.usage.systemMs;
+  if (counters)
+    result.counters = counters->read();
+  else
+    result.counters.unavailable = "not requested";
+  if (WIFEXITED(status))
+    result.exitCode = WEXITSTATUS(status);
+  else if (WIFSIGNALED(status))
+    result.signal = WTERMSIG(status);
+  return result;
+}
+
+} // namespace codeflow
@@ -0,0 +1,78 @@
+#include "../include/suggestion_batch.h"
+#include <algorithm>
+#include <cstring>
+
+namespace codeflow {
+
+namespace {
+
+constexpr std::uint32_t kMaxFieldLength = 0xffff;
+
+std::uint32_t clampedLength(std::string_view text) {
+  return std::min<std::uint32_t>(static_cast<std::uint32_t>(text.size()),
+                                 kMaxFieldLength);
+}
+
+} // namespace
+
+std::uint32_t BatchPacker::intern(std::string_view text) {
+  text = text.substr(0, kMaxFieldLength);
+  auto [it, inserted] = seen.try_emplace(text.data(), StringEntry{});
+  // A view no longer than one already stored at this address is its prefix
+  if (!inserted && text.size() <= it->second.length)
+    return it->second.offset;
+
+  it->second = {stringBytes, static_cast<std::uint32_t>(text.size())};
+  strings.push_back(text);
+  stringBytes += static_cast<std::uint32_t>(text.size());
+  return it->second.offset;
+}
+
+std::size_t BatchPacker::plan(const SuggestionBatch &batch) {
+  this->batch = &batch;
+  strings.clear();
+  stringOffsets.clear();
+  seen.clear();
+  stringBytes = 0;
+
+  stringOffsets.reserve(batch.results.size() * 2);
+  for (const Suggestion &s : batch.results) {
+    stringOffsets.push_back(intern(s.text));
+    stringOffsets.push_back(intern(s.type));
+  }
+
+  std::size_t size = 4 * sizeof(std::uint32_t) +
+                     batch.ends.size() * sizeof(std::uint32_t) +
+                     batch.results.size() * sizeof(BatchRecord) + stringBytes;
+  // Padded so the whole buffer can be viewed as a Uint32Array
+  return (size + 3) & ~std::size_t(3);
+}
+
+void BatchPacker::write(std::uint8_t *out) const {
+  const std::uint32_t header[4] = {
+      kBatchMagic, static_cast<std::uint32_t>(batch->ends.size()),
+      static_cast<std::uint32_t>(batch->results.size()), stringBytes};
+  std::memcpy(out, header, sizeof(header));
+  out += sizeof(header);
+
+  std::size_t endsBytes = batch->ends.size() * sizeof(std::uint32_t);
+  if (endsBytes > 0)
+    std::memcpy(out, batch->ends.data(), endsBytes);
+  out += endsBytes;
+
+  for (std::size_t i = 0; i < batch->results.size(); ++i) {
+    const Suggestion &s = batch->results[i];
+    BatchRecord record{stringOffsets[2 * i], stringOffsets[2 * i + 1], s.score,
+                       clampedLength(s.text) | clampedLength(s.type) << 16};
+    std::memcpy(out, &record, sizeof(record));
+    out += sizeof(record);
+  }
+
+  for (std::string_view text : strings) {
+    std::memcpy(out, text.data(), text.size());
+    out += text.size();
+  }
+  std::memset(out, 0, (4 - stringBytes % 4) % 4);
+}
+
+} // namespace codeflow
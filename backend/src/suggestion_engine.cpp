@@ -1,11 +1,298 @@
 #include "../include/suggestion_engine.h"
+#include "../include/engine_metrics.h"
+#include "../include/index_file.h"
+#include "../include/json.h"
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <fstream>
-#include <regex>
 #include <sstream>
 
 namespace codeflow {
 
+namespace {
+
+// STL class names offered in global context once their header is included
+const std::vector<SymbolId> &stlContainerSymbols() {
+  static const std::vector<SymbolId> symbols = [] {
+    std::vector<SymbolId> ids;
+    for (std::string_view name :
+         {"vector", "string", "stack", "queue", "deque", "map",
+          "unordered_map", "set", "unordered_set", "list", "forward_list",
+          "priority_queue", "bitset", "array", "pair", "tuple"}) {
+      ids.push_back(SymbolPool::global().intern(name));
+    }
+    return ids;
+  }();
+  return symbols;
+}
+
+// Result limits of the template-argument and algorithm sections, as in the
+// JavaScript route
+constexpr std::size_t kMaxTemplateArgs = 15;
+constexpr std::size_t kMaxAlgorithms = 10;
+
+// Learned usage: a session's own acceptances count kSessionUsageWeight
+// times a global one, and the ranking bonus approaches kMaxUsageBoost
+// (half a score tier of complete()) as the count grows past
+// kUsageSaturation
+constexpr float kSessionUsageWeight = 3.0f;
+constexpr float kMaxUsageBoost = 10.0f;
+constexpr float kUsageSaturation = 5.0f;
+
+char toLowerAscii(char c) { return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c; }
+
+std::string toLowerAscii(std::string_view text) {
+  std::string lower(text);
+  for (char &c : lower)
+    c = toLowerAscii(c);
+  return lower;
+}
+
+// text starts with lowerPrefix, ignoring ASCII case
+bool startsWithLower(std::string_view text, std::string_view lowerPrefix) {
+  if (text.size() < lowerPrefix.size())
+    return false;
+  for (std::size_t i = 0; i < lowerPrefix.size(); ++i) {
+    if (toLowerAscii(text[i]) != lowerPrefix[i])
+      return false;
+  }
+  return true;
+}
+
+bool equalsLower(std::string_view text, std::string_view lowerPrefix) {
+  return text.size() == lowerPrefix.size() && startsWithLower(text, lowerPrefix);
+}
+
+std::string_view viewOf(SymbolId id) {
+  return id == kNoSymbol ? std::string_view() : SymbolPool::global().view(id);
+}
+
+// Included headers as the catalogue sees them
+struct Includes {
+  const std::vector<std::string> &headers;
+  bool everything = false; // <bits/stdc++.h>
+
+  explicit Includes(const std::vector<std::string> &names) : headers(names) {
+    everything = std::any_of(headers.begin(), headers.end(),
+                             [](const std::string &h) {
+                               return h.starts_with("bits/");
+                             });
+  }
+
+  // Some included header provides type (HEADER_TO_CONTAINERS)
+  bool provide(const StlCatalog &catalog, std::string_view type) const {
+    if (everything)
+      return true;
+    for (std::size_t i = 0; i < catalog.headerContainerCount(); ++i) {
+      SymbolPair pair = catalog.headerContainer(i);
+      if (viewOf(pair.second) == type &&
+          std::find(headers.begin(), headers.end(), viewOf(pair.first)) !=
+              headers.end())
+        return true;
+    }
+    return false;
+  }
+};
+
+// TYPE_TO_KEY: catalogue type for a type or stream name, or empty. Compares
+// views, since SymbolPool::find takes a lock.
+std::string_view typeKey(const StlCatalog &catalog, std::string_view type) {
+  for (std::size_t i = 0; i < catalog.typeKeyCount(); ++i) {
+    SymbolPair pair = catalog.typeKey(i);
+    if (viewOf(pair.first) == type)
+      return viewOf(pair.second);
+  }
+  return {};
+}
+
+// Method or function row of type as a suggestion
+Suggestion methodSuggestion(const StlCatalog &catalog, const CatalogType &type,
+                            std::uint32_t row, std::string_view kind,
+                            float score, Decoration decoration) {
+  SymbolId name = catalog.methodName(row);
+  std::string_view header = viewOf(catalog.typeHeader(type));
+  std::string_view container = viewOf(catalog.typeName(type));
+  return {viewOf(name),
+          kind,
+          viewOf(catalog.methodDoc(row)),
+          score,
+          name,
+          viewOf(catalog.methodSig(row)),
+          viewOf(catalog.methodComplexity(row)),
+          container,
+          header.empty() ? container : header,
+          decoration};
+}
+
+// Candidate filter for complete(): a case-insensitive prefix, or in fuzzy
+// mode a subsequence whose alignment score replaces the fixed score tiers
+struct NameFilter {
+  std::string lower;
+  bool fuzzy;
+  FuzzyPattern pattern;
+
+  NameFilter(const std::string &prefix, MatchMode mode)
+      : lower(toLowerAscii(prefix)),
+        fuzzy(mode == MatchMode::Fuzzy && !prefix.empty()), pattern(prefix) {}
+
+  // score is only set in fuzzy mode
+  bool operator()(std::string_view name, float &score) const {
+    return fuzzy ? pattern.match(name, score) : startsWithLower(name, lower);
+  }
+};
+
+// Best first; ties alphabetically
+void sortByScore(std::vector<Suggestion> &suggestions) {
+  std::sort(suggestions.begin(), suggestions.end(),
+            [](const Suggestion &a, const Suggestion &b) {
+              return a.score != b.score ? a.score > b.score : a.text < b.text;
+            });
+}
+
+// The session's scope index, when suggest() will resolve an "obj." at the
+// cursor in the session's own text; built here on the first such query after
+// an edit, so edits stay incremental
+std::shared_ptr<const ScopeIndex> sessionScopes(const Document &doc,
+                                                const std::string &contextType,
+                                                std::string_view source,
+                                                int cursorPosition) {
+  if (!contextType.empty() || cursorPosition <= 0 || source != doc.text() ||
+      ScopeIndex::memberObject(source, static_cast<std::size_t>(cursorPosition))
+          .empty())
+    return nullptr;
+  return doc.scopes();
+}
+
+// Where to resolve an object when the query has no cursor: just inside the
+// scope of the last declaration of its leading name, or the end of the code
+std::size_t lastDeclared(const ScopeIndex &scopes, std::string_view object) {
+  std::size_t length = 0;
+  while (length < object.size() &&
+         (std::isalnum(static_cast<unsigned char>(object[length])) ||
+          object[length] == '_'))
+    length++;
+  const std::string_view name = object.substr(0, length);
+  const auto &symbols = scopes.symbols();
+  for (auto it = symbols.rbegin(); it != symbols.rend(); ++it) {
+    if (scopes.view(it->name) == name)
+      return std::max<std::size_t>(it->visibleFrom,
+                                   scopes.scopes()[it->scope].begin + 1);
+  }
+  return scopes.source().size();
+}
+
+// A member suggestion, from a class the code defines or one in the
+// workspace
+struct ClassMember {
+  std::string_view name;
+  std::string_view declaration;
+  bool method;
+};
+
+// Members of a class and its bases, nearest first: data members and member
+// functions other than constructors and operators, one per name
+void collectMembers(const ScopeIndex &scopes, std::uint32_t classScope,
+                    std::vector<ClassMember> &out) {
+  using Kind = ScopeIndex::SymbolKind;
+  for (int depth = 0; classScope != ScopeIndex::kNone && depth < 8; ++depth) {
+    const std::string_view className =
+        scopes.view(scopes.scopes()[classScope].name);
+    for (std::uint32_t at : scopes.symbolsIn(classScope)) {
+      const ScopeIndex::Symbol &symbol = scopes.symbols()[at];
+      const std::string_view name = scopes.view(symbol.name);
+      if ((symbol.kind != Kind::Field && symbol.kind != Kind::Function) ||
+          name == className || name == "operator" ||
+          std::any_of(out.begin(), out.end(), [&](const ClassMember &seen) {
+            return seen.name == name;
+          }))
+        continue;
+      out.push_back({name, scopes.view(symbol.declaration),
+                     symbol.kind == Kind::Function});
+    }
+    classScope = scopes.baseOf(classScope);
+  }
+}
+
+// The workspace class a type name refers to, through up to a few aliases;
+// null if it is not one
+const WorkspaceSymbols::Ref *workspaceClass(const WorkspaceSymbols &workspace,
+                                            std::string_view name) {
+  for (int depth = 0; depth < 4 && !name.empty(); ++depth) {
+    const WorkspaceSymbols::Ref *ref = workspace.findType(name);
+    if (!ref)
+      return nullptr;
+    const WorkspaceSymbol &symbol = workspace.symbol(*ref);
+    if (symbol.kind != ScopeIndex::SymbolKind::Alias)
+      return ref;
+    name = ScopeIndex::parseType(symbol.type).name;
+  }
+  return nullptr;
+}
+
+} // namespace
+
+void decorate(const Suggestion &s, std::string &display, std::string &doc,
+              std::string &sig) {
+  display.assign(s.text);
+  doc.assign(s.description);
+  sig.assign(s.sig);
+  switch (s.decoration) {
+  case Decoration::None:
+    break;
+  case Decoration::Signature:
+    if (!s.sig.empty())
+      display.assign(s.sig);
+    break;
+  case Decoration::Call:
+    display += "()";
+    break;
+  case Decoration::QualifiedCall:
+    display.insert(0, "std::");
+    display += "()";
+    break;
+  case Decoration::Header:
+    display = "<" + display + ">";
+    doc = "Standard C++ header " + display;
+    sig = "#include " + display;
+    break;
+  case Decoration::Local:
+    doc = "Local variable: " + display;
+    sig = display;
+    break;
+  }
+}
+
+void appendRecordsJson(std::string &out,
+                       const std::vector<Suggestion> &suggestions) {
+  std::string display, doc, sig;
+  out += '[';
+  for (const Suggestion &s : suggestions) {
+    decorate(s, display, doc, sig);
+    out += out.back() == '[' ? "{" : ",{";
+    auto field = [&](const char *key, std::string_view value) {
+      if (value.empty())
+        return;
+      appendJsonString(out, key);
+      out += ':';
+      appendJsonString(out, value);
+      out += ',';
+    };
+    field("text", s.text);
+    field("display", display);
+    field("type", s.type);
+    field("doc", doc);
+    field("sig", sig);
+    field("complexity", s.complexity);
+    field("container", s.container);
+    field("header", s.header);
+    out += "\"score\":";
+    appendJsonNumber(out, s.score);
+    out += '}';
+  }
+  out += ']';
+}
+
 SuggestionEngine::SuggestionEngine() {
   // Type methods are dynamically loaded via loadSTLData
 }
@@ -17,7 +304,16 @@ void SuggestionEngine::loadSTLData(const std::string &stlJsonPath) {
 
   std::stringstream buffer;
   buffer << file.rdbuf();
-  parseSTLJson(buffer.str());
+
+  // Build the next index from a copy of the current one; readers keep using
+  // the published snapshot until the swap.
+  std::lock_guard<std::mutex> lock(writeMutex);
+  auto next = std::make_shared<StlIndex>(*index.acquire());
+  if (mergeStlFunctions(buffer.str(), *next)) {
+    buildFuzzyIndex(*next);
+    index.publish(std::move(next));
+    responses.clear(); // Keyed by index generation; frees the old ones
+  }
 }
 
 void SuggestionEngine::loadKeywords(const std::string &keywordsPath) {
@@ -25,20 +321,34 @@ void SuggestionEngine::loadKeywords(const std::string &keywordsPath) {
   if (!file.is_open())
     return;
 
-  std::string line;
-  std::vector<std::string> keywords;
-  while (std::getline(file, line)) {
-    if (!line.empty() && line[0] != '#') {
-      trie.insert(line);
-      keywords.push_back(line);
-    }
-  }
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+
+  std::lock_guard<std::mutex> lock(writeMutex);
+  auto next = std::make_shared<StlIndex>(*index.acquire());
+  addKeywords(buffer.str(), *next);
+  buildFuzzyIndex(*next);
+  index.publish(std::move(next));
+  responses.clear();
+}
+
+bool SuggestionEngine::loadIndex(const std::string &indexPath,
+                                 std::string *error) {
+  auto next = std::make_shared<StlIndex>();
+  if (!mapIndexFile(indexPath, *next, error))
+    return false;
+  buildFuzzyIndex(*next);
+
+  std::lock_guard<std::mutex> lock(writeMutex);
+  index.publish(std::move(next));
+  responses.clear();
+  return true;
 }
 
-std::string SuggestionEngine::extractObjectName(const std::string &code,
+std::string SuggestionEngine::extractObjectName(std::string_view code,
                                                 int cursorPosition) {
   // Find the dot position near cursor
-  int dotPos = cursorPosition - 1;
+  int dotPos = std::min<int>(cursorPosition, static_cast<int>(code.size())) - 1;
   while (dotPos >= 0 && code[dotPos] != '.') {
     dotPos--;
   }
@@ -56,23 +366,39 @@ std::string SuggestionEngine::extractObjectName(const std::string &code,
 
   if (idStart >= dotPos)
     return "";
-  return code.substr(idStart, dotPos - idStart);
+  return std::string(code.substr(idStart, dotPos - idStart));
 }
 
 std::string
-SuggestionEngine::getTypeForObject(const std::string &objectName) const {
-  auto it = symbolTable.find(objectName);
-  if (it != symbolTable.end()) {
+SuggestionEngine::getTypeForObject(const DocumentSymbols &symbols,
+                                   const std::string &objectName) {
+  auto it = symbols.symbolTable.find(objectName);
+  if (it != symbols.symbolTable.end()) {
     return it->second;
   }
   return "";
 }
 
+std::string SuggestionEngine::typeAtCursor(const ScopeIndex *scopes,
+                                           std::string_view code,
+                                           std::size_t cursor) {
+  std::string_view object = ScopeIndex::memberObject(code, cursor);
+  if (object.empty())
+    return "";
+  if (!scopes || scopes->source() != code) {
+    thread_local ScopeIndex local;
+    local.build(code);
+    scopes = &local;
+  }
+  return std::string(scopes->typeOf(object, cursor).name);
+}
+
 bool SuggestionEngine::isHeaderIncluded(const std::string &type) const {
-  return includedLibraries.count(type) > 0;
+  return document.read()->includedLibraries.count(type) > 0;
 }
 
 std::vector<std::string> SuggestionEngine::getIncludedLibraries() const {
+  const auto &includedLibraries = document.read()->includedLibraries;
   std::vector<std::string> result(includedLibraries.begin(),
                                   includedLibraries.end());
   return result;
@@ -80,57 +406,128 @@ std::vector<std::string> SuggestionEngine::getIncludedLibraries() const {
 
 std::unordered_map<std::string, std::string>
 SuggestionEngine::getSymbolTable() const {
-  return symbolTable;
+  return document.read()->symbolTable;
 }
 
 std::vector<Suggestion> SuggestionEngine::getSuggestions(
     const std::string &prefix, const std::string &contextType,
-    const std::string &code, int cursorPosition, int maxResults) {
+    std::string_view code, int cursorPosition, int maxResults) {
+  // Lock-free: both snapshots stay valid for the rest of this call
+  const DocumentSymbols &doc = *document.read();
+  return suggest(*index.read(), doc, doc.scopes.get(), nullptr, prefix,
+                 contextType, code, cursorPosition, maxResults);
+}
+
+void SuggestionEngine::getSuggestionsBatch(
+    const std::vector<SuggestionQuery> &queries, int maxResults,
+    SuggestionBatch &out) {
+  out.clear();
+  out.ends.reserve(queries.size());
+  const StlIndex &stl = *index.read();
+  const DocumentSymbols &defaultDoc = *document.read();
+
+  auto append = [&](std::vector<Suggestion> &&found) {
+    out.results.insert(out.results.end(), found.begin(), found.end());
+    out.ends.push_back(static_cast<std::uint32_t>(out.results.size()));
+  };
+  for (const SuggestionQuery &q : queries) {
+    if (q.session == 0) {
+      append(suggest(stl, defaultDoc, defaultDoc.scopes.get(), nullptr,
+                     q.prefix, q.contextType, q.code, q.cursorPosition,
+                     maxResults));
+      continue;
+    }
+    std::vector<Suggestion> found;
+    sessions.read(q.session, [&](const Document &doc,
+                                 const UsageCounts &learned) {
+      std::string_view source = q.code.empty() ? doc.text() : q.code;
+      auto scopes = sessionScopes(doc, q.contextType, source, q.cursorPosition);
+      found = suggest(stl, doc.symbols(), scopes.get(), &learned, q.prefix,
+                      q.contextType, source, q.cursorPosition, maxResults);
+    });
+    append(std::move(found));
+  }
+}
 
-  std::lock_guard<std::mutex> lock(mutex);
+std::vector<Suggestion> SuggestionEngine::getSessionSuggestions(
+    SessionId session, const std::string &prefix,
+    const std::string &contextType, std::string_view code,
+    int cursorPosition, int maxResults) {
+  std::vector<Suggestion> suggestions;
+  sessions.read(session, [&](const Document &doc, const UsageCounts &learned) {
+    // Without explicit code, resolve "obj." against the session's own text
+    std::string_view source = code.empty() ? doc.text() : code;
+    auto scopes = sessionScopes(doc, contextType, source, cursorPosition);
+    suggestions = suggest(*index.read(), doc.symbols(), scopes.get(), &learned,
+                          prefix, contextType, source, cursorPosition,
+                          maxResults);
+  });
+  return suggestions;
+}
+
+std::vector<Suggestion> SuggestionEngine::suggest(
+    const StlIndex &stl, const DocumentSymbols &doc, const ScopeIndex *scopes,
+    const UsageCounts *session,
+    const std::string &prefix, const std::string &contextType,
+    std::string_view code, int cursorPosition, int maxResults) {
+  const StlCatalog &catalog = stl.catalog;
+  const auto &symbolTable = doc.symbolTable;
+  const auto &includedLibraries = doc.includedLibraries;
+  StageTimer timer(Stage::Query,
+                   EngineMetrics::global().tick(Counter::Queries));
 
   std::string actualType = contextType;
 
-  // If contextType is empty, try to extract object name from code
+  // If contextType is empty, resolve the object before the cursor through
+  // the scopes around it, else by its name in the symbol table
   if (contextType.empty() && cursorPosition > 0) {
-    std::string objectName = extractObjectName(code, cursorPosition);
+    actualType = typeAtCursor(scopes, code, cursorPosition);
+    std::string objectName =
+        actualType.empty() ? extractObjectName(code, cursorPosition) : "";
     if (!objectName.empty()) {
-      actualType = getTypeForObject(objectName);
+      actualType = getTypeForObject(doc, objectName);
     }
   } else if (!contextType.empty() && symbolTable.count(contextType)) {
     // contextType is variable name, resolve to actual type
     actualType = symbolTable.at(contextType);
   }
 
-  // ✅ RULE 1: Check if the required library is included
-  if (!actualType.empty() && typeToMethods.count(actualType)) {
-    if (!includedLibraries.count(actualType)) {
-      return {}; // ❌ Required header not included - return empty
-    }
+  const CatalogType *type =
+      actualType.empty() ? nullptr : catalog.findType(actualType);
+
+  // ✅ RULE 1: Check if the required library is included, by the type's
+  // own name or the header the catalogue lists for it
+  const bool headerMissing =
+      type && !includedLibraries.count(actualType) &&
+      !includedLibraries.count(std::string(viewOf(catalog.typeHeader(*type))));
+  timer.lap(Stage::ContextResolution);
+  if (headerMissing) {
+    return {}; // ❌ Required header not included - return empty
   }
 
   // If we have a specific context type with methods defined, return those
   // directly
-  if (!actualType.empty() && typeToMethods.count(actualType)) {
-    if (!includedLibraries.count(actualType)) {
-      return {}; // ❌ Required header not included - return empty
-    }
-    
-    const auto &methods = typeToMethods.at(actualType);
+  if (type && type->methodCount > 0) {
+    const SymbolPool &pool = SymbolPool::global();
     std::vector<Suggestion> suggestions;
+    suggestions.reserve(type->methodCount);
 
     // Filter by prefix if provided
-    for (const auto &method : methods) {
-      if (prefix.empty() || method.find(prefix) == 0) {
-        suggestions.push_back({method, "method", "", 0.0f});
+    std::uint32_t end = type->firstMethod + type->methodCount;
+    for (std::uint32_t row = type->firstMethod; row < end; ++row) {
+      if (pool.view(catalog.methodName(row)).starts_with(prefix)) {
+        suggestions.push_back(methodSuggestion(catalog, *type, row, "method",
+                                               0.0f, Decoration::Call));
       }
     }
+    timer.lap(Stage::Filtering);
 
     // ✅ RULE 4: Rank and return top results
-    rankSuggestions(suggestions);
+    rankSuggestions(suggestions, session);
     if (suggestions.size() > (size_t)maxResults) {
       suggestions.resize(maxResults);
     }
+    timer.lap(Stage::Ranking);
 
     return suggestions;
   }
@@ -138,117 +535,601 @@ std::vector<Suggestion> SuggestionEngine::getSuggestions(
   // ✅ Special handling for global context: return STL container class names
   // when appropriate headers are included
   if (contextType == "global" && !prefix.empty()) {
+    const SymbolPool &pool = SymbolPool::global();
     std::vector<Suggestion> suggestions;
-    
+
     // Check which STL containers have their headers included
-    std::vector<std::string> stlContainers = {
-      "vector", "string", "stack", "queue", "deque", "map", "unordered_map",
-      "set", "unordered_set", "list", "forward_list", "priority_queue", 
-      "bitset", "array", "pair", "tuple"
-    };
-    
-    for (const auto &container : stlContainers) {
-      // Check if the container's header is included
-      if (includedLibraries.count(container) && 
-          (prefix.empty() || container.find(prefix) == 0)) {
-        suggestions.push_back({container, "class", "", 0.0f});
+    for (SymbolId container : stlContainerSymbols()) {
+      std::string_view name = pool.view(container);
+      if (name.starts_with(prefix) &&
+          includedLibraries.count(std::string(name))) {
+        suggestions.push_back({name, "class", "", 0.0f, container});
       }
     }
-    
+
     // Also suggest common functions from included headers
     for (const auto &lib : includedLibraries) {
-      if (typeToMethods.count(lib)) {
-        const auto &functions = typeToMethods.at(lib);
-        for (const auto &func : functions) {
-          if (prefix.empty() || func.find(prefix) == 0) {
-            // Avoid duplicates
-            bool found = false;
-            for (const auto &s : suggestions) {
-              if (s.text == func) {
-                found = true;
-                break;
-              }
-            }
-            if (!found) {
-              suggestions.push_back({func, "function", "", 0.0f});
-            }
-          }
+      const CatalogType *functions = catalog.findType(lib);
+      if (!functions)
+        continue;
+      std::uint32_t end = functions->firstMethod + functions->methodCount;
+      for (std::uint32_t row = functions->firstMethod; row < end; ++row) {
+        SymbolId func = catalog.methodName(row);
+        std::string_view name = pool.view(func);
+        // Avoid duplicates
+        if (name.starts_with(prefix) &&
+            std::none_of(suggestions.begin(), suggestions.end(),
+                         [func](const Suggestion &s) {
+                           return s.symbol == func;
+                         })) {
+          suggestions.push_back({name, "function", "", 0.0f, func});
         }
       }
     }
-    
+    timer.lap(Stage::Filtering);
+
     if (!suggestions.empty()) {
-      rankSuggestions(suggestions);
+      rankSuggestions(suggestions, session);
       if (suggestions.size() > (size_t)maxResults) {
         suggestions.resize(maxResults);
       }
+      timer.lap(Stage::Ranking);
       return suggestions;
     }
   }
 
   // Fallback: Get raw trie results (for keywords and non-typed suggestions)
-  auto raw = trie.search(prefix, maxResults * 2);
+  thread_local std::vector<NodeId> raw;
+  stl.trie.completions(prefix, static_cast<std::size_t>(std::max(maxResults, 0)) * 2,
+                       raw);
 
   // Convert to Suggestion objects
   std::vector<Suggestion> suggestions;
-  for (const auto &text : raw) {
-    suggestions.push_back({text, "keyword", "", 0.0f});
+  suggestions.reserve(raw.size());
+  for (NodeId node : raw) {
+    suggestions.push_back(
+        {stl.trie.word(node), "keyword", "", 0.0f, stl.trie.symbol(node)});
   }
+  timer.lap(Stage::TrieLookup);
 
   // ✅ RULE 4: Rank and return top results
-  rankSuggestions(suggestions);
+  rankSuggestions(suggestions, session);
   if (suggestions.size() > (size_t)maxResults) {
     suggestions.resize(maxResults);
   }
+  timer.lap(Stage::Ranking);
 
   return suggestions;
 }
 
-void SuggestionEngine::updateSymbols(const std::string &code) {
-  std::lock_guard<std::mutex> lock(mutex);
+// What complete() reads from the code
+struct SuggestionEngine::CompletionScope {
+  ExtractedSymbols found;
+  std::string_view type;                // Member access: the catalogue type
+  std::vector<std::string_view> locals; // Global scope: declared names
+  ScopeIndex scopes;                    // Member access: code's scopes
+  std::string_view userClass;           // ... or a user or workspace class
+  std::vector<ClassMember> members;     // ... and its members
+  const WorkspaceSymbols *workspace = nullptr;
+};
 
-  symbolTable.clear();
-  includedLibraries.clear();
+void SuggestionEngine::scanScope(const StlCatalog &catalog,
+                                 const WorkspaceSymbols &workspace,
+                                 const std::string &contextType,
+                                 std::string_view code, std::size_t cursor,
+                                 CompletionScope &scope) {
+  scope.workspace = &workspace;
+  scope.found.includes.clear();
+  scope.found.declarations.clear();
+  scope.type = {};
+  scope.locals.clear();
+  scope.userClass = {};
+  scope.members.clear();
+  if (contextType == "include_header" || contextType == "template_arg")
+    return;
+
+  extractSymbols(code, scope.found);
+  if (contextType == "global") {
+    extractDeclaredNames(code, scope.locals);
+    return;
+  }
 
-  // ✅ Parse includes: #include <vector>, #include <stack>, etc.
-  std::regex includeRegex(R"(#include\s*<\s*([a-z_]+)\s*>)");
-  for (std::sregex_iterator it(code.begin(), code.end(), includeRegex), end;
-       it != end; ++it) {
-    includedLibraries.insert((*it)[1].str());
+  // Member access: resolve contextType through the scopes at the cursor
+  scope.scopes.build(code);
+  const ScopeIndex::Type resolved = scope.scopes.typeOf(
+      contextType, cursor == kNoCursor ? lastDeclared(scope.scopes, contextType)
+                                       : std::min(cursor, code.size()));
+  if (resolved.classScope != ScopeIndex::kNone) {
+    scope.userClass =
+        scope.scopes.view(scope.scopes.scopes()[resolved.classScope].name);
+    collectMembers(scope.scopes, resolved.classScope, scope.members);
+    return;
   }
 
-  // ✅ Parse variable declarations - specifically for STL containers
-  // Patterns: vector<int> v;  map<int,int> m;  stack<double> s; string s;
-  // list<int> lst;
-  std::regex varDecl(
-      R"(\b(vector|stack|queue|deque|map|unordered_map|set|unordered_set|string|list|forward_list|priority_queue|array|bitset)(?:<[^>]*>)?\s+(\w+)\s*[=;({])");
-  for (std::sregex_iterator it(code.begin(), code.end(), varDecl), end;
-       it != end; ++it) {
-    std::string type = (*it)[1].str();
-    std::string var = (*it)[2].str();
-    symbolTable[var] = type;
+  // A catalogue type, or a class declared elsewhere in the workspace
+  auto named = [&](std::string_view name) {
+    std::string_view key = typeKey(catalog, name);
+    scope.type = key.empty() ? name : key;
+    if (catalog.findType(scope.type))
+      return true;
+    scope.type = {};
+    const WorkspaceSymbols::Ref *ref = workspaceClass(workspace, name);
+    if (!ref)
+      return false;
+    scope.userClass = workspace.symbol(*ref).name;
+    for (const WorkspaceSymbol &member : workspace.members(*ref)) {
+      scope.members.push_back({member.name, member.declaration,
+                               member.kind == ScopeIndex::SymbolKind::Function});
+    }
+    return true;
+  };
+  if (resolved.known() && named(resolved.name))
+    return;
+  if (!resolved.known()) {
+    if (const WorkspaceSymbols::Ref *ref = workspace.findVariable(contextType)) {
+      if (named(ScopeIndex::parseType(workspace.symbol(*ref).type).name))
+        return;
+    }
   }
+
+  // Otherwise a declared variable or a type, by name
+  for (auto it = scope.found.declarations.rbegin();
+       it != scope.found.declarations.rend(); ++it) {
+    if (it->first == contextType) {
+      scope.type = it->second;
+      break;
+    }
+  }
+  if (!scope.type.empty()) {
+    std::string_view key = typeKey(catalog, scope.type);
+    scope.type = key.empty() ? scope.type : key;
+  } else {
+    scope.type = typeKey(catalog, contextType);
+  }
+}
+
+std::vector<Suggestion>
+SuggestionEngine::complete(const std::string &prefix,
+                           const std::string &contextType,
+                           const std::string &code, int maxResults,
+                           MatchMode mode, std::size_t cursor) const {
+  const StlCatalog &catalog = index.read()->catalog;
+  StageTimer timer(Stage::Query,
+                   EngineMetrics::global().tick(Counter::Queries));
+  std::uint64_t workspaceGeneration;
+  thread_local CompletionScope scope;
+  scanScope(catalog, *workspace.read(workspaceGeneration), contextType, code,
+            cursor, scope);
+  return completeIn(catalog, scope, prefix, contextType, maxResults, mode,
+                    timer);
+}
+
+ResponseCache::Body SuggestionEngine::completeJson(
+    const std::string &language, const std::string &prefix,
+    const std::string &contextType, const std::string &code, int maxResults,
+    MatchMode mode, bool *hit, std::size_t cursor) {
+  std::uint64_t generation, workspaceGeneration;
+  const StlCatalog &catalog = index.read(generation)->catalog;
+  const WorkspaceSymbols &symbols = *workspace.read(workspaceGeneration);
+  StageTimer timer(Stage::Query,
+                   EngineMetrics::global().tick(Counter::Queries));
+  thread_local CompletionScope scope;
+  bool scanned = false;
+
+  // The key's scope part: everything complete() reads from the code.
+  // Headers as a set, since order and repeats do not change what they
+  // provide; member access by the resolved type, so every variable of one
+  // type shares entries, or by a user class's member declarations.
+  auto scopeKey = [&] {
+    scanScope(catalog, symbols, contextType, code, cursor, scope);
+    scanned = true;
+    thread_local std::vector<std::string_view> headers;
+    headers.assign(scope.found.includes.begin(), scope.found.includes.end());
+    std::sort(headers.begin(), headers.end());
+    headers.erase(std::unique(headers.begin(), headers.end()), headers.end());
+    ResponseKey key;
+    key.add(headers.size());
+    for (std::string_view header : headers)
+      key.add(header);
+    if (contextType == "global") {
+      key.add(contextType).add(scope.locals.size());
+      for (std::string_view name : scope.locals)
+        key.add(name);
+    } else if (!scope.userClass.empty()) {
+      key.add("class").add(scope.userClass).add(scope.members.size());
+      for (const ClassMember &member : scope.members)
+        key.add(member.declaration);
+    } else {
+      key.add("member").add(scope.type);
+    }
+    return key.hash();
+  };
+
+  // Scanning is most of a hit's cost, so a document seen lately on this
+  // thread (the cursor moved, a request was repeated) finds its scope key
+  // by a hash of the code instead
+  struct ScopeMemo {
+    std::uint64_t code = 0;
+    std::uint64_t scope = 0;
+  };
+  thread_local std::array<ScopeMemo, 64> memos;
+  std::uint64_t scopeHash;
+  if (contextType == "include_header" || contextType == "template_arg") {
+    scopeHash = ResponseKey().add(contextType).hash();
+  } else {
+    const std::uint64_t codeHash = ResponseKey()
+                                       .add(generation)
+                                       .add(workspaceGeneration)
+                                       .add(contextType)
+                                       .add(static_cast<std::uint64_t>(cursor))
+                                       .add(code)
+                                       .hash();
+    ScopeMemo &memo = memos[codeHash % memos.size()];
+    if (memo.code != codeHash)
+      memo = {codeHash, scopeKey()};
+    scopeHash = memo.scope;
+  }
+
+  ResponseKey key;
+  key.add(generation).add(workspaceGeneration).add(language);
+  key.add(usageEpoch.load(std::memory_order_acquire));
+  key.add(static_cast<std::uint64_t>(mode));
+  key.add(static_cast<std::uint64_t>(std::max(maxResults, 0)));
+  key.add(prefix).add(scopeHash);
+  if (ResponseCache::Body body = responses.get(key.hash())) {
+    if (hit)
+      *hit = true;
+    return body;
+  }
+  if (hit)
+    *hit = false;
+  if (!scanned)
+    scanScope(catalog, symbols, contextType, code, cursor, scope);
+  auto suggestions =
+      completeIn(catalog, scope, prefix, contextType, maxResults, mode, timer);
+  std::string json;
+  appendRecordsJson(json, suggestions);
+  json.shrink_to_fit(); // Charged by capacity while cached
+  auto body = std::make_shared<const std::string>(std::move(json));
+  responses.put(key.hash(), body);
+  return body;
 }
 
-int SuggestionEngine::getSymbolCount() const { return symbolTable.size(); }
+std::vector<Suggestion>
+SuggestionEngine::completeIn(const StlCatalog &catalog,
+                             const CompletionScope &scope,
+                             const std::string &prefix,
+                             const std::string &contextType, int maxResults,
+                             MatchMode mode, StageTimer &timer) const {
+  const NameFilter matches(prefix, mode);
+  const std::string &lower = matches.lower;
+  const std::size_t limit = static_cast<std::size_t>(std::max(maxResults, 0));
+  std::vector<Suggestion> suggestions;
+
+  // Learned usage reorders candidates within a score tier
+  auto addUsageBoost = [&] {
+    const std::uint32_t now = UsageCounts::now();
+    for (Suggestion &s : suggestions)
+      s.score += usageBoost(s.text, nullptr, now);
+  };
+
+  // Catalogue order in prefix mode; fuzzy results need ranking first
+  auto rankAndTrim = [&](std::size_t keep) {
+    timer.lap(Stage::Filtering);
+    if (matches.fuzzy)
+      sortByScore(suggestions);
+    if (suggestions.size() > keep)
+      suggestions.resize(keep);
+    timer.lap(Stage::Ranking);
+  };
+
+  // Inside #include <...>
+  if (contextType == "include_header") {
+    for (std::size_t i = 0; i < catalog.headerCount() &&
+                            (matches.fuzzy || suggestions.size() < limit);
+         ++i) {
+      SymbolId id = catalog.header(i);
+      std::string_view header = viewOf(id);
+      float score;
+      if (!matches(header, score))
+        continue;
+      if (!matches.fuzzy)
+        score = !prefix.empty() && header.starts_with(prefix) ? 100 : 50;
+      suggestions.push_back({header, "header", "", score, id, {}, "-", {}, {},
+                             Decoration::Header});
+    }
+    rankAndTrim(limit);
+    return suggestions;
+  }
+
+  // Inside vector<...>
+  if (contextType == "template_arg") {
+    const std::size_t keep = std::min(limit, kMaxTemplateArgs);
+    for (std::size_t i = 0; i < catalog.templateArgCount() &&
+                            (matches.fuzzy || suggestions.size() < keep);
+         ++i) {
+      CatalogItem item = catalog.templateArg(i);
+      std::string_view text = viewOf(item.text);
+      float score = 0.0f;
+      if (matches(text, score)) {
+        suggestions.push_back({text, viewOf(item.kind), viewOf(item.doc), score,
+                               item.text, viewOf(item.sig)});
+      }
+    }
+    rankAndTrim(keep);
+    return suggestions;
+  }
+
+  const Includes includes(scope.found.includes);
+
+  // Member access to a class the code or the workspace defines
+  if (contextType != "global" && !scope.userClass.empty()) {
+    timer.lap(Stage::ContextResolution);
+    for (const ClassMember &member : scope.members) {
+      float score;
+      if (!matches(member.name, score))
+        continue;
+      if (!matches.fuzzy)
+        score = equalsLower(member.name, lower) ? 100 : 80;
+      suggestions.push_back({member.name, member.method ? "method" : "variable",
+                             "", score, kNoSymbol, member.declaration, {},
+                             scope.userClass, {},
+                             member.method ? Decoration::Call
+                                           : Decoration::None});
+    }
+    timer.lap(Stage::Filtering);
+    addUsageBoost();
+    sortByScore(suggestions);
+    if (suggestions.size() > limit)
+      suggestions.resize(limit);
+    timer.lap(Stage::Ranking);
+    return suggestions;
+  }
+
+  // Member access
+  if (contextType != "global") {
+    const std::string_view resolved = scope.type;
+    const CatalogType *type =
+        resolved.empty() ? nullptr : catalog.findType(resolved);
+    const bool provided = type && includes.provide(catalog, resolved);
+    timer.lap(Stage::ContextResolution);
+    if (!provided)
+      return {};
+
+    std::uint32_t end = type->firstMethod + type->methodCount;
+    for (std::uint32_t row = type->firstMethod; row < end; ++row) {
+      std::string_view name = viewOf(catalog.methodName(row));
+      float score;
+      if (matches(name, score)) {
+        if (!matches.fuzzy)
+          score = equalsLower(name, lower) ? 100 : 80;
+        suggestions.push_back(methodSuggestion(catalog, *type, row, "method",
+                                               score, Decoration::Call));
+      }
+    }
+    timer.lap(Stage::Filtering);
+    addUsageBoost();
+    sortByScore(suggestions);
+    if (suggestions.size() > limit)
+      suggestions.resize(limit);
+    timer.lap(Stage::Ranking);
+    return suggestions;
+  }
+
+  // Global scope: STL types whose header is included
+  timer.lap(Stage::ContextResolution);
+  for (std::size_t i = 0; i < catalog.itemCount(); ++i) {
+    CatalogItem item = catalog.item(i);
+    std::string_view text = viewOf(item.text);
+    float score;
+    if (!matches(text, score))
+      continue;
+    std::string_view key = typeKey(catalog, text);
+    if (!includes.provide(catalog, key.empty() ? text : key))
+      continue;
+    std::string_view kind = viewOf(item.kind);
+    if (!matches.fuzzy)
+      score = !lower.empty() && equalsLower(text, lower) ? 95 : 75;
+    suggestions.push_back({text, kind.empty() ? "class" : kind,
+                           viewOf(item.doc), score, item.text, viewOf(item.sig),
+                           "-", {}, {}, Decoration::Signature});
+  }
+
+  // ... algorithms, if <algorithm> is included
+  const CatalogType *algorithms = catalog.findType("algorithm");
+  if (algorithms && includes.provide(catalog, "algorithm")) {
+    std::uint32_t end = algorithms->firstMethod + algorithms->methodCount;
+    std::size_t first = suggestions.size();
+    for (std::uint32_t row = algorithms->firstMethod;
+         row < end &&
+         (matches.fuzzy || suggestions.size() - first < kMaxAlgorithms);
+         ++row) {
+      std::string_view name = viewOf(catalog.methodName(row));
+      float score;
+      if (!matches(name, score))
+        continue;
+      if (!matches.fuzzy)
+        score = !lower.empty() && equalsLower(name, lower) ? 90 : 70;
+      suggestions.push_back(methodSuggestion(catalog, *algorithms, row,
+                                             "function", score,
+                                             Decoration::QualifiedCall));
+    }
+    // The best kMaxAlgorithms fuzzy matches, not the first ones
+    if (matches.fuzzy && suggestions.size() - first > kMaxAlgorithms) {
+      auto begin = suggestions.begin() + static_cast<std::ptrdiff_t>(first);
+      std::partial_sort(begin, begin + kMaxAlgorithms, suggestions.end(),
+                        [](const Suggestion &a, const Suggestion &b) {
+                          return a.score != b.score ? a.score > b.score
+                                                    : a.text < b.text;
+                        });
+      suggestions.resize(first + kMaxAlgorithms);
+    }
+  }
+
+  // ... and locally declared names
+  for (std::string_view name : scope.locals) {
+    float score;
+    if (matches(name, score)) {
+      if (!matches.fuzzy)
+        score = 99;
+      suggestions.push_back({name, "variable", "", score, kNoSymbol, {}, "-",
+                             {}, {}, Decoration::Local});
+    }
+  }
+
+  // ... and the workspace's declarations, one per name, those the code
+  // declares itself left out. byName keeps exact matches first and equal
+  // names together, so prefix mode can stop at limit.
+  if (scope.workspace) {
+    const WorkspaceSymbols &workspace = *scope.workspace;
+    std::span<const WorkspaceSymbols::Ref> refs =
+        matches.fuzzy ? std::span<const WorkspaceSymbols::Ref>(workspace.byName)
+                      : workspace.withPrefix(prefix);
+    std::string_view previous;
+    std::size_t added = 0;
+    for (const WorkspaceSymbols::Ref &ref : refs) {
+      if (!matches.fuzzy && added >= limit)
+        break;
+      const WorkspaceSymbol &symbol = workspace.symbol(ref);
+      if (symbol.name == previous)
+        continue;
+      previous = symbol.name;
+      float score;
+      if (!matches(symbol.name, score) ||
+          std::find(scope.locals.begin(), scope.locals.end(), symbol.name) !=
+              scope.locals.end())
+        continue;
+      if (!matches.fuzzy)
+        score = !lower.empty() && equalsLower(symbol.name, lower) ? 97 : 77;
+      using Kind = ScopeIndex::SymbolKind;
+      const bool function = symbol.kind == Kind::Function;
+      std::string_view type = function ? "function"
+                              : symbol.kind == Kind::Variable ? "variable"
+                                                              : "class";
+      suggestions.push_back({symbol.name, type, "", score, kNoSymbol,
+                             symbol.declaration, {}, {},
+                             workspace.file(ref).path,
+                             function ? Decoration::Call : Decoration::None});
+      ++added;
+    }
+  }
+  timer.lap(Stage::Filtering);
+
+  addUsageBoost();
+  sortByScore(suggestions);
+  if (suggestions.size() > limit)
+    suggestions.resize(limit);
+  timer.lap(Stage::Ranking);
+  return suggestions;
+}
+
+std::vector<Suggestion> SuggestionEngine::fuzzySearch(const std::string &pattern,
+                                                      int maxResults) const {
+  const StlIndex &stl = *index.read();
+  thread_local std::vector<FuzzyHit> hits;
+  stl.fuzzy.search(FuzzyPattern(pattern),
+                   static_cast<std::size_t>(std::max(maxResults, 0)), hits);
+
+  std::vector<Suggestion> suggestions;
+  suggestions.reserve(hits.size());
+  for (const FuzzyHit &hit : hits) {
+    suggestions.push_back({viewOf(hit.symbol), viewOf(hit.type), "", hit.score,
+                           hit.symbol});
+  }
+  return suggestions;
+}
+
+void SuggestionEngine::updateSymbols(const std::string &code) {
+  // Parse into a fresh table and publish it whole, so readers see either the
+  // previous document or this one, never a mix.
+  StageTimer timer(Stage::Reindex);
+  document.publish(parseDocument(code));
+}
+
+SessionId SuggestionEngine::openSession() { return sessions.open(); }
+
+bool SuggestionEngine::updateSession(SessionId session,
+                                     const std::string &code) {
+  return sessions.write(session, [&](Document &doc) {
+    StageTimer timer(Stage::Reindex);
+    doc.reset(code);
+    return true;
+  });
+}
+
+bool SuggestionEngine::editSession(SessionId session,
+                                   const std::vector<TextEdit> &edits) {
+  return sessions.write(session, [&](Document &doc) {
+    StageTimer timer(Stage::Reindex);
+    for (const auto &edit : edits) {
+      if (!doc.apply(edit))
+        return false;
+    }
+    return true;
+  });
+}
+
+bool SuggestionEngine::closeSession(SessionId session) {
+  return sessions.close(session);
+}
+
+bool SuggestionEngine::hasSession(SessionId session) const {
+  return sessions.contains(session);
+}
+
+void SuggestionEngine::setSessionMemoryBudget(std::size_t bytes) {
+  sessions.setBudget(bytes);
+}
+
+SessionStats SuggestionEngine::getSessionStats() const {
+  return sessions.stats();
+}
+
+std::shared_ptr<DocumentSymbols>
+SuggestionEngine::parseDocument(const std::string &code) {
+  ExtractedSymbols found;
+  extractSymbols(code, found);
+
+  auto next = std::make_shared<DocumentSymbols>();
+  next->includedLibraries.insert(found.includes.begin(), found.includes.end());
+  for (auto &[var, type] : found.declarations) {
+    next->symbolTable[var] = std::move(type);
+  }
+  auto scopes = std::make_shared<ScopeIndex>();
+  scopes->buildCopy(code);
+  next->scopes = std::move(scopes);
+  return next;
+}
+
+int SuggestionEngine::getSymbolCount() const {
+  return document.read()->symbolTable.size();
+}
 
 std::vector<std::string>
 SuggestionEngine::filterByContext(const std::vector<std::string> &candidates,
-                                  const std::string &contextType) {
+                                  const std::string &contextType) const {
 
   if (contextType.empty()) {
     return candidates;
   }
 
+  const StlCatalog &catalog = index.read()->catalog;
+
   // ✅ RULE 7: Filter to methods of the specified type ONLY
-  if (typeToMethods.count(contextType)) {
-    const auto &methods = typeToMethods.at(contextType);
+  if (const CatalogType *type = catalog.findType(contextType)) {
+    const SymbolPool &pool = SymbolPool::global();
     std::vector<std::string> filtered;
+    std::uint32_t end = type->firstMethod + type->methodCount;
 
     for (const auto &candidate : candidates) {
-      if (std::find(methods.begin(), methods.end(), candidate) !=
-          methods.end()) {
-        filtered.push_back(candidate);
+      SymbolId id = pool.find(candidate);
+      if (id == kNoSymbol)
+        continue;
+      for (std::uint32_t row = type->firstMethod; row < end; ++row) {
+        if (catalog.methodName(row) == id) {
+          filtered.push_back(candidate);
+          break;
+        }
       }
     }
     return filtered;
@@ -257,12 +1138,28 @@ SuggestionEngine::filterByContext(const std::vector<std::string> &candidates,
   return candidates;
 }
 
+float SuggestionEngine::usageBoost(std::string_view name,
+                                   const UsageCounts *session,
+                                   std::uint32_t at) const {
+  float count = usage.score(name, at);
+  if (session)
+    count += kSessionUsageWeight * session->score(name, at);
+  if (count <= 0.0f)
+    return 0.0f;
+  return kMaxUsageBoost * (1.0f - std::exp(-count / kUsageSaturation));
+}
+
 void SuggestionEngine::rankSuggestions(std::vector<Suggestion> &suggestions,
-                                       bool useML) {
-  // ✅ RULE 3: Simple ranking - shorter method names first (more common
-  // pattern)
+                                       const UsageCounts *session) const {
+  // Learned usage first; ✅ RULE 3: otherwise shorter method names first
+  // (more common pattern)
+  const std::uint32_t now = UsageCounts::now();
+  for (Suggestion &s : suggestions)
+    s.score = usageBoost(s.text, session, now);
   std::sort(suggestions.begin(), suggestions.end(),
             [](const Suggestion &a, const Suggestion &b) {
+              if (a.score != b.score)
+                return a.score > b.score;
               return a.text.length() < b.text.length();
             });
 
@@ -272,59 +1169,42 @@ void SuggestionEngine::rankSuggestions(std::vector<Suggestion> &suggestions,
   }
 }
 
-void SuggestionEngine::parseSTLJson(const std::string &jsonData) {
-  // Parse JSON array format: "container": ["method1", "method2", ...]
-  // Handle both single-line and multi-line arrays
-
-  typeToMethods.clear();
-
-  // First, find all container keys
-  std::regex containerRegex(R"(\"(\w+)\"\s*:\s*\[)");
-
-  std::sregex_iterator it(jsonData.begin(), jsonData.end(), containerRegex);
-  std::sregex_iterator end;
-
-  while (it != end) {
-    std::string container = (*it)[1].str();
-    size_t arrayStart = it->position() + it->length();
-
-    // Find the closing bracket for this array
-    int bracketCount = 1;
-    size_t pos = arrayStart;
-    size_t arrayEnd = arrayStart;
+bool SuggestionEngine::recordAccepted(const std::string &text,
+                                      SessionId session) {
+  const std::uint32_t now = UsageCounts::now();
+  if (!usage.record(text, now))
+    return false;
+  usageEpoch.fetch_add(1, std::memory_order_release);
+  if (session != 0)
+    sessions.recordUse(session, text, now);
+  return true;
+}
 
-    while (pos < jsonData.length() && bracketCount > 0) {
-      if (jsonData[pos] == '[')
-        bracketCount++;
-      else if (jsonData[pos] == ']')
-        bracketCount--;
+float SuggestionEngine::getUsageScore(const std::string &text,
+                                      SessionId session) const {
+  const std::uint32_t now = UsageCounts::now();
+  if (session == 0)
+    return usage.score(text, now);
+  float score = 0.0f;
+  sessions.read(session, [&](const Document &, const UsageCounts &learned) {
+    score = learned.score(text, now);
+  });
+  return score;
+}
 
-      if (bracketCount == 0) {
-        arrayEnd = pos;
-        break;
-      }
-      pos++;
-    }
+std::size_t SuggestionEngine::getLearnedSymbolCount() const {
+  return usage.size();
+}
 
-    // Extract array content
-    std::string arrayContent =
-        jsonData.substr(arrayStart, arrayEnd - arrayStart);
-
-    // Parse individual method names from the array content
-    std::regex methodRegex(R"(\"([^\"]+)\")");
-    std::sregex_iterator methodIt(arrayContent.begin(), arrayContent.end(),
-                                  methodRegex);
-    std::sregex_iterator methodEnd;
-
-    while (methodIt != methodEnd) {
-      std::string method = (*methodIt)[1].str();
-      typeToMethods[container].push_back(method);
-      trie.insert(method); // Insert methods into Trie for fast prefix search
-      ++methodIt;
-    }
+bool SuggestionEngine::saveUsage(const std::string &path,
+                                 std::string *error) const {
+  return usage.save(path, error);
+}
 
-    ++it;
-  }
+bool SuggestionEngine::loadUsage(const std::string &path, std::string *error) {
+  bool loaded = usage.load(path, error);
+  usageEpoch.fetch_add(1, std::memory_order_release);
+  return loaded;
 }
 
 } // namespace codeflow
@@ -0,0 +1,133 @@
+#include "../include/symbol_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace codeflow {
+
+SymbolPool &SymbolPool::global() {
+  // Leaked on purpose: views must outlive every static that holds one
+  static SymbolPool *pool = new SymbolPool();
+  return *pool;
+}
+
+SymbolPool::SymbolPool() = default;
+
+const char *SymbolPool::store(std::string_view text) {
+  // Oversized strings get a buffer of their own; the open chunk stays open
+  if (text.size() > kMaxChunk / 4) {
+    char *data = chunks.emplace_back(new char[text.size()]).get();
+    chunkBytes += text.size();
+    std::memcpy(data, text.data(), text.size());
+    return data;
+  }
+  if (chunkSize - chunkUsed < text.size()) {
+    chunkSize = std::min(std::max(chunkSize * 2, kMinChunk), kMaxChunk);
+    openChunk = chunks.emplace_back(new char[chunkSize]).get();
+    chunkBytes += chunkSize;
+    chunkUsed = 0;
+  }
+  char *data = openChunk + chunkUsed;
+  std::memcpy(data, text.data(), text.size());
+  chunkUsed += text.size();
+  return data;
+}
+
+void SymbolPool::reserveEntry(SymbolId id) {
+  auto [block, offset] = locate(id);
+  if (!blocks[block]) {
+    std::size_t entries = kFirstBlock << block;
+    blocks[block].reset(new Entry[entries]);
+    blockBytes += entries * sizeof(Entry);
+  }
+}
+
+SymbolId SymbolPool::intern(std::string_view text) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = ids.find(text);
+  if (it != ids.end())
+    return it->second;
+
+  if (nextId >= kNoSymbol)
+    throw std::length_error("SymbolPool is full");
+  SymbolId id = static_cast<SymbolId>(nextId++);
+  reserveEntry(id);
+
+  const char *data = text.empty() ? "" : store(text);
+  auto [block, offset] = locate(id);
+  blocks[block][offset] = {data, static_cast<std::uint32_t>(text.size())};
+  ids.emplace(std::string_view(data, text.size()), id);
+  return id;
+}
+
+bool SymbolPool::sameTable(SymbolId first, const char *text,
+                           const std::uint32_t *offsets,
+                           std::size_t count) const {
+  for (std::size_t i = 0; i < count; ++i) {
+    std::string_view string(text + offsets[i], offsets[i + 1] - offsets[i]);
+    if (view(first + static_cast<SymbolId>(i)) != string)
+      return false;
+  }
+  return true;
+}
+
+SymbolId SymbolPool::attach(const char *text, const std::uint32_t *offsets,
+                            std::size_t count) {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::string_view all(text + offsets[0], offsets[count] - offsets[0]);
+  std::size_t key = std::hash<std::string_view>{}(all) ^ count;
+  auto [match, end] = tables.equal_range(key);
+  for (; match != end; ++match) {
+    auto [first, size] = match->second;
+    if (size == count && sameTable(first, text, offsets, count))
+      return first;
+  }
+
+  if (count >= kNoSymbol - nextId)
+    throw std::length_error("SymbolPool is full");
+  SymbolId first = static_cast<SymbolId>(nextId);
+  nextId += count;
+
+  ids.reserve(ids.size() + count);
+  for (std::size_t i = 0; i < count; ++i) {
+    SymbolId id = first + static_cast<SymbolId>(i);
+    reserveEntry(id);
+    std::string_view string(text + offsets[i], offsets[i + 1] - offsets[i]);
+    auto it = ids.find(string);
+    const char *data = it != ids.end() ? it->first.data()
+                       : string.empty() ? ""
+                                        : store(string);
+    auto [block, offset] = locate(id);
+    blocks[block][offset] = {data, static_cast<std::uint32_t>(string.size())};
+    if (it == ids.end())
+      ids.emplace(std::string_view(data, string.size()), id);
+  }
+  tables.emplace(key, std::make_pair(first, count));
+  return first;
+}
+
+SymbolId SymbolPool::find(std::string_view text) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = ids.find(text);
+  return it != ids.end() ? it->second : kNoSymbol;
+}
+
+std::size_t SymbolPool::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return nextId;
+}
+
+std::size_t SymbolPool::memoryUsage() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  // Hash node: next pointer, key view, id, cached hash
+  std::size_t tableBytes =
+      ids.bucket_count() * sizeof(void *) +
+      ids.size() * (sizeof(void *) + sizeof(std::string_view) +
+                    sizeof(SymbolId) + sizeof(std::size_t)) +
+      tables.bucket_count() * sizeof(void *) +
+      tables.size() * (sizeof(void *) + sizeof(*tables.begin()) +
+                       sizeof(std::size_t));
+  return sizeof(*this) + blockBytes + chunkBytes + tableBytes;
+}
+
+} // namespace codeflow
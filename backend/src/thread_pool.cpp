@@ -0,0 +1,100 @@
+#include "../include/thread_pool.h"
+#include <algorithm>
+
+namespace codeflow {
+
+ThreadPool::ThreadPool(std::size_t threads) {
+  threads = std::max<std::size_t>(threads, 1);
+  workers.reserve(threads);
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers.emplace_back([this] { work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  std::deque<Entry> abandoned;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    abandoned.swap(queue);
+    for (auto &[id, flag] : running) {
+      flag->store(true);
+    }
+  }
+  ready.notify_all();
+  for (Entry &entry : abandoned) {
+    entry.cancelled->store(true);
+    entry.task(*entry.cancelled);
+  }
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+TaskId ThreadPool::submit(Task task) {
+  TaskId id;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    id = nextId++;
+    queue.push_back(
+        {id, std::make_shared<std::atomic<bool>>(false), std::move(task)});
+  }
+  ready.notify_one();
+  return id;
+}
+
+bool ThreadPool::cancel(TaskId id) {
+  Entry removed;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto queued = std::find_if(queue.begin(), queue.end(),
+                               [id](const Entry &e) { return e.id == id; });
+    if (queued == queue.end()) {
+      auto it = running.find(id);
+      if (it == running.end())
+        return false;
+      it->second->store(true);
+      return true;
+    }
+    removed = std::move(*queued);
+    queue.erase(queued);
+    cancelledCount++;
+  }
+
+  // Outside the lock: the task may submit or cancel other work
+  removed.cancelled->store(true);
+  removed.task(*removed.cancelled);
+  return true;
+}
+
+ThreadPoolStats ThreadPool::stats() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return {workers.size(), queue.size(), running.size(), completed,
+          cancelledCount};
+}
+
+void ThreadPool::work() {
+  while (true) {
+    Entry entry;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      ready.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty())
+        return; // Stopping
+      entry = std::move(queue.front());
+      queue.pop_front();
+      running.emplace(entry.id, entry.cancelled);
+    }
+
+    entry.task(*entry.cancelled);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    running.erase(entry.id);
+    if (entry.cancelled->load())
+      cancelledCount++;
+    else
+      completed++;
+  }
+}
+
+} // namespace codeflow
@@ -1,82 +1,487 @@
 #include "../include/tokenizer.h"
-#include <cctype>
-#include <regex>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CODEFLOW_X86_SIMD 1
+#include <immintrin.h>
+#endif
 
 namespace codeflow {
 
-Tokenizer::Tokenizer() { initializeKeywords(); }
+namespace {
+
+// Byte classes. Fixed ASCII tables: std::isspace and friends consult the
+// global locale on every call. Bytes >= 0x80 count as identifier characters
+// so UTF-8 names stay in one token.
+constexpr unsigned char kIdent = 1;
+constexpr unsigned char kDigit = 2;
+constexpr unsigned char kSpace = 4;
+
+struct ByteClasses {
+  unsigned char bits[256] = {};
+
+  constexpr ByteClasses() {
+    for (int c = 0; c < 256; ++c) {
+      if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+          c >= 0x80)
+        bits[c] |= kIdent;
+      if (c >= '0' && c <= '9')
+        bits[c] |= kIdent | kDigit;
+      if (c == ' ' || (c >= '\t' && c <= '\r'))
+        bits[c] |= kSpace;
+    }
+  }
+
+  bool is(char c, unsigned char cls) const {
+    return bits[static_cast<unsigned char>(c)] & cls;
+  }
+};
+
+constexpr ByteClasses kClasses;
+
+// Bulk classification primitives, one implementation per SimdLevel
+struct Kernels {
+  // Length of the run of identifier / whitespace bytes starting at p
+  std::size_t (*identRun)(const char *p, const char *end);
+  std::size_t (*spaceRun)(const char *p, const char *end);
+  // First byte equal to a, b or c, or end
+  const char *(*findAny)(const char *p, const char *end, char a, char b,
+                         char c);
+};
+
+std::size_t runScalar(const char *p, const char *end, unsigned char cls) {
+  const char *start = p;
+  while (p < end && kClasses.is(*p, cls))
+    p++;
+  return static_cast<std::size_t>(p - start);
+}
+
+std::size_t identRunScalar(const char *p, const char *end) {
+  return runScalar(p, end, kIdent);
+}
+
+std::size_t spaceRunScalar(const char *p, const char *end) {
+  return runScalar(p, end, kSpace);
+}
+
+const char *findAnyScalar(const char *p, const char *end, char a, char b,
+                          char c) {
+  while (p < end && *p != a && *p != b && *p != c)
+    p++;
+  return p;
+}
+
+#ifdef CODEFLOW_X86_SIMD
+
+// Unsigned range test lo <= x < lo + n on signed byte lanes: bias by 0x80
+// so a signed compare orders them as unsigned.
+inline __m128i inRange128(__m128i v, char lo, int n) {
+  __m128i shifted = _mm_xor_si128(_mm_sub_epi8(v, _mm_set1_epi8(lo)),
+                                  _mm_set1_epi8(static_cast<char>(0x80)));
+  return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(n ^ 0x80)));
+}
+
+inline unsigned identMask128(__m128i v) {
+  __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+  __m128i word = _mm_or_si128(
+      _mm_or_si128(inRange128(lower, 'a', 26), inRange128(v, '0', 10)),
+      _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+  // High-bit bytes come straight from the sign bits
+  return static_cast<unsigned>(_mm_movemask_epi8(word) | _mm_movemask_epi8(v));
+}
+
+inline unsigned spaceMask128(__m128i v) {
+  __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                               inRange128(v, '\t', 5));
+  return static_cast<unsigned>(_mm_movemask_epi8(space));
+}
+
+template <unsigned (*Mask)(__m128i)>
+std::size_t runSse2(const char *p, const char *end, unsigned char cls) {
+  const char *start = p;
+  for (; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    unsigned stop = ~Mask(v) & 0xFFFFu;
+    if (stop)
+      return static_cast<std::size_t>(p - start) + __builtin_ctz(stop);
+  }
+  return static_cast<std::size_t>(p - start) + runScalar(p, end, cls);
+}
+
+std::size_t identRunSse2(const char *p, const char *end) {
+  return runSse2<identMask128>(p, end, kIdent);
+}
+
+std::size_t spaceRunSse2(const char *p, const char *end) {
+  return runSse2<spaceMask128>(p, end, kSpace);
+}
+
+const char *findAnySse2(const char *p, const char *end, char a, char b,
+                        char c) {
+  __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b), vc = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i hit = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+        _mm_cmpeq_epi8(v, vc));
+    unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return findAnyScalar(p, end, a, b, c);
+}
+
+#define CODEFLOW_AVX2 __attribute__((target("avx2")))
+
+CODEFLOW_AVX2 inline __m256i inRange256(__m256i v, char lo, int n) {
+  __m256i shifted = _mm256_xor_si256(_mm256_sub_epi8(v, _mm256_set1_epi8(lo)),
+                                     _mm256_set1_epi8(static_cast<char>(0x80)));
+  return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(n ^ 0x80)),
+                           shifted);
+}
+
+CODEFLOW_AVX2 inline unsigned identMask256(__m256i v) {
+  __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+  __m256i word = _mm256_or_si256(
+      _mm256_or_si256(inRange256(lower, 'a', 26), inRange256(v, '0', 10)),
+      _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+  return static_cast<unsigned>(_mm256_movemask_epi8(word) |
+                               _mm256_movemask_epi8(v));
+}
+
+CODEFLOW_AVX2 inline unsigned spaceMask256(__m256i v) {
+  __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                  inRange256(v, '\t', 5));
+  return static_cast<unsigned>(_mm256_movemask_epi8(space));
+}
+
+CODEFLOW_AVX2 std::size_t identRunAvx2(const char *p, const char *end) {
+  const char *start = p;
+  for (; end - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    unsigned stop = ~identMask256(v);
+    if (stop)
+      return static_cast<std::size_t>(p - start) + __builtin_ctz(stop);
+  }
+  return static_cast<std::size_t>(p - start) + identRunSse2(p, end);
+}
+
+CODEFLOW_AVX2 std::size_t spaceRunAvx2(const char *p, const char *end) {
+  const char *start = p;
+  for (; end - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    unsigned stop = ~spaceMask256(v);
+    if (stop)
+      return static_cast<std::size_t>(p - start) + __builtin_ctz(stop);
+  }
+  return static_cast<std::size_t>(p - start) + spaceRunSse2(p, end);
+}
+
+CODEFLOW_AVX2 const char *findAnyAvx2(const char *p, const char *end, char a,
+                                      char b, char c) {
+  __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b),
+          vc = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i hit = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+        _mm256_cmpeq_epi8(v, vc));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return findAnySse2(p, end, a, b, c);
+}
+
+#undef CODEFLOW_AVX2
+
+#endif // CODEFLOW_X86_SIMD
+
+const Kernels &kernelsFor(SimdLevel level) {
+  static constexpr Kernels scalar{identRunScalar, spaceRunScalar,
+                                  findAnyScalar};
+#ifdef CODEFLOW_X86_SIMD
+  static constexpr Kernels sse2{identRunSse2, spaceRunSse2, findAnySse2};
+  static constexpr Kernels avx2{identRunAvx2, spaceRunAvx2, findAnyAvx2};
+  switch (level) {
+  case SimdLevel::AVX2:
+    return avx2;
+  case SimdLevel::SSE2:
+    return sse2;
+  case SimdLevel::Scalar:
+    break;
+  }
+#else
+  (void)level;
+#endif
+  return scalar;
+}
+
+// Past a backslash-newline (LF or CRLF) at p, or nullptr if p is not one
+const char *skipContinuation(const char *p, const char *end) {
+  if (p + 1 < end && p[1] == '\n')
+    return p + 2;
+  if (p + 2 < end && p[1] == '\r' && p[2] == '\n')
+    return p + 3;
+  return nullptr;
+}
+
+// "..." or '...' starting at p. An unterminated literal ends before the
+// newline so the rest of the file still tokenizes.
+const char *skipQuoted(const Kernels &k, const char *p, const char *end) {
+  char quote = *p++;
+  while (true) {
+    const char *q = k.findAny(p, end, quote, '\\', '\n');
+    if (q == end)
+      return end;
+    if (*q == quote)
+      return q + 1;
+    if (*q == '\n')
+      return q;
+    p = std::min(q + 2, end); // Escape sequence
+  }
+}
+
+// R"delim( ... )delim" with p at the opening quote
+const char *skipRawString(const Kernels &k, const char *p, const char *end) {
+  constexpr std::size_t kMaxDelimiter = 16;
+  const char *delimiter = p + 1;
+  const char *open = delimiter;
+  while (open < end && *open != '(' && static_cast<std::size_t>(open - delimiter) <= kMaxDelimiter &&
+         !kClasses.is(*open, kSpace) && *open != '"' && *open != '\\' &&
+         *open != ')')
+    open++;
+  if (open >= end || *open != '(')
+    return skipQuoted(k, p, end); // Not a valid raw string
+
+  std::size_t length = static_cast<std::size_t>(open - delimiter);
+  p = open + 1;
+  while (true) {
+    const char *q = k.findAny(p, end, ')', ')', ')');
+    if (q == end)
+      return end;
+    if (static_cast<std::size_t>(end - q) > length + 1 &&
+        std::memcmp(q + 1, delimiter, length) == 0 && q[1 + length] == '"')
+      return q + 2 + length;
+    p = q + 1;
+  }
+}
+
+// Up to (not including) the newline ending a // comment
+const char *skipLineComment(const Kernels &k, const char *p, const char *end) {
+  p += 2;
+  while (true) {
+    const char *q = k.findAny(p, end, '\n', '\\', '\n');
+    if (q == end || *q == '\n')
+      return q;
+    const char *next = skipContinuation(q, end);
+    p = next ? next : q + 1;
+  }
+}
+
+const char *skipBlockComment(const Kernels &k, const char *p,
+                             const char *end) {
+  p += 2;
+  while (true) {
+    const char *q = k.findAny(p, end, '*', '*', '*');
+    if (q == end)
+      return end;
+    if (q + 1 < end && q[1] == '/')
+      return q + 2;
+    p = q + 1;
+  }
+}
+
+// Rest of a directive line, following continuations and stopping before a
+// trailing comment
+const char *skipDirective(const Kernels &k, const char *p, const char *end) {
+  const char *start = p;
+  while (true) {
+    const char *q = k.findAny(p, end, '\n', '\\', '/');
+    if (q == end || *q == '\n') {
+      p = q;
+      break;
+    }
+    if (*q == '/') {
+      if (q + 1 < end && (q[1] == '/' || q[1] == '*')) {
+        p = q;
+        break;
+      }
+      p = q + 1;
+      continue;
+    }
+    const char *next = skipContinuation(q, end);
+    p = next ? next : q + 1;
+  }
+  while (p > start && kClasses.is(p[-1], kSpace))
+    p--;
+  return p;
+}
+
+// pp-number: digits, letters, '.', digit separators and signed exponents
+const char *skipNumber(const char *p, const char *end) {
+  p++;
+  while (p < end) {
+    char c = *p;
+    if ((c == '+' || c == '-') &&
+        (p[-1] == 'e' || p[-1] == 'E' || p[-1] == 'p' || p[-1] == 'P')) {
+      p++;
+    } else if (c == '\'' && p + 1 < end && kClasses.is(p[1], kIdent)) {
+      p += 2;
+    } else if (c == '.' || kClasses.is(c, kIdent)) {
+      p++;
+    } else {
+      break;
+    }
+  }
+  return p;
+}
+
+// Open-addressed keyword table, sized so most probes hit on the first slot.
+// The hash reads only the length and the two end characters, so identifiers
+// never need to be copied or fully hashed.
+constexpr std::size_t kKeywordSlots = 256;
+constexpr std::size_t kLongestKeyword = 9;
+
+std::size_t keywordHash(std::string_view word) {
+  auto first = static_cast<unsigned char>(word.front());
+  auto last = static_cast<unsigned char>(word.back());
+  return (word.size() * 61 + first * 7 + last * 3) & (kKeywordSlots - 1);
+}
+
+bool isStringPrefix(std::string_view word) {
+  return word == "u8" || word == "u" || word == "U" || word == "L";
+}
+
+bool isRawStringPrefix(std::string_view word) {
+  return word == "R" || word == "u8R" || word == "uR" || word == "UR" ||
+         word == "LR";
+}
+
+} // namespace
+
+Tokenizer::Tokenizer() : level(detectSimdLevel()) { initializeKeywords(); }
 
 void Tokenizer::initializeKeywords() {
-  keywords = {{"if", true},        {"else", true},     {"for", true},
-              {"while", true},     {"do", true},       {"switch", true},
-              {"case", true},      {"default", true},  {"break", true},
-              {"continue", true},  {"return", true},   {"int", true},
-              {"float", true},     {"double", true},   {"char", true},
-              {"bool", true},      {"void", true},     {"long", true},
-              {"short", true},     {"unsigned", true}, {"signed", true},
-              {"const", true},     {"volatile", true}, {"static", true},
-              {"extern", true},    {"auto", true},     {"register", true},
-              {"class", true},     {"struct", true},   {"union", true},
-              {"enum", true},      {"typedef", true},  {"using", true},
-              {"namespace", true}, {"template", true}, {"typename", true},
-              {"virtual", true},   {"public", true},   {"private", true},
-              {"protected", true}, {"friend", true},   {"new", true},
-              {"delete", true},    {"vector", true},   {"map", true},
-              {"set", true},       {"string", true},   {"iostream", true},
-              {"algorithm", true}};
-}
-
-std::vector<Token> Tokenizer::tokenize(const std::string &code) {
-  std::vector<Token> tokens;
-  size_t pos = 0;
+  static constexpr std::string_view kKeywords[] = {
+      "if",       "else",     "for",       "while",     "do",
+      "switch",   "case",     "default",   "break",     "continue",
+      "return",   "int",      "float",     "double",    "char",
+      "bool",     "void",     "long",      "short",     "unsigned",
+      "signed",   "const",    "volatile",  "static",    "extern",
+      "auto",     "register", "class",     "struct",    "union",
+      "enum",     "typedef",  "using",     "namespace", "template",
+      "typename", "virtual",  "public",    "private",   "protected",
+      "friend",   "new",      "delete",    "vector",    "map",
+      "set",      "string",   "iostream",  "algorithm"};
+  keywordSlots.assign(kKeywordSlots, {});
+  for (std::string_view keyword : kKeywords) {
+    std::size_t slot = keywordHash(keyword);
+    while (!keywordSlots[slot].empty())
+      slot = (slot + 1) & (kKeywordSlots - 1);
+    keywordSlots[slot] = keyword;
+  }
+}
 
-  while (pos < code.length()) {
-    if (std::isspace(code[pos])) {
-      pos++;
+SimdLevel Tokenizer::detectSimdLevel() {
+  static const SimdLevel detected = [] {
+#ifdef CODEFLOW_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+      return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+  }();
+  return detected;
+}
+
+void Tokenizer::setSimdLevel(SimdLevel requested) {
+  level = std::min(requested, detectSimdLevel());
+}
+
+void Tokenizer::scan(std::string_view code, std::vector<TokenView> &out) const {
+  out.clear();
+  const Kernels &k = kernelsFor(level);
+  const char *begin = code.data();
+  const char *end = begin + code.size();
+  const char *p = begin;
+  bool lineStart = true; // Only whitespace since the last newline
+
+  auto emit = [&](Token::Type type, const char *from, const char *to) {
+    out.push_back({type, static_cast<std::uint32_t>(from - begin),
+                   static_cast<std::uint32_t>(to - from)});
+  };
+
+  while (p < end) {
+    char c = *p;
+    if (kClasses.is(c, kSpace)) {
+      std::size_t run = k.spaceRun(p, end);
+      if (std::memchr(p, '\n', run))
+        lineStart = true;
+      p += run;
       continue;
     }
 
-    if (isIdentifierStart(code[pos])) {
-      size_t start = pos;
-      while (pos < code.length() && isIdentifierPart(code[pos])) {
-        pos++;
-      }
-      std::string word = code.substr(start, pos - start);
-      Token::Type type =
-          isKeyword(word) ? Token::Type::KEYWORD : Token::Type::IDENTIFIER;
-      tokens.push_back({type, word, static_cast<int>(start)});
-    } else if (std::isdigit(code[pos])) {
-      size_t start = pos;
-      while (pos < code.length() &&
-             (std::isdigit(code[pos]) || code[pos] == '.')) {
-        pos++;
-      }
-      tokens.push_back({Token::Type::LITERAL, code.substr(start, pos - start),
-                        static_cast<int>(start)});
-    } else if (code[pos] == '"' || code[pos] == '\'') {
-      char quote = code[pos];
-      size_t start = pos;
-      pos++;
-      while (pos < code.length() && code[pos] != quote) {
-        if (code[pos] == '\\')
-          pos++;
-        pos++;
+    const char *start = p;
+    bool directive = lineStart && c == '#';
+    lineStart = false;
+
+    if (directive) {
+      p = skipDirective(k, p, end);
+      emit(Token::Type::PREPROCESSOR, start, p);
+    } else if (c == '/' && p + 1 < end && p[1] == '/') {
+      p = skipLineComment(k, p, end);
+      emit(Token::Type::COMMENT, start, p);
+    } else if (c == '/' && p + 1 < end && p[1] == '*') {
+      p = skipBlockComment(k, p, end);
+      emit(Token::Type::COMMENT, start, p);
+    } else if (kClasses.is(c, kDigit) ||
+               (c == '.' && p + 1 < end && kClasses.is(p[1], kDigit))) {
+      p = skipNumber(p, end);
+      emit(Token::Type::LITERAL, start, p);
+    } else if (kClasses.is(c, kIdent)) {
+      p += k.identRun(p, end);
+      std::string_view word(start, static_cast<std::size_t>(p - start));
+      if (p < end && *p == '"' && isRawStringPrefix(word)) {
+        p = skipRawString(k, p, end);
+        emit(Token::Type::LITERAL, start, p);
+      } else if (p < end && (*p == '"' || *p == '\'') && isStringPrefix(word)) {
+        p = skipQuoted(k, p, end);
+        emit(Token::Type::LITERAL, start, p);
+      } else {
+        emit(isKeyword(word) ? Token::Type::KEYWORD : Token::Type::IDENTIFIER,
+             start, p);
       }
-      if (pos < code.length())
-        pos++;
-      tokens.push_back({Token::Type::LITERAL, code.substr(start, pos - start),
-                        static_cast<int>(start)});
-    } else if (isOperator(code[pos])) {
-      tokens.push_back({Token::Type::OPERATOR, std::string(1, code[pos]),
-                        static_cast<int>(pos)});
-      pos++;
+    } else if (c == '"' || c == '\'') {
+      p = skipQuoted(k, p, end);
+      emit(Token::Type::LITERAL, start, p);
+    } else if (isOperator(c)) {
+      emit(Token::Type::OPERATOR, start, ++p);
     } else {
-      tokens.push_back({Token::Type::PUNCTUATION, std::string(1, code[pos]),
-                        static_cast<int>(pos)});
-      pos++;
+      emit(Token::Type::PUNCTUATION, start, ++p);
     }
   }
+}
 
+std::vector<TokenView> Tokenizer::scan(std::string_view code) const {
+  std::vector<TokenView> tokens;
+  scan(code, tokens);
+  return tokens;
+}
+
+std::vector<Token> Tokenizer::tokenize(const std::string &code) const {
+  std::vector<TokenView> views;
+  scan(code, views);
+
+  std::vector<Token> tokens;
+  tokens.reserve(views.size());
+  for (const TokenView &view : views) {
+    tokens.push_back({view.type, std::string(view.text(code)),
+                      static_cast<int>(view.offset)});
+  }
   return tokens;
 }
 
@@ -85,31 +490,36 @@ std::unordered_map<std::string, std::string> Tokenizer::getSymbolTable() const {
 }
 
 std::string Tokenizer::extractTypeFromContext(const std::string &code,
-                                              int cursorPosition) {
-  // Look backwards from cursor for variable declaration
-  std::regex varDecl(R"((\w+)\s+(\w+)\s*[=;])");
-  std::sregex_iterator it(code.begin(), code.begin() + cursorPosition, varDecl);
-
-  if (it != std::sregex_iterator()) {
-    auto match = *it;
-    if (match.size() >= 2) {
-      return match[1].str(); // Return the type
+                                              int cursorPosition) const {
+  // First "<type> <name> =" or "<type> <name>;" before the cursor
+  std::size_t end = std::min<std::size_t>(
+      code.size(), static_cast<std::size_t>(std::max(cursorPosition, 0)));
+  std::string_view source(code.data(), end);
+  auto tokens = scan(source);
+
+  auto isWord = [](const TokenView &t) {
+    return t.type == Token::Type::IDENTIFIER || t.type == Token::Type::KEYWORD;
+  };
+  for (std::size_t i = 0; i + 2 < tokens.size(); ++i) {
+    std::string_view next = tokens[i + 2].text(source);
+    if (isWord(tokens[i]) && isWord(tokens[i + 1]) &&
+        (next == "=" || next == ";")) {
+      return std::string(tokens[i].text(source)); // Return the type
     }
   }
 
   return "";
 }
 
-bool Tokenizer::isKeyword(const std::string &word) const {
-  return keywords.count(word) > 0;
-}
-
-bool Tokenizer::isIdentifierStart(char c) const {
-  return std::isalpha(c) || c == '_';
-}
-
-bool Tokenizer::isIdentifierPart(char c) const {
-  return std::isalnum(c) || c == '_';
+bool Tokenizer::isKeyword(std::string_view word) const {
+  if (word.size() > kLongestKeyword)
+    return false;
+  for (std::size_t slot = keywordHash(word);; slot = (slot + 1) & (kKeywordSlots - 1)) {
+    if (keywordSlots[slot].empty())
+      return false;
+    if (keywordSlots[slot] == word)
+      return true;
+  }
 }
 
 bool Tokenizer::isOperator(char c) const {
@@ -4,86 +4,275 @@
 
 namespace codeflow {
 
-Trie::Trie() { root = std::make_shared<TrieNode>(); }
+namespace {
 
-void Trie::insert(const std::string &word, int frequency, long long lastUsed) {
-  auto node = root;
-  for (char c : word) {
-    if (!node->children.count(c)) {
-      node->children[c] = std::make_shared<TrieNode>();
-    }
-    node = node->children[c];
+// Make room for `needed` entries in a node's block of `pool`. A full block is
+// moved to the end of the pool with doubled capacity; the old slots are
+// abandoned, which keeps the waste below the live entry count.
+template <typename T>
+void reserveBlock(std::vector<T> &pool, std::uint32_t &begin,
+                  std::uint16_t count, std::uint16_t &capacity,
+                  std::size_t needed) {
+  if (needed <= capacity)
+    return;
+  std::size_t grown = capacity ? capacity : 1;
+  while (grown < needed)
+    grown *= 2;
+  std::uint32_t moved = static_cast<std::uint32_t>(pool.size());
+  pool.resize(pool.size() + grown);
+  std::copy_n(pool.begin() + begin, count, pool.begin() + moved);
+  begin = moved;
+  capacity = static_cast<std::uint16_t>(grown);
+}
+
+} // namespace
+
+Trie::Trie() { nodes.edit().emplace_back(); }
+
+void Trie::view(std::span<const TrieNode> nodePool,
+                std::span<const TrieEdge> edgePool,
+                std::span<const NodeId> rankedPool, std::size_t words,
+                SymbolId symbolBase) {
+  nodes.view(nodePool);
+  edges.view(edgePool);
+  ranked.view(rankedPool);
+  wordCount = words;
+  base = symbolBase;
+}
+
+void Trie::makeEditable() {
+  if (!nodes.isViewed() && !edges.isViewed() && !ranked.isViewed())
+    return;
+  // Owned nodes hold absolute symbol ids
+  for (TrieNode &n : nodes.edit()) {
+    if (n.isEnd())
+      n.symbol += base;
   }
-  node->word = word;
-  node->isEnd = true;
-  node->frequency = frequency;
-  node->lastUsed =
-      lastUsed ? lastUsed
-               : std::chrono::system_clock::now().time_since_epoch().count();
+  base = 0;
+  edges.edit();
+  ranked.edit();
 }
 
-std::vector<std::string> Trie::search(const std::string &prefix,
-                                      int maxResults) {
-  auto node = root;
+NodeId Trie::findChild(NodeId node, char c) const {
+  const TrieNode &n = nodes[node];
+  const TrieEdge *begin = edges.data() + n.edgeBegin;
+  const TrieEdge *end = begin + n.edgeCount;
+  for (const TrieEdge *e = begin; e != end; ++e) {
+    if (e->label == c)
+      return e->child;
+    if (e->label > c)
+      break; // Edges are sorted by label
+  }
+  return kNoNode;
+}
 
-  // Navigate to prefix
+NodeId Trie::addChild(NodeId node, char c) {
+  auto &nodePool = nodes.edit();
+  auto &edgePool = edges.edit();
+  NodeId child = static_cast<NodeId>(nodePool.size());
+  nodePool.emplace_back();
+
+  TrieNode &n = nodePool[node];
+  reserveBlock(edgePool, n.edgeBegin, n.edgeCount, n.edgeCapacity,
+               n.edgeCount + 1);
+
+  auto first = edgePool.begin() + n.edgeBegin;
+  auto last = first + n.edgeCount;
+  auto pos = std::find_if(first, last,
+                          [c](const TrieEdge &e) { return e.label > c; });
+  std::copy_backward(pos, last, last + 1);
+  *pos = {c, child};
+  n.edgeCount++;
+  return child;
+}
+
+NodeId Trie::findNode(std::string_view prefix) const {
+  NodeId node = 0;
   for (char c : prefix) {
-    if (!node->children.count(c)) {
-      return {}; // No results
+    node = findChild(node, c);
+    if (node == kNoNode)
+      return kNoNode;
+  }
+  return node;
+}
+
+std::string_view Trie::wordOf(const TrieNode &node) const {
+  return SymbolPool::global().view(symbolOf(node));
+}
+
+bool Trie::ranksBefore(NodeId a, NodeId b) const {
+  // Higher frequency first, then shorter words, then alphabetical
+  const TrieNode &x = nodes[a];
+  const TrieNode &y = nodes[b];
+  if (x.frequency != y.frequency)
+    return x.frequency > y.frequency;
+  std::string_view wx = wordOf(x);
+  std::string_view wy = wordOf(y);
+  if (wx.size() != wy.size())
+    return wx.size() < wy.size();
+  return wx < wy;
+}
+
+void Trie::promote(NodeId node, NodeId terminal) {
+  auto &rankedPool = ranked.edit();
+  TrieNode &n = nodes.edit()[node];
+  NodeId *block = rankedPool.data() + n.rankedBegin;
+  std::size_t i = std::find(block, block + n.rankedCount, terminal) - block;
+
+  if (i == n.rankedCount) {
+    if (n.rankedCount < kTopK) {
+      reserveBlock(rankedPool, n.rankedBegin, n.rankedCount, n.rankedCapacity,
+                   n.rankedCount + 1);
+      block = rankedPool.data() + n.rankedBegin;
+      n.rankedCount++;
+    } else if (ranksBefore(terminal, block[kTopK - 1])) {
+      i = kTopK - 1;
+    } else {
+      return; // Not good enough for this subtree's list
     }
-    node = node->children[c];
+    block[i] = terminal;
   }
 
-  // DFS from prefix node
-  std::vector<std::string> results;
-  int count = 0;
-  return dfs(node, count, maxResults);
+  for (; i > 0 && ranksBefore(block[i], block[i - 1]); --i) {
+    std::swap(block[i], block[i - 1]);
+  }
 }
 
-std::vector<std::string> Trie::dfs(std::shared_ptr<TrieNode> node, int &count,
-                                   int maxResults) {
+void Trie::rebuildRanking(NodeId node) {
+  // Children's lists are already correct, so their union (plus this node's
+  // own word) contains this node's top K.
+  std::vector<NodeId> candidates;
+  const TrieNode &n = nodes[node];
+  if (n.isEnd())
+    candidates.push_back(node);
+  for (std::uint32_t i = 0; i < n.edgeCount; ++i) {
+    const TrieNode &child = nodes[edges[n.edgeBegin + i].child];
+    candidates.insert(candidates.end(), ranked.begin() + child.rankedBegin,
+                      ranked.begin() + child.rankedBegin + child.rankedCount);
+  }
+
+  std::size_t keep = std::min(candidates.size(), kTopK);
+  std::partial_sort(
+      candidates.begin(), candidates.begin() + keep, candidates.end(),
+      [this](NodeId a, NodeId b) { return ranksBefore(a, b); });
 
-  std::vector<std::string> results;
+  auto &rankedPool = ranked.edit();
+  TrieNode &target = nodes.edit()[node];
+  reserveBlock(rankedPool, target.rankedBegin, target.rankedCount,
+               target.rankedCapacity, keep);
+  std::copy_n(candidates.begin(), keep, rankedPool.begin() + target.rankedBegin);
+  target.rankedCount = static_cast<std::uint16_t>(keep);
+}
 
-  if (!node)
-    return results;
+void Trie::insert(std::string_view word, int frequency, long long lastUsed) {
+  makeEditable();
+  std::vector<NodeId> path;
+  path.reserve(word.size() + 1);
+  NodeId node = 0;
+  path.push_back(node);
+  for (char c : word) {
+    NodeId next = findChild(node, c);
+    node = next != kNoNode ? next : addChild(node, c);
+    path.push_back(node);
+  }
 
-  if (node->isEnd && count < maxResults) {
-    results.push_back(node->word);
-    count++;
+  TrieNode &n = nodes.edit()[node];
+  bool demoted = n.isEnd() && frequency < n.frequency;
+  if (!n.isEnd()) {
+    n.symbol = SymbolPool::global().intern(word);
+    wordCount++;
   }
+  n.frequency = frequency;
+  n.lastUsed =
+      lastUsed ? lastUsed
+               : std::chrono::system_clock::now().time_since_epoch().count();
+
+  // Keep every ancestor's ranked list current. A rise can only move the word
+  // up; a drop may let an unlisted word in, so those lists are rebuilt from
+  // the children bottom-up.
+  if (!demoted) {
+    for (NodeId ancestor : path)
+      promote(ancestor, node);
+    return;
+  }
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    const TrieNode &a = nodes[*it];
+    const NodeId *block = ranked.data() + a.rankedBegin;
+    if (std::find(block, block + a.rankedCount, node) != block + a.rankedCount)
+      rebuildRanking(*it);
+  }
+}
+
+std::span<const NodeId> Trie::completions(std::string_view prefix) const {
+  NodeId node = findNode(prefix);
+  if (node == kNoNode)
+    return {};
+  const TrieNode &n = nodes[node];
+  return {ranked.data() + n.rankedBegin, n.rankedCount};
+}
+
+void Trie::completions(std::string_view prefix, std::size_t maxResults,
+                       std::vector<NodeId> &out) const {
+  out.clear();
+  // Navigate to prefix
+  NodeId node = findNode(prefix);
+  if (node == kNoNode || maxResults == 0)
+    return; // No results
 
-  // Sort children by frequency for better ranking
-  std::vector<std::pair<char, std::shared_ptr<TrieNode>>> sorted(
-      node->children.begin(), node->children.end());
-  std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
-    return a.second->frequency > b.second->frequency;
-  });
-
-  for (const auto &[c, child] : sorted) {
-    if (count >= maxResults)
-      break;
-    auto subResults = dfs(child, count, maxResults);
-    results.insert(results.end(), subResults.begin(), subResults.end());
+  // Common case: the answer is precomputed on the prefix node
+  const TrieNode &n = nodes[node];
+  if (maxResults <= kTopK) {
+    std::size_t count = std::min<std::size_t>(maxResults, n.rankedCount);
+    out.assign(ranked.begin() + n.rankedBegin,
+               ranked.begin() + n.rankedBegin + count);
+    return;
   }
 
+  // Larger requests rank the whole subtree
+  collect(node, out);
+  std::size_t count = std::min(maxResults, out.size());
+  std::partial_sort(
+      out.begin(), out.begin() + count, out.end(),
+      [this](NodeId a, NodeId b) { return ranksBefore(a, b); });
+  out.resize(count);
+}
+
+std::vector<std::string> Trie::search(const std::string &prefix,
+                                      int maxResults) const {
+  std::vector<NodeId> found;
+  completions(prefix, static_cast<std::size_t>(std::max(maxResults, 0)),
+              found);
+
+  std::vector<std::string> results;
+  results.reserve(found.size());
+  for (NodeId node : found) {
+    results.emplace_back(wordOf(nodes[node]));
+  }
   return results;
 }
 
+void Trie::collect(NodeId node, std::vector<NodeId> &out) const {
+  std::vector<NodeId> stack{node};
+  while (!stack.empty()) {
+    NodeId current = stack.back();
+    stack.pop_back();
+    const TrieNode &n = nodes[current];
+    if (n.isEnd())
+      out.push_back(current);
+    for (std::uint32_t i = 0; i < n.edgeCount; ++i) {
+      stack.push_back(edges[n.edgeBegin + i].child);
+    }
+  }
+}
+
 std::vector<std::string> Trie::getAllWords() const {
   std::vector<std::string> results;
-  std::function<void(std::shared_ptr<TrieNode>)> traverse;
-  traverse = [&](std::shared_ptr<TrieNode> node) {
-    if (!node)
-      return;
-    if (node->isEnd) {
-      results.push_back(node->word);
-    }
-    for (const auto &[c, child] : node->children) {
-      traverse(child);
+  results.reserve(wordCount);
+  for (const TrieNode &n : nodes) {
+    if (n.isEnd()) {
+      results.emplace_back(wordOf(n));
     }
-  };
-  traverse(root);
+  }
   return results;
 }
 
@@ -93,4 +282,8 @@ void Trie::loadWords(const std::vector<std::string> &words) {
   }
 }
 
+std::size_t Trie::memoryUsage() const {
+  return nodes.memoryUsage() + edges.memoryUsage() + ranked.memoryUsage();
+}
+
 } // namespace codeflow
@@ -0,0 +1,168 @@
+#include "../include/usage_counts.h"
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+
+namespace codeflow {
+
+namespace {
+
+constexpr const char *kFileHeader = "codeflow-usage 1";
+
+std::uint64_t pack(float count, std::uint32_t at) {
+  return static_cast<std::uint64_t>(at) << 32 | std::bit_cast<std::uint32_t>(count);
+}
+
+float countOf(std::uint64_t value) {
+  return std::bit_cast<float>(static_cast<std::uint32_t>(value));
+}
+
+std::uint32_t timeOf(std::uint64_t value) {
+  return static_cast<std::uint32_t>(value >> 32);
+}
+
+
+bool fail(std::string *error, const std::string &message) {
+  if (error)
+    *error = message;
+  return false;
+}
+
+} // namespace
+
+UsageCounts::UsageCounts(std::size_t capacity, double halfLifeSeconds)
+    : slots(new Slot[std::bit_ceil(std::max<std::size_t>(capacity, 2))]),
+      mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1),
+      halfLife(halfLifeSeconds > 0 ? halfLifeSeconds
+                                   : kDefaultHalfLifeSeconds) {}
+
+std::uint32_t UsageCounts::now() {
+  return static_cast<std::uint32_t>(
+      std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count());
+}
+
+std::uint64_t UsageCounts::keyOf(std::string_view name) {
+  std::uint64_t key = std::hash<std::string_view>{}(name);
+  return key ? key : 1;
+}
+
+const UsageCounts::Slot *UsageCounts::find(std::uint64_t key) const {
+  for (std::size_t probe = 0, i = key & mask; probe <= mask;
+       ++probe, i = (i + 1) & mask) {
+    std::uint64_t held = slots[i].key.load(std::memory_order_relaxed);
+    if (held == key)
+      return &slots[i];
+    if (held == 0)
+      return nullptr;
+  }
+  return nullptr;
+}
+
+UsageCounts::Slot *UsageCounts::claim(std::uint64_t key, SymbolId symbol) {
+  for (std::size_t probe = 0, i = key & mask; probe <= mask;
+       ++probe, i = (i + 1) & mask) {
+    std::uint64_t held = slots[i].key.load(std::memory_order_relaxed);
+    if (held == 0 && slots[i].key.compare_exchange_strong(
+                         held, key, std::memory_order_relaxed)) {
+      slots[i].symbol.store(symbol, std::memory_order_relaxed);
+      used.fetch_add(1, std::memory_order_relaxed);
+      return &slots[i];
+    }
+    // Lost the race for this slot: held is now its owner
+    if (held == key)
+      return &slots[i];
+  }
+  return nullptr;
+}
+
+float UsageCounts::decayed(std::uint64_t value, std::uint32_t at) const {
+  float count = countOf(value);
+  std::uint32_t last = timeOf(value);
+  if (count == 0.0f || at <= last)
+    return count;
+  return count * static_cast<float>(std::exp2(-double(at - last) / halfLife));
+}
+
+bool UsageCounts::record(std::string_view name, std::uint32_t at,
+                         float weight) {
+  SymbolId symbol = SymbolPool::global().find(name);
+  if (symbol == kNoSymbol)
+    return false;
+  Slot *slot = claim(keyOf(name), symbol);
+  if (!slot)
+    return false;
+  std::uint64_t value = slot->value.load(std::memory_order_relaxed);
+  std::uint64_t next;
+  do {
+    // Decay to the later of the two times, so out-of-order updates from
+    // different threads still add up
+    std::uint32_t last = std::max(at, timeOf(value));
+    next = pack(decayed(value, last) + weight, last);
+  } while (!slot->value.compare_exchange_weak(value, next,
+                                              std::memory_order_relaxed));
+  return true;
+}
+
+float UsageCounts::score(std::string_view name, std::uint32_t at) const {
+  const Slot *slot = find(keyOf(name));
+  return slot ? decayed(slot->value.load(std::memory_order_relaxed), at) : 0.0f;
+}
+
+std::size_t UsageCounts::memoryUsage() const {
+  return capacity() * sizeof(Slot);
+}
+
+bool UsageCounts::save(const std::string &path, std::string *error) const {
+  const SymbolPool &pool = SymbolPool::global();
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream out(temporary, std::ios::trunc);
+    out << kFileHeader << '\n';
+    for (std::size_t i = 0; i <= mask; ++i) {
+      SymbolId symbol = slots[i].symbol.load(std::memory_order_relaxed);
+      std::uint64_t value = slots[i].value.load(std::memory_order_relaxed);
+      // A slot claimed this instant may not have its symbol yet
+      if (symbol == kNoSymbol || countOf(value) <= 0.0f)
+        continue;
+      out << countOf(value) << ' ' << timeOf(value) << ' ' << pool.view(symbol)
+          << '\n';
+    }
+    if (!out)
+      return fail(error, "cannot write " + temporary);
+  }
+  if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return fail(error, "cannot rename " + temporary + " to " + path);
+  }
+  return true;
+}
+
+bool UsageCounts::load(const std::string &path, std::string *error) {
+  std::ifstream in(path);
+  if (!in.is_open())
+    return fail(error, "cannot open " + path);
+  std::string line;
+  if (!std::getline(in, line) || line != kFileHeader)
+    return fail(error, "not a usage file");
+
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    float count;
+    std::uint32_t at;
+    std::string name;
+    if (!(fields >> count >> at >> name) || !(count > 0.0f))
+      continue;
+    // Adding the saved count at its own time decays it like the original
+    record(name, at, count);
+  }
+  return true;
+}
+
+} // namespace codeflow
@@ -0,0 +1,627 @@
+#include "../include/workspace_index.h"
+#include "../include/thread_pool.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <latch>
+#include <map>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace codeflow {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Kind = ScopeIndex::SymbolKind;
+
+constexpr std::array<std::string_view, 10> kSourceExtensions = {
+    "h", "hpp", "hh", "hxx", "ipp", "c", "cc", "cpp", "cxx", "c++"};
+
+// Declarations are shown in completion lists; longer ones are cut
+constexpr std::size_t kMaxDeclarationBytes = 160;
+
+constexpr std::uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO |
+                                     IN_MOVED_FROM | IN_CREATE | IN_DELETE |
+                                     IN_ONLYDIR | IN_DONT_FOLLOW |
+                                     IN_EXCL_UNLINK;
+
+bool fail(std::string *error, std::string message) {
+  if (error)
+    *error = std::move(message);
+  return false;
+}
+
+char foldCase(char c) { return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c; }
+
+// Negative, zero or positive as a sorts before, with or after b, ignoring
+// ASCII case
+int compareFolded(std::string_view a, std::string_view b) {
+  const std::size_t n = std::min(a.size(), b.size());
+  for (std::size_t i = 0; i < n; ++i) {
+    const char x = foldCase(a[i]), y = foldCase(b[i]);
+    if (x != y)
+      return static_cast<unsigned char>(x) < static_cast<unsigned char>(y) ? -1
+                                                                           : 1;
+  }
+  return a.size() < b.size() ? -1 : a.size() > b.size() ? 1 : 0;
+}
+
+// Directories the walk and the watch leave out
+bool skipDirectory(std::string_view name) {
+  return name.starts_with('.') || name == "node_modules";
+}
+
+std::string join(const std::string &directory, std::string_view name) {
+  return directory.empty() ? std::string(name)
+                           : directory + "/" + std::string(name);
+}
+
+// Calls visit(path, isDirectory) for everything under root/relative that
+// is not in a skipped directory, with paths relative to root. Symbolic
+// links are neither followed nor visited.
+template <typename Visit>
+void walk(const std::string &root, const std::string &relative, Visit visit) {
+  std::error_code ec;
+  const fs::path base(root);
+  fs::recursive_directory_iterator it(
+      relative.empty() ? base : base / relative,
+      fs::directory_options::skip_permission_denied, ec);
+  for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    const fs::directory_entry &entry = *it;
+    if (entry.is_symlink(ec))
+      continue;
+    const bool directory = entry.is_directory(ec);
+    if (directory && skipDirectory(entry.path().filename().native())) {
+      it.disable_recursion_pending();
+      continue;
+    }
+    visit(entry.path().lexically_relative(base).generic_string(), directory);
+  }
+}
+
+// Whether the declaration of symbol is qualified ("void Point::norm()"):
+// a definition of something declared elsewhere
+bool qualified(const ScopeIndex &scopes, const ScopeIndex::Symbol &symbol) {
+  std::string_view before = scopes.source().substr(0, symbol.name.offset);
+  while (!before.empty() &&
+         (before.back() == ' ' || before.back() == '\t' || before.back() == '\n'))
+    before.remove_suffix(1);
+  return before.ends_with("::");
+}
+
+} // namespace
+
+std::size_t WorkspaceFile::memoryUsage() const {
+  return sizeof(WorkspaceFile) + path.capacity() + text.capacity() +
+         symbols.capacity() * sizeof(WorkspaceSymbol);
+}
+
+std::span<const WorkspaceSymbols::Ref>
+WorkspaceSymbols::withPrefix(std::string_view prefix) const {
+  auto first = std::lower_bound(
+      byName.begin(), byName.end(), prefix, [&](Ref ref, std::string_view p) {
+        return compareFolded(symbol(ref).name, p) < 0;
+      });
+  auto last = std::upper_bound(
+      first, byName.end(), prefix, [&](std::string_view p, Ref ref) {
+        return compareFolded(p, symbol(ref).name.substr(0, p.size())) < 0;
+      });
+  return {first, last};
+}
+
+namespace {
+
+// The symbol named exactly name whose kind passes accept, preferring one
+// with members (a definition over a forward declaration)
+const WorkspaceSymbols::Ref *findNamed(const WorkspaceSymbols &symbols,
+                                       std::string_view name, auto accept) {
+  const WorkspaceSymbols::Ref *found = nullptr;
+  for (const WorkspaceSymbols::Ref &ref : symbols.withPrefix(name)) {
+    const WorkspaceSymbol &symbol = symbols.symbol(ref);
+    if (symbol.name != name || !accept(symbol.kind))
+      continue;
+    if (!found || (symbol.memberCount > 0 &&
+                   symbols.symbol(*found).memberCount == 0))
+      found = &ref;
+  }
+  return found;
+}
+
+} // namespace
+
+const WorkspaceSymbols::Ref *
+WorkspaceSymbols::findType(std::string_view name) const {
+  return findNamed(*this, name, [](Kind kind) {
+    return kind == Kind::Type || kind == Kind::Alias;
+  });
+}
+
+const WorkspaceSymbols::Ref *
+WorkspaceSymbols::findVariable(std::string_view name) const {
+  return findNamed(*this, name,
+                   [](Kind kind) { return kind == Kind::Variable; });
+}
+
+std::span<const WorkspaceSymbol> WorkspaceSymbols::members(Ref type) const {
+  const WorkspaceSymbol &symbol = this->symbol(type);
+  return std::span<const WorkspaceSymbol>(files[type.file]->symbols)
+      .subspan(symbol.firstMember, symbol.memberCount);
+}
+
+bool WorkspaceIndex::isSource(std::string_view path) {
+  const std::size_t dot = path.rfind('.');
+  if (dot == std::string_view::npos || path.find('/', dot) != std::string_view::npos)
+    return false;
+  std::string_view extension = path.substr(dot + 1);
+  return std::find(kSourceExtensions.begin(), kSourceExtensions.end(),
+                   extension) != kSourceExtensions.end();
+}
+
+std::shared_ptr<const WorkspaceFile>
+WorkspaceIndex::indexText(std::string path, std::string_view text) {
+  thread_local ScopeIndex scopes;
+  scopes.build(text);
+  const auto &all = scopes.symbols();
+
+  // Namespace-scope declarations, then each class's members after them
+  struct Kept {
+    const ScopeIndex::Symbol *symbol;
+    std::uint32_t container; // Index of the class in kept, or kNone
+  };
+  std::vector<Kept> kept;
+  for (std::uint32_t scope = 0; scope < scopes.scopes().size(); ++scope) {
+    const ScopeIndex::ScopeKind kind = scopes.scopes()[scope].kind;
+    if (kind != ScopeIndex::ScopeKind::File &&
+        kind != ScopeIndex::ScopeKind::Namespace)
+      continue;
+    for (std::uint32_t at : scopes.symbolsIn(scope)) {
+      const ScopeIndex::Symbol &symbol = all[at];
+      if (symbol.kind != Kind::Parameter && symbol.kind != Kind::Field &&
+          scopes.view(symbol.name) != "operator" && !qualified(scopes, symbol))
+        kept.push_back({&symbol, ScopeIndex::kNone});
+    }
+  }
+  const std::size_t topLevel = kept.size();
+  std::vector<std::pair<std::uint32_t, std::uint32_t>> memberRanges(topLevel);
+  for (std::uint32_t type = 0; type < topLevel; ++type) {
+    const ScopeIndex::Symbol &symbol = *kept[type].symbol;
+    if (symbol.kind != Kind::Type || symbol.body == ScopeIndex::kNone)
+      continue;
+    const std::string_view className = scopes.view(symbol.name);
+    const auto first = static_cast<std::uint32_t>(kept.size());
+    for (std::uint32_t at : scopes.symbolsIn(symbol.body)) {
+      const ScopeIndex::Symbol &member = all[at];
+      const std::string_view name = scopes.view(member.name);
+      if ((member.kind == Kind::Field || member.kind == Kind::Function) &&
+          name != className && name != "operator")
+        kept.push_back({&member, type});
+    }
+    memberRanges[type] = {first, static_cast<std::uint32_t>(kept.size()) - first};
+  }
+
+  // Copy the kept text once, into a string sized up front so the views
+  // taken while appending stay valid
+  auto declarationOf = [&](const ScopeIndex::Symbol &symbol) {
+    std::string_view declaration = scopes.view(symbol.declaration);
+    if (declaration.size() > kMaxDeclarationBytes) {
+      std::size_t cut = kMaxDeclarationBytes;
+      while (cut > 0 && (static_cast<unsigned char>(declaration[cut]) & 0xC0) == 0x80)
+        cut--;
+      declaration = declaration.substr(0, cut);
+    }
+    return declaration;
+  };
+  auto file = std::make_shared<WorkspaceFile>();
+  file->path = std::move(path);
+  file->bytes = text.size();
+  std::size_t bytes = 0;
+  for (const Kept &k : kept) {
+    bytes += k.symbol->name.length + k.symbol->type.length +
+             declarationOf(*k.symbol).size();
+  }
+  file->text.reserve(bytes);
+  auto copy = [&](std::string_view from) {
+    const std::size_t at = file->text.size();
+    file->text.append(from);
+    return std::string_view(file->text).substr(at, from.size());
+  };
+  file->symbols.reserve(kept.size());
+  for (const Kept &k : kept) {
+    const ScopeIndex::Symbol &symbol = *k.symbol;
+    WorkspaceSymbol out{copy(scopes.view(symbol.name)),
+                        copy(scopes.view(symbol.type)),
+                        copy(declarationOf(symbol)),
+                        k.container == ScopeIndex::kNone
+                            ? std::string_view()
+                            : file->symbols[k.container].name,
+                        symbol.kind,
+                        0,
+                        0};
+    if (k.container == ScopeIndex::kNone && file->symbols.size() < topLevel) {
+      out.firstMember = memberRanges[file->symbols.size()].first;
+      out.memberCount = memberRanges[file->symbols.size()].second;
+    }
+    file->symbols.push_back(out);
+  }
+  return file;
+}
+
+std::shared_ptr<const WorkspaceFile>
+WorkspaceIndex::indexFile(const std::string &path) const {
+  const std::string full = rootPath + "/" + path;
+  int fd = ::open(full.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return nullptr;
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+      static_cast<std::uint64_t>(info.st_size) > kMaxFileBytes) {
+    ::close(fd);
+    return nullptr;
+  }
+  // Read rather than mapped: a file truncated by an editor while it is
+  // indexed would raise SIGBUS through a mapping. The buffer is reused
+  // across the files a thread indexes; indexText copies what it keeps.
+  thread_local std::string text;
+  text.resize(static_cast<std::size_t>(info.st_size));
+  std::size_t length = 0;
+  while (length < text.size()) {
+    const ssize_t n = ::pread(fd, text.data() + length, text.size() - length,
+                              static_cast<off_t>(length));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0) {
+      ::close(fd);
+      return nullptr;
+    }
+    if (n == 0)
+      break; // Truncated since fstat
+    length += static_cast<std::size_t>(n);
+  }
+  ::close(fd);
+  return indexText(path, std::string_view(text.data(), length));
+}
+
+WorkspaceIndex::~WorkspaceIndex() { stopWatching(); }
+
+bool WorkspaceIndex::open(const std::string &root, std::size_t threads,
+                          std::string *error) {
+  stopWatching();
+  std::lock_guard<std::mutex> lock(writeMutex);
+  std::error_code ec;
+  const fs::path base = fs::absolute(root, ec).lexically_normal();
+  if (ec || !fs::is_directory(base, ec))
+    return fail(error, root + " is not a directory");
+
+  const Clock::time_point start = Clock::now();
+  rootPath = base.string();
+  while (rootPath.size() > 1 && rootPath.back() == '/')
+    rootPath.pop_back();
+  std::vector<std::string> paths;
+  walk(rootPath, "", [&](std::string path, bool directory) {
+    if (!directory && isSource(path))
+      paths.push_back(std::move(path));
+  });
+
+  // Workers take the next file until none are left
+  std::vector<std::shared_ptr<const WorkspaceFile>> files(paths.size());
+  if (!paths.empty()) {
+    std::size_t workers =
+        threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min(workers, paths.size());
+    std::atomic<std::size_t> next{0};
+    std::latch done(static_cast<std::ptrdiff_t>(workers));
+    ThreadPool pool(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+      pool.submit([&](const std::atomic<bool> &) {
+        for (std::size_t at; (at = next.fetch_add(1)) < paths.size();)
+          files[at] = indexFile(paths[at]);
+        done.count_down();
+      });
+    }
+    done.wait();
+  }
+
+  const std::size_t found = files.size();
+  std::erase(files, nullptr);
+  std::uint64_t bytes = 0;
+  for (const auto &file : files)
+    bytes += file->bytes;
+  const double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  {
+    std::lock_guard<std::mutex> stats(statsMutex);
+    counters.indexedFiles = files.size();
+    counters.indexedBytes = bytes;
+    counters.skippedFiles = found - files.size();
+    counters.indexMs = seconds * 1e3;
+    counters.filesPerSecond = seconds > 0 ? files.size() / seconds : 0;
+    counters.megabytesPerSecond = seconds > 0 ? bytes / seconds / 1e6 : 0;
+    counters.updates = 0;
+    counters.updatedFiles = 0;
+  }
+  publish(std::move(files));
+  return true;
+}
+
+void WorkspaceIndex::update(const std::vector<std::string> &paths) {
+  std::lock_guard<std::mutex> lock(writeMutex);
+  if (rootPath.empty())
+    return;
+  std::map<std::string, std::shared_ptr<const WorkspaceFile>> byPath;
+  for (const auto &file : published.acquire()->files)
+    byPath.emplace(file->path, file);
+
+  std::uint64_t changed = 0;
+  auto reindex = [&](const std::string &path) {
+    if (auto file = indexFile(path)) {
+      byPath[path] = std::move(file);
+      changed++;
+    }
+  };
+  for (const std::string &path : paths) {
+    // Drop what was indexed at or under path, then index what is there now
+    if (path.empty()) {
+      changed += byPath.size();
+      byPath.clear();
+    } else {
+      changed += byPath.erase(path);
+      const std::string under = path + "/";
+      auto it = byPath.lower_bound(under);
+      while (it != byPath.end() && it->first.starts_with(under)) {
+        it = byPath.erase(it);
+        changed++;
+      }
+    }
+    std::error_code ec;
+    if (fs::is_directory(path.empty() ? rootPath : rootPath + "/" + path, ec)) {
+      walk(rootPath, path, [&](const std::string &inner, bool directory) {
+        if (!directory && isSource(inner))
+          reindex(inner);
+      });
+    } else if (isSource(path)) {
+      reindex(path);
+    }
+  }
+
+  std::vector<std::shared_ptr<const WorkspaceFile>> files;
+  files.reserve(byPath.size());
+  for (auto &[path, file] : byPath)
+    files.push_back(std::move(file));
+  {
+    std::lock_guard<std::mutex> stats(statsMutex);
+    counters.updates++;
+    counters.updatedFiles += changed;
+  }
+  publish(std::move(files));
+}
+
+void WorkspaceIndex::close() {
+  stopWatching();
+  std::lock_guard<std::mutex> lock(writeMutex);
+  rootPath.clear();
+  {
+    std::lock_guard<std::mutex> stats(statsMutex);
+    counters = WorkspaceStats();
+  }
+  publish({});
+}
+
+void WorkspaceIndex::publish(
+    std::vector<std::shared_ptr<const WorkspaceFile>> files) {
+  using Ref = WorkspaceSymbols::Ref;
+  auto next = std::make_shared<WorkspaceSymbols>();
+  std::sort(files.begin(), files.end(), [](const auto &a, const auto &b) {
+    return a->path < b->path;
+  });
+  next->files = std::move(files);
+
+  // Files carried over from the current snapshot keep their place in its
+  // byName, under their new index: both lists are sorted by path, so the
+  // order of the kept refs holds. Only the new files' refs are sorted, then
+  // merged in, so an update costs the size of the change plus one pass.
+  const std::shared_ptr<const WorkspaceSymbols> previous = published.acquire();
+  constexpr std::uint32_t kGone = ~std::uint32_t(0);
+  std::vector<std::uint32_t> remap(previous->files.size(), kGone);
+  std::vector<Ref> fresh;
+  std::size_t memory = sizeof(WorkspaceSymbols);
+  for (std::uint32_t f = 0, old = 0; f < next->files.size(); ++f) {
+    const WorkspaceFile &file = *next->files[f];
+    next->bytes += file.bytes;
+    next->symbolCount += file.symbols.size();
+    memory += file.memoryUsage();
+    while (old < previous->files.size() &&
+           previous->files[old]->path < file.path)
+      ++old;
+    if (old < previous->files.size() && previous->files[old] == next->files[f]) {
+      remap[old++] = f;
+      continue;
+    }
+    for (std::uint32_t s = 0; s < file.symbols.size(); ++s) {
+      if (file.symbols[s].container.empty())
+        fresh.push_back({f, s});
+    }
+  }
+  auto before = [&](Ref a, Ref b) {
+    std::string_view x = next->symbol(a).name, y = next->symbol(b).name;
+    int order = compareFolded(x, y);
+    if (order != 0)
+      return order < 0;
+    return x != y ? x < y : a.file < b.file;
+  };
+  std::sort(fresh.begin(), fresh.end(), before);
+  std::vector<Ref> kept;
+  kept.reserve(previous->byName.size());
+  for (Ref ref : previous->byName) {
+    if (remap[ref.file] != kGone)
+      kept.push_back({remap[ref.file], ref.symbol});
+  }
+  next->byName.resize(kept.size() + fresh.size());
+  std::merge(kept.begin(), kept.end(), fresh.begin(), fresh.end(),
+             next->byName.begin(), before);
+  memory += next->byName.capacity() * sizeof(Ref);
+
+  {
+    std::lock_guard<std::mutex> stats(statsMutex);
+    counters.files = next->files.size();
+    counters.symbols = next->symbolCount;
+    counters.bytes = next->bytes;
+    counters.memoryBytes = memory;
+  }
+  published.publish(std::move(next));
+}
+
+WorkspaceStats WorkspaceIndex::stats() const {
+  std::lock_guard<std::mutex> lock(statsMutex);
+  return counters;
+}
+
+bool WorkspaceIndex::watch(std::string *error) {
+  std::lock_guard<std::mutex> guard(watchMutex);
+  if (watcher.joinable())
+    return true;
+  {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (rootPath.empty())
+      return fail(error, "no workspace is open");
+  }
+  inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd < 0)
+    return fail(error, std::string("inotify: ") + std::strerror(errno));
+  wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd < 0) {
+    ::close(inotifyFd);
+    inotifyFd = -1;
+    return fail(error, std::string("eventfd: ") + std::strerror(errno));
+  }
+  watchTree("");
+  {
+    std::lock_guard<std::mutex> stats(statsMutex);
+    counters.watching = true;
+  }
+  watcher = std::thread([this] { watchLoop(); });
+  return true;
+}
+
+void WorkspaceIndex::stopWatching() {
+  std::lock_guard<std::mutex> guard(watchMutex);
+  if (!watcher.joinable())
+    return;
+  const std::uint64_t one = 1;
+  if (::write(wakeFd, &one, sizeof one) < 0) {
+    // The counter cannot overflow at one; the loop wakes regardless
+  }
+  watcher.join();
+  ::close(inotifyFd);
+  ::close(wakeFd);
+  inotifyFd = wakeFd = -1;
+  watches.clear();
+  std::lock_guard<std::mutex> stats(statsMutex);
+  counters.watching = false;
+  counters.watchedDirectories = 0;
+}
+
+void WorkspaceIndex::watchTree(const std::string &directory) {
+  auto add = [&](const std::string &path) {
+    const std::string full = path.empty() ? rootPath : rootPath + "/" + path;
+    const int wd = ::inotify_add_watch(inotifyFd, full.c_str(), kWatchMask);
+    if (wd >= 0)
+      watches[wd] = path;
+  };
+  add(directory);
+  walk(rootPath, directory, [&](const std::string &path, bool isDirectory) {
+    if (isDirectory)
+      add(path);
+  });
+  std::lock_guard<std::mutex> stats(statsMutex);
+  counters.watchedDirectories = watches.size();
+}
+
+void WorkspaceIndex::unwatchTree(const std::string &directory) {
+  const std::string under = directory + "/";
+  for (auto it = watches.begin(); it != watches.end();) {
+    if (it->second == directory || it->second.starts_with(under)) {
+      ::inotify_rm_watch(inotifyFd, it->first);
+      it = watches.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  std::lock_guard<std::mutex> stats(statsMutex);
+  counters.watchedDirectories = watches.size();
+}
+
+void WorkspaceIndex::watchLoop() {
+  alignas(inotify_event) char buffer[64 * 1024];
+  std::vector<std::string> changed;
+  bool overflowed = false;
+  while (true) {
+    pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {wakeFd, POLLIN, 0}};
+    const bool pending = overflowed || !changed.empty();
+    const int ready = ::poll(fds, 2, pending ? kSettleMs : -1);
+    if (ready < 0 && errno == EINTR)
+      continue;
+    if (ready < 0 || (fds[1].revents & POLLIN))
+      break;
+    if (ready == 0) {
+      // Quiet since the last event: apply the burst. After an overflow
+      // events were lost, so the whole tree is indexed again.
+      if (overflowed) {
+        changed.assign(1, "");
+        // Directories created meanwhile have no watch yet
+        watchTree("");
+      }
+      std::sort(changed.begin(), changed.end());
+      changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+      update(changed);
+      changed.clear();
+      overflowed = false;
+      continue;
+    }
+
+    const ssize_t length = ::read(inotifyFd, buffer, sizeof buffer);
+    for (ssize_t at = 0; at < length;) {
+      const auto *event = reinterpret_cast<const inotify_event *>(buffer + at);
+      at += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      if (event->mask & IN_Q_OVERFLOW) {
+        overflowed = true;
+        continue;
+      }
+      auto directory = watches.find(event->wd);
+      if (directory == watches.end())
+        continue;
+      if (event->mask & IN_IGNORED) {
+        watches.erase(directory);
+        continue;
+      }
+      if (event->len == 0)
+        continue;
+      const std::string_view name(event->name);
+      const std::string path = join(directory->second, name);
+      if (event->mask & IN_ISDIR) {
+        if (skipDirectory(name))
+          continue;
+        if (event->mask & (IN_CREATE | IN_MOVED_TO))
+          watchTree(path);
+        else
+          unwatchTree(path);
+        changed.push_back(path);
+      } else if (!(event->mask & IN_CREATE) && isSource(name)) {
+        // A created file is indexed once it is written and closed
+        changed.push_back(path);
+      }
+    }
+  }
+}
+
+} // namespace codeflow
@@ -5,6 +5,9 @@
 
 const http = require('http');
 const app = require('./server');
+const config = require('./config');
+const { InMemoryJobQueue } = require('./src/queue/jobQueue');
+const { OutputStream } = require('./src/queue/outputStream');
 
 const PORT = 3096;
 let server;
@@ -119,6 +122,19 @@ async function runTests() {
       const queueMetrics = await request({ path: '/api/jobs', method: 'GET' });
       assert('GET /api/jobs returns active workers & processed count', queueMetrics.status === 200 && queueMetrics.json?.totalProcessed >= 2);
 
+      // 9. A streaming reader that never advances still lets the hard kill
+      // finish the run
+      const hardKillMs = config.EXECUTION_HARD_KILL_TIMEOUT_MS;
+      config.EXECUTION_HARD_KILL_TIMEOUT_MS = 500;
+      const stalledJob = { stream: new OutputStream({ capacityBytes: 1024 }) };
+      stalledJob.stream.reader();
+      const stalled = await Promise.race([
+        new InMemoryJobQueue({ profilerPath: null }).runStreamed(stalledJob, 'yes', { streamStdout: true }),
+        new Promise(r => setTimeout(() => r(null), 5000))
+      ]);
+      config.EXECUTION_HARD_KILL_TIMEOUT_MS = hardKillMs;
+      assert('Hard kill settles a run whose reader stopped reading', stalled?.timedOut === true);
+
       console.log('\n================================================');
       console.log(`📊 Concurrency & Scaling Test Suite Complete!`);
       console.log('================================================\n');
@@ -0,0 +1,111 @@
+// Compile latency of typical submissions through CodeRunner, with and
+// without the precompiled headers for their include set. The compile cache
+// is off, so every run compiles.
+//
+//   codeflow_bench_compile [--rounds N] [--pch-dir DIR]
+//
+// DIR defaults to a fresh temporary directory, so the one-off cost of
+// building the headers is reported too.
+#include "../include/code_runner.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Submission {
+  const char *name;
+  const char *code;
+};
+
+const Submission kSubmissions[] = {
+    {"bits/stdc++.h",
+     "#include <bits/stdc++.h>\nusing namespace std;\n"
+     "int main() { vector<int> v{3, 1, 2}; sort(v.begin(), v.end());\n"
+     "  cout << v[0] << '\\n'; }\n"},
+    {"algorithm+iostream+string+vector",
+     "#include <algorithm>\n#include <iostream>\n#include <string>\n"
+     "#include <vector>\nusing namespace std;\n"
+     "int main() { vector<string> v{\"b\", \"a\"}; sort(v.begin(), v.end());\n"
+     "  cout << v[0] << '\\n'; }\n"},
+    {"iostream",
+     "#include <iostream>\n"
+     "int main() { std::cout << \"hello\" << std::endl; }\n"},
+    {"map (no profile)",
+     "#include <map>\n#include <cstdio>\n"
+     "int main() { std::map<int, int> m{{1, 2}}; std::printf(\"%d\\n\", "
+     "m[1]); }\n"},
+};
+
+int usage() {
+  std::fprintf(stderr,
+               "usage: codeflow_bench_compile [--rounds N] [--pch-dir DIR]\n");
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int rounds = 5;
+  std::string pchDirectory;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if ((arg == "--rounds" || arg == "--pch-dir") && i + 1 >= argc)
+      return usage();
+    if (arg == "--rounds")
+      rounds = std::max(1, std::atoi(argv[++i]));
+    else if (arg == "--pch-dir")
+      pchDirectory = argv[++i];
+    else
+      return usage();
+  }
+
+  bool temporary = pchDirectory.empty();
+  if (temporary) {
+    char pattern[] = "/tmp/codeflow_bench_pch-XXXXXX";
+    if (::mkdtemp(pattern) == nullptr) {
+      std::perror("codeflow_bench_compile: mkdtemp");
+      return 1;
+    }
+    pchDirectory = pattern;
+  }
+
+  {
+    CodeRunner runner("", 0, pchDirectory);
+    auto start = Clock::now();
+    std::size_t ready = runner.warmPrecompiledHeaders();
+    std::chrono::duration<double> took = Clock::now() - start;
+    std::printf("%zu precompiled include sets ready in %.1f s\n\n", ready,
+                took.count());
+  }
+
+  std::printf("%-34s %14s %14s %8s\n", "submission", "no pch ms", "pch ms",
+              "speedup");
+  for (const Submission &submission : kSubmissions) {
+    CodeRunner plain("", 0, "");
+    CodeRunner precompiled("", 0, pchDirectory);
+    for (int round = 0; round < rounds; ++round) {
+      plain.runCode(submission.code);
+      precompiled.runCode(submission.code);
+    }
+    codeflow::PchStats without = plain.getPchStats();
+    codeflow::PchStats with = precompiled.getPchStats();
+    // A submission no profile matches is compiled without one either way
+    double pchMs = with.compilesWithPch ? with.medianWithPchMs
+                                        : with.medianWithoutPchMs;
+    std::printf("%-34s %14.0f %14.0f %7.1fx\n", submission.name,
+                without.medianWithoutPchMs, pchMs,
+                without.medianWithoutPchMs / pchMs);
+  }
+
+  if (temporary) {
+    std::error_code ignored;
+    std::filesystem::remove_all(pchDirectory, ignored);
+  }
+  return 0;
+}
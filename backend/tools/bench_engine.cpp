@@ -0,0 +1,652 @@
+// Latency and throughput of the completion engine's hot paths over the real
+// symbol index: trie insert and search, tokenizer scans, updateSymbols on
+// synthetic sources of 1k to 100k lines, the scope index's build and type
+// resolution at a cursor, indexing a synthetic workspace of sources and
+// re-indexing one of its files, and getSuggestions in member,
+// global and keyword contexts, and the route's completeJson on response
+// cache misses and hits. Last, what the engine's own stage metrics
+// (EngineMetrics) add to each getSuggestions context, against a budget of
+// 2% of the query.
+//
+//   codeflow_bench_engine [INDEX] [--filter TEXT] [--min-time-ms N]
+//                         [--json FILE] [--compare BASELINE]
+//                         [--threshold PCT] [--tail-threshold PCT]
+//
+// INDEX defaults to CODEFLOW_INDEX_FILE from the environment, then to the
+// index the build produced. Every benchmark warms up untimed first, then
+// times single operations until it has run for --min-time-ms (default 500)
+// and collected its minimum sample count. Each sample has the measured cost
+// of reading the clock subtracted. Reported: p50, p99 and p999 latency,
+// and throughput from the mean.
+//
+// --json writes the results for a later --compare, which flags every
+// benchmark whose p50 grew by more than --threshold percent (default 10)
+// or whose p99 grew by more than --tail-threshold percent (default 25), and
+// exits with 1 if any did (2 for bad arguments or an unreadable baseline).
+// Metrics over budget exit with 1 too.
+// Build optimized (CMAKE_BUILD_TYPE=Release) for numbers worth storing; the
+// JSON records whether it was.
+#include "../include/engine_metrics.h"
+#include "../include/index_file.h"
+#include "../include/json.h"
+#include "../include/scope_index.h"
+#include "../include/suggestion_engine.h"
+#include "../include/workspace_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace codeflow;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+  std::string index;
+  std::string filter;
+  double minTimeMs = 500;
+  std::string jsonPath;
+  std::string baselinePath;
+  double threshold = 10;
+  double tailThreshold = 25;
+};
+
+struct Result {
+  std::string name;
+  std::size_t samples = 0;
+  double p50 = 0, p99 = 0, p999 = 0, mean = 0; // Nanoseconds per operation
+  double bytesPerOp = 0;                       // 0 where bytes mean nothing
+
+  double opsPerSecond() const { return mean > 0 ? 1e9 / mean : 0; }
+};
+
+// Median cost of one Clock::now() pair, subtracted from every sample
+double timerOverheadNs() {
+  std::vector<double> samples(10000);
+  for (double &sample : samples) {
+    auto start = Clock::now();
+    auto end = Clock::now();
+    sample = std::chrono::duration<double, std::nano>(end - start).count();
+  }
+  std::nth_element(samples.begin(), samples.begin() + samples.size() / 2,
+                   samples.end());
+  return samples[samples.size() / 2];
+}
+
+// Nearest rank: the smallest sample at or above fraction q of them
+double percentile(const std::vector<double> &sorted, double q) {
+  std::size_t rank = static_cast<std::size_t>(std::ceil(q * sorted.size()));
+  return sorted[std::min(sorted.size() - 1, rank == 0 ? 0 : rank - 1)];
+}
+
+class Bench {
+public:
+  explicit Bench(const Options &options)
+      : options(options), overhead(timerOverheadNs()) {}
+
+  bool selected(const std::string &name) const {
+    return options.filter.empty() ||
+           name.find(options.filter) != std::string::npos;
+  }
+
+  // Time op() one call per sample. before() runs untimed ahead of each
+  // call, for resetting state.
+  template <typename Op, typename Before>
+  void measure(const std::string &name, std::size_t minSamples,
+               double bytesPerOp, Op op, Before before) {
+    if (!selected(name))
+      return;
+    using Ms = std::chrono::duration<double, std::milli>;
+    const double warmupMs = options.minTimeMs / 10;
+    std::size_t warmups = 0;
+    for (auto start = Clock::now();
+         warmups < minSamples / 10 || Ms(Clock::now() - start).count() < warmupMs;
+         ++warmups) {
+      before();
+      op();
+    }
+
+    constexpr std::size_t kMaxSamples = 2'000'000;
+    std::vector<double> samples;
+    samples.reserve(std::min(kMaxSamples, std::max<std::size_t>(minSamples, 4096)));
+    double spentMs = 0;
+    while ((samples.size() < minSamples || spentMs < options.minTimeMs) &&
+           samples.size() < kMaxSamples) {
+      before();
+      auto start = Clock::now();
+      op();
+      auto end = Clock::now();
+      double took = std::chrono::duration<double, std::nano>(end - start).count();
+      spentMs += took / 1e6;
+      samples.push_back(std::max(0.0, took - overhead));
+    }
+
+    Result result;
+    result.name = name;
+    result.samples = samples.size();
+    result.bytesPerOp = bytesPerOp;
+    double total = 0;
+    for (double sample : samples)
+      total += sample;
+    result.mean = total / samples.size();
+    std::sort(samples.begin(), samples.end());
+    result.p50 = percentile(samples, 0.50);
+    result.p99 = percentile(samples, 0.99);
+    result.p999 = percentile(samples, 0.999);
+    print(result);
+    results.push_back(std::move(result));
+  }
+
+  template <typename Op>
+  void measure(const std::string &name, std::size_t minSamples,
+               double bytesPerOp, Op op) {
+    measure(name, minSamples, bytesPerOp, op, [] {});
+  }
+
+  const std::vector<Result> &all() const { return results; }
+  double timerOverhead() const { return overhead; }
+
+private:
+  const Options &options;
+  double overhead;
+  std::vector<Result> results;
+
+  static std::string duration(double ns) {
+    char text[32];
+    if (ns < 1e3)
+      std::snprintf(text, sizeof(text), "%.0f ns", ns);
+    else if (ns < 1e6)
+      std::snprintf(text, sizeof(text), "%.2f us", ns / 1e3);
+    else
+      std::snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+    return text;
+  }
+
+  static void print(const Result &r) {
+    char bandwidth[32] = "";
+    if (r.bytesPerOp > 0)
+      std::snprintf(bandwidth, sizeof(bandwidth), "%.1f MB/s",
+                    r.bytesPerOp * r.opsPerSecond() / 1e6);
+    std::printf("%-36s %9zu %11s %11s %11s %13.0f %12s\n", r.name.c_str(),
+                r.samples, duration(r.p50).c_str(), duration(r.p99).c_str(),
+                duration(r.p999).c_str(), r.opsPerSecond(), bandwidth);
+    std::fflush(stdout);
+  }
+};
+
+// A plausible translation unit of about `lines` lines: includes, then
+// functions filling and sorting containers, with comments and strings
+std::string syntheticSource(int lines) {
+  std::string code = "#include <algorithm>\n#include <iostream>\n"
+                     "#include <map>\n#include <string>\n#include <vector>\n"
+                     "using namespace std;\n\nvector<int> values;\n";
+  int line = 8;
+  for (int f = 0; line < lines; ++f, line += 12) {
+    std::string n = std::to_string(f);
+    code += "// Fills and sorts batch " + n + "\n"
+            "int process" + n + "(vector<int>& items" + n + ") {\n"
+            "  map<string, int> counts" + n + ";\n"
+            "  for (int i = 0; i < 16; ++i) {\n"
+            "    items" + n + ".push_back(i * " + n + " % 7);\n"
+            "    counts" + n + "[\"key\" + to_string(i)] += i;\n"
+            "  }\n"
+            "  sort(items" + n + ".begin(), items" + n + ".end());\n"
+            "  auto it = lower_bound(items" + n + ".begin(), items" + n + ".end(), 3);\n"
+            "  cout << \"batch " + n + ": \" << counts" + n + ".size() << endl;\n"
+            "  return it == items" + n + ".end() ? 0 : *it;\n"
+            "}\n";
+  }
+  return code;
+}
+
+std::string escape(const std::string &text) {
+  std::string out;
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      out += '\\';
+    if (static_cast<unsigned char>(c) >= 0x20)
+      out += c;
+  }
+  return out;
+}
+
+bool writeJson(const Options &options, const Bench &bench) {
+  std::ofstream out(options.jsonPath, std::ios::trunc);
+  char timestamp[32];
+  std::time_t now = std::time(nullptr);
+  std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ",
+                std::gmtime(&now));
+#ifdef __OPTIMIZE__
+  const bool optimized = true;
+#else
+  const bool optimized = false;
+#endif
+  out << std::fixed << std::setprecision(1);
+  out << "{\n  \"version\": 1,\n  \"timestamp\": \"" << timestamp
+      << "\",\n  \"compiler\": \"" << escape(__VERSION__)
+      << "\",\n  \"optimized\": " << (optimized ? "true" : "false")
+      << ",\n  \"index\": \"" << escape(options.index)
+      << "\",\n  \"minTimeMs\": " << options.minTimeMs
+      << ",\n  \"timerOverheadNs\": " << bench.timerOverhead()
+      << ",\n  \"benchmarks\": [";
+  const auto &results = bench.all();
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    out << (i ? ",\n" : "\n") << "    {\"name\": \"" << escape(r.name)
+        << "\", \"samples\": " << r.samples << ", \"p50Ns\": " << r.p50
+        << ", \"p99Ns\": " << r.p99 << ", \"p999Ns\": " << r.p999
+        << ", \"meanNs\": " << r.mean
+        << ", \"opsPerSec\": " << r.opsPerSecond();
+    if (r.bytesPerOp > 0)
+      out << ", \"bytesPerSec\": " << r.bytesPerOp * r.opsPerSecond();
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+  return static_cast<bool>(out);
+}
+
+// A stored --json run; false, having said why, when it cannot be used
+bool loadBaseline(const std::string &path, JsonValue &baseline) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    std::fprintf(stderr, "codeflow_bench_engine: cannot read %s\n", path.c_str());
+    return false;
+  }
+  std::stringstream text;
+  text << in.rdbuf();
+  std::string error;
+  const JsonValue *list = nullptr;
+  if (!parseJson(text.str(), baseline, &error) ||
+      !(list = baseline.find("benchmarks")) || !list->isArray()) {
+    std::fprintf(stderr, "codeflow_bench_engine: %s: %s\n", path.c_str(),
+                 error.empty() ? "not a benchmark result" : error.c_str());
+    return false;
+  }
+  return true;
+}
+
+// Flag regressions against the baseline; true if there are any
+bool compare(const Options &options, const JsonValue &baseline,
+             const Bench &bench) {
+  const JsonValue *list = baseline.find("benchmarks");
+  std::printf("\ncompared with %s (p50 +%.0f%%, p99 +%.0f%% allowed)\n",
+              options.baselinePath.c_str(), options.threshold,
+              options.tailThreshold);
+  std::printf("%-36s %-5s %12s %12s %9s\n", "benchmark", "", "baseline",
+              "current", "change");
+  int regressions = 0;
+  for (const Result &r : bench.all()) {
+    const JsonValue *before = nullptr;
+    for (const JsonValue &item : list->items) {
+      if (item.stringOr("name") == r.name)
+        before = &item;
+    }
+    if (!before) {
+      std::printf("%-36s (not in baseline)\n", r.name.c_str());
+      continue;
+    }
+    struct {
+      const char *label, *key;
+      double current, allowed;
+    } metrics[] = {{"p50", "p50Ns", r.p50, options.threshold},
+                   {"p99", "p99Ns", r.p99, options.tailThreshold}};
+    for (const auto &metric : metrics) {
+      const JsonValue *value = before->find(metric.key);
+      if (!value || value->type != JsonValue::Type::Number)
+        continue;
+      double old = value->number;
+      // Sub-nanosecond baselines are timer noise, not a reference
+      double change = old >= 1 ? (metric.current / old - 1) * 100 : 0;
+      bool regressed = change > metric.allowed;
+      regressions += regressed;
+      std::printf("%-36s %-5s %9.0f ns %9.0f ns %+8.1f%%%s\n", r.name.c_str(),
+                  metric.label, old, metric.current, change,
+                  regressed ? "  REGRESSED" : "");
+    }
+  }
+  std::printf("\n%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+  return regressions > 0;
+}
+
+int usage() {
+  std::fprintf(stderr,
+               "usage: codeflow_bench_engine [INDEX] [--filter TEXT]"
+               " [--min-time-ms N] [--json FILE] [--compare BASELINE]"
+               " [--threshold PCT] [--tail-threshold PCT]\n");
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+#ifdef CODEFLOW_INDEX_FILE
+  options.index = CODEFLOW_INDEX_FILE;
+#endif
+  if (const char *env = std::getenv("CODEFLOW_INDEX_FILE"))
+    options.index = env;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool takesValue = arg == "--filter" || arg == "--min-time-ms" ||
+                      arg == "--json" || arg == "--compare" ||
+                      arg == "--threshold" || arg == "--tail-threshold";
+    if (takesValue && i + 1 >= argc)
+      return usage();
+    if (arg == "--filter")
+      options.filter = argv[++i];
+    else if (arg == "--min-time-ms")
+      options.minTimeMs = std::max(1.0, std::atof(argv[++i]));
+    else if (arg == "--json")
+      options.jsonPath = argv[++i];
+    else if (arg == "--compare")
+      options.baselinePath = argv[++i];
+    else if (arg == "--threshold")
+      options.threshold = std::atof(argv[++i]);
+    else if (arg == "--tail-threshold")
+      options.tailThreshold = std::atof(argv[++i]);
+    else if (arg.starts_with("-"))
+      return usage();
+    else
+      options.index = arg;
+  }
+  if (options.index.empty())
+    return usage();
+
+  JsonValue baseline;
+  if (!options.baselinePath.empty() && !loadBaseline(options.baselinePath, baseline))
+    return 2;
+
+  // The index twice: mapped on its own for the trie, and in an engine
+  StlIndex stl;
+  SuggestionEngine engine;
+  std::string error;
+  if (!mapIndexFile(options.index, stl, &error) ||
+      !engine.loadIndex(options.index, &error)) {
+    std::fprintf(stderr, "codeflow_bench_engine: %s\n", error.c_str());
+    return 1;
+  }
+
+  Bench bench(options);
+#ifndef __OPTIMIZE__
+  std::printf("warning: unoptimized build; numbers are not comparable\n");
+#endif
+  std::printf("%zu indexed names, timer overhead %.0f ns subtracted\n\n",
+              stl.trie.size(), bench.timerOverhead());
+  std::printf("%-36s %9s %11s %11s %11s %13s %12s\n", "benchmark", "samples",
+              "p50", "p99", "p999", "ops/s", "throughput");
+
+  // Trie: every indexed name, with numbered variants to reach a size where
+  // the trie outgrows L1
+  const std::vector<std::string> names = stl.trie.getAllWords();
+  std::vector<std::string> words;
+  for (int variant = 0; words.size() < 50'000; ++variant) {
+    for (const std::string &name : names)
+      words.push_back(variant == 0 ? name : name + std::to_string(variant));
+  }
+  {
+    auto trie = std::make_unique<Trie>();
+    std::size_t next = 0;
+    bench.measure(
+        "trie/insert", 100'000, 0, [&] { trie->insert(words[next++]); },
+        [&] {
+          if (next == words.size()) {
+            trie = std::make_unique<Trie>();
+            next = 0;
+          }
+        });
+  }
+  {
+    std::vector<std::string> prefixes;
+    for (const std::string &name : names) {
+      for (std::size_t length = 1; length <= std::min<std::size_t>(4, name.size()); ++length)
+        prefixes.push_back(name.substr(0, length));
+    }
+    std::vector<NodeId> found;
+    std::size_t next = 0;
+    bench.measure("trie/search", 100'000, 0, [&] {
+      stl.trie.completions(prefixes[next], 10, found);
+      next = (next + 1) % prefixes.size();
+    });
+  }
+
+  // Tokenizer and symbol extraction over whole sources
+  Tokenizer tokenizer;
+  std::vector<TokenView> tokens;
+  for (int lines : {1'000, 10'000, 100'000}) {
+    const std::string source = syntheticSource(lines);
+    const std::string size = std::to_string(lines / 1000) + "k";
+    bench.measure("tokenizer/scan/" + size + "_lines", lines >= 100'000 ? 20 : 200,
+                  static_cast<double>(source.size()),
+                  [&] { tokenizer.scan(source, tokens); });
+    bench.measure("engine/updateSymbols/" + size + "_lines",
+                  lines >= 100'000 ? 10 : 50, static_cast<double>(source.size()),
+                  [&] { engine.updateSymbols(source); });
+  }
+
+  // Scope index: building it over a whole source, then resolving objects
+  // at a cursor in its last function, against locals, a parameter and a
+  // global
+  {
+    const std::string source = syntheticSource(50'000);
+    ScopeIndex scopes;
+    bench.measure("scopes/build/50k_lines", 50, static_cast<double>(source.size()),
+                  [&] { scopes.build(source); });
+
+    scopes.build(source);
+    const std::string local = "  map<string, int> counts";
+    const std::size_t declared = source.rfind(local) + local.size();
+    const std::string n = source.substr(declared, source.find(';', declared) - declared);
+    const std::size_t cursor = source.rfind("return it");
+    const std::string expressions[] = {"counts" + n, "items" + n, "values",
+                                       "counts" + n + "[\"key\"]", "it"};
+    for (const std::string &expression : expressions) {
+      if (!scopes.typeOf(expression, cursor).known()) {
+        std::fprintf(stderr, "codeflow_bench_engine: %s does not resolve\n",
+                     expression.c_str());
+        return 1;
+      }
+    }
+    std::size_t next = 0;
+    bench.measure("scopes/resolve", 100'000, 0, [&] {
+      scopes.typeOf(expressions[next], cursor);
+      next = (next + 1) % std::size(expressions);
+    });
+  }
+
+  // Workspace index: a tree of 1000 sources of 200 lines each, indexed on
+  // every core, then one file re-indexed as the watcher does after a save,
+  // and a global completion that takes names from the whole workspace
+  WorkspaceStats workspaceStats;
+  {
+    char root[] = "/tmp/codeflow_bench_workspace-XXXXXX";
+    if (mkdtemp(root) == nullptr) {
+      std::fprintf(stderr, "codeflow_bench_engine: cannot create %s\n", root);
+      return 1;
+    }
+    constexpr int kFiles = 1'000;
+    const std::string source = syntheticSource(200);
+    double bytes = 0;
+    for (int f = 0; f < kFiles; ++f) {
+      const std::string n = std::to_string(f);
+      const std::string dir = std::string(root) + "/module" + std::to_string(f / 50);
+      std::filesystem::create_directories(dir);
+      std::string text = "struct Record" + n +
+                         " { int id; string name; int total() const; };\n" +
+                         source;
+      for (std::size_t at = 0; (at = text.find("process", at)) != std::string::npos;
+           at += 8)
+        text.insert(at + 7, "_" + n + "_");
+      std::ofstream(dir + "/unit" + n + (f % 4 ? ".cpp" : ".h")) << text;
+      bytes += static_cast<double>(text.size());
+    }
+
+    WorkspaceIndex &workspace = engine.workspaceIndex();
+    bench.measure("workspace/open/1000_files", 5, bytes,
+                  [&] { workspace.open(root); });
+    workspace.open(root);
+    workspaceStats = workspace.stats();
+    bench.measure("workspace/update/1_file", 50, 0,
+                  [&] { workspace.update({"module3/unit150.h"}); });
+    bench.measure("engine/complete/global_workspace", 10'000, 0, [&] {
+      engine.complete("process_15", "global", source);
+    });
+    workspace.close();
+    std::filesystem::remove_all(root);
+  }
+
+  // Completion in each context, against a 1k-line document
+  const std::string document = syntheticSource(1'000);
+  engine.updateSymbols(document);
+  const std::string memberCode = document + "values.p";
+  const int memberCursor = static_cast<int>(memberCode.size());
+  struct Query {
+    const char *name;
+    std::string prefix, context;
+    const std::string &code;
+    int cursor;
+  };
+  const std::string none;
+  const Query queries[] = {
+      {"engine/getSuggestions/member", "p", "", memberCode, memberCursor},
+      {"engine/getSuggestions/global", "so", "global", none, 0},
+      {"engine/getSuggestions/keyword", "wh", "", none, 0},
+  };
+  for (const Query &query : queries) {
+    if (!bench.selected(query.name))
+      continue;
+    if (engine.getSuggestions(query.prefix, query.context, query.code, query.cursor)
+            .empty()) {
+      std::fprintf(stderr, "codeflow_bench_engine: %s returns nothing\n",
+                   query.name);
+      return 1;
+    }
+    bench.measure(query.name, 100'000, 0, [&] {
+      engine.getSuggestions(query.prefix, query.context, query.code, query.cursor);
+    });
+  }
+
+  // POST /api/getSuggestions over an editor-sized document: complete() and
+  // serializing its records, as a response cache miss costs, then
+  // completeJson answering from the cache, for the same document (its scope
+  // key memoized) and for edited ones, whose includes, declarations and
+  // locals are scanned for the key.
+  const std::string routeCode = syntheticSource(200);
+  struct Route {
+    const char *name;
+    std::string prefix, context;
+  };
+  const Route routes[] = {{"member", "", "values"}, {"global", "s", "global"}};
+  struct Entry {
+    const char *name;
+    std::size_t results;
+    ResponseCache::Body body;
+  };
+  std::vector<Entry> entries;
+  for (const Route &route : routes) {
+    bench.measure(std::string("engine/completeJson/miss/") + route.name, 10'000,
+                  0, [&] {
+                    std::string json;
+                    appendRecordsJson(json, engine.complete(route.prefix,
+                                                            route.context,
+                                                            routeCode));
+                  });
+    bench.measure(std::string("engine/completeJson/hit/") + route.name,
+                  100'000, 0, [&] {
+                    engine.completeJson("cpp", route.prefix, route.context,
+                                        routeCode);
+                  });
+    // As while typing: the code differs on every request, so its scope is
+    // scanned again before the lookup
+    std::vector<std::string> edits;
+    for (int i = 0; i < 128; ++i)
+      edits.push_back(routeCode + "// edit " + std::to_string(i) + "\n");
+    std::size_t next = 0;
+    bench.measure(std::string("engine/completeJson/hit_edited/") + route.name,
+                  100'000, 0, [&] {
+                    engine.completeJson("cpp", route.prefix, route.context,
+                                        edits[next]);
+                    next = (next + 1) % edits.size();
+                  });
+    entries.push_back(
+        {route.name,
+         engine.complete(route.prefix, route.context, routeCode).size(),
+         engine.completeJson("cpp", route.prefix, route.context, routeCode)});
+  }
+  std::printf("\n%-36s %9s %11s %11s\n", "response cache entry", "results",
+              "body", "charged");
+  for (const Entry &entry : entries) {
+    std::printf("%-36s %9zu %8zu B %8zu B\n",
+                (std::string("engine/completeJson/") + entry.name).c_str(),
+                entry.results, entry.body->size(),
+                ResponseCache::entryBytes(*entry.body));
+  }
+
+  std::printf("\n%-36s %9s %11s %11s %11s\n", "workspace index (last open)",
+              "files", "symbols", "files/s", "MB/s");
+  std::printf("%-36s %9zu %11zu %11.0f %11.1f\n", "workspace/open/1000_files",
+              workspaceStats.indexedFiles, workspaceStats.symbols,
+              workspaceStats.filesPerSecond, workspaceStats.megabytesPerSecond);
+
+  // Pairs of short rounds with metrics off and on, in alternating order;
+  // the median of the pairs' ratios, so drift and noise spikes cancel out.
+  // The mean counts: sampled queries pay for their clock reads, the others
+  // only for a counter.
+  constexpr double kMetricsBudgetPercent = 2;
+  constexpr int kPairs = 301, kQueriesPerRound = 500;
+  bool overBudget = false;
+  std::printf("\n%-36s %11s %11s %9s\n", "metrics overhead (mean)", "off",
+              "on", "cost");
+  for (const Query &query : queries) {
+    if (!bench.selected(query.name))
+      continue;
+    auto round = [&](bool on) {
+      EngineMetrics::global().setEnabled(on);
+      const auto start = Clock::now();
+      for (int i = 0; i < kQueriesPerRound; ++i)
+        engine.getSuggestions(query.prefix, query.context, query.code,
+                              query.cursor);
+      return std::chrono::duration<double, std::nano>(Clock::now() - start)
+                 .count() /
+             kQueriesPerRound;
+    };
+    std::vector<double> off, on, ratios;
+    for (int pair = 0; pair < kPairs; ++pair) {
+      const bool onFirst = pair % 2;
+      const double first = round(onFirst);
+      const double second = round(!onFirst);
+      off.push_back(onFirst ? second : first);
+      on.push_back(onFirst ? first : second);
+      ratios.push_back(on.back() / off.back());
+    }
+    EngineMetrics::global().setEnabled(true);
+    auto median = [](std::vector<double> &values) {
+      std::nth_element(values.begin(), values.begin() + values.size() / 2,
+                       values.end());
+      return values[values.size() / 2];
+    };
+    const double cost = (median(ratios) - 1) * 100;
+    overBudget |= cost > kMetricsBudgetPercent;
+    std::printf("%-36s %8.0f ns %8.0f ns %+8.1f%%%s\n", query.name,
+                median(off), median(on), cost,
+                cost > kMetricsBudgetPercent ? "  OVER BUDGET" : "");
+  }
+
+  if (!options.jsonPath.empty() && !writeJson(options, bench)) {
+    std::fprintf(stderr, "codeflow_bench_engine: cannot write %s\n",
+                 options.jsonPath.c_str());
+    return 1;
+  }
+  bool regressed =
+      !options.baselinePath.empty() && compare(options, baseline, bench);
+  return regressed || overBudget ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+// Fuzzy completion latency over the full symbol index, at every SIMD level
+// this CPU supports: the mask prefilter alone, and the whole search
+// (prefilter, alignment scoring and ranking).
+//
+//   codeflow_bench_fuzzy [INDEX] [--rounds N]
+//
+// INDEX defaults to the file named by CODEFLOW_INDEX_FILE. Exits with 1 if
+// the p99 of a search at the best level is over the 50 us budget.
+#include "../include/index_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace codeflow;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+constexpr double kBudgetMicros = 50.0;
+
+// Abbreviations as typed, from a single character up to whole words
+const char *const kQueries[] = {
+    "pb",   "emb",     "psh",       "ub",     "lwb",       "srt",
+    "v",    "st",      "fnd",       "mxe",    "nth",       "uom",
+    "cnt",  "rsz",     "ins",       "ers",    "strm",      "shrd",
+    "uniq", "accmlt",  "isalnum",   "sort",   "rbegin",    "push_back",
+    "x",    "lower_b", "unordered", "stbl",   "mk_shared", "zz",
+};
+
+struct Percentiles {
+  double p50, p99, max;
+};
+
+Percentiles summarize(std::vector<double> &samples) {
+  std::sort(samples.begin(), samples.end());
+  auto at = [&](double q) {
+    return samples[std::min(samples.size() - 1,
+                             static_cast<std::size_t>(q * samples.size()))];
+  };
+  return {at(0.50), at(0.99), samples.back()};
+}
+
+template <typename Run> Percentiles measure(int rounds, Run run) {
+  std::vector<double> samples;
+  samples.reserve(rounds * std::size(kQueries));
+  for (int warm = 0; warm < 3; ++warm) {
+    for (const char *query : kQueries)
+      run(query);
+  }
+  for (int round = 0; round < rounds; ++round) {
+    for (const char *query : kQueries) {
+      auto start = Clock::now();
+      run(query);
+      std::chrono::duration<double, std::micro> took = Clock::now() - start;
+      samples.push_back(took.count());
+    }
+  }
+  return summarize(samples);
+}
+
+const char *levelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::Scalar:
+    return "scalar";
+  case SimdLevel::SSE2:
+    return "sse2";
+  case SimdLevel::AVX2:
+    return "avx2";
+  }
+  return "?";
+}
+
+int usage() {
+  std::fprintf(stderr, "usage: codeflow_bench_fuzzy [INDEX] [--rounds N]\n");
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string path;
+  int rounds = 200;
+  if (const char *env = std::getenv("CODEFLOW_INDEX_FILE"))
+    path = env;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--rounds") {
+      if (i + 1 >= argc)
+        return usage();
+      rounds = std::max(1, std::atoi(argv[++i]));
+    } else if (arg.starts_with("-")) {
+      return usage();
+    } else {
+      path = arg;
+    }
+  }
+  if (path.empty())
+    return usage();
+
+  StlIndex index;
+  std::string error;
+  if (!mapIndexFile(path, index, &error)) {
+    std::fprintf(stderr, "codeflow_bench_fuzzy: %s\n", error.c_str());
+    return 1;
+  }
+  buildFuzzyIndex(index);
+
+  std::printf("%zu names, %zu queries x %d rounds\n\n", index.fuzzy.size(),
+              std::size(kQueries), rounds);
+  std::printf("%-8s %-8s %10s %10s %10s\n", "level", "stage", "p50 us",
+              "p99 us", "max us");
+
+  std::vector<std::uint32_t> candidates;
+  std::vector<FuzzyHit> hits;
+  const SimdLevel best = Tokenizer::detectSimdLevel();
+  Percentiles budgeted{};
+  for (SimdLevel level :
+       {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+    if (level > best)
+      break;
+    index.fuzzy.setSimdLevel(level);
+    Percentiles filter = measure(rounds, [&](const char *query) {
+      index.fuzzy.filter(fuzzyMask(query), candidates);
+    });
+    Percentiles search = measure(rounds, [&](const char *query) {
+      index.fuzzy.search(FuzzyPattern(query), 20, hits);
+    });
+    std::printf("%-8s %-8s %10.2f %10.2f %10.2f\n", levelName(level), "filter",
+                filter.p50, filter.p99, filter.max);
+    std::printf("%-8s %-8s %10.2f %10.2f %10.2f\n", levelName(level), "search",
+                search.p50, search.p99, search.max);
+    budgeted = search;
+  }
+
+  bool ok = budgeted.p99 <= kBudgetMicros;
+  std::printf("\nsearch p99 at %s: %.2f us (budget %.0f us) %s\n",
+              levelName(best), budgeted.p99, kBudgetMicros,
+              ok ? "ok" : "OVER BUDGET");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// Compile the STL, keyword and constant data files into one index file that
+// the engine maps at startup (SuggestionEngine::loadIndex).
+//
+//   codeflow_build_index --functions data/stl_functions.json
+//                        --keywords data/cpp_keywords.txt
+//                        --stl-dir backend/data/stl
+//                        --constants backend/data/constants.json
+//                        -o codeflow_index.bin
+//
+// Every input is optional; the output is deterministic for the same inputs.
+#include "../include/index_file.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+using namespace codeflow;
+
+namespace {
+
+bool readFile(const fs::path &path, std::string &out) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  std::stringstream buffer;
+  buffer << file.rdbuf();
+  out = buffer.str();
+  return true;
+}
+
+int usage() {
+  std::cerr << "usage: codeflow_build_index [--functions FILE] [--keywords FILE]"
+               " [--stl-dir DIR] [--constants FILE] -o OUTPUT"
+            << std::endl;
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string functions, keywords, stlDir, constants, output;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc)
+      return usage();
+    std::string value = argv[++i];
+    if (arg == "--functions")
+      functions = value;
+    else if (arg == "--keywords")
+      keywords = value;
+    else if (arg == "--stl-dir")
+      stlDir = value;
+    else if (arg == "--constants")
+      constants = value;
+    else if (arg == "-o")
+      output = value;
+    else
+      return usage();
+  }
+  if (output.empty())
+    return usage();
+
+  StlIndex index;
+  std::string text;
+  auto load = [&](const fs::path &path, auto merge) {
+    if (!readFile(path, text) || !merge(text)) {
+      std::cerr << "codeflow_build_index: cannot load " << path.string()
+                << std::endl;
+      return false;
+    }
+    return true;
+  };
+
+  if (!functions.empty() && !load(functions, [&](std::string_view json) {
+        return mergeStlFunctions(json, index);
+      }))
+    return 1;
+
+  if (!stlDir.empty()) {
+    // Sorted, so the output does not depend on directory order
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(stlDir, ec)) {
+      if (entry.path().extension() == ".json")
+        files.push_back(entry.path());
+    }
+    if (ec) {
+      std::cerr << "codeflow_build_index: cannot read " << stlDir << std::endl;
+      return 1;
+    }
+    std::sort(files.begin(), files.end());
+    for (const fs::path &file : files) {
+      std::string type = file.stem().string();
+      if (!load(file, [&](std::string_view json) {
+            return mergeStlDefinition(type, json, index);
+          }))
+        return 1;
+    }
+  }
+
+  if (!constants.empty() && !load(constants, [&](std::string_view json) {
+        return mergeConstants(json, index);
+      }))
+    return 1;
+
+  if (!keywords.empty() && !load(keywords, [&](std::string_view list) {
+        addKeywords(list, index);
+        return true;
+      }))
+    return 1;
+
+  std::string error;
+  if (!writeIndexFile(index, output, &error)) {
+    std::cerr << "codeflow_build_index: " << error << std::endl;
+    return 1;
+  }
+  std::cout << "codeflow_build_index: " << output << ": " << index.trie.size()
+            << " words, " << index.catalog.types().size() << " types, "
+            << index.catalog.methodCount() << " methods, "
+            << fs::file_size(output) << " bytes" << std::endl;
+  return 0;
+}
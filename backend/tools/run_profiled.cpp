@@ -0,0 +1,129 @@
+// Run a command and write its resource usage and hardware counters as JSON
+// (codeflow::profileJson) once it exits. The job queue runs programs through
+// this, since Node gives a parent neither wait4's rusage nor perf events:
+//
+//   codeflow_run_profiled --output profile.json -- ./program [ARGS...]
+//
+// stdio passes straight through. The command is forked and its counters
+// opened before it execs, so they cover it from its first instruction.
+// SIGTERM, SIGINT and SIGHUP are passed on to it (timeout(1) signals only
+// its own child). The exit status is the command's; when a signal ended
+// it, the same signal ends this process, so a caller sees the crash as if
+// the command had run directly.
+#include "../include/run_profile.h"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace codeflow;
+
+namespace {
+
+volatile pid_t child = 0;
+
+void forward(int signal) {
+  if (child > 0)
+    ::kill(child, signal);
+}
+
+int usage() {
+  std::cerr << "usage: codeflow_run_profiled --output FILE -- COMMAND [ARGS...]"
+            << std::endl;
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string output;
+  int first = 1;
+  for (; first < argc; ++first) {
+    std::string arg = argv[first];
+    if (arg == "--") {
+      ++first;
+      break;
+    }
+    if (arg != "--output" || first + 1 >= argc)
+      return usage();
+    output = argv[++first];
+  }
+  if (output.empty() || first >= argc)
+    return usage();
+
+  // The child waits on this pipe until its counters are open
+  int go[2];
+  if (::pipe2(go, O_CLOEXEC) != 0) {
+    std::perror("codeflow_run_profiled: pipe");
+    return 125;
+  }
+  const auto start = std::chrono::steady_clock::now();
+  pid_t pid = ::fork();
+  if (pid < 0) {
+    std::perror("codeflow_run_profiled: fork");
+    return 125;
+  }
+  if (pid == 0) {
+    ::close(go[1]);
+    char ready;
+    while (::read(go[0], &ready, 1) < 0 && errno == EINTR) {
+    }
+    ::execvp(argv[first], argv + first);
+    std::fprintf(stderr, "%s: %s\n", argv[first], std::strerror(errno));
+    ::_exit(errno == ENOENT ? 127 : 126);
+  }
+
+  ::close(go[0]);
+  child = pid;
+  struct sigaction action {};
+  action.sa_handler = forward;
+  for (int signal : {SIGTERM, SIGINT, SIGHUP})
+    ::sigaction(signal, &action, nullptr);
+
+  RunProfile profile;
+  int status = 0;
+  {
+    HardwareCounters counters(pid, /*enableOnExec=*/true);
+    ::write(go[1], "x", 1);
+    ::close(go[1]);
+
+    struct rusage usage {};
+    while (::wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+    profile.wallMs = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    profile.usage = ResourceUsage::from(usage);
+    profile.counters = counters.read();
+  }
+
+  // Renamed into place, so a reader never sees half a file
+  std::string staging = output + ".tmp";
+  {
+    std::ofstream out(staging, std::ios::trunc);
+    out << profileJson(profile) << '\n';
+  }
+  std::rename(staging.c_str(), output.c_str());
+
+  if (WIFSIGNALED(status)) {
+    int signal = WTERMSIG(status);
+    struct rlimit noCore {0, 0};
+    ::setrlimit(RLIMIT_CORE, &noCore);
+    std::signal(signal, SIG_DFL);
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, signal);
+    ::sigprocmask(SIG_UNBLOCK, &signals, nullptr);
+    ::raise(signal);
+    return 128 + signal;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 125;
+}
@@ -4,6 +4,7 @@ import { useEditor } from '../../context/EditorContext';
 import TrieVisualizer from './TrieVisualizer';
 import MemoryVisualizer from './MemoryVisualizer';
 import ComplexityBadge from './ComplexityBadge';
+import RunProfileCard from './RunProfileCard';
 
 export default function BentoProfiler() {
   const { 
@@ -132,6 +133,7 @@ export default function BentoProfiler() {
         <TrieVisualizer />
         <MemoryVisualizer />
         <ComplexityBadge />
+        <RunProfileCard />
       </aside>
     </>
   );
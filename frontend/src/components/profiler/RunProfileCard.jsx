@@ -0,0 +1,127 @@
+import React from 'react';
+import { Timer, AlertTriangle } from 'lucide-react';
+import { useEngine } from '../../context/EngineContext';
+
+// 1234567 → "1.23M"
+function compact(value) {
+  if (value === null || value === undefined) return '—';
+  if (value >= 1e9) return (value / 1e9).toFixed(2) + 'G';
+  if (value >= 1e6) return (value / 1e6).toFixed(2) + 'M';
+  if (value >= 1e3) return (value / 1e3).toFixed(1) + 'K';
+  return String(value);
+}
+
+function rate(misses, total) {
+  if (misses === null || misses === undefined || !total) return '';
+  return ` (${((misses / total) * 100).toFixed(2)}%)`;
+}
+
+function Metric({ label, value, title, color = 'var(--text-cyan)' }) {
+  return (
+    <div
+      style={{
+        background: 'rgba(255, 255, 255, 0.02)',
+        padding: '6px 8px',
+        borderRadius: 'var(--radius-xs)',
+        border: '1px solid var(--border-subtle)'
+      }}
+      title={title}
+    >
+      <div style={{ fontSize: '9px', color: 'var(--text-muted)', fontWeight: 600, letterSpacing: '0.05em' }}>
+        {label}
+      </div>
+      <div style={{ fontSize: '12px', fontFamily: 'var(--font-code)', color, fontWeight: 700, marginTop: 2 }}>
+        {value}
+      </div>
+    </div>
+  );
+}
+
+/**
+ * Resource usage and hardware counters of the last run, as the backend
+ * measured them (wait4 rusage and perf events)
+ */
+export default function RunProfileCard() {
+  const { executionStats } = useEngine();
+  const profile = executionStats.profile;
+
+  return (
+    <div className="bento-card">
+      <div className="bento-card-title">
+        <div style={{ display: 'flex', alignItems: 'center', gap: 6 }}>
+          <Timer size={14} color="var(--accent-cyan)" />
+          <span>Last Run Profile</span>
+        </div>
+      </div>
+
+      {!profile ? (
+        <div style={{ fontSize: '10px', color: 'var(--text-dim)', marginTop: 4 }}>
+          Run a program to see its CPU time, memory and cache behaviour.
+        </div>
+      ) : (
+        <>
+          <div style={{ display: 'grid', gridTemplateColumns: '1fr 1fr 1fr', gap: 6, marginTop: 4 }}>
+            <Metric label="CPU USER / SYS" value={`${profile.userMs.toFixed(1)} / ${profile.systemMs.toFixed(1)} ms`} />
+            <Metric label="PEAK RSS" value={`${(profile.maxRssKb / 1024).toFixed(1)} MB`} color="var(--text-violet)" />
+            <Metric label="WALL" value={`${profile.wallMs.toFixed(1)} ms`} />
+            <Metric
+              label="PAGE FAULTS"
+              value={`${compact(profile.minorFaults)} / ${compact(profile.majorFaults)}`}
+              title="Minor (no I/O) / major (read from disk)"
+              color="var(--text-violet)"
+            />
+            <Metric
+              label="CTX SWITCHES"
+              value={`${compact(profile.voluntaryContextSwitches)} / ${compact(profile.involuntaryContextSwitches)}`}
+              title="Voluntary (blocked) / involuntary (preempted)"
+            />
+          </div>
+
+          {profile.counters.available ? (
+            <div style={{ display: 'grid', gridTemplateColumns: '1fr 1fr 1fr', gap: 6, marginTop: 6 }}>
+              <Metric label="CYCLES" value={compact(profile.counters.cycles)} color="var(--text-emerald)" />
+              <Metric label="INSTRUCTIONS" value={compact(profile.counters.instructions)} color="var(--text-emerald)" />
+              <Metric
+                label="IPC"
+                value={profile.counters.instructionsPerCycle ?? '—'}
+                title="Instructions per cycle"
+                color="var(--text-emerald)"
+              />
+              <Metric
+                label="BRANCH MISSES"
+                value={compact(profile.counters.branchMisses) + rate(profile.counters.branchMisses, profile.counters.instructions)}
+                title="Share of instructions"
+                color="var(--accent-amber)"
+              />
+              <Metric label="L1D READ MISSES" value={compact(profile.counters.l1dReadMisses)} color="var(--accent-amber)" />
+              <Metric label="LLC MISSES" value={compact(profile.counters.llcMisses)} color="var(--accent-coral)" />
+            </div>
+          ) : (
+            <div style={{
+              marginTop: 6,
+              padding: '4px 8px',
+              background: 'rgba(245, 158, 11, 0.05)',
+              border: '1px solid rgba(245, 158, 11, 0.15)',
+              borderRadius: 'var(--radius-xs)',
+              fontSize: '10px',
+              color: 'var(--text-secondary)',
+              display: 'flex',
+              alignItems: 'center',
+              gap: 6
+            }}>
+              <AlertTriangle size={11} color="var(--accent-amber)" style={{ flexShrink: 0 }} />
+              <span style={{ overflow: 'hidden', textOverflow: 'ellipsis', whiteSpace: 'nowrap' }} title={profile.counters.unavailableReason}>
+                Hardware counters unavailable: {profile.counters.unavailableReason}
+              </span>
+            </div>
+          )}
+          {profile.counters.scaled && (
+            <div style={{ fontSize: '9px', color: 'var(--text-dim)', marginTop: 4 }}>
+              Counters were multiplexed; totals are extrapolated.
+            </div>
+          )}
+        </>
+      )}
+    </div>
+  );
+}
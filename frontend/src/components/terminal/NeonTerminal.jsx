@@ -10,7 +10,9 @@ export default function NeonTerminal() {
     setTerminalActiveTab, 
     assemblyOutput, 
     clearLogs,
-    isRunning 
+    isRunning,
+    runPhase,
+    liveOutput
   } = useEngine();
 
   const { terminalHeight, setTerminalHeight, setIsTerminalOpen } = useEditor();
@@ -26,7 +28,7 @@ export default function NeonTerminal() {
     if (logsEndRef.current && !isMinimized) {
       logsEndRef.current.scrollTop = logsEndRef.current.scrollHeight;
     }
-  }, [outputLogs, assemblyOutput, isMinimized]);
+  }, [outputLogs, liveOutput, assemblyOutput, isMinimized]);
 
   // Draggable vertical resizer
   const startResize = (clientY) => {
@@ -232,10 +234,20 @@ export default function NeonTerminal() {
               );
             })}
 
+            {liveOutput && (
+              <div style={{ color: 'var(--text-secondary)', whiteSpace: 'pre-wrap', marginBottom: 2 }}>
+                {liveOutput}
+              </div>
+            )}
+
             {isRunning && (
               <div style={{ display: 'flex', alignItems: 'center', gap: 8, color: 'var(--text-cyan)', marginTop: 6 }}>
                 <span className="animate-radar" style={{ width: 8, height: 8, borderRadius: '50%', background: 'var(--accent-cyan)' }} />
-                <span>Compiling translation unit with C++20 Clang...</span>
+                <span>
+                  {runPhase === 'running' ? 'Running program...'
+                    : runPhase === 'queued' ? 'Waiting for a sandbox worker...'
+                    : 'Compiling translation unit with C++20 Clang...'}
+                </span>
               </div>
             )}
           </div>
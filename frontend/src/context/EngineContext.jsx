@@ -4,6 +4,35 @@ import { useEditor } from './EditorContext';
 const EngineContext = createContext(null);
 const API_BASE = process.env.REACT_APP_API_BASE || '/api';
 
+/**
+ * Follow a queued run's Server-Sent Events until its exit event, which
+ * resolves the promise with the outcome
+ */
+function followJob(jobId, { onPhase, onOutput }) {
+  return new Promise((resolve, reject) => {
+    const source = new EventSource(`${API_BASE}/runCode/${jobId}`);
+    const onChunk = (e) => onOutput(JSON.parse(e.data));
+    source.addEventListener('status', (e) => onPhase(JSON.parse(e.data).phase));
+    source.addEventListener('stdout', onChunk);
+    source.addEventListener('stderr', onChunk);
+    source.addEventListener('truncated', (e) => {
+      const { reason } = JSON.parse(e.data);
+      onOutput(reason === 'limit'
+        ? '\n[output limit reached, the rest was discarded]\n'
+        : '\n[earlier output dropped]\n');
+    });
+    source.addEventListener('exit', (e) => {
+      source.close();
+      resolve(JSON.parse(e.data));
+    });
+    source.onerror = () => {
+      // EventSource reconnects by itself, resuming from the last event id,
+      // unless the server refused the stream
+      if (source.readyState === EventSource.CLOSED) reject(new Error('Output stream closed'));
+    };
+  });
+}
+
 export function EngineProvider({ children }) {
   const { activeFile, activeLanguage, cursorPos } = useEditor();
 
@@ -15,6 +44,8 @@ export function EngineProvider({ children }) {
 
   // Execution & Output state
   const [isRunning, setIsRunning] = useState(false);
+  const [runPhase, setRunPhase] = useState(null); // queued | compiling | running
+  const [liveOutput, setLiveOutput] = useState(''); // Streamed so far by the current run
   const [outputLogs, setOutputLogs] = useState([
     '⚡ IntelliCPP Engine v2.0 Initialized [C++20 ISO/IEC 14882]',
     '✓ Clang-Trie Symbol Indexer: 10,420 STL symbols loaded in 1.4ms',
@@ -26,7 +57,8 @@ export function EngineProvider({ children }) {
   const [executionStats, setExecutionStats] = useState({
     executionTimeMs: 0,
     memoryUsageKb: 4820,
-    exitCode: 0
+    exitCode: 0,
+    profile: null // The program's rusage and hardware counters, from the backend
   });
 
   // Autocomplete Suggestions
@@ -157,8 +189,12 @@ export function EngineProvider({ children }) {
       `Compiling ${activeFile.name} (${activeLanguage.badge})...`
     ]);
 
+    let output = ''; // Streamed so far
     try {
-      const res = await fetch(`${API_BASE}/runCode`, {
+      // Streamed where the browser supports it: output shows up as the
+      // program prints it rather than when it exits
+      const canStream = typeof EventSource !== 'undefined';
+      const res = await fetch(`${API_BASE}/runCode${canStream ? '?async=true' : ''}`, {
         method: 'POST',
         headers: { 'Content-Type': 'application/json' },
         body: JSON.stringify({
@@ -168,10 +204,34 @@ export function EngineProvider({ children }) {
         })
       });
 
-      const elapsed = Math.round(performance.now() - startExec);
-
-      if (res.ok) {
+      let elapsed;
+      let exitCode = 0;
+      let profile = null;
+      if (res.status === 202) {
+        const { jobId } = await res.json();
+        const exit = await followJob(jobId, {
+          onPhase: setRunPhase,
+          onOutput: (text) => {
+            output += text;
+            setLiveOutput(output);
+          }
+        });
+        elapsed = Math.round(performance.now() - startExec);
+        exitCode = exit.exitCode;
+        profile = exit.profile || null;
+        setLiveOutput('');
+        setOutputLogs(prev => [
+          ...prev,
+          ...(output ? [output] : []),
+          ...(exit.error ? [`❌ Compiler Diagnostic / Runtime Error:`, exit.error] : []),
+          exit.success
+            ? `\n✓ Program exited with code ${exit.exitCode} (${elapsed}ms execution time)`
+            : `❌ Program exited with code ${exit.exitCode} (${exit.status})${exit.escalated ? ', rebuilt with sanitizers for the report above' : ''}`
+        ]);
+      } else if (res.ok) {
+        elapsed = Math.round(performance.now() - startExec);
         const data = await res.json();
+        profile = data.profile || null;
         if (data.output) {
           setOutputLogs(prev => [
             ...prev,
@@ -186,6 +246,7 @@ export function EngineProvider({ children }) {
           ]);
         }
       } else {
+        elapsed = Math.round(performance.now() - startExec);
         // Simulated local fallback run if serverless sandbox isn't attached
         setOutputLogs(prev => [
           ...prev,
@@ -228,14 +289,18 @@ main:
       setExecutionStats({
         executionTimeMs: elapsed,
         memoryUsageKb: Math.round(4200 + Math.random() * 800),
-        exitCode: 0
+        exitCode,
+        profile
       });
     } catch (err) {
+      setLiveOutput('');
       setOutputLogs(prev => [
         ...prev,
+        ...(output ? [output] : []),
         `❌ Execution Error: ${err.message || 'Failed to reach compiler backend'}`
       ]);
     } finally {
+      setRunPhase(null);
       setIsRunning(false);
     }
   };
@@ -252,7 +317,9 @@ main:
         cacheHitRate,
         isBackendConnected,
         isRunning,
+        runPhase,
         outputLogs,
+        liveOutput,
         terminalActiveTab,
         setTerminalActiveTab,
         assemblyOutput,
@@ -1,10 +1,31 @@
+#include <atomic>
 #include <iostream>
 #include <vector>
 #include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
 #include <string>
+#include <thread>
 #include "backend/include/trie.h"
 #include "backend/include/tokenizer.h"
+#include "backend/include/suggestion_batch.h"
 #include "backend/include/suggestion_engine.h"
+#include "backend/include/thread_pool.h"
+#include "backend/include/index_file.h"
+#include "backend/include/code_runner.h"
+#include "backend/include/engine_metrics.h"
+#include "backend/include/compile_cache.h"
+#include "backend/include/pch_cache.h"
+#include "backend/include/response_cache.h"
+#include "backend/include/scope_index.h"
+#include "backend/include/snapshot.h"
+#include "backend/include/subprocess.h"
+#include "backend/include/workspace_index.h"
 
 int main() {
     std::cout << "═══════════════════════════════════════════════════" << std::endl;
@@ -34,7 +55,7 @@ int main() {
     std::cout << "✓ Indexed " << trie.getAllWords().size() << " symbols in " << insert_us << " µs" << std::endl;
 
     // 2. Benchmark Prefix Search ("vec", "pu", "so")
-    std::vector<std::string> test_prefixes = {"vec", "pu", "so", "st", "emp"};
+    std::vector<std::string> test_prefixes = {"vec", "pu", "so", "st", "emp", "s"};
     
     for (const auto& p : test_prefixes) {
         auto t0 = std::chrono::high_resolution_clock::now();
@@ -46,16 +67,965 @@ int main() {
                   << lookup_ns / 1000.0 << " µs (" << lookup_ns << " ns)" << std::endl;
     }
 
+    // Ranked lists are precomputed per node, so the top hit for a one-character
+    // prefix is the highest-frequency symbol in its subtree
+    auto ranked = trie.completions("s");
+    if (ranked.empty() || trie.word(ranked[0]) != "size") {
+        std::cout << "✗ Ranked completions for 's' should start with 'size'" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Top-" << ranked.size() << " ranked completions for 's' start with '"
+              << trie.word(ranked[0]) << "'" << std::endl;
+
     // 3. Test Tokenizer
     codeflow::Tokenizer tokenizer;
     std::string sample_code = "#include <vector>\nusing namespace std;\nint main() { vector<int> my_array; return 0; }";
     auto tokens = tokenizer.tokenize(sample_code);
     std::cout << "✓ Tokenizer parsed " << tokens.size() << " tokens from C++ translation unit" << std::endl;
 
+    std::string tricky = "#define X(a) \\\n  a\nauto s = R\"x(it's \"raw\")x\"; // don't\n/* a\nb */ int n = 1'000;";
+    auto views = tokenizer.scan(tricky);
+    codeflow::Tokenizer scalar;
+    scalar.setSimdLevel(codeflow::SimdLevel::Scalar);
+    auto scalarViews = scalar.scan(tricky);
+    bool sameAsScalar = views.size() == scalarViews.size();
+    for (size_t i = 0; sameAsScalar && i < views.size(); ++i) {
+        sameAsScalar = views[i].offset == scalarViews[i].offset && views[i].length == scalarViews[i].length;
+    }
+    if (views.size() != 13 || views[0].type != codeflow::Token::Type::PREPROCESSOR ||
+        views[4].text(tricky) != "R\"x(it's \"raw\")x\"" || views[6].type != codeflow::Token::Type::COMMENT ||
+        views[11].text(tricky) != "1'000" || !sameAsScalar) {
+        std::cout << "✗ Scanner should keep directives, raw strings and comments whole" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Zero-copy scan handled directives, raw strings and comments" << std::endl;
+
+    codeflow::ExtractedSymbols extracted;
+    codeflow::extractSymbols("#include <map>\nstd::map<int, vector<int>> m; // string s;\n"
+                             "#include <set>\nset<int> t;\n", extracted);
+    if (extracted.includes != std::vector<std::string>{"map", "set"} || extracted.declarations.size() != 2 ||
+        extracted.declarations[0] != std::pair<std::string, std::string>{"m", "map"} ||
+        extracted.declarations[1] != std::pair<std::string, std::string>{"t", "set"}) {
+        std::cout << "✗ Symbol scanner should find <map>, <set> and their declarations only" << std::endl;
+        return 1;
+    }
+    // Digit separators are not character literals, and raw strings end at
+    // their own delimiter
+    extracted = {};
+    codeflow::extractSymbols("#include <set>\nlong big = 1'000;\nset<int> a;\n"
+                             "auto r = R\"(\" vector<int> fake; \")\";\nset<int> real;\n"
+                             "char q = '\\'';\nset<int> last;\n", extracted);
+    std::vector<std::pair<std::string, std::string>> expectedDeclarations = {
+        {"a", "set"}, {"real", "set"}, {"last", "set"}};
+    if (extracted.declarations != expectedDeclarations) {
+        std::cout << "✗ Symbol scanner should skip digit separators and raw strings" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Symbol scanner resolved nested template arguments and skipped comments" << std::endl;
+
     // 4. Test Suggestion Engine
     codeflow::SuggestionEngine engine;
+    engine.loadSTLData(CODEFLOW_DATA_DIR "/stl_functions.json");
+    engine.loadKeywords(CODEFLOW_DATA_DIR "/cpp_keywords.txt");
+    engine.updateSymbols("#include <vector>\nvector<int> v;");
     auto suggestions = engine.getSuggestions("p", "vector", "vector<int> v; v.p", 18, 5);
-    std::cout << "✓ SuggestionEngine initialized and queried" << std::endl;
+    if (suggestions.empty() || suggestions[0].text.rfind("p", 0) != 0) {
+        std::cout << "✗ Expected vector methods starting with 'p'" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ SuggestionEngine initialized and queried (" << suggestions.size()
+              << " vector methods for 'p')" << std::endl;
+
+    // 5. Readers run against published snapshots while the index is rebuilt
+    std::atomic<bool> reloading{true};
+    std::atomic<int> torn{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            while (reloading.load()) {
+                if (engine.getSuggestions("p", "vector", "", 0, 5).size() != suggestions.size())
+                    torn++;
+                if (engine.getSuggestions("wh", "", "", 0, 5).empty())
+                    torn++;
+            }
+        });
+    }
+    for (int i = 0; i < 20; ++i) {
+        engine.loadKeywords(CODEFLOW_DATA_DIR "/cpp_keywords.txt");
+        engine.loadSTLData(CODEFLOW_DATA_DIR "/stl_functions.json");
+        engine.updateSymbols("#include <vector>\nvector<int> v;");
+    }
+    reloading = false;
+    for (auto& reader : readers) reader.join();
+    if (torn > 0) {
+        std::cout << "✗ Readers observed " << torn << " inconsistent results during reload" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Concurrent readers stayed consistent across 20 index reloads" << std::endl;
+
+    // Each instance keeps its own per-thread reference: reading one does not
+    // release what another returned, and a superseded value goes at the next
+    // read of its own instance
+    {
+        codeflow::Snapshot<std::string> first(std::make_shared<const std::string>("first"));
+        codeflow::Snapshot<std::string> second(std::make_shared<const std::string>("second"));
+        const std::string* a = first.read();
+        const std::string* b = second.read();
+        std::weak_ptr<const std::string> superseded = first.acquire();
+        first.publish(std::make_shared<const std::string>("again"));
+        bool separate = *a == "first" && *b == "second" && !superseded.expired();
+        separate &= *first.read() == "again" && superseded.expired() && second.read() == b;
+        if (!separate) {
+            std::cout << "✗ Snapshot reads of one instance should not release another's value" << std::endl;
+            return 1;
+        }
+    }
+
+    // 6. Sessions keep per-document symbols apart and respect the memory budget
+    auto first = engine.openSession();
+    auto second = engine.openSession();
+    engine.updateSession(first, "#include <vector>\nvector<int> v;");
+    engine.updateSession(second, "#include <string>\nstring v;");
+    auto firstHits = engine.getSessionSuggestions(first, "push", "v", "", 0, 5);
+    auto secondHits = engine.getSessionSuggestions(second, "app", "v", "", 0, 5);
+    if (firstHits.empty() || firstHits[0].text != "push_back" || secondHits.empty() ||
+        secondHits[0].text != "append") {
+        std::cout << "✗ Sessions should resolve 'v' to their own types" << std::endl;
+        return 1;
+    }
+
+    // Edits re-index only the touched lines: retype "vector" as "string"
+    std::string doc = "#include <vector>\n#include <string>\nvector<int> w;\n";
+    engine.updateSession(second, doc);
+    engine.editSession(second, {{doc.find("vector<int>"), 11, "string"}});
+    auto edited = engine.getSessionSuggestions(second, "app", "w", "", 0, 5);
+    if (edited.empty() || edited[0].text != "append") {
+        std::cout << "✗ Incremental edit should re-type 'w' as string" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Incremental edit re-indexed the damaged line" << std::endl;
+
+    // Random edits across line blocks, including ones that add, join and
+    // remove lines, leave the same lines and symbols as scanning the result
+    {
+        std::string text = "#include <vector>\n";
+        for (int i = 0; i < 600; ++i)
+            text += (i % 3 ? "vector<int> v" : "set<int> s") + std::to_string(i) + ";\n";
+        codeflow::Document edited, scanned;
+        edited.reset(text);
+        std::mt19937 random(7);
+        const char* inserts[] = {"", "\n", "x", "map<int, int> m9;\n#include <map>\n", "\n\n;"};
+        bool same = true;
+        for (int i = 0; i < 2000 && same; ++i) {
+            const std::string& current = edited.text();
+            std::size_t offset = random() % (current.size() + 1);
+            std::size_t removed = std::min<std::size_t>(random() % (i % 50 == 0 ? 3000 : 12),
+                                                        current.size() - offset);
+            edited.apply({offset, removed, inserts[random() % std::size(inserts)]});
+            scanned.reset(edited.text());
+            auto keys = [](const codeflow::Document& doc) {
+                std::set<std::string> names;
+                for (const auto& entry : doc.symbols().symbolTable)
+                    names.insert(entry.first);
+                return names;
+            };
+            same = edited.lineCount() == scanned.lineCount() && keys(edited) == keys(scanned) &&
+                   edited.symbols().includedLibraries == scanned.symbols().includedLibraries;
+        }
+        if (!same) {
+            std::cout << "✗ Incremental edits should match a full re-scan" << std::endl;
+            return 1;
+        }
+    }
+
+    engine.setSessionMemoryBudget(engine.getSessionStats().bytes - 1);
+    auto stats = engine.getSessionStats();
+    if (stats.liveSessions != 1 || stats.evictions != 1 || engine.hasSession(first)) {
+        std::cout << "✗ Over-budget sessions should be evicted least recently used first" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Sessions isolated; LRU eviction keeps " << stats.liveSessions << " session in "
+              << stats.bytes << " bytes" << std::endl;
+
+    // 7. The precompiled index is mapped, not parsed, and answers like the JSON
+    codeflow::SuggestionEngine mapped;
+    std::string indexError;
+    auto mapStart = std::chrono::high_resolution_clock::now();
+    bool indexLoaded = mapped.loadIndex(CODEFLOW_INDEX_FILE, &indexError);
+    auto mapUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::high_resolution_clock::now() - mapStart).count();
+    mapped.updateSymbols("#include <vector>\nvector<int> v;");
+    auto mappedHits = mapped.getSuggestions("p", "vector", "vector<int> v; v.p", 18, 5);
+    auto mappedKeywords = mapped.getSuggestions("wh", "", "", 0, 5);
+    if (!indexLoaded || mappedHits.size() != suggestions.size() ||
+        mappedHits[0].text != suggestions[0].text || mappedKeywords.empty() ||
+        mappedKeywords[0].text != "while") {
+        std::cout << "✗ Mapped index should answer like the JSON data " << indexError << std::endl;
+        return 1;
+    }
+
+    // Route-shaped records carry the catalogue metadata; headers resolve
+    // through HEADER_TO_CONTAINERS, so <queue> provides priority_queue
+    std::string source = "#include <queue>\n#include <algorithm>\n"
+                         "priority_queue<int> pq;\nint sorted = 0;\n";
+    auto members = mapped.complete("to", "pq", source);
+    auto globals = mapped.complete("sor", "global", source);
+    auto headers = mapped.complete("vec", "include_header", "");
+    if (members.empty() || members[0].text != "top" || members[0].sig.empty() ||
+        members[0].header != "queue" || !mapped.complete("", "pq", "priority_queue<int> pq;").empty() ||
+        globals.size() < 2 || globals[0].text != "sorted" || globals[0].type != "variable" ||
+        globals[1].text != "sort" || globals[1].container != "algorithm" ||
+        headers.empty() || headers[0].text != "vector") {
+        std::cout << "✗ complete() should return catalogue records gated by includes" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ complete() returned '" << members[0].sig << "' ("
+              << members[0].complexity << ") for pq.to" << std::endl;
+
+    // A flipped byte fails the checksum and leaves the loaded index in place
+    std::string corruptPath = CODEFLOW_INDEX_FILE ".corrupt";
+    {
+        std::ifstream in(CODEFLOW_INDEX_FILE, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        bytes[bytes.size() / 2] ^= 0x5a;
+        std::ofstream(corruptPath, std::ios::binary) << bytes;
+    }
+    if (mapped.loadIndex(corruptPath, &indexError) ||
+        mapped.getSuggestions("wh", "", "", 0, 5).empty()) {
+        std::cout << "✗ Corrupt index file should be rejected" << std::endl;
+        return 1;
+    }
+    std::cout << "✓ Mapped precompiled index in " << mapUs << " µs; corrupt copy rejected ("
+              << indexError << ")" << std::endl;
+
+    // Reloading a rewritten file (a new inode each time) unmaps the old copy
+    // once nothing views it, and reuses the ids of the identical string table
+    {
+        std::string reloadPath = CODEFLOW_INDEX_FILE ".reload";
+        auto mapsOf = [&] {
+            std::ifstream maps("/proc/self/maps");
+            int count = 0;
+            for (std::string line; std::getline(maps, line);)
+                count += line.find(reloadPath) != std::string::npos;
+            return count;
+        };
+        codeflow::SuggestionEngine reloaded;
+        std::size_t poolSize = 0;
+        bool reloadsOk = true;
+        for (int i = 0; i < 5; ++i) {
+            std::filesystem::copy_file(CODEFLOW_INDEX_FILE, reloadPath + ".tmp",
+                                       std::filesystem::copy_options::overwrite_existing);
+            std::filesystem::rename(reloadPath + ".tmp", reloadPath);
+            reloadsOk = reloadsOk && reloaded.loadIndex(reloadPath) &&
+                        !reloaded.getSuggestions("wh", "", "", 0, 5).empty();
+            if (i == 0) poolSize = codeflow::SymbolPool::global().size();
+        }
+        int liveMaps = mapsOf();
+        bool poolStable = codeflow::SymbolPool::global().size() == poolSize;
+        std::filesystem::remove(reloadPath);
+        if (!reloadsOk || liveMaps != 1 || !poolStable) {
+            std::cout << "✗ Reloading an index should unmap the old file and reuse its ids ("
+                      << liveMaps << " mappings)" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ 5 index reloads kept one mapping and " << poolSize << " symbols"
+                  << std::endl;
+    }
+
+    // 8. Worker pool: tasks run concurrently off the calling thread; queued
+    // tasks cancel immediately, running ones see their flag
+    {
+        codeflow::ThreadPool pool(2);
+        std::atomic<int> started{0};
+        std::atomic<int> stopped{0};
+        std::atomic<bool> queuedSawCancel{false};
+        auto blocker = [&](const std::atomic<bool>& cancelled) {
+            started++;
+            while (!cancelled.load()) std::this_thread::yield();
+            stopped++;
+        };
+        codeflow::TaskId taskA = pool.submit(blocker);
+        codeflow::TaskId taskB = pool.submit(blocker);
+        codeflow::TaskId queued = pool.submit([&](const std::atomic<bool>& cancelled) {
+            queuedSawCancel = cancelled.load();
+        });
+        while (started.load() < 2) std::this_thread::yield();
+        codeflow::ThreadPoolStats busy = pool.stats();
+
+        bool cancelledQueued = pool.cancel(queued);
+        bool cancelledRunning = pool.cancel(taskA) && pool.cancel(taskB);
+        while (stopped.load() < 2) std::this_thread::yield();
+        std::atomic<bool> ran{false};
+        pool.submit([&](const std::atomic<bool>&) { ran = true; });
+        while (!ran.load()) std::this_thread::yield();
+
+        if (busy.running != 2 || busy.queued != 1 || !cancelledQueued || !queuedSawCancel ||
+            !cancelledRunning || pool.cancel(queued)) {
+            std::cout << "✗ Worker pool should run tasks concurrently and cancel them" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "✓ Worker pool ran 2 tasks concurrently; queued and running tasks cancelled"
+              << std::endl;
+
+    // 9. Batched queries match single queries and pack into one buffer
+    {
+        auto session = mapped.openSession();
+        mapped.updateSession(session, "#include <string>\nstring s;\n");
+        std::string typed = "vector<int> v; v.p";
+        std::vector<codeflow::SuggestionQuery> queries = {
+            {0, "p", "", typed, 18}, {session, "app", "s", "", 0}, {9999, "x", "", "", 0}};
+        codeflow::SuggestionBatch batch;
+        mapped.getSuggestionsBatch(queries, 5, batch);
+        auto single = mapped.getSuggestions("p", "", typed, 18, 5);
+        auto sessionHits = mapped.getSessionSuggestions(session, "app", "s", "", 0, 5);
+
+        codeflow::BatchPacker packer;
+        std::vector<std::uint32_t> packed((packer.plan(batch) + 3) / 4);
+        packer.write(reinterpret_cast<std::uint8_t*>(packed.data()));
+        auto packedText = [&](std::uint32_t record) {
+            const std::uint32_t* r = packed.data() + 4 + packed[1] + record * 4;
+            const char* strings = reinterpret_cast<const char*>(packed.data() + 4 + packed[1] + packed[2] * 4);
+            return std::string_view(strings + r[0], r[3] & 0xffff);
+        };
+        if (batch.ends.size() != 3 || batch.ends[0] != single.size() || single.empty() ||
+            batch.ends[1] - batch.ends[0] != sessionHits.size() || batch.ends[2] != batch.ends[1] ||
+            packed[0] != codeflow::kBatchMagic || packed[1] != 3 || packed[2] != batch.results.size() ||
+            packedText(0) != single[0].text || packedText(batch.ends[0]) != sessionHits[0].text) {
+            std::cout << "✗ Batch should answer each query like a single call" << std::endl;
+            return 1;
+        }
+
+        std::cout << "✓ Batched queries packed; engine + packing cost per query:";
+        for (std::size_t size : {1, 16, 256}) {
+            std::vector<codeflow::SuggestionQuery> many(size, {session, "app", "s", "", 0});
+            const int rounds = 4096 / static_cast<int>(size) + 16;
+            auto t0 = std::chrono::high_resolution_clock::now();
+            for (int round = 0; round < rounds; ++round) {
+                mapped.getSuggestionsBatch(many, 10, batch);
+                packed.resize((packer.plan(batch) + 3) / 4);
+                packer.write(reinterpret_cast<std::uint8_t*>(packed.data()));
+            }
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::high_resolution_clock::now() - t0).count();
+            std::cout << " " << size << " → " << ns / (rounds * size) << " ns";
+        }
+        std::cout << std::endl;
+    }
+
+    // 10. Fuzzy matching: abbreviations, word boundaries, SIMD prefilter
+    {
+        auto fuzzy = mapped.fuzzySearch("pb", 5);
+        auto emb = mapped.fuzzySearch("emb", 5);
+        auto members = mapped.complete("pb", "v", "#include <vector>\nvector<int> v;\n", 20,
+                                       codeflow::MatchMode::Fuzzy);
+        float pushBack = 0, pauseBefore = 0;
+        codeflow::FuzzyPattern("pb").match("push_back", pushBack);
+        codeflow::FuzzyPattern("pb").match("upper_bound", pauseBefore);
+        bool hasPushBack = false, hasPopBack = false;
+        for (const auto& s : members) {
+            hasPushBack |= s.text == "push_back";
+            hasPopBack |= s.text == "pop_back";
+        }
+        if (fuzzy.empty() || fuzzy[0].text.find('_') == std::string_view::npos ||
+            emb.empty() || emb[0].text != "emplace_back" || !hasPushBack || !hasPopBack ||
+            pushBack <= pauseBefore || codeflow::FuzzyPattern("bp").match("push_back", pushBack)) {
+            std::cout << "✗ Fuzzy search should rank word-boundary subsequences first" << std::endl;
+            return 1;
+        }
+
+        codeflow::StlIndex index;
+        codeflow::mapIndexFile(CODEFLOW_INDEX_FILE, index);
+        codeflow::buildFuzzyIndex(index);
+        std::vector<std::uint32_t> simd, scalarHits;
+        bool simdAgrees = index.fuzzy.size() > 100;
+        for (const char* pattern : {"pb", "emb", "x", "zz", "_", "q9"}) {
+            index.fuzzy.filter(codeflow::fuzzyMask(pattern), simd);
+            index.fuzzy.setSimdLevel(codeflow::SimdLevel::Scalar);
+            index.fuzzy.filter(codeflow::fuzzyMask(pattern), scalarHits);
+            index.fuzzy.setSimdLevel(codeflow::SimdLevel::AVX2);
+            simdAgrees = simdAgrees && simd == scalarHits;
+        }
+        if (!simdAgrees) {
+            std::cout << "✗ SIMD prefilter should keep exactly the scalar candidates" << std::endl;
+            return 1;
+        }
+
+        std::vector<codeflow::FuzzyHit> hits;
+        const int rounds = 200;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (int round = 0; round < rounds; ++round)
+            index.fuzzy.search(codeflow::FuzzyPattern("emb"), 20, hits);
+        auto us = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - t0).count() / (rounds * 1000.0);
+        std::cout << "✓ Fuzzy \"emb\" → " << emb[0].text << " over " << index.fuzzy.size()
+                  << " names in " << us << " µs" << std::endl;
+    }
+
+    // 11. Accepted completions are learned, decay, and survive a restart
+    {
+        auto before = mapped.getSuggestions("p", "vector", "vector<int> v; v.p", 18, 10);
+        std::string picked(before.back().text);
+        for (int i = 0; i < 3; ++i) mapped.recordAccepted(picked);
+        auto after = mapped.getSuggestions("p", "vector", "vector<int> v; v.p", 18, 10);
+
+        auto mine = mapped.openSession();
+        auto other = mapped.openSession();
+        mapped.recordAccepted("emplace_back", mine);
+
+        codeflow::UsageCounts counts(16, 100.0);
+        std::vector<std::thread> writers;
+        for (int t = 0; t < 4; ++t) {
+            writers.emplace_back([&] {
+                for (int i = 0; i < 10000; ++i) counts.record("push_back", 1000);
+            });
+        }
+        for (auto& writer : writers) writer.join();
+        float halved = counts.score("push_back", 1100);
+
+        std::string usagePath = "/tmp/codeflow_usage_test.txt";
+        codeflow::SuggestionEngine restarted;
+        restarted.loadIndex(CODEFLOW_INDEX_FILE);
+        bool reloaded = mapped.saveUsage(usagePath) && restarted.loadUsage(usagePath);
+        std::remove(usagePath.c_str());
+
+        if (after.empty() || after[0].text != picked || before[0].text == picked ||
+            mapped.getUsageScore("emplace_back", mine) <= 0.0f ||
+            mapped.getUsageScore("emplace_back", other) != 0.0f ||
+            counts.score("push_back", 1000) != 40000.0f || halved < 19999.0f || halved > 20001.0f ||
+            !reloaded || restarted.getUsageScore(picked) < 2.9f ||
+            restarted.getLearnedSymbolCount() != mapped.getLearnedSymbolCount()) {
+            std::cout << "✗ Accepted completions should be ranked first, decay and reload" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Accepted '" << picked << "' now ranks first; 40000 concurrent bumps"
+                  << " counted, halved after one half-life, reloaded from disk" << std::endl;
+    }
+
+    // 12. Builds are cached by content: programs and compile errors alike
+    {
+        char cacheDir[] = "/tmp/codeflow_cache_test-XXXXXX";
+        if (mkdtemp(cacheDir) == nullptr) {
+            std::cout << "✗ Cannot create a cache directory" << std::endl;
+            return 1;
+        }
+        std::string programPath = std::string(cacheDir) + "-program";
+        std::string diagnostics;
+        using Result = codeflow::CompileCache::Result;
+        codeflow::CompileCache::Inputs broken{"g++ 12", "-O2", "int main( {"};
+        codeflow::CompileCache::Inputs built{"g++ 12", "-O2", "int main() {}"};
+        codeflow::CompileCache::Inputs upgraded{"g++ 13", "-O2", "int main() {}"};
+
+        bool cached;
+        {
+            codeflow::CompileCache cache(cacheDir + std::string("/unit"));
+            Result cold = cache.lookup(broken, programPath, diagnostics);
+            cache.storeDiagnostics(broken, "error: expected ')'");
+            std::ofstream(programPath) << "binary";
+            cache.storeProgram(built, programPath);
+            std::remove(programPath.c_str());
+            cached = cold == Result::Miss &&
+                     cache.lookup(broken, programPath, diagnostics) == Result::Diagnostics &&
+                     diagnostics == "error: expected ')'" &&
+                     cache.lookup(built, programPath, diagnostics) == Result::Program &&
+                     std::ifstream(programPath).good() &&
+                     cache.lookup(upgraded, programPath, diagnostics) == Result::Miss;
+            cache.lookup(built, programPath, diagnostics); // Most recent
+        }
+        // Reopened, the oldest entry (broken) is evicted first
+        codeflow::CompileCache reopened(cacheDir + std::string("/unit"));
+        std::size_t entries = reopened.stats().entries;
+        reopened.setBudget(reopened.stats().bytes - 1);
+        bool evicted = entries == 2 && reopened.stats().entries == 1 &&
+                       reopened.lookup(built, programPath, diagnostics) == Result::Program;
+
+        CodeRunner runner(cacheDir + std::string("/runner"), 64 * 1024 * 1024);
+        std::string hello = "#include <cstdio>\nint main() { std::puts(\"hi\"); }\n";
+        auto start = std::chrono::high_resolution_clock::now();
+        std::string first = runner.runCode(hello);
+        auto mid = std::chrono::high_resolution_clock::now();
+        std::string second = runner.runCode(hello);
+        auto end = std::chrono::high_resolution_clock::now();
+        std::string failed = runner.runCode("int main( {");
+        std::string failedAgain = runner.runCode("int main( {");
+        codeflow::CompileCacheStats stats = runner.getCacheStats();
+
+        std::remove(programPath.c_str());
+        std::filesystem::remove_all(cacheDir);
+
+        auto field = [](const std::string& json, const char* name) {
+            std::size_t at = json.find(std::string("\"") + name + "\":");
+            return at == std::string::npos ? std::string() : json.substr(at, json.find(",\"", at + 1) - at);
+        };
+        if (!cached || !evicted || field(first, "output") != field(second, "output") ||
+            field(failed, "error") != field(failedAgain, "error") ||
+            field(second, "compileCached") != "\"compileCached\":true" ||
+            first.find("\"success\":true") == std::string::npos ||
+            stats.hits != 2 || stats.misses != 2 || stats.entries != 2) {
+            std::cout << "✗ Compile cache should reuse programs and diagnostics" << std::endl;
+            return 1;
+        }
+        auto ms = [](auto from, auto to) {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+        };
+        std::cout << "✓ Compile cache: hit returns the same result ("
+                  << ms(start, mid) << " ms cold, " << ms(mid, end) << " ms cached)" << std::endl;
+    }
+
+    // 13. Submissions starting with a common include set compile against a
+    //     precompiled header, without gaining headers they did not include
+    {
+        auto prefix = codeflow::PchCache::headerPrefix(
+            "// solution\n#include <vector>\n/* io\n */ #include <iostream>\n\n"
+            "using namespace std;\n#include <map>\n");
+        const auto& profiles = codeflow::PchCache::profiles();
+        auto profileOf = [&](const char* code) {
+            int match = codeflow::PchCache::match(code);
+            return match < 0 ? std::string("none") : std::string(profiles[match].name);
+        };
+        bool detected = prefix == std::vector<std::string>{"vector", "iostream"} &&
+                        profileOf("#include <bits/stdc++.h>\n#include <iostream>\n") == "stdcpp" &&
+                        profileOf("#include <iostream>\n#include <vector>\n") == "iostream_vector" &&
+                        profileOf("#include <vector>\n") == "none" &&
+                        profileOf("int x;\n#include <iostream>\n") == "none";
+
+        char pchDir[] = "/tmp/codeflow_pch_test-XXXXXX";
+        if (mkdtemp(pchDir) == nullptr) {
+            std::cout << "✗ Cannot create a PCH directory" << std::endl;
+            return 1;
+        }
+        CodeRunner runner("", 0, pchDir);
+        std::string hello = runner.runCode(
+            "#include <iostream>\nint main() { std::cout << \"pch\" << std::endl; }\n");
+        std::string missing = runner.runCode(
+            "#include <iostream>\nint main() { std::vector<int> v; }\n");
+        codeflow::PchStats stats = runner.getPchStats();
+        std::filesystem::remove_all(pchDir);
+
+        if (!detected || hello.find("\"success\":true") == std::string::npos ||
+            hello.find("pch") == std::string::npos ||
+            missing.find("\"success\":false") == std::string::npos ||
+            stats.compilesWithPch != 2 || stats.profilesReady != 1) {
+            std::cout << "✗ Precompiled headers should match include prefixes and compile" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Precompiled <iostream>: " << stats.medianWithPchMs
+                  << " ms median compile; missing includes still fail" << std::endl;
+    }
+
+    // 14. Processes run without a shell, with limits, separate streams and
+    //     structured results; runs on many threads don't interfere
+    {
+        codeflow::ProcessOptions options;
+        options.environment = codeflow::minimalEnvironment();
+        auto streams = codeflow::runProcess({"sh", "-c", "echo out; echo err >&2; exit 3"}, options);
+        auto missing = codeflow::runProcess({"/nonexistent/codeflow"}, options);
+        // Limits are in place before exec; stdin is empty
+        options.workingDirectory = "/";
+        options.limits.cpuSeconds = 7;
+        auto limited = codeflow::runProcess({"sh", "-c", "ulimit -t; pwd; cat"}, options);
+        options.workingDirectory = "/nonexistent/codeflow";
+        auto nowhere = codeflow::runProcess({"true"}, options);
+        options.workingDirectory.clear();
+        options.limits = {};
+        options.timeout = std::chrono::milliseconds(200);
+        auto slept = codeflow::runProcess({"sleep", "5"}, options);
+        // Closing its output does not take a child past the deadline
+        options.timeout = std::chrono::milliseconds(500);
+        auto closed = codeflow::runProcess({"sh", "-c", "exec >&- 2>&-; sleep 3"}, options);
+        options.timeout = std::chrono::seconds(10);
+        options.limits.cpuSeconds = 1;
+        auto spun = codeflow::runProcess({"sh", "-c", "while :; do :; done"}, options);
+
+        std::vector<std::string> outputs(4);
+        std::vector<std::thread> runs;
+        CodeRunner shared("", 0, "");
+        for (int i = 0; i < 4; ++i) {
+            runs.emplace_back([&, i] {
+                outputs[i] = shared.runCode("#include <cstdio>\nint main() { std::printf(\"run " +
+                                            std::to_string(i) + "\"); }\n");
+            });
+        }
+        for (auto& run : runs) run.join();
+        bool isolated = true;
+        for (int i = 0; i < 4; ++i)
+            isolated &= outputs[i].find("\"output\":\"run " + std::to_string(i) + "\"") != std::string::npos;
+        RunResult aborted = shared.run("#include <cstdlib>\nint main() { std::abort(); }\n");
+
+        if (streams.out != "out\n" || streams.err != "err\n" || streams.exitCode != 3 ||
+            missing.started || missing.error.empty() || limited.out != "7\n/\n" ||
+            nowhere.started || nowhere.error.rfind("chdir: ", 0) != 0 ||
+            !slept.timedOut || slept.signal != SIGKILL || slept.wallMs > 1000 ||
+            !closed.timedOut || closed.signal != SIGKILL || closed.wallMs > 1500 ||
+            spun.signal != SIGXCPU || spun.cpuMs < 900 || !isolated ||
+            aborted.success || aborted.stage != "run" || aborted.signal != SIGABRT) {
+            std::cout << "✗ Processes should report streams, limits and signals" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Spawned without a shell: exit 3, timeout after " << slept.wallMs
+                  << " ms, SIGXCPU after " << spun.cpuMs << " ms CPU, 4 concurrent runs isolated"
+                  << std::endl;
+    }
+
+    // 15. Output streams while the program runs, line by line
+    {
+        using Clock = std::chrono::steady_clock;
+        CodeRunner runner("", 0, "");
+        std::vector<std::pair<double, std::string>> chunks;
+        auto start = Clock::now();
+        RunResult streamed = runner.run(
+            "#include <iostream>\n#include <thread>\nint main() {\n"
+            "  std::cout << \"first\\n\";\n"
+            "  std::this_thread::sleep_for(std::chrono::milliseconds(800));\n"
+            "  std::cout << \"second\\n\";\n}\n",
+            nullptr, [&](int stream, std::string_view data) {
+                if (stream == 1)
+                    chunks.emplace_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count(),
+                                        std::string(data));
+            });
+
+        std::string joined;
+        for (auto& chunk : chunks) joined += chunk.second;
+        double firstByteMs = chunks.empty() ? 0 : chunks.front().first - streamed.compileMs;
+        if (!streamed.success || joined != streamed.output || chunks.size() != 2 ||
+            chunks.front().second != "first\n" || chunks.back().first - chunks.front().first < 700) {
+            std::cout << "✗ Program output should stream as it is printed" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Streamed output: first line " << firstByteMs << " ms after the build, "
+                  << "second " << chunks.back().first - chunks.front().first << " ms later" << std::endl;
+    }
+
+    // 16. Tiered runs: a fast build first, rebuilt with sanitizers only when
+    //     it crashes; the policy can force either build
+    {
+        CodeRunner runner("", 0, "");
+        const std::string busy =
+            "#include <cstdio>\n#include <vector>\nint main() {\n"
+            "  std::vector<long> v(1 << 20);\n  long sum = 0;\n"
+            "  for (int r = 0; r < 50; ++r)\n"
+            "    for (std::size_t i = 0; i < v.size(); ++i) sum += v[i] += i ^ r;\n"
+            "  std::printf(\"%ld\\n\", sum);\n}\n";
+        const std::string segfault = "int main() { int* volatile p = nullptr; return *p; }\n";
+        const std::string overflow =
+            "#include <vector>\nint main() { std::vector<int> v(3); int* d = v.data(); d[5] = 1; }\n";
+
+        RunResult fast = runner.run(busy);
+        RunResult slow = runner.run(busy, nullptr, {}, ExecutionMode::Sanitized);
+        RunResult escalated = runner.run(segfault);
+        RunResult fastOnly = runner.run(segfault, nullptr, {}, ExecutionMode::Fast);
+        RunResult caught = runner.run(overflow, nullptr, {}, ExecutionMode::Sanitized);
+        ExecutionMode parsed = ExecutionMode::Tiered;
+        bool parses = parseExecutionMode("sanitized", parsed) && parsed == ExecutionMode::Sanitized &&
+                      !parseExecutionMode("async", parsed) && parsed == ExecutionMode::Sanitized;
+
+        if (!fast.success || fast.tier != "fast" || fast.escalated ||
+            !slow.success || slow.tier != "sanitized" || slow.output != fast.output ||
+            escalated.tier != "sanitized" || !escalated.escalated || escalated.fastSignal != SIGSEGV ||
+            escalated.error.find("AddressSanitizer") == std::string::npos ||
+            fastOnly.tier != "fast" || fastOnly.escalated || fastOnly.signal != escalated.fastSignal ||
+            caught.success || caught.error.find("heap-buffer-overflow") == std::string::npos ||
+            !parses) {
+            std::cout << "✗ Tiered runs should escalate crashes to a sanitizer build" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Tiered: fast build ran in " << fast.wallMs << " ms (sanitized " << slow.wallMs
+                  << " ms), compiled in " << fast.compileMs << " ms (" << slow.compileMs
+                  << " ms); SIGSEGV escalated to an ASan report" << std::endl;
+    }
+
+    // 17. Every run is profiled: rusage always, hardware counters where
+    //     perf events are permitted
+    {
+        CodeRunner runner("", 0, "");
+        const std::string touches64Mb =
+            "#include <cstdio>\n#include <vector>\nint main() {\n"
+            "  std::vector<char> v(64 << 20);\n  long sum = 0;\n"
+            "  for (int r = 0; r < 4; ++r)\n"
+            "    for (std::size_t i = 0; i < v.size(); i += 64) sum += v[i] += r;\n"
+            "  std::printf(\"%ld\\n\", sum);\n}\n";
+        RunResult ran = runner.run(touches64Mb, nullptr, {}, ExecutionMode::Fast);
+        RunResult broken = runner.run("int main() { return }\n", nullptr, {}, ExecutionMode::Fast);
+        std::string json = runner.runCode(touches64Mb, nullptr, {}, ExecutionMode::Fast);
+
+        const codeflow::CounterValues* counters = ran.profile ? &ran.profile->counters : nullptr;
+        bool countersSane = counters &&
+                            (counters->available() ? counters->instructions.value_or(0) > 0
+                                                   : !counters->unavailable.empty() && !counters->cycles);
+        if (!ran.success || !ran.profile || ran.profile->usage.maxRssKb < 64 * 1024 ||
+            ran.profile->usage.minorFaults == 0 || ran.profile->usage.userMs + ran.profile->usage.systemMs <= 0 ||
+            !countersSane || broken.profile || json.find("\"profile\":{\"wallMs\":") == std::string::npos) {
+            std::cout << "✗ Runs should report rusage and hardware counters" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Profile: " << ran.profile->usage.maxRssKb / 1024 << " MB peak RSS, "
+                  << ran.profile->usage.minorFaults << " minor faults, " << ran.profile->usage.userMs
+                  << " ms user; counters "
+                  << (counters->available() ? std::to_string(*counters->instructions) + " instructions"
+                                            : "unavailable: " + counters->unavailable)
+                  << std::endl;
+    }
+
+    // 18. Stage metrics: HDR buckets within 12.5%, every query counted,
+    //     sampled stages timed, nothing lost across threads
+    {
+        using codeflow::LatencyHistogram;
+        bool bucketsHold = true;
+        for (std::uint64_t ns : {0ull, 7ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull, 1ull << 40}) {
+            std::size_t bucket = LatencyHistogram::bucketOf(ns);
+            std::uint64_t low = bucket == 0 ? 0 : LatencyHistogram::bucketLimit(bucket - 1);
+            std::uint64_t high = LatencyHistogram::bucketLimit(bucket);
+            bucketsHold &= low <= ns && ns < high && (high - low) * 8 <= std::max<std::uint64_t>(low, 8);
+        }
+        LatencyHistogram histogram;
+        for (std::uint64_t ns : {100ull, 127ull, 128ull, 129ull, 5000ull}) {
+            ++histogram.buckets[LatencyHistogram::bucketOf(ns)];
+            ++histogram.count;
+        }
+        bucketsHold &= histogram.countBelow(128) == 2 && histogram.countBelow(256) == 4 &&
+                       histogram.quantileNs(0.5) == 143 && histogram.quantileNs(1.0) >= 5000;
+
+        codeflow::EngineMetrics& metrics = codeflow::EngineMetrics::global();
+        using codeflow::Counter;
+        using codeflow::Stage;
+        metrics.setSampleEvery(1);
+        codeflow::SuggestionEngine engine;
+        engine.updateSymbols("#include <vector>\nvector<int> v;");
+        const std::uint64_t queries = metrics.count(Counter::Queries);
+        const std::uint64_t timed = metrics.histogram(Stage::Query).count;
+        const std::uint64_t lookups = metrics.histogram(Stage::TrieLookup).count;
+        const std::uint64_t reindexes = metrics.histogram(Stage::Reindex).count;
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&] {
+                for (int i = 0; i < 1000; ++i)
+                    engine.getSuggestions("wh", "", "", 0);
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        engine.updateSymbols("#include <map>\nmap<int, int> m;");
+        metrics.setSampleEvery(codeflow::EngineMetrics::kDefaultSampleEvery);
+
+        LatencyHistogram query = metrics.histogram(Stage::Query);
+        if (!bucketsHold || metrics.count(Counter::Queries) - queries != 4000 ||
+            query.count - timed != 4000 || metrics.histogram(Stage::TrieLookup).count - lookups != 4000 ||
+            metrics.histogram(Stage::Reindex).count - reindexes != 1 || query.quantileNs(0.5) == 0 ||
+            query.quantileNs(0.99) < query.quantileNs(0.5)) {
+            std::cout << "✗ Stage metrics should count every query and time every sampled one" << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Metrics: 4000 queries on 4 threads, all timed; query p50 "
+                  << query.quantileNs(0.5) << " ns, p99 " << query.quantileNs(0.99) << " ns" << std::endl;
+    }
+
+    // 19. Response cache: byte budget, TTL, and route bodies shared by
+    //     equivalent queries (same header set, same resolved type)
+    {
+        using codeflow::ResponseCache;
+        const std::size_t entry = ResponseCache::entryBytes(std::string(100, 'x'));
+        ResponseCache cache(ResponseCache::kShards * 2 * entry, std::chrono::minutes(1));
+        // Keys 0, 1, 2 share shard 0, which holds two entries
+        for (std::uint64_t key = 0; key < 3; ++key)
+            cache.put(key, std::make_shared<const std::string>(100, 'a' + key));
+        cache.put(1ull << 63, std::make_shared<const std::string>(10 * entry, 'z'));
+        bool bounded = !cache.get(0) && cache.get(1) && *cache.get(2) == std::string(100, 'c') &&
+                       !cache.get(1ull << 63) && cache.stats().evictions == 1 &&
+                       cache.stats().bytes == 2 * entry;
+        cache.setTtl(std::chrono::milliseconds(0));
+        cache.put(3, std::make_shared<const std::string>("[]"));
+        bounded &= !cache.get(3) && cache.stats().expirations == 1;
+
+        const std::string code = "#include <queue>\n#include <vector>\npriority_queue<int> pq;\n";
+        const std::string same = "#include <vector>\n#include <queue>\n#include <queue>\n"
+                                 "priority_queue<int> other;\n";
+        bool hit = true;
+        auto miss = mapped.completeJson("cpp", "to", "pq", code, 20, codeflow::MatchMode::Prefix, &hit);
+        std::string expected;
+        codeflow::appendRecordsJson(expected, mapped.complete("to", "pq", code));
+        bool missed = !hit;
+        auto again = mapped.completeJson("cpp", "to", "other", same, 20, codeflow::MatchMode::Prefix, &hit);
+        bool shared = hit && again == miss;
+        mapped.completeJson("cpp", "t", "pq", code, 20, codeflow::MatchMode::Prefix, &hit);
+        bool keyed = !hit;
+        mapped.completeJson("cpp", "so", "global", code + "int sorted;\n", 20, codeflow::MatchMode::Prefix, &hit);
+        mapped.completeJson("cpp", "so", "global", code + "int solved;\n", 20, codeflow::MatchMode::Prefix, &hit);
+        keyed &= !hit;
+        mapped.loadIndex(CODEFLOW_INDEX_FILE);
+        mapped.completeJson("cpp", "to", "pq", code, 20, codeflow::MatchMode::Prefix, &hit);
+        keyed &= !hit;
+        // Learned usage changes the ranking, so an acceptance is a miss too
+        mapped.completeJson("cpp", "to", "pq", code, 20, codeflow::MatchMode::Prefix, &hit);
+        keyed &= hit;
+        mapped.recordAccepted("top");
+        mapped.completeJson("cpp", "to", "pq", code, 20, codeflow::MatchMode::Prefix, &hit);
+        keyed &= !hit;
+
+        if (!bounded || !missed || !shared || !keyed || *miss != expected ||
+            miss->rfind("[{\"text\":\"top\",\"display\":\"top()\",\"type\":\"method\"", 0) != 0) {
+            std::cout << "✗ Response cache should bound bytes and age and share equivalent queries' bodies"
+                      << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Response cache: " << miss->size() << "-byte body shared by equivalent queries, "
+                  << ResponseCache::entryBytes("") << " bytes of bookkeeping per entry" << std::endl;
+    }
+
+    // 20. Scope index: names resolve innermost scope first, through
+    //     parameters, range-for variables, auto, members and aliases; the
+    //     route completes a user class's members, and sessions resolve
+    //     "obj." at the cursor
+    {
+        using codeflow::ScopeIndex;
+        const std::string source =
+            "#include <map>\n#include <string>\n#include <vector>\nusing namespace std;\n"
+            "struct Point { double x, y; double norm() const; };\n"
+            "using Path = vector<Point>;\n"
+            "map<string, Path> routes;\n"
+            "int walk(const vector<string>& names, Path path) {\n"
+            "    string routes = names.front();\n"
+            "    for (const auto& p : path) {\n"
+            "        auto copy = p;\n"
+            "        /*A*/\n"
+            "    }\n"
+            "    /*B*/\n"
+            "    return 0;\n"
+            "}\n"
+            "/*C*/\n";
+        ScopeIndex scopes;
+        scopes.build(source);
+        auto at = [&](const char* mark) { return source.find(mark); };
+        auto type = [&](const char* expression, const char* mark) {
+            return std::string(scopes.typeOf(expression, at(mark)).name);
+        };
+        const std::uint32_t point = scopes.typeOf("copy", at("/*A*/")).classScope;
+        const ScopeIndex::Symbol* norm = point == ScopeIndex::kNone ? nullptr : scopes.member(point, "norm");
+        bool resolved = type("routes", "/*A*/") == "string" && type("routes", "/*C*/") == "map" &&
+                        type("names", "/*B*/") == "vector" && type("p", "/*A*/") == "Point" &&
+                        type("copy", "/*A*/") == "Point" && type("copy", "/*B*/").empty() &&
+                        type("path", "/*B*/") == "vector" &&
+                        type("routes[\"a\"].back().x", "/*C*/") == "double" &&
+                        norm && norm->kind == ScopeIndex::SymbolKind::Function &&
+                        scopes.view(norm->type) == "double" && !scopes.lookup("x", at("/*C*/"));
+
+        const auto prefix = codeflow::MatchMode::Prefix;
+        auto members = mapped.complete("", "copy", source, 20, prefix, at("/*A*/"));
+        auto strings = mapped.complete("subs", "routes", source, 20, prefix, at("/*A*/"));
+        bool completed = members.size() == 3 && members[0].text == "norm" &&
+                         members[0].type == "method" && members[0].container == "Point" &&
+                         members[1].text == "x" && members[1].type == "variable" &&
+                         !strings.empty() && strings[0].text == "substr" &&
+                         mapped.complete("", "copy", source, 20, prefix, at("/*B*/")).empty() &&
+                         mapped.complete("", "copy", source).size() == 3;
+
+        const std::string shadowed = "#include <string>\n#include <vector>\n"
+                                     "void f() {\n    vector<int> v;\n    v.\n}\nstring v;\n";
+        codeflow::SessionId session = mapped.openSession();
+        mapped.updateSession(session, shadowed);
+        const int cursor = static_cast<int>(shadowed.find("v.\n") + 2);
+        auto atCursor = mapped.getSessionSuggestions(session, "", "", "", cursor, 5);
+        // An edit leaves the scope index stale; the next lookup rebuilds it
+        mapped.editSession(session, {{shadowed.find("vector<int>"), 11, "string"}});
+        auto afterEdit = mapped.getSessionSuggestions(session, "", "", "", cursor - 5, 5);
+        mapped.closeSession(session);
+        completed &= !atCursor.empty() && atCursor[0].container == "vector" &&
+                     !afterEdit.empty() && afterEdit[0].container == "string";
+
+        codeflow::Document lazy;
+        lazy.reset(shadowed);
+        auto built = lazy.scopes();
+        bool cached = lazy.scopes() == built;
+        lazy.apply({shadowed.find("vector<int>"), 11, "string"});
+        auto rebuilt = lazy.scopes();
+        completed &= cached && rebuilt != built && rebuilt->source() == lazy.text() &&
+                     rebuilt->typeOf("v", static_cast<std::size_t>(cursor - 5)).name == "string";
+
+        if (!resolved || !completed) {
+            std::cout << "✗ Scope index should resolve names through enclosing scopes at the cursor"
+                      << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Scope index: " << scopes.scopes().size() << " scopes, "
+                  << scopes.symbols().size() << " symbols; member completion of a user class"
+                  << std::endl;
+    }
+
+    // 21. Workspace index: sources under the root are indexed (hidden
+    //     directories and other files left out), global and member
+    //     completion see them, and the watcher follows new and deleted files
+    {
+        char root[] = "/tmp/codeflow_workspace_test-XXXXXX";
+        if (mkdtemp(root) == nullptr) {
+            std::cout << "✗ Cannot create a workspace directory" << std::endl;
+            return 1;
+        }
+        const std::string dir = root;
+        std::filesystem::create_directories(dir + "/include");
+        std::filesystem::create_directories(dir + "/src");
+        std::filesystem::create_directories(dir + "/.git");
+        std::ofstream(dir + "/include/shapes.h")
+            << "#pragma once\nstruct Shape { double width, height; double area() const; };\n"
+               "double totalArea(const Shape* shapes, int count);\nextern Shape unitSquare;\n";
+        std::ofstream(dir + "/src/shapes.cpp")
+            << "#include \"shapes.h\"\nShape unitSquare;\n"
+               "double totalArea(const Shape* shapes, int count) { return 0; }\n"
+               "double Shape::area() const { return width * height; }\n";
+        std::ofstream(dir + "/.git/hidden.h") << "int hiddenHelper();\n";
+        std::ofstream(dir + "/notes.txt") << "int notesHelper();\n";
+
+        codeflow::WorkspaceIndex& workspace = mapped.workspaceIndex();
+        std::string error;
+        const bool opened = workspace.open(dir, 2, &error);
+        const codeflow::WorkspaceStats indexed = workspace.stats();
+
+        const std::string code = "#include \"shapes.h\"\n";
+        const auto prefix = codeflow::MatchMode::Prefix;
+        auto functions = mapped.complete("tot", "global", code);
+        auto members = mapped.complete("", "unitSquare", code);
+        auto shadowed = mapped.complete("tot", "global", code + "int totalArea;\n");
+        bool completed = opened && indexed.files == 2 && functions.size() == 1 &&
+                         functions[0].text == "totalArea" && functions[0].type == "function" &&
+                         functions[0].header == "include/shapes.h" &&
+                         members.size() == 3 && members[0].text == "area" &&
+                         members[0].container == "Shape" &&
+                         shadowed.size() == 1 && shadowed[0].header.empty() &&
+                         mapped.complete("hidden", "global", code).empty() &&
+                         mapped.complete("notes", "global", code).empty();
+
+        // Until it shows up (or goes away): the watcher settles bursts first
+        auto waitFor = [&](bool present) {
+            for (int i = 0; i < 200; ++i) {
+                if (mapped.complete("extra", "global", code).empty() != present)
+                    return true;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            return false;
+        };
+        bool hit = true;
+        auto before = mapped.completeJson("cpp", "extra", "global", code, 20, prefix, &hit);
+        const bool watching = workspace.watch(&error);
+        std::ofstream(dir + "/src/extra.cpp") << "int extraCount(int n) { return n; }\n";
+        const bool added = waitFor(true);
+        auto after = mapped.completeJson("cpp", "extra", "global", code, 20, prefix, &hit);
+        std::filesystem::remove(dir + "/src/extra.cpp");
+        const bool removed = waitFor(false);
+        const codeflow::WorkspaceStats updated = workspace.stats();
+        workspace.close();
+        std::filesystem::remove_all(dir);
+
+        bool followed = watching && added && removed && *before == "[]" && !hit &&
+                        after->find("\"text\":\"extraCount\"") != std::string::npos &&
+                        updated.watching && updated.updates > 0 && updated.files == 2;
+        if (!completed || !followed) {
+            std::cout << "✗ Workspace index should complete other files' symbols and follow changes"
+                      << (error.empty() ? "" : ": " + error) << std::endl;
+            return 1;
+        }
+        std::cout << "✓ Workspace: " << indexed.files << " files, " << indexed.symbols
+                  << " symbols indexed at " << indexed.filesPerSecond << " files/s; "
+                  << "new and deleted files followed by the watcher" << std::endl;
+    }
 
     std::cout << "═══════════════════════════════════════════════════" << std::endl;
     std::cout << "🎯 ALL NATIVE C++20 BENCHMARKS PASSED (SUB-MICROSECOND LATENCY)" << std::endl;